@@ -0,0 +1,133 @@
+// MessagePack decoder for the Time Tracker webhook (n8n Code node)
+// Used when WEBHOOK_PAYLOAD_FORMAT in config.h is PAYLOAD_FORMAT_MSGPACK.
+// Turns the compact payload back into rfid_events rows, one n8n item per event.
+// Sessions (SESSION_MODE) come out as rfid_sessions rows with event_type 'session'.
+// Devices with several readers (NFC_READER_COUNT > 1) add reader_index to every row.
+//
+// Webhook node: set "Binary Property" to "data" and enable "Raw Body".
+// Code node: mode "Run Once for All Items", paste this file.
+
+const TAG_TYPES = ['Unknown', 'Mifare Classic (4-byte)', 'ISO14443-4 (7-byte)'];
+const NO_NETWORK = 255;
+
+function decodeMsgPack(bytes) {
+  let pos = 0;
+  const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+
+  function str(length) {
+    const text = Buffer.from(bytes.subarray(pos, pos + length)).toString('utf8');
+    pos += length;
+    return text;
+  }
+  function bin(length) {
+    const data = bytes.subarray(pos, pos + length);
+    pos += length;
+    return data;
+  }
+  function array(count) {
+    const items = [];
+    for (let i = 0; i < count; i++) items.push(next());
+    return items;
+  }
+  function map(count) {
+    const object = {};
+    for (let i = 0; i < count; i++) {
+      const key = next();
+      object[key] = next();
+    }
+    return object;
+  }
+  function next() {
+    const type = bytes[pos++];
+    if (type < 0x80) return type;
+    if (type >= 0xe0) return type - 0x100;
+    if ((type & 0xf0) === 0x80) return map(type & 0x0f);
+    if ((type & 0xf0) === 0x90) return array(type & 0x0f);
+    if ((type & 0xe0) === 0xa0) return str(type & 0x1f);
+
+    let value;
+    switch (type) {
+      case 0xc0: return null;
+      case 0xc2: return false;
+      case 0xc3: return true;
+      case 0xc4: return bin(bytes[pos++]);
+      case 0xcc: value = view.getUint8(pos); pos += 1; return value;
+      case 0xcd: value = view.getUint16(pos); pos += 2; return value;
+      case 0xce: value = view.getUint32(pos); pos += 4; return value;
+      case 0xcf: value = Number(view.getBigUint64(pos)); pos += 8; return value;
+      case 0xd0: value = view.getInt8(pos); pos += 1; return value;
+      case 0xd1: value = view.getInt16(pos); pos += 2; return value;
+      case 0xd2: value = view.getInt32(pos); pos += 4; return value;
+      case 0xd3: value = Number(view.getBigInt64(pos)); pos += 8; return value;
+      case 0xd9: return str(bytes[pos++]);
+      case 0xdc: value = view.getUint16(pos); pos += 2; return array(value);
+      case 0xde: value = view.getUint16(pos); pos += 2; return map(value);
+      default: throw new Error(`Unsupported MessagePack type 0x${type.toString(16)}`);
+    }
+  }
+
+  return next();
+}
+
+// Same branches as timeStatusText() in src/poll_event.cpp
+function timeStatusText(epochMs, network, timeSynced) {
+  if (timeSynced) return 'Synced with NTP';
+  if (epochMs !== 0) return 'Corrected after NTP sync';
+  return network === NO_NETWORK ? 'Not synced (No WiFi)' : 'Not synced';
+}
+
+// Rebuilds the same column values the JSON payload carries
+function toRow(event, deviceId) {
+  const [eventType, uid, tagType, epochMs, rssi, network, timeSynced] = event;
+  const [durationMs, endEstimated] = eventType === 2 ? event.slice(7, 9) : [];
+  const readerIndex = event[eventType === 2 ? 9 : 7];  // Only sent by devices with several readers
+  const tagId = Array.from(uid, (b) => b.toString(16).padStart(2, '0')).join(' ');
+  if (eventType === 2) {
+    // Unsynced sessions have no device time; assume they just ended
+    const start = epochMs > 0 ? epochMs : Date.now() - durationMs;
+    return {
+      timestamp: new Date(start).toISOString(),
+      event_type: 'session',
+      session_end: new Date(start + durationMs).toISOString(),
+      duration_ms: durationMs,
+      end_estimated: endEstimated,
+      tag_id: tagId,
+      tag_type: TAG_TYPES[tagType] || 'Unknown',
+      device_id: deviceId,
+    };
+  }
+
+  const present = eventType === 1;
+  const row = {
+    // Unsynced events have no device time; fall back to the time they were received
+    timestamp: new Date(epochMs > 0 ? epochMs : Date.now()).toISOString(),
+    event_type: present ? 'tag_insert' : 'tag_removed',
+    tag_present: present,
+    tag_id: tagId,
+    device_id: deviceId,
+  };
+  if (readerIndex !== undefined) {
+    row.reader_index = readerIndex;
+  }
+  if (present) {
+    // SSID names stay on the device; the payload only carries the WIFI_NETWORKS index
+    row.tag_type = TAG_TYPES[tagType] || 'Unknown';
+    row.wifi_status = network === NO_NETWORK ? 'Disconnected' : `Connected to network ${network} (${rssi} dBm)`;
+    row.time_status = timeStatusText(epochMs, network, timeSynced);
+  }
+  return row;
+}
+
+const rows = [];
+const items = $input.all();
+for (let i = 0; i < items.length; i++) {
+  const body = await this.helpers.getBinaryDataBuffer(i, 'data');
+  const payload = decodeMsgPack(new Uint8Array(body));
+  if (payload.v < 1 || payload.v > 3) {
+    throw new Error(`Unsupported payload version ${payload.v}`);
+  }
+  for (const event of payload.events) {
+    rows.push({ json: toRow(event, payload.device_id) });
+  }
+}
+return rows;
@@ -12,6 +12,7 @@ CREATE TABLE rfid_events (
     wifi_status TEXT,
     time_status TEXT,
     device_id TEXT,
+    reader_index SMALLINT NOT NULL DEFAULT 0,  -- Antenna of the device (NFC_READER_COUNT > 1), else 0
     created_at TIMESTAMPTZ DEFAULT NOW(),
     updated_at TIMESTAMPTZ DEFAULT NOW()
 );
@@ -52,6 +53,51 @@ CREATE TRIGGER update_rfid_events_updated_at
     FOR EACH ROW
     EXECUTE FUNCTION update_updated_at_column();
 
+-- Bulk insert for batched webhook payloads (rfid_poll_results array)
+-- Inserts the whole array in one statement and returns the number of rows
+CREATE OR REPLACE FUNCTION insert_rfid_events(events JSONB)
+RETURNS INTEGER AS $$
+DECLARE
+    inserted INTEGER;
+BEGIN
+    INSERT INTO rfid_events (
+        timestamp,
+        event_type,
+        tag_present,
+        tag_id,
+        tag_type,
+        wifi_status,
+        time_status,
+        device_id,
+        reader_index
+    )
+    SELECT
+        COALESCE(e."timestamp", NOW()),  -- null when the device never synced its clock
+        e.event_type,
+        e.tag_present,
+        e.tag_id,
+        e.tag_type,
+        e.wifi_status,
+        e.time_status,
+        e.device_id,
+        COALESCE(e.reader_index, 0)      -- only sent by devices with several readers
+    FROM jsonb_to_recordset(events) AS e(
+        "timestamp" TIMESTAMPTZ,
+        event_type TEXT,
+        tag_present BOOLEAN,
+        tag_id TEXT,
+        tag_type TEXT,
+        wifi_status TEXT,
+        time_status TEXT,
+        device_id TEXT,
+        reader_index SMALLINT
+    );
+
+    GET DIAGNOSTICS inserted = ROW_COUNT;
+    RETURN inserted;
+END;
+$$ LANGUAGE plpgsql;
+
 -- Example insert that would work with our webhook payload
 INSERT INTO rfid_events (
     timestamp,
@@ -63,7 +109,7 @@ INSERT INTO rfid_events (
     time_status,
     device_id
 ) VALUES (
-    '2024-02-24 12:53:04+01',  -- From payload timestamp
+    '2024-02-24T12:53:04.123+01:00',  -- From payload timestamp (ISO-8601, detection time)
     'tag_insert',              -- From payload event_type
     true,                      -- From payload tag_present
     'dd 54 2a 83',            -- From payload tag_id
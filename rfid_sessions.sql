@@ -0,0 +1,118 @@
+-- RFID Sessions Table for Time Tracker Project
+-- This table stores completed work sessions, sent by devices with SESSION_MODE enabled
+-- (one row per insert/removal pair, paired on the device)
+-- Run after tag_assignments.sql and device_assignments.sql: it reuses their trigger functions
+
+-- Create rfid_sessions table
+CREATE TABLE rfid_sessions (
+    id BIGINT GENERATED BY DEFAULT AS IDENTITY PRIMARY KEY,
+    started_at TIMESTAMPTZ NOT NULL,
+    ended_at TIMESTAMPTZ NOT NULL,
+    duration_ms BIGINT NOT NULL CHECK (duration_ms >= 0),
+    end_estimated BOOLEAN NOT NULL DEFAULT false,  -- Device rebooted during the session, ended_at is its last checkpoint
+    tag_id TEXT NOT NULL,
+    tag_type TEXT,
+    device_id TEXT,
+    created_at TIMESTAMPTZ DEFAULT NOW()
+);
+
+-- Create indexes
+CREATE INDEX idx_rfid_sessions_started_at ON rfid_sessions(started_at);
+CREATE INDEX idx_rfid_sessions_tag_id ON rfid_sessions(tag_id);
+CREATE INDEX idx_rfid_sessions_device_id ON rfid_sessions(device_id);
+
+-- Enable Row Level Security (RLS)
+ALTER TABLE rfid_sessions ENABLE ROW LEVEL SECURITY;
+
+-- Create policy to allow inserts from webhook
+CREATE POLICY "Enable insert for webhooks" ON rfid_sessions
+    FOR INSERT
+    TO authenticated
+    WITH CHECK (true);
+
+-- Create policy to allow read access
+CREATE POLICY "Enable read access for authenticated users" ON rfid_sessions
+    FOR SELECT
+    TO authenticated
+    USING (true);
+
+-- New tags and devices seen in sessions are added like those seen in rfid_events
+CREATE TRIGGER detect_new_session_tag
+AFTER INSERT ON rfid_sessions
+FOR EACH ROW
+EXECUTE FUNCTION insert_new_tag();
+
+CREATE TRIGGER detect_new_session_device
+AFTER INSERT ON rfid_sessions
+FOR EACH ROW
+EXECUTE FUNCTION insert_new_device();
+
+-- Bulk insert for session payloads (event_type 'session'), one object or a batch array
+-- Returns the number of rows
+CREATE OR REPLACE FUNCTION insert_rfid_sessions(sessions JSONB)
+RETURNS INTEGER AS $$
+DECLARE
+    inserted INTEGER;
+BEGIN
+    IF jsonb_typeof(sessions) = 'object' THEN
+        sessions := jsonb_build_array(sessions);
+    END IF;
+
+    INSERT INTO rfid_sessions (
+        started_at,
+        ended_at,
+        duration_ms,
+        end_estimated,
+        tag_id,
+        tag_type,
+        device_id
+    )
+    SELECT
+        -- null when the device never synced its clock: assume the session just ended
+        COALESCE(s."timestamp", NOW() - s.duration_ms * INTERVAL '1 millisecond'),
+        COALESCE(s.session_end, NOW()),
+        s.duration_ms,
+        COALESCE(s.end_estimated, false),
+        s.tag_id,
+        s.tag_type,
+        s.device_id
+    FROM jsonb_to_recordset(sessions) AS s(
+        "timestamp" TIMESTAMPTZ,
+        event_type TEXT,
+        session_end TIMESTAMPTZ,
+        duration_ms BIGINT,
+        end_estimated BOOLEAN,
+        tag_id TEXT,
+        tag_type TEXT,
+        device_id TEXT
+    )
+    WHERE s.event_type = 'session';
+
+    GET DIAGNOSTICS inserted = ROW_COUNT;
+    RETURN inserted;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Time per project and task: a plain aggregate, no pairing of insert/removal rows needed
+CREATE OR REPLACE VIEW project_time AS
+SELECT
+    t.project_name,
+    t.task_name,
+    date_trunc('day', s.started_at) AS day,
+    COUNT(*) AS sessions,
+    SUM(s.duration_ms) * INTERVAL '1 millisecond' AS time_spent
+FROM rfid_sessions s
+LEFT JOIN tag_assignments t ON t.tag_id = s.tag_id
+GROUP BY t.project_name, t.task_name, date_trunc('day', s.started_at);
+
+-- Example insert that would work with a session payload
+SELECT insert_rfid_sessions('{
+    "timestamp": "2024-02-24T12:53:04.123+01:00",
+    "event_type": "session",
+    "session_end": "2024-02-24T14:08:10.456+01:00",
+    "duration_ms": 4506333,
+    "end_estimated": false,
+    "tag_id": "dd 54 2a 83",
+    "tag_type": "Mifare Classic (4-byte)",
+    "device_id": "NFC_ABC123"
+}');
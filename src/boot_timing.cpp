@@ -0,0 +1,45 @@
+#include "boot_timing.h"
+#include "config.h"
+#include "logger.h"
+
+static volatile unsigned long bootPhaseTimes[BOOT_PHASE_COUNT];
+
+static const char* const bootPhaseNames[BOOT_PHASE_COUNT] = {
+    "Serial ready",
+    "RFID ready",
+    "Setup done",
+    "WiFi connected",
+    "Time synced",
+    "First event",
+    "First delivery"
+};
+
+void markBootPhase(BootPhase phase) {
+    if (phase >= BOOT_PHASE_COUNT || bootPhaseTimes[phase] != 0) {
+        return;
+    }
+    unsigned long now = millis();
+    bootPhaseTimes[phase] = now != 0 ? now : 1;  // 0 means "not reached"
+    
+    LOG_INFO("Boot: %s at %lu ms", bootPhaseNames[phase], now);
+    if (phase == BOOT_PHASE_FIRST_DELIVERY) {
+        printBootTiming();
+    }
+}
+
+unsigned long getBootPhaseTime(BootPhase phase) {
+    return phase < BOOT_PHASE_COUNT ? bootPhaseTimes[phase] : 0;
+}
+
+void printBootTiming() {
+    DEBUG_SERIAL.println("\n--- Boot Timing ---");
+    DEBUG_SERIAL.printf("Build: %s %s\n", __DATE__, __TIME__);
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (bootPhaseTimes[i] != 0) {
+            DEBUG_SERIAL.printf("%-16s %6lu ms\n", bootPhaseNames[i], bootPhaseTimes[i]);
+        } else {
+            DEBUG_SERIAL.printf("%-16s      -\n", bootPhaseNames[i]);
+        }
+    }
+    DEBUG_SERIAL.println("--- End Boot Timing ---\n");
+}
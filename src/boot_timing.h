@@ -0,0 +1,26 @@
+#ifndef BOOT_TIMING_H
+#define BOOT_TIMING_H
+
+#include <Arduino.h>
+
+// Boot milestones, in the order they normally happen
+enum BootPhase {
+    BOOT_PHASE_SERIAL,          // Debug serial up
+    BOOT_PHASE_RFID_READY,      // PN532 found and configured
+    BOOT_PHASE_SETUP_DONE,      // setup() finished, tag polling starts
+    BOOT_PHASE_WIFI_CONNECTED,  // First link up (cached or scanned)
+    BOOT_PHASE_TIME_SYNCED,     // First NTP sync
+    BOOT_PHASE_FIRST_EVENT,     // First tag event queued
+    BOOT_PHASE_FIRST_DELIVERY,  // First event accepted by the webhook
+    BOOT_PHASE_COUNT
+};
+
+/**
+ * Records millis() the first time each phase is reached, so time-to-first-event
+ * can be compared across firmware versions. Safe to call from any task.
+ */
+void markBootPhase(BootPhase phase);
+unsigned long getBootPhaseTime(BootPhase phase);  // 0 if not reached yet
+void printBootTiming();
+
+#endif // BOOT_TIMING_H
@@ -0,0 +1,75 @@
+#include "circuit_breaker.h"
+
+CircuitBreaker::CircuitBreaker()
+    : state(BREAKER_CLOSED), consecutiveFailures(0), openedAt(0), cooldown(BREAKER_COOLDOWN),
+      openCount(0), rejectedCount(0) {
+}
+
+bool CircuitBreaker::allowRequest(unsigned long now) {
+    switch (state) {
+        case BREAKER_CLOSED:
+            return true;
+        case BREAKER_OPEN:
+            if (now - openedAt >= cooldown) {
+                state = BREAKER_HALF_OPEN;
+                return true;
+            }
+            rejectedCount++;
+            return false;
+        case BREAKER_HALF_OPEN:
+        default:
+            // Only the sender task posts, so the probe has finished before the next request
+            return true;
+    }
+}
+
+void CircuitBreaker::onSuccess() {
+    state = BREAKER_CLOSED;
+    consecutiveFailures = 0;
+    cooldown = BREAKER_COOLDOWN;
+}
+
+void CircuitBreaker::onFailure(unsigned long now) {
+    consecutiveFailures++;
+
+    if (state == BREAKER_HALF_OPEN) {
+        // Probe failed: stay away longer next time
+        cooldown = constrain(cooldown * 2, (unsigned long)BREAKER_COOLDOWN, (unsigned long)BREAKER_MAX_COOLDOWN);
+    } else if (state != BREAKER_CLOSED || consecutiveFailures < BREAKER_FAILURE_THRESHOLD) {
+        return;
+    }
+
+    state = BREAKER_OPEN;
+    openedAt = now;
+    openCount++;
+}
+
+void CircuitBreaker::expireCooldown() {
+    if (state == BREAKER_OPEN) {
+        state = BREAKER_HALF_OPEN;
+    }
+}
+
+const char* CircuitBreaker::getStateName() const {
+    static const char* stateNames[] = { "Closed", "Open", "Half-open" };
+    return stateNames[state];
+}
+
+unsigned long CircuitBreaker::timeUntilProbe(unsigned long now) const {
+    if (state != BREAKER_OPEN) {
+        return 0;
+    }
+    unsigned long elapsed = now - openedAt;
+    return elapsed >= cooldown ? 0 : cooldown - elapsed;
+}
+
+unsigned long retryBackoffDelay(uint32_t attempt) {
+    unsigned long delay = WEBHOOK_RETRY_BASE_DELAY;
+    while (attempt-- > 1 && delay < WEBHOOK_RETRY_MAX_DELAY) {
+        delay *= 2;
+    }
+    delay = min(delay, (unsigned long)WEBHOOK_RETRY_MAX_DELAY);
+
+    // Equal jitter: somewhere in [delay / 2, delay]
+    return delay / 2 + random(delay / 2 + 1);
+}
@@ -0,0 +1,55 @@
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+enum BreakerState : uint8_t {
+    BREAKER_CLOSED,     // Requests go through
+    BREAKER_OPEN,       // Requests fail immediately until the cooldown has passed
+    BREAKER_HALF_OPEN   // One probe request is allowed to test for recovery
+};
+
+/**
+ * Circuit breaker for one webhook endpoint. After BREAKER_FAILURE_THRESHOLD
+ * consecutive failures it opens, so further sends fail without touching the
+ * network. Once the cooldown has passed one probe is let through: success
+ * closes the circuit, failure reopens it with a doubled cooldown.
+ * Pure timing logic, no network access.
+ */
+class CircuitBreaker {
+    private:
+        BreakerState state;
+        uint32_t consecutiveFailures;
+        unsigned long openedAt;
+        unsigned long cooldown;     // Current cooldown, grows with every failed probe
+
+        // Statistics
+        uint32_t openCount;
+        uint32_t rejectedCount;     // Requests refused while open
+
+    public:
+        CircuitBreaker();
+
+        bool allowRequest(unsigned long now);  // Moves OPEN to HALF_OPEN once the cooldown is over
+        void onSuccess();
+        void onFailure(unsigned long now);
+        void expireCooldown();  // Probe on the next request, e.g. after WiFi came back
+
+        // Status and info
+        BreakerState getState() const { return state; }
+        const char* getStateName() const;
+        unsigned long timeUntilProbe(unsigned long now) const;  // 0 unless open
+        uint32_t getConsecutiveFailures() const { return consecutiveFailures; }
+        uint32_t getOpenCount() const { return openCount; }
+        uint32_t getRejectedCount() const { return rejectedCount; }
+};
+
+/**
+ * Delay before retry number attempt (1 = first retry): exponential from
+ * WEBHOOK_RETRY_BASE_DELAY, capped at WEBHOOK_RETRY_MAX_DELAY, with the upper
+ * half randomized so many devices do not retry in lockstep after an outage.
+ */
+unsigned long retryBackoffDelay(uint32_t attempt);
+
+#endif // CIRCUIT_BREAKER_H
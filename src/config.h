@@ -8,21 +8,61 @@
 // PN532 NFC Module I2C Pins
 #define PN532_SDA 1
 #define PN532_SCL 0
+#define PN532_IRQ -1   // GPIO wired to PN532 IRQ, -1 = not wired (blocking poll mode)
+#define PN532_RESET -1 // GPIO wired to PN532 RSTO, -1 = not wired
+
+// Reader Pool (several PN532 on one controller, behind a TCA9548A I2C multiplexer)
+// NFC_READER_COUNT and NFC_MAX_TARGETS can also come from build_flags (env:native_pool)
+#ifndef NFC_READER_COUNT
+#define NFC_READER_COUNT 1              // PN532 readers; more than 1 needs the mux and polling mode (PN532_IRQ -1)
+#endif
+#define NFC_I2C_MUX_ADDRESS 0x70        // TCA9548A address with A0-A2 low
+#define NFC_READER_MUX_CHANNELS { 0, 1, 2, 3, 4, 5, 6, 7 }  // Mux channel of reader 0, 1, ...
+#define NFC_READER_PRIORITIES { 0, 0, 0, 0, 0, 0, 0, 0 }    // Higher goes first when several readers are due
+#ifndef NFC_MAX_TARGETS
+#define NFC_MAX_TARGETS 1               // Cards read per full poll (InListPassiveTarget MaxTg, 1 or 2)
+#endif
+#define NFC_INIT_RETRY_INTERVAL 10000   // ms between attempts to bring up readers that did not answer
+
+// PN532 IRQ Mode Timing (ms, only used when PN532_IRQ is wired)
+#define NFC_REARM_INTERVAL 200    // Delay before re-checking a tag that is still present
+#define NFC_ABSENT_TIMEOUT 300    // No IRQ within this time means the tag was removed
+
+// Adaptive Poll Scheduler (ms, polling mode without IRQ)
+#define POLL_PRESENT_INTERVAL 250       // Presence re-check rate while a known tag is on the reader
+#define POLL_FAST_INTERVAL 150          // Idle poll rate right after a removal
+#define POLL_FAST_PERIOD 30000          // How long to keep polling fast after a removal
+#define POLL_BACKOFF_STEP 60000         // Idle time after which the interval doubles again
+#define POLL_IDLE_MAX_INTERVAL 1000     // Slowest idle poll rate
+#define NFC_ACTIVATION_RETRIES 2        // PN532 passive activation retries per full poll (0xFF = forever)
+
+// Low-Power Mode (duty cycling between polls)
+// Light sleep is automatic (ESP-IDF power management) and needs an sdkconfig with CONFIG_PM_ENABLE and
+// CONFIG_FREERTOS_USE_TICKLESS_IDLE; without them only the PN532s and the WiFi modem sleep.
+// WiFi stays associated, but the USB-CDC console drops out while the chip sleeps.
+#define LOW_POWER_MODE 0                // 1 = PN532 PowerDown and automatic ESP32 light sleep between polls
+#define LOW_POWER_CPU_MHZ 80            // CPU clock in low-power mode (80 is the minimum for WiFi)
+#define LOW_POWER_MIN_SLEEP 20          // ms, shorter gaps between polls are spent awake
+#define LOW_POWER_MAX_SLEEP 1000        // ms, longest single idle wait with light sleep allowed
+#define POWER_REPORT_INTERVAL 600000    // ms between power status reports in low-power mode
 
 // Time Configuration
 #define NTP_SERVER "pool.ntp.org"
-#define GMT_OFFSET_SEC 3600  // UTC+1 Brussels
-#define DAYLIGHT_OFFSET_SEC 3600
+#define TIME_ZONE "CET-1CEST,M3.5.0,M10.5.0/3"  // POSIX TZ rule: Brussels, DST last Sunday of March to October
+#define NTP_SYNC_INTERVAL 3600000               // ms between background resyncs (1 hour)
 
 // Device Configuration
 #define DEVICE_NAME "M5STAMP_C3U"  // Default name if not overridden
 #define SERIAL_BAUD 115200
+#define BOOT_SERIAL_WAIT 0         // ms to wait for the USB serial monitor at boot (0 = don't wait)
 
 // LED Colors (RGB format)
 #define COLOR_WIFI_CONNECTING 0x0000FF  // Blue
 #define COLOR_WIFI_CONNECTED 0x0000FF   // Solid Blue
 #define COLOR_TAG_PRESENT 0x00FF00      // Green
+#define COLOR_TAG_UNASSIGNED 0xFFA000   // Amber: tag not assigned to a project (TAG_CACHE_ENABLED)
 #define COLOR_ERROR 0xFF0000            // Red
+#define COLOR_TIME_SYNC 0xFF00FF        // Purple: brief flash on every NTP sync
 #define LED_BRIGHTNESS 10               // 0-255 (default: 10)
 
 // LED Timing (ms)
@@ -30,13 +70,105 @@
 #define LED_FAST_BLINK_INTERVAL 200     // 0.2 seconds
 #define LED_ERROR_BLINK_INTERVAL 200    // 0.2 seconds
 #define LED_ERROR_SEQUENCE_PAUSE 1000   // 1 second pause between error sequences
+#define LED_SYNC_FLASH_DURATION 200     // 0.2 seconds
+#define LED_TASK_STACK_SIZE 2048        // bytes
+#define LED_TASK_PRIORITY 0             // Below the loop task; a late blink is harmless
 
 // Timing Configuration
 #define WIFI_TIMEOUT 10000        // ms to wait for WiFi connection
+#define WIFI_SCAN_TIMEOUT 10000   // ms before an unfinished network scan is abandoned
+#define WIFI_RETRY_INTERVAL 30000 // ms to wait after all networks failed before scanning again
+#define WIFI_FAST_CONNECT_TIMEOUT 3000 // ms for a direct connect to the cached access point before scanning
+#define WIFI_FAST_CONNECT_STATIC_IP 1  // Reuse the cached DHCP lease as a static IP (0 = always use DHCP)
+#define WIFI_STATIC_IP_MAX_AGE 43200000 // ms after DHCP handed out the cached address that it may be reused (keep below the lease time)
 #define BUTTON_DEBOUNCE_TIME 200  // ms
 #define HTTP_TIMEOUT 5000         // ms
+#define DNS_CACHE_TTL 300000      // ms to reuse a resolved webhook host IP (5 minutes)
+
+// Presence Filter (debounces flapping reads into clean insert/removal events)
+#define PRESENCE_WINDOW 4               // M: a pending change is dropped after more than M - N contrary polls
+#define PRESENCE_CONFIRM 3              // N: polls that must see a change (an uncontested removal only needs its hold)
+#define PRESENCE_INSERT_HOLD 0          // ms a new tag must stay before tag_insert is sent
+#define PRESENCE_REMOVE_HOLD 750        // ms a tag must stay away before tag_removed is sent
+#define PRESENCE_REINSERT_GRACE 2000    // ms in which the same tag coming back cancels its removal (0 = off)
+
+// Session Mode (one record per completed session instead of tag_insert/tag_removed pairs)
+#define SESSION_MODE 0                  // 1 = send sessions, 0 = send every insert and removal
+#define SESSION_CHECKPOINT_INTERVAL 300000 // ms between flash checkpoints of the open session
+#define SESSION_CHECKPOINT_DELAY 10000  // ms a new or resumed session runs before its first checkpoint (0 = next loop)
+#define SESSION_RESUME_WINDOW 10000     // ms after boot for the tag of a checkpointed session to resume it
+
+// Tag Assignment Cache (tag_assignments copied to flash, delta synced through the webhook)
+#define TAG_CACHE_ENABLED 0             // 1 = needs the assignment sync branch in n8n, see sql_scripts.md
+#define TAG_CACHE_SYNC_INTERVAL 600000  // ms between delta syncs (10 minutes)
+#define TAG_CACHE_SYNC_PAGE 32          // Changed assignments per sync request
+#define TAG_CACHE_MERGE_BATCH 256       // Changes collected before the flash table is rewritten
+
+// Event Queue Configuration
+#define EVENT_QUEUE_LENGTH 32           // Max events buffered between loop() and the sender task
+#define EVENT_SENDER_STACK_SIZE 8192    // bytes
+#define EVENT_SENDER_PRIORITY 1         // Same as the Arduino loop task
+#define EVENT_SENDER_POLL_INTERVAL 1000 // ms the sender waits for new events before checking the backlog
+
+// Event Journal Configuration (SPIFFS store-and-forward)
+#define JOURNAL_SEGMENT_COUNT 64        // Segment files rotated round-robin to spread flash wear
+#define JOURNAL_SEGMENT_SIZE 4096       // bytes per segment (one flash sector)
+#define JOURNAL_CURSOR_MAX_ENTRIES 64   // Cursor file is rewritten after this many appends
+
+// Webhook Endpoints (URLs in credentials.h: WEBHOOK_URL, or a WEBHOOK_URLS list in order of preference)
+#define WEBHOOK_MAX_ENDPOINTS 4         // Further WEBHOOK_URLS entries are ignored
+#define WEBHOOK_DUAL_WRITE 0            // 1 = post every payload to the two healthiest endpoints
+#define WEBHOOK_PRIORITY_PENALTY 200    // ms added to the health score per position in the list
+#define WEBHOOK_ERROR_PENALTY 5000      // ms added to the health score of an endpoint failing every request
+#define WEBHOOK_HEALTH_DECAY 60000      // ms for an unused endpoint's error rate to halve
+
+// Webhook Retry and Circuit Breaker (one breaker per endpoint; failed events stay in the journal)
+#define WEBHOOK_RETRY_BASE_DELAY 1000   // ms before the first retry, doubled for every further failure
+#define WEBHOOK_RETRY_MAX_DELAY 60000   // ms cap for the retry delay (plus or minus jitter)
+#define BREAKER_FAILURE_THRESHOLD 3     // Consecutive failures that open the circuit
+#define BREAKER_COOLDOWN 30000          // ms the circuit stays open before a probe request
+#define BREAKER_MAX_COOLDOWN 300000     // ms cap, the cooldown doubles after every failed probe
+
+// Webhook Batching (1 = one rfid_poll_result object per request)
+#define WEBHOOK_BATCH_MAX_EVENTS 1      // Max events packed into one rfid_poll_results array
+#define WEBHOOK_BATCH_WINDOW 2000       // ms to wait for more events before sending a partial batch
+#define WEBHOOK_BATCH_MAX_BYTES 4096    // Max serialized payload size per request
+
+// Webhook Payload Encoding
+#define PAYLOAD_FORMAT_JSON 0           // Readable JSON objects (application/json)
+#define PAYLOAD_FORMAT_MSGPACK 1        // Compact MessagePack arrays (application/msgpack), see msgpack_decoder.js
+#define WEBHOOK_PAYLOAD_FORMAT PAYLOAD_FORMAT_JSON
+
+// Metrics
+#define METRICS_SAMPLE_INTERVAL 1000    // ms between gauge updates (heap, queue depth, RSSI)
+#define HEARTBEAT_INTERVAL 300000       // ms between metrics heartbeats to the webhook (0 = off)
+
+// Local HTTP API (collectors pull events from the journal, see http_api.h)
+#define HTTP_API_ENABLED 0              // Serve /events, /status and /metrics on the local network (needs HTTP_API_TOKEN)
+#define HTTP_API_PORT 80
+#define HTTP_API_STACK_SIZE 8192        // bytes (the /metrics document is built on this stack)
+#define HTTP_API_PRIORITY 1             // Same as the Arduino loop task
+#define HTTP_API_POLL_INTERVAL 20       // ms between checks for new clients
+#define HTTP_API_MAX_EVENTS 1000        // Max events per /events response, clients page with next_seq
+#define HTTP_API_READ_BATCH 16          // Journal records read per lock of the journal
+#define HTTP_API_CHUNK_SIZE 1024        // bytes buffered per HTTP chunk
 
 // Debug Configuration
 #define DEBUG_SERIAL Serial       // Use USB CDC serial for debug output
 
+// Logging (LOG_ERROR ... LOG_DEBUG, see logger.h); status dumps always print
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4               // Adds payloads, response bodies and request timing
+#define LOG_LEVEL LOG_LEVEL_INFO        // Messages above this level are not compiled in
+#define LOG_ASYNC 1                     // 1 = format and print on the log task, 0 = print in the caller
+#define LOG_RING_SLOTS 32               // Messages waiting for the log task (power of two)
+#define LOG_RECORD_SIZE 128             // bytes of arguments per message; longer strings are cut
+#define LOG_LINE_SIZE 256               // bytes per formatted line
+#define LOG_DRAIN_STACK_SIZE 3072       // bytes
+#define LOG_DRAIN_PRIORITY 0            // Below every other task, so printing only uses idle time
+#define LOG_DRAIN_INTERVAL 20           // ms the log task waits when the ring is empty
+
 #endif // CONFIG_H
@@ -0,0 +1,362 @@
+#include "event_journal.h"
+#include <stddef.h>
+#include "logger.h"
+
+static const char* JOURNAL_CURSOR_PATH = "/journal_cursor.bin";
+static const char* JOURNAL_CURSOR_TEMP_PATH = "/journal_cursor_tmp.bin";
+static const char* JOURNAL_TEMP_PATH = "/journal_tmp.bin";
+
+// Persisted read cursor, appended on every ack
+struct CursorEntry {
+    uint32_t readSeq;
+    uint32_t crc;
+};
+
+EventJournal::EventJournal()
+    : mounted(false), recordsPerSegment(1), headSeq(0), readSeq(0), cursorEntries(0),
+      overwrittenCount(0), corruptCount(0) {
+}
+
+uint32_t EventJournal::crc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+uint32_t EventJournal::recordCrc(const JournalRecord& record) {
+    return crc32(reinterpret_cast<const uint8_t*>(&record), offsetof(JournalRecord, crc));
+}
+
+void EventJournal::segmentPath(uint32_t segment, char* path) {
+    snprintf(path, SEGMENT_PATH_SIZE, "/journal_%02u.bin", (unsigned)segment);
+}
+
+uint32_t EventJournal::oldestSeq() const {
+    if (headSeq == 0) {
+        return 0;
+    }
+    uint32_t lastGeneration = (headSeq - 1) / recordsPerSegment;
+    if (lastGeneration < JOURNAL_SEGMENT_COUNT) {
+        return 0;
+    }
+    return (lastGeneration - JOURNAL_SEGMENT_COUNT + 1) * recordsPerSegment;
+}
+
+bool EventJournal::begin() {
+    DEBUG_SERIAL.println("\nInitializing Event Journal...");
+
+    if (!SPIFFS.begin(true)) {  // Format on first use
+        DEBUG_SERIAL.println("Error: Could not mount SPIFFS!");
+        return false;
+    }
+
+    recordsPerSegment = JOURNAL_SEGMENT_SIZE / sizeof(JournalRecord);
+    mounted = true;
+
+    if (!recover()) {
+        DEBUG_SERIAL.println("Warning: Journal recovery incomplete, some records may be replayed twice");
+    }
+    loadCursor();
+
+    printJournalStatus();
+    return true;
+}
+
+bool EventJournal::recover() {
+    bool found = false;
+    uint32_t lastSeq = 0;
+    uint32_t headSegment = 0;
+    uint32_t headValidRecords = 0;
+    size_t headFileSize = 0;
+
+    // Scan every segment and keep the newest run of consecutive valid records
+    for (uint32_t segment = 0; segment < JOURNAL_SEGMENT_COUNT; segment++) {
+        char path[SEGMENT_PATH_SIZE];
+        segmentPath(segment, path);
+        if (!SPIFFS.exists(path)) {
+            continue;
+        }
+        File file = SPIFFS.open(path, FILE_READ);
+        if (!file) {
+            continue;
+        }
+
+        JournalRecord record;
+        uint32_t validRecords = 0;
+        uint32_t segmentLastSeq = 0;
+        while (file.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) == sizeof(record)) {
+            if (record.crc != recordCrc(record) ||
+                segmentOf(record.seq) != segment ||
+                slotOf(record.seq) != validRecords) {
+                break;
+            }
+            segmentLastSeq = record.seq;
+            validRecords++;
+        }
+        size_t fileSize = file.size();
+        file.close();
+
+        if (validRecords > 0 && (!found || segmentLastSeq > lastSeq)) {
+            found = true;
+            lastSeq = segmentLastSeq;
+            headSegment = segment;
+            headValidRecords = validRecords;
+            headFileSize = fileSize;
+        }
+    }
+
+    headSeq = found ? lastSeq + 1 : 0;
+
+    // A power cut during append leaves a partial record at the end of the head segment
+    if (found && headFileSize != headValidRecords * sizeof(JournalRecord)) {
+        DEBUG_SERIAL.printf("Journal: discarding torn record in segment %u\n", (unsigned)headSegment);
+        return repairSegment(headSegment, headValidRecords);
+    }
+    return true;
+}
+
+bool EventJournal::repairSegment(uint32_t segment, uint32_t validRecords) {
+    char path[SEGMENT_PATH_SIZE];
+    segmentPath(segment, path);
+    File source = SPIFFS.open(path, FILE_READ);
+    File target = SPIFFS.open(JOURNAL_TEMP_PATH, FILE_WRITE);
+    if (!source || !target) {
+        return false;
+    }
+
+    JournalRecord record;
+    for (uint32_t i = 0; i < validRecords; i++) {
+        if (source.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) != sizeof(record) ||
+            target.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record)) != sizeof(record)) {
+            source.close();
+            target.close();
+            return false;
+        }
+    }
+    source.close();
+    target.close();
+
+    SPIFFS.remove(path);
+    return SPIFFS.rename(JOURNAL_TEMP_PATH, path);
+}
+
+bool EventJournal::readCursorFile(const char* path, uint32_t& cursor, uint32_t& entries) {
+    // The newest valid entry wins; a torn entry at the end is ignored
+    bool found = false;
+    entries = 0;
+    if (!SPIFFS.exists(path)) {
+        return false;
+    }
+    File file = SPIFFS.open(path, FILE_READ);
+    CursorEntry entry;
+    while (file && file.read(reinterpret_cast<uint8_t*>(&entry), sizeof(entry)) == sizeof(entry)) {
+        entries++;
+        if (entry.crc == crc32(reinterpret_cast<const uint8_t*>(&entry.readSeq), sizeof(entry.readSeq))) {
+            cursor = entry.readSeq;
+            found = true;
+        }
+    }
+    if (file && file.size() % sizeof(entry) != 0) {
+        entries = JOURNAL_CURSOR_MAX_ENTRIES;  // Torn append: rewrite before appending behind it
+    }
+    file.close();
+    return found;
+}
+
+void EventJournal::loadCursor() {
+    uint32_t cursor = 0;
+    uint32_t tempCursor = 0;
+    uint32_t tempEntries = 0;
+    bool found = readCursorFile(JOURNAL_CURSOR_PATH, cursor, cursorEntries);
+
+    // A power cut during saveCursor() can leave the new cursor in the temp file only.
+    // The cursor never moves back, so the larger of the two is the latest.
+    bool foundTemp = readCursorFile(JOURNAL_CURSOR_TEMP_PATH, tempCursor, tempEntries);
+    if (foundTemp && (!found || tempCursor > cursor)) {
+        cursor = tempCursor;
+        found = true;
+    }
+    if (SPIFFS.exists(JOURNAL_CURSOR_TEMP_PATH)) {
+        cursorEntries = JOURNAL_CURSOR_MAX_ENTRIES;  // Finish the interrupted rewrite on the next save
+    }
+
+    // Clamp into the range still present on flash
+    uint32_t oldest = oldestSeq();
+    readSeq = found ? cursor : oldest;
+    if (readSeq < oldest) {
+        readSeq = oldest;
+    }
+    if (readSeq > headSeq) {
+        readSeq = headSeq;
+    }
+}
+
+bool EventJournal::saveCursor() {
+    CursorEntry entry;
+    entry.readSeq = readSeq;
+    entry.crc = crc32(reinterpret_cast<const uint8_t*>(&entry.readSeq), sizeof(entry.readSeq));
+
+    if (cursorEntries < JOURNAL_CURSOR_MAX_ENTRIES) {
+        File file = SPIFFS.open(JOURNAL_CURSOR_PATH, FILE_APPEND);
+        if (!file) {
+            return false;
+        }
+        bool success = file.write(reinterpret_cast<const uint8_t*>(&entry), sizeof(entry)) == sizeof(entry);
+        file.close();
+        cursorEntries++;
+        return success;
+    }
+
+    // Compact to a single entry: the old file stays valid until the rename replaces it
+    File file = SPIFFS.open(JOURNAL_CURSOR_TEMP_PATH, FILE_WRITE);
+    if (!file) {
+        return false;
+    }
+    bool success = file.write(reinterpret_cast<const uint8_t*>(&entry), sizeof(entry)) == sizeof(entry);
+    file.close();
+    if (!success) {
+        return false;
+    }
+
+    SPIFFS.remove(JOURNAL_CURSOR_PATH);
+    if (!SPIFFS.rename(JOURNAL_CURSOR_TEMP_PATH, JOURNAL_CURSOR_PATH)) {
+        return false;
+    }
+    cursorEntries = 1;
+    return true;
+}
+
+bool EventJournal::append(const PollEvent& event) {
+    if (!mounted) {
+        return false;
+    }
+
+    uint32_t segment = segmentOf(headSeq);
+    uint32_t slot = slotOf(headSeq);
+
+    // Starting a segment that still holds the oldest generation recycles it
+    if (slot == 0 && headSeq >= getCapacity()) {
+        uint32_t newOldest = headSeq - getCapacity() + recordsPerSegment;
+        if (readSeq < newOldest) {
+            overwrittenCount += newOldest - readSeq;
+            readSeq = newOldest;
+            saveCursor();
+        }
+    }
+
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.seq = headSeq;
+    record.event = event;
+    record.crc = recordCrc(record);
+
+    char path[SEGMENT_PATH_SIZE];
+    segmentPath(segment, path);
+    File file = SPIFFS.open(path, slot == 0 ? FILE_WRITE : FILE_APPEND);
+    if (!file) {
+        return false;
+    }
+    size_t written = file.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record));
+    file.close();
+
+    if (written != sizeof(record)) {
+        repairSegment(segment, slot);
+        return false;
+    }
+
+    headSeq++;
+    return true;
+}
+
+EventJournal::ReadStatus EventJournal::readRecord(uint32_t seq, JournalRecord& record) {
+    char path[SEGMENT_PATH_SIZE];
+    segmentPath(segmentOf(seq), path);
+    File file = SPIFFS.open(path, FILE_READ);
+    if (!file) {
+        // A missing segment lost its records; any other open failure may be transient
+        return SPIFFS.exists(path) ? RECORD_UNAVAILABLE : RECORD_CORRUPT;
+    }
+
+    bool success = file.seek(slotOf(seq) * sizeof(JournalRecord), SeekSet) &&
+                   file.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) == sizeof(record);
+    file.close();
+
+    return success && record.seq == seq && record.crc == recordCrc(record) ? RECORD_OK : RECORD_CORRUPT;
+}
+
+size_t EventJournal::peek(PollEvent* events, size_t maxEvents) {
+    if (!mounted) {
+        return 0;
+    }
+
+    JournalRecord record;
+    size_t count = 0;
+    uint32_t seq = readSeq;
+    while (count < maxEvents && seq < headSeq) {
+        ReadStatus status = readRecord(seq, record);
+        if (status == RECORD_UNAVAILABLE) {
+            if (count == 0) {
+                LOG_WARN("Journal: record %u unreadable, retrying later", (unsigned)seq);
+            }
+            break;
+        }
+        if (status == RECORD_CORRUPT) {
+            if (count > 0) {
+                break;  // Return what we have; the corrupt record is skipped on the next peek
+            }
+            LOG_WARN("Journal: skipping corrupt record %u", (unsigned)readSeq);
+            corruptCount++;
+            readSeq++;
+            saveCursor();
+            seq = readSeq;
+            continue;
+        }
+        events[count++] = record.event;
+        seq++;
+    }
+    return count;
+}
+
+size_t EventJournal::read(uint32_t fromSeq, JournalRecord* records, size_t maxRecords, uint32_t& nextSeq) {
+    // Anything older than the ring has been recycled; start at the oldest record still present
+    uint32_t seq = max(fromSeq, oldestSeq());
+    size_t count = 0;
+    if (mounted) {
+        while (count < maxRecords && seq < headSeq) {
+            // Corrupt records are skipped here and counted by peek(); an unreadable one ends the page
+            ReadStatus status = readRecord(seq, records[count]);
+            if (status == RECORD_UNAVAILABLE) {
+                break;
+            }
+            if (status == RECORD_OK) {
+                count++;
+            }
+            seq++;
+        }
+    }
+    nextSeq = seq;
+    return count;
+}
+
+bool EventJournal::ack(uint32_t count) {
+    if (!mounted || count == 0 || readSeq >= headSeq) {
+        return false;
+    }
+    readSeq += min(count, pendingCount());
+    return saveCursor();
+}
+
+void EventJournal::printJournalStatus() {
+    DEBUG_SERIAL.println("\n--- Event Journal Status ---");
+    DEBUG_SERIAL.printf("Mounted: %s\n", mounted ? "YES" : "NO");
+    DEBUG_SERIAL.printf("Record size: %u bytes, capacity: %u records in %d segments\n",
+                        (unsigned)sizeof(JournalRecord), getCapacity(), JOURNAL_SEGMENT_COUNT);
+    DEBUG_SERIAL.printf("Head seq: %u, Read seq: %u, Pending: %u\n", headSeq, readSeq, pendingCount());
+    DEBUG_SERIAL.printf("Overwritten: %u, Corrupt: %u\n", overwrittenCount, corruptCount);
+    DEBUG_SERIAL.println("--- End Event Journal Status ---\n");
+}
@@ -0,0 +1,81 @@
+#ifndef EVENT_JOURNAL_H
+#define EVENT_JOURNAL_H
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include "config.h"
+#include "poll_event.h"
+
+// On-flash record: fixed size, so record N of a segment lives at N * sizeof(JournalRecord)
+struct JournalRecord {
+    uint32_t seq;     // Monotonic sequence number, never reused
+    PollEvent event;
+    uint32_t crc;     // CRC32 over seq + event, detects torn or corrupted writes
+};
+
+/**
+ * Append-only ring journal of poll events on SPIFFS.
+ *
+ * Sequence number S is stored in segment (S / recordsPerSegment) % JOURNAL_SEGMENT_COUNT
+ * at slot S % recordsPerSegment, so segments are filled and recycled round-robin.
+ * The read cursor (next sequence to replay) is persisted separately, which makes
+ * delivery at-least-once across power cuts. The cursor file is compacted through a
+ * temp file and a rename, so some valid cursor survives a power cut at any point.
+ */
+class EventJournal {
+    private:
+        enum ReadStatus {
+            RECORD_OK,
+            RECORD_CORRUPT,      // Torn, overwritten or failed its CRC: skip it
+            RECORD_UNAVAILABLE   // Segment could not be opened right now: try again later
+        };
+
+        bool mounted;
+        uint32_t recordsPerSegment;
+        uint32_t headSeq;           // Next sequence number to write
+        uint32_t readSeq;           // Next sequence number to replay
+        uint32_t cursorEntries;     // Entries in the cursor file since last rewrite
+        uint32_t overwrittenCount;  // Unsent records lost because the ring wrapped
+        uint32_t corruptCount;      // Records skipped because of a CRC mismatch
+
+        static uint32_t crc32(const uint8_t* data, size_t length);
+        static uint32_t recordCrc(const JournalRecord& record);
+        static const size_t SEGMENT_PATH_SIZE = 24;
+        static void segmentPath(uint32_t segment, char* path);  // Into a SEGMENT_PATH_SIZE buffer, no String on the append path
+
+        uint32_t segmentOf(uint32_t seq) const { return (seq / recordsPerSegment) % JOURNAL_SEGMENT_COUNT; }
+        uint32_t slotOf(uint32_t seq) const { return seq % recordsPerSegment; }
+        uint32_t oldestSeq() const;
+
+        bool recover();
+        bool repairSegment(uint32_t segment, uint32_t validRecords);
+        bool readCursorFile(const char* path, uint32_t& cursor, uint32_t& entries);
+        void loadCursor();
+        bool saveCursor();
+        ReadStatus readRecord(uint32_t seq, JournalRecord& record);
+
+    public:
+        EventJournal();
+        bool begin();  // Mount SPIFFS and rebuild head/cursor from flash
+
+        bool append(const PollEvent& event);
+        size_t peek(PollEvent* events, size_t maxEvents);  // Oldest unsent events, skipping corrupt records
+        bool ack(uint32_t count = 1);                       // Mark the first count peeked events as delivered
+
+        // Reads retained records from fromSeq on, delivered or not, without moving the cursor.
+        // nextSeq is where the following read should continue.
+        size_t read(uint32_t fromSeq, JournalRecord* records, size_t maxRecords, uint32_t& nextSeq);
+
+        // Status and info
+        bool isMounted() const { return mounted; }
+        uint32_t pendingCount() const { return headSeq - readSeq; }
+        uint32_t getCapacity() const { return recordsPerSegment * JOURNAL_SEGMENT_COUNT; }
+        uint32_t getHeadSeq() const { return headSeq; }
+        uint32_t getReadSeq() const { return readSeq; }
+        uint32_t getOldestSeq() const { return oldestSeq(); }  // Oldest record still on flash
+        uint32_t getOverwrittenCount() const { return overwrittenCount; }
+        uint32_t getCorruptCount() const { return corruptCount; }
+        void printJournalStatus();
+};
+
+#endif // EVENT_JOURNAL_H
@@ -0,0 +1,88 @@
+#include "event_json.h"
+#include "config.h"
+
+static void fillAssignment(JsonObject result, const PollEvent& event) {
+    // Only with the tag cache; what the device knew at detection time
+    if (event.assignment == ASSIGNMENT_NOT_CHECKED) {
+        return;
+    }
+    result["assignment"] = assignmentName(event.assignment);
+    if (event.assignment == ASSIGNMENT_ASSIGNED) {
+        result["assignment_id"] = event.assignmentId;
+    }
+}
+
+void fillPollResult(JsonObject result, const PollEvent& event, const char* deviceId) {
+    // Text fields are rendered here, at serialization time only.
+    // char[] values are copied into the document, string literals are stored by reference.
+    char tagId[TAG_ID_TEXT_SIZE];
+    char timestamp[TIMESTAMP_TEXT_SIZE];
+    formatTagId(event.uid, event.uidLength, tagId, sizeof(tagId));
+    formatTimestamp(event.epochMs, timestamp, sizeof(timestamp));
+    
+    if (event.epochMs != 0) {
+        result["timestamp"] = timestamp;
+    } else {
+        result["timestamp"] = nullptr;  // Never synced: the ingest side uses its receive time
+    }
+    
+    if (event.kind == EVENT_SESSION) {
+        // timestamp is the session start
+        char ended[TIMESTAMP_TEXT_SIZE];
+        formatTimestamp(event.epochMs + event.durationMs, ended, sizeof(ended));
+        result["event_type"] = "session";
+        if (event.epochMs != 0) {
+            result["session_end"] = ended;
+        } else {
+            result["session_end"] = nullptr;
+        }
+        result["duration_ms"] = event.durationMs;
+        result["end_estimated"] = event.endEstimated;
+        result["tag_id"] = tagId;
+        result["tag_type"] = tagTypeName(event.tagType);
+        result["device_id"] = deviceId;
+        fillAssignment(result, event);
+        return;
+    }
+    
+    result["event_type"] = event.tagPresent ? "tag_insert" : "tag_removed";
+    result["tag_present"] = event.tagPresent;
+    result["tag_id"] = tagId;
+    result["device_id"] = deviceId;
+    if (NFC_READER_COUNT > 1) {
+        result["reader_index"] = event.readerIndex;  // Which antenna of this device
+    }
+    
+    if (event.tagPresent) {
+        char wifiStatus[WIFI_STATUS_TEXT_SIZE];
+        formatWifiStatus(event, wifiStatus, sizeof(wifiStatus));
+        result["tag_type"] = tagTypeName(event.tagType);
+        result["wifi_status"] = wifiStatus;
+        result["time_status"] = timeStatusText(event);
+        fillAssignment(result, event);
+    }
+}
+
+size_t encodeEventsJson(JsonDocument& doc, const PollEvent* events, size_t count, const char* deviceId,
+                        bool batch, size_t maxBytes, char* buffer, size_t size, size_t& packed) {
+    doc.clear();
+    packed = 0;
+    
+    if (!batch) {
+        fillPollResult(doc.createNestedObject("rfid_poll_result"), events[0], deviceId);
+        packed = 1;
+    } else {
+        JsonArray results = doc.createNestedArray("rfid_poll_results");
+        
+        // Pack events until the serialized size would exceed the per-request cap
+        for (; packed < count; packed++) {
+            fillPollResult(results.createNestedObject(), events[packed], deviceId);
+            if (packed > 0 && (doc.overflowed() || measureJson(doc) > maxBytes)) {
+                results.remove(packed);
+                break;
+            }
+        }
+    }
+    
+    return serializeJson(doc, buffer, size);
+}
@@ -0,0 +1,23 @@
+#ifndef EVENT_JSON_H
+#define EVENT_JSON_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
+#include "poll_event.h"
+
+// Webhook JSON encoding. No Arduino dependencies, so host tools (tools/loadgen) build it too.
+
+// The rfid_poll_result object, also served by the local HTTP API
+void fillPollResult(JsonObject result, const PollEvent& event, const char* deviceId);
+
+/**
+ * Encodes events as {"rfid_poll_result": {...}}, or with batch as
+ * {"rfid_poll_results": [...]} holding as many events as fit in maxBytes.
+ * doc is scratch space. Returns the length written to buffer (0 on error)
+ * and the number of events packed in packed.
+ */
+size_t encodeEventsJson(JsonDocument& doc, const PollEvent* events, size_t count, const char* deviceId,
+                        bool batch, size_t maxBytes, char* buffer, size_t size, size_t& packed);
+
+#endif // EVENT_JSON_H
@@ -0,0 +1,289 @@
+#include "event_queue.h"
+#include "boot_timing.h"
+#include "logger.h"
+
+EventQueue::EventQueue(WebhookManager& webhook, WiFiManager& wifi, TagCache& tagCache)
+    : queue(nullptr), senderTask(nullptr), webhook(webhook), wifi(wifi), tagCache(tagCache), journalLock(nullptr), deviceId(""), bootId(0),
+      replayRequested(false), retryAttempt(0), nextRetryTime(0), lastHeartbeatTime(0),
+      enqueuedCount(0), sentCount(0), failedCount(0), overflowCount(0), rejectedCount(0), peakDepth(0) {
+}
+
+void EventQueue::senderTaskEntry(void* param) {
+    static_cast<EventQueue*>(param)->senderLoop();
+}
+
+bool EventQueue::sendEvent(const PollEvent& event) {
+    bool success = webhook.sendPollResult(event, deviceId);
+
+    if (success) {
+        sentCount++;
+        markBootPhase(BOOT_PHASE_FIRST_DELIVERY);
+    } else {
+        failedCount++;
+    }
+    return success;
+}
+
+void EventQueue::resolveTimestamps(PollEvent* events, size_t count) {
+    // Events detected before NTP sync get their time from the monotonic clock offset
+    uint64_t nowEpochMs = wifi.getEpochMillis();
+    uint32_t nowMs = millis();
+    for (size_t i = 0; i < count; i++) {
+        resolveEventTime(events[i], bootId, nowMs, nowEpochMs);
+    }
+}
+
+size_t EventQueue::sendBatch(PollEvent* events, size_t count) {
+    resolveTimestamps(events, count);
+    
+    if (WEBHOOK_BATCH_MAX_EVENTS <= 1) {
+        return sendEvent(events[0]) ? 1 : 0;
+    }
+
+    size_t delivered = webhook.sendPollResults(events, count, deviceId);
+    if (delivered > 0) {
+        sentCount += delivered;
+        markBootPhase(BOOT_PHASE_FIRST_DELIVERY);
+    } else {
+        failedCount += count;
+    }
+    return delivered;
+}
+
+bool EventQueue::appendToJournal(const PollEvent& event) {
+    xSemaphoreTake(journalLock, portMAX_DELAY);
+    bool success = journal.append(event);
+    xSemaphoreGive(journalLock);
+    return success;
+}
+
+size_t EventQueue::readJournal(uint32_t fromSeq, JournalRecord* records, size_t maxRecords, uint32_t& nextSeq) {
+    if (journalLock == nullptr) {
+        nextSeq = fromSeq;
+        return 0;
+    }
+
+    xSemaphoreTake(journalLock, portMAX_DELAY);
+    size_t count = journal.read(fromSeq, records, maxRecords, nextSeq);
+    xSemaphoreGive(journalLock);
+
+    // Only events of the current boot can be resolved; older ones keep a null timestamp
+    uint64_t nowEpochMs = wifi.getEpochMillis();
+    uint32_t nowMs = millis();
+    for (size_t i = 0; i < count; i++) {
+        resolveEventTime(records[i].event, bootId, nowMs, nowEpochMs);
+    }
+    return count;
+}
+
+void EventQueue::storeEvent(const PollEvent& event) {
+    if (!appendToJournal(event)) {
+        // Journal unavailable: fall back to a direct, best-effort send
+        if (wifi.isConnected()) {
+            PollEvent resolved = event;
+            resolveTimestamps(&resolved, 1);
+            sendEvent(resolved);
+        }
+    }
+}
+
+void EventQueue::moveQueueToJournal() {
+    PollEvent event;
+    while (xQueueReceive(queue, &event, 0) == pdTRUE) {
+        storeEvent(event);
+    }
+}
+
+void EventQueue::drainJournal() {
+    if (journal.pendingCount() == 0 || !wifi.isConnected()) {
+        return;
+    }
+
+    // While the webhook keeps failing, only retry after the backoff or when the link comes back
+    if (!replayRequested && retryAttempt > 0 && (long)(millis() - nextRetryTime) < 0) {
+        return;
+    }
+    if (replayRequested) {
+        webhook.probeNow();  // The outage may have been our own link
+    }
+    replayRequested = false;
+    if (retryAttempt > 0) {
+        metrics.increment(COUNTER_WEBHOOK_RETRIES);
+    }
+
+    if (journal.pendingCount() > 1) {
+        LOG_INFO("Replaying %u journaled events...", journal.pendingCount());
+    }
+
+    while (wifi.isConnected()) {
+        xSemaphoreTake(journalLock, portMAX_DELAY);
+        size_t count = journal.peek(batch, WEBHOOK_BATCH_MAX_EVENTS);
+        xSemaphoreGive(journalLock);
+        if (count == 0) {
+            break;
+        }
+        size_t delivered = sendBatch(batch, count);
+        size_t rejected = webhook.getLastRejected();
+        if (delivered == 0 && rejected == 0) {
+            scheduleRetry();  // Transport error, 5xx, 408 or 429
+            return;
+        }
+        if (rejected > 0) {
+            // Retrying would block every later event; the records stay in the journal ring (GET /events)
+            rejectedCount += rejected;
+            metrics.increment(COUNTER_EVENTS_REJECTED, rejected);
+            LOG_ERROR("Webhook refused %u events, dropped from the backlog", (unsigned)rejected);
+        }
+        xSemaphoreTake(journalLock, portMAX_DELAY);
+        journal.ack(delivered + rejected);
+        xSemaphoreGive(journalLock);
+
+        // Keep the RAM queue from overflowing while a long backlog drains
+        moveQueueToJournal();
+    }
+    retryAttempt = 0;
+}
+
+void EventQueue::scheduleRetry() {
+    retryAttempt++;
+    unsigned long delay = max(retryBackoffDelay(retryAttempt), webhook.timeUntilAvailable(millis()));
+    nextRetryTime = millis() + delay;
+    LOG_WARN("Send failed, retry %u in %lu ms (%u events waiting)",
+             retryAttempt, delay, journal.pendingCount());
+}
+
+unsigned long EventQueue::getNextRetryIn() const {
+    if (retryAttempt == 0) {
+        return 0;
+    }
+    long remaining = (long)(nextRetryTime - millis());
+    return remaining > 0 ? remaining : 0;
+}
+
+void EventQueue::waitForBatch() {
+    // Give a partial batch up to WEBHOOK_BATCH_WINDOW ms to fill before sending it
+    PollEvent event;
+    unsigned long windowStart = millis();
+    while (journal.pendingCount() < WEBHOOK_BATCH_MAX_EVENTS) {
+        unsigned long elapsed = millis() - windowStart;
+        if (elapsed >= WEBHOOK_BATCH_WINDOW) {
+            break;
+        }
+        if (xQueueReceive(queue, &event, pdMS_TO_TICKS(WEBHOOK_BATCH_WINDOW - elapsed)) == pdTRUE) {
+            storeEvent(event);
+        }
+    }
+}
+
+void EventQueue::sendHeartbeatIfDue() {
+    // Sent after the backlog, so metrics never delay events; missed heartbeats are not retried
+    if (HEARTBEAT_INTERVAL == 0 || !wifi.isConnected() || millis() - lastHeartbeatTime < HEARTBEAT_INTERVAL) {
+        return;
+    }
+    lastHeartbeatTime = millis();
+    webhook.sendHeartbeat(deviceId);
+}
+
+void EventQueue::syncTagCacheIfDue() {
+    // Like the heartbeat: after the backlog, and only while events are getting through
+    if (!TAG_CACHE_ENABLED || !wifi.isConnected() || getBacklogCount() > 0) {
+        return;
+    }
+    tagCache.syncIfDue(webhook, deviceId);
+}
+
+void EventQueue::senderLoop() {
+    PollEvent event;
+
+    for (;;) {
+        if (xQueueReceive(queue, &event, pdMS_TO_TICKS(EVENT_SENDER_POLL_INTERVAL)) == pdTRUE) {
+            storeEvent(event);
+            moveQueueToJournal();
+
+            if (WEBHOOK_BATCH_MAX_EVENTS > 1 && journal.isMounted() && wifi.isConnected()) {
+                waitForBatch();
+            }
+        }
+
+        drainJournal();
+        sendHeartbeatIfDue();
+        syncTagCacheIfDue();
+    }
+}
+
+bool EventQueue::begin(const String& deviceId) {
+    DEBUG_SERIAL.println("\nInitializing Event Queue...");
+    this->deviceId = deviceId;
+    bootId = esp_random();
+
+    journalLock = xSemaphoreCreateMutex();
+    if (journalLock == nullptr) {
+        DEBUG_SERIAL.println("Error: Could not allocate journal lock!");
+        return false;
+    }
+
+    if (!journal.begin()) {
+        DEBUG_SERIAL.println("Warning: Event journal unavailable, events will not survive outages");
+    } else if (TAG_CACHE_ENABLED && !tagCache.begin()) {
+        DEBUG_SERIAL.println("Warning: Tag cache unavailable, tags will not be checked locally");
+    }
+
+    queue = xQueueCreate(EVENT_QUEUE_LENGTH, sizeof(PollEvent));
+    if (queue == nullptr) {
+        DEBUG_SERIAL.println("Error: Could not allocate event queue!");
+        return false;
+    }
+
+    if (xTaskCreate(senderTaskEntry, "webhook_sender", EVENT_SENDER_STACK_SIZE,
+                    this, EVENT_SENDER_PRIORITY, &senderTask) != pdPASS) {
+        DEBUG_SERIAL.println("Error: Could not start webhook sender task!");
+        return false;
+    }
+
+    DEBUG_SERIAL.printf("Event Queue initialized (%d slots, %u bytes each)\n",
+                        EVENT_QUEUE_LENGTH, (unsigned)sizeof(PollEvent));
+    return true;
+}
+
+bool EventQueue::enqueue(const PollEvent& event) {
+    if (queue == nullptr) {
+        overflowCount++;
+        return false;
+    }
+
+    // Sessions restored from an earlier boot keep that boot's ID
+    PollEvent stamped = event;
+    if (stamped.bootId == 0) {
+        stamped.bootId = bootId;
+    }
+    
+    // Never wait here: this runs on the RFID poll path
+    if (xQueueSend(queue, &stamped, 0) != pdTRUE) {
+        overflowCount++;
+        return false;
+    }
+
+    enqueuedCount++;
+    uint32_t depth = uxQueueMessagesWaiting(queue);
+    if (depth > peakDepth) {
+        peakDepth = depth;
+    }
+    return true;
+}
+
+uint32_t EventQueue::getDepth() const {
+    return queue != nullptr ? uxQueueMessagesWaiting(queue) : 0;
+}
+
+void EventQueue::printQueueStatus() {
+    DEBUG_SERIAL.println("\n--- Event Queue Status ---");
+    DEBUG_SERIAL.printf("Depth: %u/%d (peak %u)\n", getDepth(), EVENT_QUEUE_LENGTH, peakDepth);
+    DEBUG_SERIAL.printf("Enqueued: %u, Sent: %u, Failed: %u, Rejected: %u, Overflow: %u\n",
+                        enqueuedCount, sentCount, failedCount, rejectedCount, overflowCount);
+    DEBUG_SERIAL.printf("Journal backlog: %u (overwritten %u, corrupt %u)\n",
+                        journal.pendingCount(), journal.getOverwrittenCount(), journal.getCorruptCount());
+    if (retryAttempt > 0) {
+        DEBUG_SERIAL.printf("Retry: attempt %u in %lu ms\n", retryAttempt, getNextRetryIn());
+    }
+    DEBUG_SERIAL.println("--- End Event Queue Status ---\n");
+}
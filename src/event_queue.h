@@ -0,0 +1,91 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "poll_event.h"
+#include "event_journal.h"
+#include "webhook_manager.h"
+#include "wifi_manager.h"
+#include "tag_cache.h"
+
+/**
+ * Bounded queue between the RFID poll loop and a dedicated sender task.
+ * enqueue() never blocks, so a slow webhook cannot stall tag polling.
+ * The sender task writes every event to the SPIFFS journal first and then
+ * replays the journal in order while WiFi and the webhook are reachable.
+ * After a failed send the backlog is retried with exponential backoff and
+ * jitter, never before some webhook endpoint's circuit breaker allows a request.
+ * It also posts the periodic metrics heartbeat and runs the tag cache sync.
+ * The journal can also be read from other tasks (the local HTTP API), so
+ * every journal access goes through journalLock.
+ */
+class EventQueue {
+    private:
+        QueueHandle_t queue;
+        TaskHandle_t senderTask;
+        WebhookManager& webhook;
+        WiFiManager& wifi;
+        TagCache& tagCache;
+        EventJournal journal;
+        SemaphoreHandle_t journalLock;
+        String deviceId;
+        uint32_t bootId;                            // Stamped on every event, see resolveEventTime()
+        volatile bool replayRequested;
+        uint32_t retryAttempt;                      // Failed sends in a row, 0 while delivering
+        unsigned long nextRetryTime;                // millis() when the backlog may be retried
+        unsigned long lastHeartbeatTime;
+        PollEvent batch[WEBHOOK_BATCH_MAX_EVENTS];  // Kept off the sender task stack
+
+        // Counters (written from one task each, read from anywhere)
+        volatile uint32_t enqueuedCount;
+        volatile uint32_t sentCount;
+        volatile uint32_t failedCount;
+        volatile uint32_t overflowCount;
+        volatile uint32_t rejectedCount;
+        volatile uint32_t peakDepth;
+
+        static void senderTaskEntry(void* param);
+        void senderLoop();
+        bool sendEvent(const PollEvent& event);
+        size_t sendBatch(PollEvent* events, size_t count);
+        void resolveTimestamps(PollEvent* events, size_t count);
+        void storeEvent(const PollEvent& event);
+        void moveQueueToJournal();
+        void waitForBatch();
+        void drainJournal();
+        void sendHeartbeatIfDue();
+        void syncTagCacheIfDue();
+        void scheduleRetry();
+        bool appendToJournal(const PollEvent& event);
+
+    public:
+        EventQueue(WebhookManager& webhook, WiFiManager& wifi, TagCache& tagCache);
+        bool begin(const String& deviceId);
+        bool enqueue(const PollEvent& event);  // Returns false if the queue was full
+        void requestReplay() { replayRequested = true; }  // Retry the journal backlog now
+
+        // Retained journal records from fromSeq on, with timestamps resolved; safe from any task
+        size_t readJournal(uint32_t fromSeq, JournalRecord* records, size_t maxRecords, uint32_t& nextSeq);
+
+        // Status and info
+        uint32_t getDepth() const;
+        uint32_t getPeakDepth() const { return peakDepth; }
+        uint32_t getEnqueuedCount() const { return enqueuedCount; }
+        uint32_t getSentCount() const { return sentCount; }
+        uint32_t getFailedCount() const { return failedCount; }
+        uint32_t getOverflowCount() const { return overflowCount; }
+        uint32_t getRejectedCount() const { return rejectedCount; }  // Dropped after a 4xx, see drainJournal()
+        uint32_t getRetryAttempt() const { return retryAttempt; }
+        unsigned long getNextRetryIn() const;       // ms until the next retry, 0 if none is pending
+        uint32_t getBacklogCount() const { return journal.pendingCount(); }
+        const EventJournal& getJournal() const { return journal; }
+        uint32_t getBootId() const { return bootId; }
+        void printQueueStatus();
+};
+
+#endif // EVENT_QUEUE_H
@@ -0,0 +1,119 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <Arduino.h>
+#include "poll_event.h"
+
+// Thin hardware interfaces. Application logic talks to these instead of calling
+// Adafruit_PN532, WiFi, HTTPClient, millis() or delay() directly, so simulated
+// implementations can be swapped in off-device.
+
+class Clock {
+    public:
+        virtual ~Clock() {}
+        virtual unsigned long millis() = 0;
+        virtual unsigned long micros() = 0;
+        virtual void delay(unsigned long ms) = 0;
+};
+
+enum PresenceResult {
+    PRESENCE_ABSENT,
+    PRESENCE_PRESENT,
+    PRESENCE_UNSUPPORTED  // Tag or reader cannot answer a cheap check, do a full poll
+};
+
+// One card found by a full poll
+struct NfcTarget {
+    uint8_t uid[MAX_UID_LENGTH];
+    uint8_t uidLength;
+};
+
+class NfcReader {
+    public:
+        virtual ~NfcReader() {}
+        virtual bool begin() = 0;                  // Bring up the bus and the reader
+        virtual uint32_t getFirmwareVersion() = 0;  // 0 if no reader answers
+        virtual bool configure() = 0;              // SAM configuration for passive targets
+        virtual uint8_t readPassiveTargets(NfcTarget* targets, uint8_t maxTargets, uint16_t timeout) = 0;  // Cards found (MaxTg = maxTargets)
+        virtual bool setActivationRetries(uint8_t retries) = 0;  // Bounds how long a full poll searches
+        virtual PresenceResult checkPresence() = 0;  // Cheap check on the last activated target
+        virtual bool powerDown() = 0;  // RF field off, lowest power until wakeUp()
+        virtual bool wakeUp() = 0;
+
+        // Asynchronous detection, driven by the reader's IRQ line
+        virtual bool hasIrq() = 0;
+        virtual bool startDetection() = 0;    // Send InListPassiveTarget without waiting
+        virtual bool isDetectionReady() = 0;  // Result available, no bus traffic needed
+        virtual bool readDetectedTarget(NfcTarget& target) = 0;
+        virtual unsigned long getLastIrqLatency() = 0;  // ms from IRQ to result read
+};
+
+class SleepController {
+    public:
+        virtual ~SleepController() {}
+        virtual void setCpuFrequency(uint32_t mhz) = 0;
+        virtual void enableModemSleep() = 0;  // WiFi radio sleeps between access point beacons
+        // Lets the chip light-sleep on its own whenever every task is blocked, woken by its timers,
+        // WiFi beacons (the station stays associated) or wakePin going low (-1 = none).
+        // Sleep stays locked out until allowLightSleep(true). False if the build cannot do it.
+        virtual bool enableAutoLightSleep(int wakePin) = 0;
+        virtual void allowLightSleep(bool allowed) = 0;
+        virtual void waitForWake(unsigned long ms) = 0;  // Blocks the caller up to ms, ends early on wakePin
+};
+
+// Link events, delivered from the network stack's own task
+enum NetworkEvent {
+    NETWORK_EVENT_GOT_IP,
+    NETWORK_EVENT_DISCONNECTED
+};
+
+typedef void (*NetworkEventHandler)(NetworkEvent event, void* context);
+
+// Access point and DHCP lease of the current link, cached to skip scan and DHCP next time
+struct NetworkLinkInfo {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+class NetworkInterface {
+    public:
+        virtual ~NetworkInterface() {}
+        virtual void setStationMode() = 0;
+        virtual void setEventHandler(NetworkEventHandler handler, void* context) = 0;
+        virtual bool startScan() = 0;              // Asynchronous, poll scanResult()
+        virtual int scanResult() = 0;              // Networks found, -1 while running, -2 on failure
+        virtual String scannedSSID(int index) = 0;
+        virtual void clearScan() = 0;
+        virtual void begin(const char* ssid, const char* password) = 0;  // Returns immediately
+        virtual void beginDirect(const char* ssid, const char* password,
+                                 uint8_t channel, const uint8_t* bssid) = 0;  // Known AP, no channel scan
+        virtual void setStaticIP(const NetworkLinkInfo& lease) = 0;  // Skip DHCP on the next connect
+        virtual void useDhcp() = 0;
+        virtual bool getLinkInfo(NetworkLinkInfo& info) = 0;  // False if the link is down
+        virtual void disconnect() = 0;
+        virtual bool isLinkUp() = 0;
+        virtual String currentSSID() = 0;
+        virtual int rssi() = 0;
+        virtual IPAddress localIP() = 0;
+};
+
+class HttpTransport {
+    public:
+        virtual ~HttpTransport() {}
+        virtual bool resolve(const char* host, IPAddress& ip) = 0;
+        virtual bool connect(const IPAddress& ip, uint16_t port, uint32_t timeout) = 0;
+        virtual bool connected() = 0;
+        virtual void stop() = 0;
+
+        // POST over the open connection; returns the HTTP status or a negative error code
+        virtual int post(const String& host, uint16_t port, const String& path,
+                         const char* contentType, const uint8_t* payload, size_t length) = 0;
+        virtual String readResponse() = 0;  // Body of the last response
+        virtual void endRequest() = 0;      // Keeps the connection open if the server allows it
+};
+
+#endif // HAL_H
@@ -0,0 +1,401 @@
+#include "hal_arduino.h"
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+
+// PN532 I2C framing
+static const uint8_t PN532_I2C_ADDRESS = 0x24;
+static const uint8_t PN532_HOST_TO_PN532 = 0xD4;
+static const uint8_t PN532_PN532_TO_HOST = 0xD5;
+static const uint8_t PN532_CMD_DIAGNOSE = 0x00;
+static const uint8_t PN532_DIAGNOSE_PRESENCE = 0x06;  // Attention request / card presence test
+static const uint8_t PN532_CMD_POWERDOWN = 0x16;
+static const uint8_t PN532_CMD_INLISTPASSIVETARGET = 0x4A;
+static const uint8_t PN532_BAUD_ISO14443A = 0x00;     // 106 kbps type A
+static const uint8_t PN532_SEL_RES_ISO_DEP = 0x20;    // Target speaks ISO14443-4, its ATS follows the UID
+static const uint8_t PN532_WAKEUP_I2C = 0x80;         // PowerDown WakeUpEnable: wake on host I2C traffic
+static const uint16_t PN532_POWERDOWN_TIMEOUT = 50;   // ms
+static const unsigned int PN532_WAKEUP_DELAY = 2000;  // us for the oscillator to restart after wake-up
+static const uint16_t PN532_PRESENCE_TIMEOUT = 50;    // ms
+static const uint8_t PN532_RESPONSE_MAX = 253;       // LEN 255 minus TFI and response code
+static const uint16_t PN532_RAW_FRAME_MAX = PN532_RESPONSE_MAX + 10;  // Status, framing and checksums around it
+static const uint8_t PN532_LIBRARY_UID_MAX = 10;      // The library copies triple-size UIDs in full
+
+volatile unsigned long Pn532Reader::irqTime = 0;
+int Pn532Reader::irqGpio = -1;
+bool Pn532Reader::busStarted = false;
+int Pn532Reader::selectedChannel = -1;
+TaskHandle_t volatile ArduinoSleep::waitingTask = nullptr;
+
+void IRAM_ATTR Pn532Reader::onIrq() {
+    irqTime = millis();
+    // The light sleep wake-up turns the pin into a low-level interrupt, which would fire
+    // until the response is read; startDetection() unmasks it again
+    gpio_intr_disable((gpio_num_t)irqGpio);
+    ArduinoSleep::wakeFromIsr();
+}
+
+void Pn532Reader::select() {
+    if (muxChannel < 0 || selectedChannel == muxChannel) {
+        return;
+    }
+    Wire.beginTransmission(NFC_I2C_MUX_ADDRESS);
+    Wire.write((uint8_t)(1 << muxChannel));
+    selectedChannel = Wire.endTransmission() == 0 ? muxChannel : -1;
+}
+
+bool Pn532Reader::begin() {
+    // The ESP32-C3 has one I2C controller; every reader shares it
+    if (!busStarted) {
+        // Increase I2C clock speed for more reliable communication
+        Wire.setClock(100000); // 100kHz standard mode
+        
+        // Initialize I2C for ESP32-C3
+        Wire.begin(PN532_SDA, PN532_SCL);
+        // The default 128-byte buffer cuts off a full frame, e.g. two ISO-DEP targets with long ATS
+        Wire.setBufferSize(PN532_RAW_FRAME_MAX);
+        busStarted = true;
+    }
+    select();
+    
+    if (irqPin >= 0) {
+        // PN532 pulls IRQ low when a response frame is ready
+        pinMode(irqPin, INPUT_PULLUP);
+        irqGpio = irqPin;
+        attachInterrupt(digitalPinToInterrupt(irqPin), onIrq, FALLING);
+    }
+    
+    return nfc.begin();
+}
+
+uint8_t Pn532Reader::readPassiveTargets(NfcTarget* targets, uint8_t maxTargets, uint16_t timeout) {
+    select();
+    
+    if (maxTargets <= 1) {
+        uint8_t uid[PN532_LIBRARY_UID_MAX];
+        uint8_t uidLength = 0;
+        if (!nfc.readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, timeout)) {
+            return 0;
+        }
+        targets[0].uidLength = min(uidLength, MAX_UID_LENGTH);
+        memcpy(targets[0].uid, uid, targets[0].uidLength);
+        return 1;
+    }
+    
+    // The library hard-codes MaxTg = 1; the PN532 can activate two type A cards at once
+    const uint8_t command[] = { PN532_CMD_INLISTPASSIVETARGET, (uint8_t)min(maxTargets, (uint8_t)2),
+                                PN532_BAUD_ISO14443A };
+    uint8_t response[PN532_RESPONSE_MAX];
+    int length = exchangeRaw(command, sizeof(command), response, sizeof(response), timeout);
+    if (length < 1) {
+        return 0;
+    }
+    
+    // NbTg, then per target: Tg, SENS_RES (2), SEL_RES, NFCIDLength, NFCID, [ATS]
+    uint8_t found = 0;
+    int pos = 1;
+    for (uint8_t i = 0; i < response[0] && found < maxTargets; i++) {
+        if (pos + 5 > length) {
+            break;
+        }
+        uint8_t selRes = response[pos + 3];
+        uint8_t idLength = response[pos + 4];
+        pos += 5;
+        if (pos + idLength > length) {
+            break;
+        }
+        targets[found].uidLength = min(idLength, MAX_UID_LENGTH);
+        memcpy(targets[found].uid, &response[pos], targets[found].uidLength);
+        found++;
+        pos += idLength;
+        if (selRes & PN532_SEL_RES_ISO_DEP) {
+            if (pos >= length) {
+                break;
+            }
+            pos += response[pos];  // ATS length byte counts itself
+        }
+    }
+    return found;
+}
+
+bool Pn532Reader::waitReady(uint16_t timeout) {
+    // In I2C mode every read starts with a status byte, bit 0 set when a frame is ready
+    unsigned long start = millis();
+    for (;;) {
+        if (Wire.requestFrom(PN532_I2C_ADDRESS, (uint8_t)1) == 1 && (Wire.read() & 0x01)) {
+            return true;
+        }
+        if (millis() - start >= timeout) {
+            return false;
+        }
+        delay(1);
+    }
+}
+
+int Pn532Reader::exchangeRaw(const uint8_t* command, uint8_t length,
+                             uint8_t* response, uint8_t responseSize, uint16_t timeout) {
+    // Frame: 00 00 FF LEN LCS TFI DATA... DCS 00
+    uint8_t frameLength = length + 1;
+    uint8_t checksum = PN532_HOST_TO_PN532;
+    
+    Wire.beginTransmission(PN532_I2C_ADDRESS);
+    Wire.write(0x00);
+    Wire.write(0x00);
+    Wire.write(0xFF);
+    Wire.write(frameLength);
+    Wire.write((uint8_t)(~frameLength + 1));
+    Wire.write(PN532_HOST_TO_PN532);
+    for (uint8_t i = 0; i < length; i++) {
+        Wire.write(command[i]);
+        checksum += command[i];
+    }
+    Wire.write((uint8_t)(~checksum + 1));
+    Wire.write(0x00);
+    if (Wire.endTransmission() != 0) {
+        return -1;
+    }
+    
+    // ACK frame: status 00 00 FF 00 FF 00
+    if (!waitReady(timeout) || Wire.requestFrom(PN532_I2C_ADDRESS, (uint8_t)7) != 7) {
+        return -1;
+    }
+    uint8_t ack[7];
+    for (uint8_t i = 0; i < 7; i++) {
+        ack[i] = Wire.read();
+    }
+    if (ack[3] != 0xFF || ack[4] != 0x00 || ack[5] != 0xFF) {
+        return -1;
+    }
+    
+    // Response frame: status 00 00 FF LEN LCS D5 CMD+1 DATA... DCS 00
+    size_t readLength = min(responseSize, PN532_RESPONSE_MAX) + 10;
+    if (!waitReady(timeout) || Wire.requestFrom((uint16_t)PN532_I2C_ADDRESS, readLength) != readLength) {
+        return -1;
+    }
+    uint8_t frame[PN532_RAW_FRAME_MAX];
+    for (size_t i = 0; i < readLength; i++) {
+        frame[i] = Wire.read();
+    }
+    if (frame[3] != 0xFF || (uint8_t)(frame[4] + frame[5]) != 0 ||
+        frame[6] != PN532_PN532_TO_HOST || frame[7] != command[0] + 1) {
+        return -1;
+    }
+    
+    int dataLength = frame[4] - 2;  // LEN covers TFI and response code
+    if (dataLength < 0 || dataLength > responseSize) {
+        return -1;
+    }
+    // DCS makes TFI + data sum to zero; a frame corrupted on the bus must not yield a UID
+    uint8_t sum = 0;
+    for (int i = 0; i < frame[4] + 1; i++) {
+        sum += frame[6 + i];
+    }
+    if (sum != 0) {
+        return -1;
+    }
+    memcpy(response, &frame[8], dataLength);
+    return dataLength;
+}
+
+PresenceResult Pn532Reader::checkPresence() {
+    // Diagnose test 0x06 talks to the target selected by the last InListPassiveTarget,
+    // without a new anti-collision round
+    const uint8_t command[] = { PN532_CMD_DIAGNOSE, PN532_DIAGNOSE_PRESENCE };
+    uint8_t status = 0xFF;
+    
+    select();
+    if (exchangeRaw(command, sizeof(command), &status, 1, PN532_PRESENCE_TIMEOUT) != 1) {
+        return PRESENCE_UNSUPPORTED;
+    }
+    
+    switch (status & 0x3F) {  // Low bits carry the error code
+        case 0x00:
+            return PRESENCE_PRESENT;
+        case 0x01:  // Timeout: the target did not answer
+            return PRESENCE_ABSENT;
+        default:
+            return PRESENCE_UNSUPPORTED;
+    }
+}
+
+bool Pn532Reader::powerDown() {
+    if (poweredDown) {
+        return true;
+    }
+    const uint8_t command[] = { PN532_CMD_POWERDOWN, PN532_WAKEUP_I2C };
+    uint8_t status = 0xFF;
+    
+    select();
+    if (exchangeRaw(command, sizeof(command), &status, 1, PN532_POWERDOWN_TIMEOUT) != 1 || (status & 0x3F) != 0) {
+        return false;
+    }
+    poweredDown = true;
+    return true;
+}
+
+bool Pn532Reader::wakeUp() {
+    if (!poweredDown) {
+        return true;
+    }
+    // Any transfer to our address wakes the PN532; this first one is not acknowledged
+    select();
+    Wire.beginTransmission(PN532_I2C_ADDRESS);
+    Wire.endTransmission();
+    delayMicroseconds(PN532_WAKEUP_DELAY);
+    poweredDown = false;
+    return true;
+}
+
+bool Pn532Reader::startDetection() {
+    // Returns once the PN532 acknowledged the command; the target search runs on the PN532
+    select();
+    bool started = nfc.startPassiveTargetIDDetection(PN532_MIFARE_ISO14443A);
+    gpio_intr_enable((gpio_num_t)irqPin);  // The ACK has been read, so IRQ only goes low for the result
+    return started;
+}
+
+bool Pn532Reader::isDetectionReady() {
+    // Level check rather than the edge flag, so a response that arrived while
+    // the ACK was still being read is not missed
+    return irqPin >= 0 && digitalRead(irqPin) == LOW;
+}
+
+bool Pn532Reader::readDetectedTarget(NfcTarget& target) {
+    lastIrqLatency = millis() - irqTime;
+    select();
+    uint8_t uid[PN532_LIBRARY_UID_MAX];
+    uint8_t uidLength = 0;
+    if (!nfc.readDetectedPassiveTargetID(uid, &uidLength)) {
+        return false;
+    }
+    target.uidLength = min(uidLength, MAX_UID_LENGTH);
+    memcpy(target.uid, uid, target.uidLength);
+    return true;
+}
+
+bool ArduinoSleep::enableAutoLightSleep(int wakePin) {
+    if (noSleepLock == nullptr && esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "loop", &noSleepLock) != ESP_OK) {
+        return false;
+    }
+    esp_pm_lock_acquire(noSleepLock);
+    
+    if (wakePin >= 0) {
+        gpio_wakeup_enable((gpio_num_t)wakePin, GPIO_INTR_LOW_LEVEL);
+        esp_sleep_enable_gpio_wakeup();
+    }
+    
+    // Fails unless the sdkconfig has CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    esp_pm_config_esp32c3_t config = {};
+    config.max_freq_mhz = getCpuFrequencyMhz();
+    config.min_freq_mhz = getXtalFrequencyMhz();
+    config.light_sleep_enable = true;
+    if (esp_pm_configure(&config) != ESP_OK) {
+        if (wakePin >= 0) {
+            gpio_wakeup_disable((gpio_num_t)wakePin);
+            gpio_set_intr_type((gpio_num_t)wakePin, GPIO_INTR_NEGEDGE);
+        }
+        return false;
+    }
+    return true;
+}
+
+void ArduinoSleep::allowLightSleep(bool allowed) {
+    if (noSleepLock == nullptr) {
+        return;
+    }
+    if (allowed) {
+        esp_pm_lock_release(noSleepLock);
+    } else {
+        esp_pm_lock_acquire(noSleepLock);
+    }
+}
+
+void ArduinoSleep::waitForWake(unsigned long ms) {
+    // The idle task light-sleeps while this blocks. A wake-up given while the loop was still busy
+    // ends the wait at once, which only costs one extra loop pass
+    waitingTask = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms));
+}
+
+void IRAM_ATTR ArduinoSleep::wakeFromIsr() {
+    TaskHandle_t task = waitingTask;
+    if (task == nullptr) {
+        return;
+    }
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+void ArduinoNetwork::setStationMode() {
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);  // WiFiManager decides which network to retry
+}
+
+void ArduinoNetwork::setEventHandler(NetworkEventHandler handler, void* context) {
+    WiFi.onEvent([handler, context](WiFiEvent_t event, WiFiEventInfo_t) {
+        switch (event) {
+            case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+                handler(NETWORK_EVENT_GOT_IP, context);
+                break;
+            case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+                handler(NETWORK_EVENT_DISCONNECTED, context);
+                break;
+            default:
+                break;
+        }
+    });
+}
+
+void ArduinoNetwork::setStaticIP(const NetworkLinkInfo& lease) {
+    WiFi.config(IPAddress(lease.ip), IPAddress(lease.gateway), IPAddress(lease.subnet), IPAddress(lease.dns));
+}
+
+void ArduinoNetwork::useDhcp() {
+    // All-zero addresses switch the station back to DHCP
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+}
+
+bool ArduinoNetwork::getLinkInfo(NetworkLinkInfo& info) {
+    if (WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+    const uint8_t* bssid = WiFi.BSSID();
+    if (bssid == nullptr) {
+        return false;
+    }
+    memcpy(info.bssid, bssid, sizeof(info.bssid));
+    info.channel = WiFi.channel();
+    info.ip = WiFi.localIP();
+    info.gateway = WiFi.gatewayIP();
+    info.subnet = WiFi.subnetMask();
+    info.dns = WiFi.dnsIP();
+    return true;
+}
+
+ArduinoHttpTransport::ArduinoHttpTransport() {
+    http.setReuse(true);
+    http.setTimeout(HTTP_TIMEOUT);
+}
+
+bool ArduinoHttpTransport::resolve(const char* host, IPAddress& ip) {
+    if (ip.fromString(host)) {
+        return true;  // IP literal, no lookup needed
+    }
+    return WiFi.hostByName(host, ip) == 1;
+}
+
+bool ArduinoHttpTransport::connect(const IPAddress& ip, uint16_t port, uint32_t timeout) {
+    if (!client.connect(ip, port, timeout)) {
+        return false;
+    }
+    client.setNoDelay(true);
+    return true;
+}
+
+int ArduinoHttpTransport::post(const String& host, uint16_t port, const String& path,
+                               const char* contentType, const uint8_t* payload, size_t length) {
+    http.begin(client, host, port, path);
+    http.addHeader("Content-Type", contentType);
+    return http.POST(const_cast<uint8_t*>(payload), length);
+}
@@ -0,0 +1,116 @@
+#ifndef HAL_ARDUINO_H
+#define HAL_ARDUINO_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_PN532.h>
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include <HTTPClient.h>
+#include <esp_pm.h>
+#include "config.h"
+#include "hal.h"
+
+// ESP32/Arduino implementations of the hardware interfaces in hal.h
+
+class ArduinoClock : public Clock {
+    public:
+        unsigned long millis() override { return ::millis(); }
+        unsigned long micros() override { return ::micros(); }
+        void delay(unsigned long ms) override { ::delay(ms); }
+};
+
+class ArduinoSleep : public SleepController {
+    private:
+        esp_pm_lock_handle_t noSleepLock;  // Held except while the loop task waits in waitForWake()
+        static TaskHandle_t volatile waitingTask;  // Loop task, set by its first waitForWake()
+
+    public:
+        ArduinoSleep() : noSleepLock(nullptr) {}
+        void setCpuFrequency(uint32_t mhz) override { setCpuFrequencyMhz(mhz); }
+        void enableModemSleep() override { WiFi.setSleep(WIFI_PS_MIN_MODEM); }
+        bool enableAutoLightSleep(int wakePin) override;
+        void allowLightSleep(bool allowed) override;
+        void waitForWake(unsigned long ms) override;
+        static void IRAM_ATTR wakeFromIsr();    // Ends a pending waitForWake()
+};
+
+class Pn532Reader : public NfcReader {
+    private:
+        Adafruit_PN532& nfc;
+        int irqPin;
+        int muxChannel;                         // TCA9548A channel, -1 if the reader is on the bus directly
+        unsigned long lastIrqLatency;
+        bool poweredDown;
+        static volatile unsigned long irqTime;  // millis() of the last IRQ falling edge
+        static int irqGpio;                     // Pin onIrq() masks until the next startDetection()
+        static bool busStarted;
+        static int selectedChannel;             // Mux channel currently routed, -1 if unknown
+
+        static void IRAM_ATTR onIrq();
+        void select();  // Route the bus to this reader before any transfer
+
+        // Raw I2C frame exchange for commands the Adafruit library does not expose
+        bool waitReady(uint16_t timeout);
+        int exchangeRaw(const uint8_t* command, uint8_t length,
+                        uint8_t* response, uint8_t responseSize, uint16_t timeout);
+
+    public:
+        // Readers behind a mux share one Adafruit_PN532: they all answer at the same address
+        Pn532Reader(Adafruit_PN532& nfc, int irqPin = -1, int muxChannel = -1)
+            : nfc(nfc), irqPin(irqPin), muxChannel(muxChannel), lastIrqLatency(0), poweredDown(false) {}
+        bool begin() override;
+        uint32_t getFirmwareVersion() override { select(); return nfc.getFirmwareVersion(); }
+        bool configure() override { select(); return nfc.SAMConfig(); }
+        uint8_t readPassiveTargets(NfcTarget* targets, uint8_t maxTargets, uint16_t timeout) override;
+        bool setActivationRetries(uint8_t retries) override { select(); return nfc.setPassiveActivationRetries(retries); }
+        PresenceResult checkPresence() override;
+        bool powerDown() override;
+        bool wakeUp() override;
+
+        bool hasIrq() override { return irqPin >= 0; }
+        bool startDetection() override;
+        bool isDetectionReady() override;
+        bool readDetectedTarget(NfcTarget& target) override;
+        unsigned long getLastIrqLatency() override { return lastIrqLatency; }
+};
+
+class ArduinoNetwork : public NetworkInterface {
+    public:
+        void setStationMode() override;
+        void setEventHandler(NetworkEventHandler handler, void* context) override;
+        bool startScan() override { return WiFi.scanNetworks(true) != WIFI_SCAN_FAILED; }
+        int scanResult() override { return WiFi.scanComplete(); }
+        String scannedSSID(int index) override { return WiFi.SSID(index); }
+        void clearScan() override { WiFi.scanDelete(); }
+        void begin(const char* ssid, const char* password) override { WiFi.begin(ssid, password); }
+        void beginDirect(const char* ssid, const char* password,
+                         uint8_t channel, const uint8_t* bssid) override { WiFi.begin(ssid, password, channel, bssid); }
+        void setStaticIP(const NetworkLinkInfo& lease) override;
+        void useDhcp() override;
+        bool getLinkInfo(NetworkLinkInfo& info) override;
+        void disconnect() override { WiFi.disconnect(); }
+        bool isLinkUp() override { return WiFi.status() == WL_CONNECTED; }
+        String currentSSID() override { return WiFi.SSID(); }
+        int rssi() override { return WiFi.RSSI(); }
+        IPAddress localIP() override { return WiFi.localIP(); }
+};
+
+class ArduinoHttpTransport : public HttpTransport {
+    private:
+        HTTPClient http;
+        WiFiClient client;  // Kept open between posts (HTTP keep-alive)
+
+    public:
+        ArduinoHttpTransport();
+        bool resolve(const char* host, IPAddress& ip) override;
+        bool connect(const IPAddress& ip, uint16_t port, uint32_t timeout) override;
+        bool connected() override { return client.connected(); }
+        void stop() override { client.stop(); }
+        int post(const String& host, uint16_t port, const String& path,
+                 const char* contentType, const uint8_t* payload, size_t length) override;
+        String readResponse() override { return http.getString(); }
+        void endRequest() override { http.end(); }
+};
+
+#endif // HAL_ARDUINO_H
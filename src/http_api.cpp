@@ -0,0 +1,284 @@
+#include "http_api.h"
+#include "metrics.h"
+#include "logger.h"
+
+HttpApi::HttpApi(EventQueue& queue, WebhookManager& webhook, WiFiManager& wifi)
+    : server(HTTP_API_PORT), queue(queue), webhook(webhook), wifi(wifi), deviceId(""), serverTask(nullptr),
+      listening(false), serving(false), chunkLength(0), requestCount(0), eventsServed(0),
+      unauthorizedCount(0) {
+}
+
+void HttpApi::serverTaskEntry(void* param) {
+    static_cast<HttpApi*>(param)->serverLoop();
+}
+
+void HttpApi::serverLoop() {
+    for (;;) {
+        // The listening socket survives reconnects, so it is only opened once
+        if (!listening && wifi.isConnected()) {
+            server.begin();
+            listening = true;
+            LOG_INFO("HTTP API listening on http://%s:%d/", wifi.getIPAddress().c_str(), HTTP_API_PORT);
+        }
+        if (listening) {
+            server.handleClient();
+        }
+        vTaskDelay(pdMS_TO_TICKS(HTTP_API_POLL_INTERVAL));
+    }
+}
+
+bool HttpApi::begin(const String& deviceId) {
+    DEBUG_SERIAL.println("\nInitializing HTTP API...");
+    this->deviceId = deviceId;
+
+    // Anyone on the network could read the journal otherwise
+    if (strlen(HTTP_API_TOKEN) == 0) {
+        DEBUG_SERIAL.println("Error: HTTP API needs HTTP_API_TOKEN in credentials.h!");
+        return false;
+    }
+    server.collectHeaders(nullptr, 0);  // Collects the Authorization header
+
+    // Handlers run on the server task, inside handleClient()
+    server.on("/events", HTTP_GET, [this]() { handleEvents(); });
+    server.on("/status", HTTP_GET, [this]() { handleStatus(); });
+    server.on("/metrics", HTTP_GET, [this]() { handleMetrics(); });
+    server.onNotFound([this]() { handleNotFound(); });
+
+    if (xTaskCreate(serverTaskEntry, "http_api", HTTP_API_STACK_SIZE,
+                    this, HTTP_API_PRIORITY, &serverTask) != pdPASS) {
+        DEBUG_SERIAL.println("Error: Could not start HTTP API task!");
+        return false;
+    }
+
+    DEBUG_SERIAL.printf("HTTP API initialized (port %d, waiting for WiFi)\n", HTTP_API_PORT);
+    return true;
+}
+
+void HttpApi::appendChunk(const char* data, size_t length) {
+    if (chunkLength + length > sizeof(chunk)) {
+        flushChunk();
+    }
+    if (length > sizeof(chunk)) {
+        server.sendContent(data, length);
+        return;
+    }
+    memcpy(chunk + chunkLength, data, length);
+    chunkLength += length;
+}
+
+void HttpApi::flushChunk() {
+    if (chunkLength > 0) {
+        server.sendContent(chunk, chunkLength);
+        chunkLength = 0;
+    }
+}
+
+void HttpApi::sendJson(const JsonDocument& doc) {
+    String body;
+    serializeJson(doc, body);
+    server.send(200, "application/json", body);
+}
+
+bool HttpApi::authorize() {
+    String presented;
+    String authorization = server.header("Authorization");
+    if (authorization.startsWith("Bearer ")) {
+        presented = authorization.substring(7);
+    } else if (server.hasArg("token")) {
+        presented = server.arg("token");
+    }
+
+    // Compares every byte, so the answer time does not reveal how much of the token matched
+    const char* token = HTTP_API_TOKEN;
+    size_t tokenLength = strlen(token);
+    uint8_t difference = presented.length() != tokenLength;
+    for (size_t i = 0; i < tokenLength && i < presented.length(); i++) {
+        difference |= presented[i] ^ token[i];
+    }
+    if (difference == 0) {
+        return true;
+    }
+
+    unauthorizedCount++;
+    server.sendHeader("WWW-Authenticate", "Bearer");
+    server.send(401, "application/json", "{\"error\":\"unauthorized\"}");
+    return false;
+}
+
+void HttpApi::handleEvents() {
+    if (!authorize()) {
+        return;
+    }
+    serving = true;
+    requestCount++;
+
+    const EventJournal& journal = queue.getJournal();
+    if (!journal.isMounted()) {
+        server.send(503, "application/json", "{\"error\":\"event journal unavailable\"}");
+        serving = false;
+        return;
+    }
+
+    uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), nullptr, 10) : 0;
+    uint32_t limit = HTTP_API_MAX_EVENTS;
+    if (server.hasArg("limit")) {
+        limit = constrain(strtoul(server.arg("limit").c_str(), nullptr, 10), 1UL, (unsigned long)HTTP_API_MAX_EVENTS);
+    }
+
+    // Chunked response: the event count is unknown until the journal has been read
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    chunkLength = 0;
+
+    // oldest_seq > since tells the collector that events were recycled before it pulled them
+    char text[512];
+    int length = snprintf(text, sizeof(text), "{\"device_id\":\"%s\",\"since\":%u,\"oldest_seq\":%u,\"events\":[",
+                          deviceId.c_str(), since, journal.getOldestSeq());
+    appendChunk(text, length);
+
+    StaticJsonDocument<512> eventDoc;
+    uint32_t seq = since;
+    uint32_t sent = 0;
+    while (sent < limit && server.client().connected()) {
+        uint32_t nextSeq;
+        size_t count = queue.readJournal(seq, records, min((uint32_t)HTTP_API_READ_BATCH, limit - sent), nextSeq);
+        if (count == 0 && nextSeq == seq) {
+            break;  // Caught up with the head
+        }
+        seq = nextSeq;
+
+        for (size_t i = 0; i < count; i++) {
+            eventDoc.clear();
+            JsonObject event = eventDoc.to<JsonObject>();
+            event["seq"] = records[i].seq;
+            fillPollResult(event, records[i].event, deviceId.c_str());
+
+            size_t eventLength = 0;
+            if (sent > 0) {
+                text[eventLength++] = ',';
+            }
+            eventLength += serializeJson(eventDoc, text + eventLength, sizeof(text) - eventLength);
+            appendChunk(text, eventLength);
+            sent++;
+        }
+    }
+
+    // next_seq is the since value for the following request; head_seq < since means the journal was reset
+    uint32_t headSeq = journal.getHeadSeq();
+    length = snprintf(text, sizeof(text), "],\"count\":%u,\"next_seq\":%u,\"head_seq\":%u,\"more\":%s}",
+                      sent, seq, headSeq, seq < headSeq ? "true" : "false");
+    appendChunk(text, length);
+    flushChunk();
+    server.sendContent("");  // Final empty chunk ends the response
+
+    eventsServed += sent;
+    serving = false;
+}
+
+void HttpApi::handleStatus() {
+    if (!authorize()) {
+        return;
+    }
+    serving = true;
+    requestCount++;
+
+    StaticJsonDocument<1536> doc;  // Up to WEBHOOK_MAX_ENDPOINTS endpoint entries
+    doc["device_id"] = deviceId.c_str();
+    doc["uptime_ms"] = millis();
+    doc["free_heap"] = ESP.getFreeHeap();
+
+    JsonObject wifiObject = doc.createNestedObject("wifi");
+    wifiObject["state"] = wifi.getStateName();
+    wifiObject["connected"] = wifi.isConnected();
+    wifiObject["network"] = wifi.getNetworkIndex();
+    wifiObject["rssi"] = wifi.getRSSI();
+    wifiObject["reconnects"] = wifi.getReconnectCount();
+
+    // The timestamp string is copied into the document
+    char timestamp[TIMESTAMP_TEXT_SIZE];
+    uint64_t epochMs = wifi.getEpochMillis();
+    formatTimestamp(epochMs, timestamp, sizeof(timestamp));
+    JsonObject timeObject = doc.createNestedObject("time");
+    timeObject["synced"] = wifi.isTimeSynced();
+    if (epochMs != 0) {
+        timeObject["now"] = timestamp;
+    } else {
+        timeObject["now"] = nullptr;
+    }
+    timeObject["drift_ppm"] = wifi.getDriftPpm();
+    timeObject["error_bound_ms"] = wifi.getTimestampErrorBound();
+
+    JsonObject queueObject = doc.createNestedObject("queue");
+    queueObject["depth"] = queue.getDepth();
+    queueObject["peak_depth"] = queue.getPeakDepth();
+    queueObject["enqueued"] = queue.getEnqueuedCount();
+    queueObject["sent"] = queue.getSentCount();
+    queueObject["failed"] = queue.getFailedCount();
+    queueObject["rejected"] = queue.getRejectedCount();
+    queueObject["overflow"] = queue.getOverflowCount();
+
+    JsonObject webhookObject = doc.createNestedObject("webhook");
+    webhookObject["retry_attempt"] = queue.getRetryAttempt();
+    webhookObject["next_retry_ms"] = queue.getNextRetryIn();
+    webhookObject["failovers"] = webhook.getFailoverCount();
+    JsonArray endpointArray = webhookObject.createNestedArray("endpoints");
+    for (size_t i = 0; i < webhook.getEndpointCount(); i++) {
+        const WebhookEndpoint& endpoint = webhook.getEndpoint(i);
+        JsonObject endpointObject = endpointArray.createNestedObject();
+        endpointObject["host"] = endpoint.host.c_str();
+        endpointObject["circuit"] = endpoint.breaker.getStateName();
+        endpointObject["latency_ms"] = endpoint.latencyEwma;
+        endpointObject["error_permille"] = endpoint.errorEwma;
+        endpointObject["requests"] = endpoint.requestCount;
+        endpointObject["failures"] = endpoint.failureCount;
+        endpointObject["circuit_opens"] = endpoint.breaker.getOpenCount();
+        endpointObject["skipped_requests"] = endpoint.breaker.getRejectedCount();
+    }
+
+    const EventJournal& journal = queue.getJournal();
+    JsonObject journalObject = doc.createNestedObject("journal");
+    journalObject["mounted"] = journal.isMounted();
+    journalObject["oldest_seq"] = journal.getOldestSeq();
+    journalObject["read_seq"] = journal.getReadSeq();  // Next event the webhook will send
+    journalObject["head_seq"] = journal.getHeadSeq();
+    journalObject["backlog"] = journal.pendingCount();
+    journalObject["capacity"] = journal.getCapacity();
+    journalObject["overwritten"] = journal.getOverwrittenCount();
+    journalObject["corrupt"] = journal.getCorruptCount();
+
+    JsonObject apiObject = doc.createNestedObject("api");
+    apiObject["requests"] = requestCount;
+    apiObject["events_served"] = eventsServed;
+
+    sendJson(doc);
+    serving = false;
+}
+
+void HttpApi::handleMetrics() {
+    if (!authorize()) {
+        return;
+    }
+    serving = true;
+    requestCount++;
+
+    StaticJsonDocument<HEARTBEAT_DOC_CAPACITY> doc;
+    JsonObject root = doc.to<JsonObject>();
+    root["device_id"] = deviceId.c_str();
+    root["uptime_ms"] = millis();
+    metrics.writeJson(root);
+
+    sendJson(doc);
+    serving = false;
+}
+
+void HttpApi::handleNotFound() {
+    server.send(404, "application/json", "{\"error\":\"not found\",\"endpoints\":[\"/events\",\"/status\",\"/metrics\"]}");
+}
+
+void HttpApi::printApiStatus() {
+    DEBUG_SERIAL.println("\n--- HTTP API Status ---");
+    DEBUG_SERIAL.printf("Listening: %s (port %d)\n", listening ? "YES" : "NO", HTTP_API_PORT);
+    DEBUG_SERIAL.printf("Requests: %u, Events served: %u, Unauthorized: %u\n",
+                        requestCount, eventsServed, unauthorizedCount);
+    DEBUG_SERIAL.println("--- End HTTP API Status ---\n");
+}
@@ -0,0 +1,76 @@
+#ifndef HTTP_API_H
+#define HTTP_API_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WebServer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "event_queue.h"
+#include "webhook_manager.h"
+#include "wifi_manager.h"
+
+// Shared secret for every request, from credentials.h; the API does not start without one
+#ifndef HTTP_API_TOKEN
+#define HTTP_API_TOKEN ""
+#endif
+
+/**
+ * Local HTTP API for collectors that pull events instead of receiving the webhook:
+ *   GET /events?since=<seq>&limit=<n>  retained journal events from seq on, streamed
+ *   GET /status                         device, WiFi, time, queue and webhook state
+ *   GET /metrics                        the metrics registry (same object as the heartbeat)
+ *
+ * /events reads the journal HTTP_API_READ_BATCH records at a time and sends the
+ * response in chunks, so its RAM use does not depend on the number of events.
+ * The server runs on its own task; a slow client never stalls tag polling.
+ *
+ * Every request must carry HTTP_API_TOKEN, as "Authorization: Bearer <token>" or
+ * as ?token=<token>; anything else gets 401.
+ */
+class HttpApi {
+    private:
+        WebServer server;
+        EventQueue& queue;
+        WebhookManager& webhook;
+        WiFiManager& wifi;
+        String deviceId;
+        TaskHandle_t serverTask;
+        bool listening;
+        volatile bool serving;      // A request is being answered, see isServing()
+
+        // Kept off the server task stack
+        JournalRecord records[HTTP_API_READ_BATCH];
+        char chunk[HTTP_API_CHUNK_SIZE];
+        size_t chunkLength;
+
+        // Counters
+        volatile uint32_t requestCount;
+        volatile uint32_t eventsServed;
+        volatile uint32_t unauthorizedCount;
+
+        static void serverTaskEntry(void* param);
+        void serverLoop();
+        void handleEvents();
+        void handleStatus();
+        void handleMetrics();
+        void handleNotFound();
+        bool authorize();  // Sends 401 and returns false unless the request carries the token
+        void sendJson(const JsonDocument& doc);
+        void appendChunk(const char* data, size_t length);
+        void flushChunk();
+
+    public:
+        HttpApi(EventQueue& queue, WebhookManager& webhook, WiFiManager& wifi);
+        bool begin(const String& deviceId);  // Starts the server task; it listens once WiFi is up
+
+        // Status and info
+        bool isServing() const { return serving; }
+        uint32_t getRequestCount() const { return requestCount; }
+        uint32_t getEventsServed() const { return eventsServed; }
+        uint32_t getUnauthorizedCount() const { return unauthorizedCount; }
+        void printApiStatus();
+};
+
+#endif // HTTP_API_H
@@ -0,0 +1,419 @@
+#include "logger.h"
+
+Logger logger;
+
+static const uint32_t RING_MASK = LOG_RING_SLOTS - 1;
+
+static const char* const LEVEL_NAMES[] = { "none", "error", "warn", "info", "debug" };
+
+// What one printf conversion takes from the argument list
+enum ArgType : uint8_t {
+    ARG_NONE,           // %%
+    ARG_INT,            // Also char and short, which are promoted to int
+    ARG_LONG,
+    ARG_LONG_LONG,
+    ARG_SIZE,
+    ARG_POINTER,
+    ARG_DOUBLE,         // Also float, promoted to double
+    ARG_STRING,
+    ARG_UNSUPPORTED     // '*' width or precision, %n or an unknown conversion
+};
+
+/**
+ * Parses the conversion that starts after a '%'. Returns its length, conversion character included.
+ */
+static size_t parseSpec(const char* spec, ArgType& type) {
+    size_t i = 0;
+    while (spec[i] != '\0' && strchr("-+ #0", spec[i]) != nullptr) {
+        i++;
+    }
+    while (isdigit((unsigned char)spec[i]) || spec[i] == '.') {
+        i++;
+    }
+    uint8_t longs = 0;
+    bool sized = false;
+    while (spec[i] == 'h') {
+        i++;
+    }
+    while (spec[i] == 'l') {
+        longs++;
+        i++;
+    }
+    if (spec[i] == 'z') {
+        sized = true;
+        i++;
+    }
+
+    switch (spec[i]) {
+        case '%':
+            type = ARG_NONE;
+            break;
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            type = sized ? ARG_SIZE : longs >= 2 ? ARG_LONG_LONG : longs == 1 ? ARG_LONG : ARG_INT;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+            type = ARG_DOUBLE;
+            break;
+        case 's':
+            type = ARG_STRING;
+            break;
+        case 'p':
+            type = ARG_POINTER;
+            break;
+        default:
+            type = ARG_UNSUPPORTED;
+            return i;
+    }
+    return i + 1;
+}
+
+static bool store(uint8_t* args, uint8_t& length, const void* value, size_t size) {
+    if (length + size > LOG_RECORD_SIZE) {
+        return false;
+    }
+    memcpy(args + length, value, size);
+    length += size;
+    return true;
+}
+
+static bool fetch(const uint8_t* args, uint8_t length, size_t& offset, void* value, size_t size) {
+    if (offset + size > length) {
+        return false;
+    }
+    memcpy(value, args + offset, size);
+    offset += size;
+    return true;
+}
+
+Logger::Logger()
+    : writePos(0), readPos(0), drainTask(nullptr), started(false), writtenCount(0), droppedCount(0),
+      peakUsed(0), reportedDropped(0), callerTime(0), maxCallerTime(0) {
+    for (uint32_t i = 0; i < LOG_RING_SLOTS; i++) {
+        ring[i].sequence.store(i);
+    }
+}
+
+void Logger::drainTaskEntry(void* param) {
+    static_cast<Logger*>(param)->drainLoop();
+}
+
+void Logger::drainLoop() {
+    for (;;) {
+        if (!drainOne()) {
+            printDropped();
+            vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL));
+        }
+    }
+}
+
+bool Logger::begin() {
+    if (!LOG_ASYNC) {
+        return true;
+    }
+    if (xTaskCreate(drainTaskEntry, "log_drain", LOG_DRAIN_STACK_SIZE,
+                    this, LOG_DRAIN_PRIORITY, &drainTask) != pdPASS) {
+        DEBUG_SERIAL.println("Error: Could not start log task, logging in the caller");
+        return false;
+    }
+    started = true;
+    return true;
+}
+
+void Logger::capture(Record& record, const char* format, va_list args) {
+    record.format = format;
+    record.length = 0;
+    record.truncated = false;
+
+    for (const char* p = format; *p != '\0'; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        ArgType type;
+        size_t specLength = parseSpec(p + 1, type);
+        bool stored = true;
+        switch (type) {
+            case ARG_NONE:
+                break;
+            case ARG_INT: {
+                int value = va_arg(args, int);
+                stored = store(record.args, record.length, &value, sizeof(value));
+                break;
+            }
+            case ARG_LONG: {
+                long value = va_arg(args, long);
+                stored = store(record.args, record.length, &value, sizeof(value));
+                break;
+            }
+            case ARG_LONG_LONG: {
+                long long value = va_arg(args, long long);
+                stored = store(record.args, record.length, &value, sizeof(value));
+                break;
+            }
+            case ARG_SIZE: {
+                size_t value = va_arg(args, size_t);
+                stored = store(record.args, record.length, &value, sizeof(value));
+                break;
+            }
+            case ARG_POINTER: {
+                void* value = va_arg(args, void*);
+                stored = store(record.args, record.length, &value, sizeof(value));
+                break;
+            }
+            case ARG_DOUBLE: {
+                double value = va_arg(args, double);
+                stored = store(record.args, record.length, &value, sizeof(value));
+                break;
+            }
+            case ARG_STRING: {
+                const char* value = va_arg(args, const char*);
+                if (value == nullptr) {
+                    value = "(null)";
+                }
+                // Copied with its terminator; a string longer than the space left ends in "..."
+                size_t room = LOG_RECORD_SIZE - record.length;
+                size_t length = strnlen(value, room);
+                if (room < 4) {
+                    stored = false;
+                } else if (length < room) {
+                    memcpy(record.args + record.length, value, length + 1);
+                    record.length += length + 1;
+                } else {
+                    memcpy(record.args + record.length, value, room - 4);
+                    memcpy(record.args + record.length + room - 4, "...", 4);
+                    record.length = LOG_RECORD_SIZE;
+                }
+                break;
+            }
+            case ARG_UNSUPPORTED:
+                stored = false;
+                break;
+        }
+        if (!stored) {
+            // The remaining arguments cannot be located, so the line ends here
+            record.truncated = true;
+            return;
+        }
+        p += specLength;
+    }
+}
+
+size_t Logger::render(const Record& record, char* line, size_t size) {
+    size_t used = 0;
+    size_t offset = 0;
+    bool complete = true;
+    const char* p = record.format;
+
+    while (*p != '\0' && used + 1 < size) {
+        if (*p != '%') {
+            line[used++] = *p++;
+            continue;
+        }
+        ArgType type;
+        size_t specLength = parseSpec(p + 1, type) + 1;
+        char spec[16];
+        if (type == ARG_UNSUPPORTED || specLength >= sizeof(spec)) {
+            complete = false;
+            break;
+        }
+        memcpy(spec, p, specLength);
+        spec[specLength] = '\0';
+        p += specLength;
+
+        int written = 0;
+        bool fetched = true;
+        switch (type) {
+            case ARG_NONE:
+                written = snprintf(line + used, size - used, "%%");
+                break;
+            case ARG_INT: {
+                int value;
+                if ((fetched = fetch(record.args, record.length, offset, &value, sizeof(value)))) {
+                    written = snprintf(line + used, size - used, spec, value);
+                }
+                break;
+            }
+            case ARG_LONG: {
+                long value;
+                if ((fetched = fetch(record.args, record.length, offset, &value, sizeof(value)))) {
+                    written = snprintf(line + used, size - used, spec, value);
+                }
+                break;
+            }
+            case ARG_LONG_LONG: {
+                long long value;
+                if ((fetched = fetch(record.args, record.length, offset, &value, sizeof(value)))) {
+                    written = snprintf(line + used, size - used, spec, value);
+                }
+                break;
+            }
+            case ARG_SIZE: {
+                size_t value;
+                if ((fetched = fetch(record.args, record.length, offset, &value, sizeof(value)))) {
+                    written = snprintf(line + used, size - used, spec, value);
+                }
+                break;
+            }
+            case ARG_POINTER: {
+                void* value;
+                if ((fetched = fetch(record.args, record.length, offset, &value, sizeof(value)))) {
+                    written = snprintf(line + used, size - used, spec, value);
+                }
+                break;
+            }
+            case ARG_DOUBLE: {
+                double value;
+                if ((fetched = fetch(record.args, record.length, offset, &value, sizeof(value)))) {
+                    written = snprintf(line + used, size - used, spec, value);
+                }
+                break;
+            }
+            case ARG_STRING: {
+                const char* value = reinterpret_cast<const char*>(record.args + offset);
+                if ((fetched = offset < record.length)) {
+                    offset += strlen(value) + 1;
+                    written = snprintf(line + used, size - used, spec, value);
+                }
+                break;
+            }
+            case ARG_UNSUPPORTED:
+                break;
+        }
+        if (!fetched) {
+            complete = false;
+            break;
+        }
+        if (written > 0) {
+            used += min((size_t)written, size - used - 1);
+        }
+    }
+
+    // Arguments that did not fit the record
+    if (!complete || record.truncated) {
+        used = min(used, size - 4);
+        memcpy(line + used, "...", 3);
+        used += 3;
+    }
+    line[used] = '\0';
+    return used;
+}
+
+void Logger::recordCallerTime(unsigned long start) {
+    uint32_t elapsed = micros() - start;
+    callerTime += elapsed;
+    uint32_t longest = maxCallerTime.load();
+    while (elapsed > longest && !maxCallerTime.compare_exchange_weak(longest, elapsed)) {
+    }
+}
+
+void Logger::printNow(const char* format, va_list args) {
+    char line[LOG_LINE_SIZE];
+    vsnprintf(line, sizeof(line), format, args);
+    DEBUG_SERIAL.println(line);
+}
+
+void Logger::write(const char* format, ...) {
+    unsigned long start = micros();
+    va_list args;
+    va_start(args, format);
+    if (!started) {
+        printNow(format, args);
+        va_end(args);
+        writtenCount++;
+        recordCallerTime(start);
+        return;
+    }
+
+    // Claim a slot: its sequence equals the write position while it is free (bounded MPMC ring)
+    uint32_t pos = writePos.load(std::memory_order_relaxed);
+    Record* record;
+    for (;;) {
+        record = &ring[pos & RING_MASK];
+        int32_t diff = (int32_t)(record->sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full: the log task is behind, drop instead of waiting for it
+            va_end(args);
+            droppedCount++;
+            recordCallerTime(start);
+            return;
+        } else {
+            pos = writePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    capture(*record, format, args);
+    va_end(args);
+    record->sequence.store(pos + 1, std::memory_order_release);
+
+    uint32_t waiting = pos + 1 - readPos.load(std::memory_order_relaxed);
+    uint32_t peak = peakUsed.load();
+    while (waiting > peak && !peakUsed.compare_exchange_weak(peak, waiting)) {
+    }
+    writtenCount++;
+    recordCallerTime(start);
+}
+
+bool Logger::drainOne() {
+    uint32_t pos = readPos.load(std::memory_order_relaxed);
+    Record* record;
+    for (;;) {
+        record = &ring[pos & RING_MASK];
+        int32_t diff = (int32_t)(record->sequence.load(std::memory_order_acquire) - (pos + 1));
+        if (diff == 0) {
+            if (readPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;  // Empty, or the next message is still being written
+        } else {
+            pos = readPos.load(std::memory_order_relaxed);
+        }
+    }
+
+    char line[LOG_LINE_SIZE];
+    render(*record, line, sizeof(line));
+    // Free the slot before the slow serial write
+    record->sequence.store(pos + LOG_RING_SLOTS, std::memory_order_release);
+    DEBUG_SERIAL.println(line);
+    return true;
+}
+
+void Logger::printDropped() {
+    uint32_t dropped = droppedCount.load();
+    if (dropped != reportedDropped) {
+        DEBUG_SERIAL.printf("Log: %u messages dropped (ring full)\n", dropped - reportedDropped);
+        reportedDropped = dropped;
+    }
+}
+
+void Logger::flush() {
+    while (drainOne()) {
+    }
+}
+
+void Logger::printLogStatus(uint32_t events) {
+    uint32_t written = writtenCount.load();
+    uint32_t spent = callerTime.load();
+
+    DEBUG_SERIAL.println("\n--- Log Status ---");
+    DEBUG_SERIAL.printf("Level: %s, Output: %s\n", LEVEL_NAMES[LOG_LEVEL],
+                        started ? "log task" : "in caller");
+    DEBUG_SERIAL.printf("Messages: %u written, %u dropped, Ring peak: %u of %d slots\n",
+                        written, droppedCount.load(), peakUsed.load(), LOG_RING_SLOTS);
+    if (written > 0) {
+        DEBUG_SERIAL.printf("Caller time: %u us per message (max %u us)\n",
+                            spent / written, maxCallerTime.load());
+    }
+    if (events > 0) {
+        // Everything logged so far (webhook and WiFi included) over the tag events
+        DEBUG_SERIAL.printf("Per tag event: %u us, %u.%u messages\n",
+                            spent / events, written / events, (written * 10 / events) % 10);
+    }
+    if (started) {
+        DEBUG_SERIAL.printf("Log task stack free: %u bytes\n", (unsigned)uxTaskGetStackHighWaterMark(drainTask));
+    }
+    DEBUG_SERIAL.println("--- End Log Status ---\n");
+}
@@ -0,0 +1,102 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <stdarg.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "config.h"
+
+#if (LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) != 0
+#error "LOG_RING_SLOTS must be a power of two"
+#endif
+#if LOG_RECORD_SIZE > 255
+#error "LOG_RECORD_SIZE must fit Logger::Record::length (255 bytes max)"
+#endif
+
+// Messages above LOG_LEVEL compile to nothing, arguments included, so they must not have side effects.
+// The format must be a string literal: the ring keeps a pointer to it, not a copy
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(format, ...) logger.write("" format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(format, ...) logger.write("" format, ##__VA_ARGS__)
+#else
+#define LOG_WARN(format, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(format, ...) logger.write("" format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(format, ...) logger.write("" format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) do {} while (0)
+#endif
+
+/**
+ * Debug log that keeps serial output off the poll loop and the sender task.
+ *
+ * write() does not format: it copies the format pointer and the raw arguments
+ * (strings by value, cut to LOG_RECORD_SIZE) into a slot of a fixed ring, and
+ * the log task formats and prints the line later at LOG_DRAIN_PRIORITY. Slots
+ * are claimed with a compare-and-swap on the write position, so any task can
+ * log without a lock; when the ring is full the message is counted as dropped
+ * and the caller carries on. Each message becomes one line.
+ * Supports the printf conversions used in this code except '*' widths and %n.
+ * Before begin(), and with LOG_ASYNC 0, messages print in the caller.
+ */
+class Logger {
+    private:
+        struct Record {
+            std::atomic<uint32_t> sequence;     // Slot state, see write() and drainOne()
+            const char* format;
+            uint8_t length;                     // bytes used in args
+            bool truncated;                     // Arguments did not fit; the line ends at the first missing one
+            uint8_t args[LOG_RECORD_SIZE];
+        };
+
+        Record ring[LOG_RING_SLOTS];
+        std::atomic<uint32_t> writePos;
+        std::atomic<uint32_t> readPos;
+        TaskHandle_t drainTask;
+        bool started;
+
+        // Statistics
+        std::atomic<uint32_t> writtenCount;
+        std::atomic<uint32_t> droppedCount;
+        std::atomic<uint32_t> peakUsed;         // Most slots waiting at once
+        uint32_t reportedDropped;               // Drops already announced by the log task
+        std::atomic<uint32_t> callerTime;       // us spent in write(), all messages
+        std::atomic<uint32_t> maxCallerTime;    // us
+
+        static void drainTaskEntry(void* param);
+        void drainLoop();
+        bool drainOne();
+        void printDropped();
+        void printNow(const char* format, va_list args);
+        static void capture(Record& record, const char* format, va_list args);
+        static size_t render(const Record& record, char* line, size_t size);
+        void recordCallerTime(unsigned long start);
+
+    public:
+        Logger();
+        bool begin();  // Starts the log task; until then messages print in the caller
+
+        void write(const char* format, ...) __attribute__((format(printf, 2, 3)));
+        void flush();  // Prints every waiting message in the calling task
+        bool isIdle() const { return readPos.load() == writePos.load(); }
+
+        // Status and info
+        uint32_t getWrittenCount() const { return writtenCount.load(); }
+        uint32_t getDroppedCount() const { return droppedCount.load(); }
+        void printLogStatus(uint32_t events);  // events: tag events so far, for the cost per event
+};
+
+extern Logger logger;
+
+#endif // LOGGER_H
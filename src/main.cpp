@@ -1,9 +1,19 @@
 #include <Wire.h>
 #include <Adafruit_PN532.h>
-#include <Adafruit_NeoPixel.h>
 #include "config.h"
+#include "hal_arduino.h"
 #include "wifi_manager.h"
 #include "webhook_manager.h"
+#include "event_queue.h"
+#include "reader_pool.h"
+#include "session_tracker.h"
+#include "tag_cache.h"
+#include "boot_timing.h"
+#include "power_manager.h"
+#include "metrics.h"
+#include "http_api.h"
+#include "logger.h"
+#include "status_led.h"
 
 /**
  * Generates a unique device ID based on the ESP32 chip ID
@@ -18,103 +28,328 @@ String getDeviceId() {
 // Store device ID
 String deviceId = "";
 
-// Initialize PN532 using I2C (with IRQ and RESET pins disabled)
-Adafruit_PN532 nfc(-1, -1);  // Use I2C, disable IRQ and RESET pins
+// Initialize PN532 using I2C (IRQ and RESET are -1 unless wired in config.h).
+// Readers behind the I2C mux all answer at the same address, so they share it
+Adafruit_PN532 nfc(PN532_IRQ, PN532_RESET);
+const int readerMuxChannels[] = NFC_READER_MUX_CHANNELS;
+const uint8_t readerPriorities[] = NFC_READER_PRIORITIES;
 
-// Initialize NeoPixel
-Adafruit_NeoPixel pixels(1, BUILTIN_LED_PIN, NEO_GRB + NEO_KHZ800);
+// Hardware interfaces used by the application logic
+ArduinoClock systemClock;
+ArduinoNetwork wifiNetwork;
+ArduinoHttpTransport httpTransport;
+ArduinoSleep sleepController;
 
 // Initialize managers
-WiFiManager wifiManager;
-WebhookManager webhookManager;
+WiFiManager wifiManager(wifiNetwork, systemClock);
+WebhookManager webhookManager(httpTransport, systemClock);
+TagCache tagCache;
+EventQueue eventQueue(webhookManager, wifiManager, tagCache);
+ReaderPool readerPool;
+SessionTracker sessionTracker;
+PowerManager powerManager(sleepController, systemClock, PN532_IRQ);
+HttpApi httpApi(eventQueue, webhookManager, wifiManager);
 
-// Store last successful tag read
-String lastTagId = "";
+// Tag cache answer for the last inserted tag, shown by the status LED
+TagAssignment presentAssignment = ASSIGNMENT_NOT_CHECKED;
 
 // Timing management
-unsigned long lastReadTime = 0;
-unsigned long lastWifiCheckTime = 0;
-const int I2C_RECOVERY_TIME = 100;  // ms between I2C operations
-const int TAG_READ_TIMEOUT = 1000;   // ms (increased for better detection)
-const int MAX_UID_LENGTH = 7;       // Maximum UID length we'll handle
-const int WIFI_CHECK_INTERVAL = 5000; // Check WiFi every 5 seconds
+const unsigned long LOOP_STALL_REPORT = 100;  // ms, report new longest gaps between loop() runs above this
 
-// Tag type detection
-enum TagType {
-    UNKNOWN,
-    MIFARE_CLASSIC,    // 4-byte UID
-    ISO14443_4         // 7-byte UID
-};
+// Loop stall metric: longest time between two loop() runs
+unsigned long lastLoopTime = 0;
+unsigned long maxLoopStall = 0;
+unsigned long lastPowerReportTime = 0;
+unsigned long lastMetricsSampleTime = 0;
+unsigned long lastReaderRetryTime = 0;
 
-TagType detectTagType(uint8_t uidLength) {
-    switch (uidLength) {
-        case 4:
-            return MIFARE_CLASSIC;
-        case 7:
-            return ISO14443_4;
-        default:
-            return UNKNOWN;
+void initializeRFID() {
+    // One reader per PN532, created once at boot; a single reader sits on the bus without the mux
+    for (uint8_t i = 0; i < NFC_READER_COUNT; i++) {
+        int muxChannel = NFC_READER_COUNT > 1 ? readerMuxChannels[i] : -1;
+        readerPool.addReader(*new Pn532Reader(nfc, PN532_IRQ, muxChannel), readerPriorities[i]);
+    }
+    
+    // Initialize I2C and every PN532; without any reader the rest of the device keeps running
+    if (readerPool.begin() == 0) {
+        DEBUG_SERIAL.printf("No PN532 reader answered, retrying every %d s\n", NFC_INIT_RETRY_INTERVAL / 1000);
+        statusLed.setError(LED_ERROR_NFC);
     }
 }
 
-void initializeRFID() {
-    // Increase I2C clock speed for more reliable communication
-    Wire.setClock(100000); // 100kHz standard mode
-    
-    // Initialize I2C for ESP32-C3
-    Wire.begin(PN532_SDA, PN532_SCL);
-    
-    // Initialize PN532
-    if (!nfc.begin()) {
-        DEBUG_SERIAL.println("Error: Could not initialize PN532!");
-        while (1) {
-            pixels.setPixelColor(0, COLOR_ERROR);
-            pixels.show();
-            delay(LED_ERROR_BLINK_INTERVAL);
-            pixels.setPixelColor(0, 0);
-            pixels.show();
-            delay(LED_ERROR_BLINK_INTERVAL);
+/**
+ * Brings up readers that did not answer at boot (or since), every NFC_INIT_RETRY_INTERVAL.
+ */
+void retryReaders(unsigned long now) {
+    if (readerPool.getOnlineCount() == readerPool.getCount() ||
+        now - lastReaderRetryTime < NFC_INIT_RETRY_INTERVAL) {
+        return;
+    }
+    lastReaderRetryTime = now;
+    if (readerPool.begin() > 0) {
+        statusLed.clearError(LED_ERROR_NFC);
+    }
+}
+
+/**
+ * Worst-case time from a tag arriving to the device seeing it, for the power report.
+ */
+unsigned long detectionLatency(unsigned long now) {
+    NfcReader& reader = readerPool.getReader(0);
+    return reader.hasIrq() ? reader.getLastIrqLatency() : readerPool.currentInterval(now);
+}
+
+/**
+ * Refreshes the gauges that are sampled rather than updated on change.
+ */
+void sampleMetrics() {
+    metrics.setGauge(GAUGE_FREE_HEAP, ESP.getFreeHeap());
+    metrics.setGauge(GAUGE_MIN_FREE_HEAP, ESP.getMinFreeHeap());
+    metrics.setGauge(GAUGE_QUEUE_DEPTH, eventQueue.getDepth());
+    metrics.setGauge(GAUGE_JOURNAL_BACKLOG, eventQueue.getBacklogCount());
+    metrics.setGauge(GAUGE_WIFI_RSSI, wifiManager.getRSSI());
+    metrics.setGauge(GAUGE_PRESENCE_EVENTS_SAVED, readerPool.getSavedEvents());
+}
+
+/**
+ * Single-character commands on the debug serial port:
+ * 'm' dumps the metrics, 's' prints every module's status.
+ */
+void handleSerialCommands() {
+    while (DEBUG_SERIAL.available() > 0) {
+        // Waiting log lines first, so they do not interleave with the dump
+        logger.flush();
+        switch (DEBUG_SERIAL.read()) {
+            case 'm':
+                sampleMetrics();
+                metrics.printMetrics();
+                break;
+            case 's':
+                wifiManager.printWiFiStatus();
+                eventQueue.printQueueStatus();
+                if (HTTP_API_ENABLED) {
+                    httpApi.printApiStatus();
+                }
+                readerPool.printPoolStatus(systemClock.millis());
+                if (SESSION_MODE) {
+                    sessionTracker.printSessionStatus(systemClock.millis());
+                }
+                if (TAG_CACHE_ENABLED) {
+                    tagCache.printCacheStatus();
+                }
+                powerManager.printPowerStatus(detectionLatency(systemClock.millis()));
+                logger.printLogStatus(metrics.getCounter(SESSION_MODE ? COUNTER_SESSIONS : COUNTER_TAG_EVENTS));
+                printBootTiming();
+                break;
+            default:
+                break;
         }
     }
+}
+
+/**
+ * Light sleep is only allowed while nothing is waiting to be sent or logged, no HTTP API request
+ * is being answered, WiFi is not scanning or connecting and no LED error code is blinking:
+ * each sleep adds wake-up latency to the other tasks, and an error needs attention more than power.
+ */
+bool canSleep() {
+    WiFiState wifiState = wifiManager.getState();
+    return eventQueue.getDepth() == 0 && eventQueue.getBacklogCount() == 0 && !httpApi.isServing() &&
+           logger.isIdle() && statusLed.getErrors() == 0 &&
+           wifiState != WIFI_STATE_SCANNING && wifiState != WIFI_STATE_CONNECTING;
+}
+
+/**
+ * Queues a session completed by the session tracker (SESSION_MODE).
+ */
+void publishSession(PollEvent& session) {
+    int networkIndex = wifiManager.getNetworkIndex();
+    session.networkIndex = networkIndex >= 0 ? networkIndex : POLL_EVENT_NO_NETWORK;
+    session.rssi = networkIndex >= 0 ? wifiManager.getRSSI() : 0;
+    if (TAG_CACHE_ENABLED) {
+        session.assignment = tagCache.lookup(session.uid, session.uidLength, session.assignmentId);
+    }
+    
+    bool queued = eventQueue.enqueue(session);
+    metrics.increment(COUNTER_SESSIONS);
+    if (!queued) {
+        LOG_WARN("Warning: Event queue full, event dropped (overflow %u)", eventQueue.getOverflowCount());
+    }
+    
+    // The rest is the debug printout; skip formatting it when INFO messages are compiled out
+    if (LOG_LEVEL < LOG_LEVEL_INFO) {
+        return;
+    }
+    
+    char tagId[TAG_ID_TEXT_SIZE];
+    char started[TIMESTAMP_TEXT_SIZE];
+    formatTagId(session.uid, session.uidLength, tagId, sizeof(tagId));
+    formatTimestamp(session.epochMs, started, sizeof(started));
+    
+    LOG_INFO("\nSession Completed:");
+    LOG_INFO("Tag ID: %s", tagId);
+    LOG_INFO("Started: %s", started);
+    if (session.assignment != ASSIGNMENT_NOT_CHECKED) {
+        LOG_INFO("Assignment: %s", assignmentName(session.assignment));
+    }
+    LOG_INFO("Duration: %lu s%s", (unsigned long)session.durationMs / 1000,
+             session.endEstimated ? " (ended during a reboot, estimated)" : "");
+    
+    if (queued) {
+        LOG_INFO("Event queued (depth %u)", eventQueue.getDepth());
+    }
+}
+
+/**
+ * Builds and queues the event for one confirmed presence change.
+ * The change may have happened before now (hold times), so its time is back-dated.
+ * In SESSION_MODE the change goes to the session tracker instead.
+ */
+void publishPresenceChange(const PresenceChange& change, unsigned long now) {
+    uint64_t nowEpochMs = wifiManager.getEpochMillis();
+    uint64_t detectedEpochMs = nowEpochMs != 0 ? nowEpochMs - (now - change.at) : 0;
+    
+    // Local feedback for the new tag, without a round trip
+    TagAssignment assignment = ASSIGNMENT_NOT_CHECKED;
+    uint32_t assignmentId = 0;
+    if (change.present && TAG_CACHE_ENABLED) {
+        assignment = tagCache.lookup(change.uid, change.uidLength, assignmentId);
+        presentAssignment = assignment;
+    }
+    
+    if (SESSION_MODE) {
+        PollEvent session;
+        markBootPhase(BOOT_PHASE_FIRST_EVENT);
+        if (sessionTracker.onChange(change, detectedEpochMs, session)) {
+            publishSession(session);
+        }
+        return;
+    }
+    
+    TagType tagType = change.present ? detectTagType(change.uidLength) : UNKNOWN;
+    
+    // Build the binary event record; no text is formatted on this path
+    int networkIndex = wifiManager.getNetworkIndex();
+    PollEvent event;
+    memset(&event, 0, sizeof(event));
+    event.epochMs = detectedEpochMs;
+    event.monotonicMs = change.at;
+    memcpy(event.uid, change.uid, change.uidLength);
+    event.uidLength = change.uidLength;
+    event.tagType = tagType;
+    event.tagPresent = change.present;
+    event.timeSynced = detectedEpochMs != 0;
+    event.networkIndex = networkIndex >= 0 ? networkIndex : POLL_EVENT_NO_NETWORK;
+    event.rssi = networkIndex >= 0 ? wifiManager.getRSSI() : 0;
+    event.assignment = assignment;
+    event.assignmentId = assignmentId;
+    event.readerIndex = change.reader;
+    
+    // Hand off to the sender task; never blocks the poll loop
+    bool queued = eventQueue.enqueue(event);
+    markBootPhase(BOOT_PHASE_FIRST_EVENT);
+    metrics.increment(COUNTER_TAG_EVENTS);
+    if (!queued) {
+        LOG_WARN("Warning: Event queue full, event dropped (overflow %u)", eventQueue.getOverflowCount());
+    }
+    
+    if (LOG_LEVEL < LOG_LEVEL_INFO) {
+        return;
+    }
+    
+    char tagId[TAG_ID_TEXT_SIZE];
+    char timestamp[TIMESTAMP_TEXT_SIZE];
+    formatTagId(event.uid, event.uidLength, tagId, sizeof(tagId));
+    formatTimestamp(event.epochMs, timestamp, sizeof(timestamp));
+    
+    LOG_INFO("\nRFID Poll Result:");
+    LOG_INFO("Timestamp: %s", timestamp);
+    LOG_INFO("Tag Present: %s", change.present ? "YES" : "NO");
+    if (NFC_READER_COUNT > 1) {
+        LOG_INFO("Reader: %u", change.reader);
+    }
+    NfcReader& reader = readerPool.getReader(change.reader);
+    if (!change.present && !reader.hasIrq()) {
+        LOG_DEBUG("Removal detected within: %lu ms",
+                  readerPool.getScheduler(change.reader).getLastRemovalLatency());
+    }
+    if (change.present && reader.hasIrq()) {
+        LOG_DEBUG("Detection latency: %lu ms", reader.getLastIrqLatency());
+    }
+    if (now != change.at) {
+        LOG_DEBUG("Confirmed after: %lu ms", now - change.at);
+    }
+    LOG_INFO("Tag ID: %s", tagId);
     
-    // Check for PN532 board
-    uint32_t versiondata = nfc.getFirmwareVersion();
-    if (!versiondata) {
-        DEBUG_SERIAL.println("Error: Did not find PN532 board!");
-        while (1) {
-            pixels.setPixelColor(0, COLOR_ERROR);
-            pixels.show();
-            delay(LED_ERROR_BLINK_INTERVAL);
-            pixels.setPixelColor(0, 0);
-            pixels.show();
-            delay(LED_ERROR_BLINK_INTERVAL);
+    if (change.present) {
+        LOG_INFO("Tag Type: %s", tagTypeName(tagType));
+        if (LOG_LEVEL >= LOG_LEVEL_DEBUG) {
+            char wifiStatus[WIFI_STATUS_TEXT_SIZE];
+            formatWifiStatus(event, wifiStatus, sizeof(wifiStatus));
+            LOG_DEBUG("WiFi: %s", wifiStatus);
+            LOG_DEBUG("Time_Status: %s", timeStatusText(event));
+        }
+        if (event.assignment != ASSIGNMENT_NOT_CHECKED) {
+            LOG_INFO("Assignment: %s", assignmentName(event.assignment));
         }
     }
     
-    // Print firmware version
-    DEBUG_SERIAL.print("Found chip PN5"); 
-    DEBUG_SERIAL.println((versiondata>>24) & 0xFF, HEX);
-    DEBUG_SERIAL.print("Firmware ver. ");
-    DEBUG_SERIAL.print((versiondata>>16) & 0xFF, DEC);
-    DEBUG_SERIAL.print('.'); 
-    DEBUG_SERIAL.println((versiondata>>8) & 0xFF, DEC);
+    if (queued) {
+        LOG_INFO("Event queued (depth %u)", eventQueue.getDepth());
+    }
+}
+
+/**
+ * Sends every change the readers' presence filters have confirmed. Returns true if there was any.
+ */
+bool publishPresenceChanges(unsigned long now) {
+    PresenceChange change;
+    bool published = false;
+    while (readerPool.nextChange(now, change)) {
+        publishPresenceChange(change, now);
+        published = true;
+    }
     
-    // Configure PN532
-    nfc.SAMConfig();
+    // Session checkpoints and the resume window after a reboot
+    PollEvent session;
+    if (SESSION_MODE && sessionTracker.update(now, wifiManager.getEpochMillis(), session)) {
+        publishSession(session);
+    }
+    return published;
+}
+
+/**
+ * Green while a (debounced) tag is present on any reader, amber if the tag cache
+ * knows the last inserted one has no project, otherwise blue.
+ * Only sets the pattern; the LED task draws it, and errors and flashes go over it.
+ */
+void updateStatusLed() {
+    bool tagPresent = readerPool.isAnyPresent();
+    if (tagPresent &&
+        (presentAssignment == ASSIGNMENT_UNKNOWN || presentAssignment == ASSIGNMENT_UNASSIGNED)) {
+        statusLed.setPattern(LED_PATTERN_TAG_UNASSIGNED);  // Amber when the tag has no project
+    } else if (tagPresent) {
+        statusLed.setPattern(LED_PATTERN_TAG_PRESENT);  // Green when tag present
+    } else if (wifiManager.isConnected()) {
+        statusLed.setPattern(LED_PATTERN_CONNECTED);  // Blue when WiFi connected
+    } else {
+        statusLed.setPattern(LED_PATTERN_CONNECTING);  // Blinking blue when connecting
+    }
 }
 
 void setup() {
-    delay(1000); // Delay for a few seconds to allow USB serial to connect
-    
-    // Initialize Serial for debugging
+    // Initialize Serial for debugging; only wait for a monitor if configured
     DEBUG_SERIAL.begin(SERIAL_BAUD);
+#if BOOT_SERIAL_WAIT > 0
+    while (!DEBUG_SERIAL && millis() < BOOT_SERIAL_WAIT) {
+        delay(10);
+    }
+#endif
     DEBUG_SERIAL.println("Initializing...");
+    markBootPhase(BOOT_PHASE_SERIAL);
     
-    // Initialize NeoPixel
-    pixels.begin();
-    pixels.setBrightness(LED_BRIGHTNESS);
-    pixels.setPixelColor(0, COLOR_WIFI_CONNECTING);
-    pixels.show();
+    // Status LED (blinking blue while connecting), animated by its own task
+    statusLed.begin();
     
     // Get device ID
     deviceId = getDeviceId();
@@ -122,18 +357,14 @@ void setup() {
     
     // Initialize RFID
     initializeRFID();
+    markBootPhase(BOOT_PHASE_RFID_READY);
+    powerManager.begin();
     
-    // Initialize and connect WiFi
+    // Start connecting WiFi in the background
+    // No networks configured: show the error code, but keep polling and journaling tags
     if (!wifiManager.begin()) {
         DEBUG_SERIAL.println("Failed to initialize WiFi!");
-        while (1) {
-            pixels.setPixelColor(0, COLOR_ERROR);
-            pixels.show();
-            delay(LED_ERROR_BLINK_INTERVAL);
-            pixels.setPixelColor(0, 0);
-            pixels.show();
-            delay(LED_ERROR_BLINK_INTERVAL);
-        }
+        statusLed.setError(LED_ERROR_WIFI_CONFIG);
     }
 
     // Initialize webhook manager
@@ -142,123 +373,95 @@ void setup() {
     } else {
         // Print detailed webhook status
         webhookManager.printWebhookStatus();
+        webhookManager.printEncodingComparison(deviceId);
+    }
+
+    // Start the webhook sender task (mounts the SPIFFS journal)
+    if (!eventQueue.begin(deviceId)) {
+        DEBUG_SERIAL.println("Failed to initialize event queue!");
     }
     
+    // Pick up a session that was open when the device last went down
+    if (SESSION_MODE) {
+        sessionTracker.begin(eventQueue.getBootId(), systemClock.millis());
+    }
+    
+    // Serve the journal to pulling collectors (starts listening once WiFi is up)
+    if (HTTP_API_ENABLED && !httpApi.begin(deviceId)) {
+        DEBUG_SERIAL.println("Failed to initialize HTTP API!");
+    }
+    
+    // Replay journaled events as soon as WiFi comes back
+    wifiManager.onLinkRestored([]() { eventQueue.requestReplay(); });
+    
+    // Boot output above stays in order; from here on log lines are printed by the log task
+    logger.begin();
+    
+    markBootPhase(BOOT_PHASE_SETUP_DONE);
     DEBUG_SERIAL.println("Setup complete!");
     DEBUG_SERIAL.println("-------------------------");
 }
 
 void loop() {
-    unsigned long currentTime = millis();
-    
-    // Check WiFi connection periodically
-    if (currentTime - lastWifiCheckTime >= WIFI_CHECK_INTERVAL) {
-        lastWifiCheckTime = currentTime;
-        wifiManager.checkConnection();
-    }
+    unsigned long currentTime = systemClock.millis();
     
-    // Enforce consistent RFID polling interval
-    if (currentTime - lastReadTime < LED_SLOW_BLINK_INTERVAL) {
-        delay(10); // Small yield delay
-        return;
+    // Track the longest stall between loop() runs (tag polls are delayed by at least this much)
+    if (lastLoopTime != 0 && currentTime - lastLoopTime > maxLoopStall) {
+        maxLoopStall = currentTime - lastLoopTime;
+        metrics.setGauge(GAUGE_MAX_LOOP_STALL, maxLoopStall);
+        if (maxLoopStall >= LOOP_STALL_REPORT) {
+            LOG_WARN("Longest loop stall so far: %lu ms", maxLoopStall);
+        }
     }
-
-    uint8_t uid[] = { 0, 0, 0, 0, 0, 0, 0 };
-    uint8_t uidLength;
-    bool success = false;
+    lastLoopTime = currentTime;
     
-    // Add small delay between I2C operations
-    delay(I2C_RECOVERY_TIME);
+    // Advance the WiFi state machine; connecting and reconnecting never block polling
+    wifiManager.update();
+    updateStatusLed();
+    handleSerialCommands();
+    retryReaders(currentTime);
     
-    // First try ISO14443A detection
-    success = nfc.readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, TAG_READ_TIMEOUT);
-    
-    // Update timing after I2C operation
-    lastReadTime = currentTime;
+    if (currentTime - lastMetricsSampleTime >= METRICS_SAMPLE_INTERVAL) {
+        lastMetricsSampleTime = currentTime;
+        sampleMetrics();
+    }
     
-    static bool lastSuccess = false;
-    static String lastUid = "";
-    static TagType lastTagType = UNKNOWN;
-    String currentUid = "";
-    TagType currentTagType = UNKNOWN;
+    if (LOW_POWER_MODE && currentTime - lastPowerReportTime >= POWER_REPORT_INTERVAL) {
+        lastPowerReportTime = currentTime;
+        powerManager.printPowerStatus(detectionLatency(currentTime));
+    }
     
-    if (success) {
-        currentTagType = detectTagType(uidLength);
-        
-        // Build current UID string
-        for (uint8_t i = 0; i < uidLength && i < MAX_UID_LENGTH; i++) {
-            if (uid[i] < 0x10) currentUid += "0";
-            currentUid += String(uid[i], HEX);
-            currentUid += " ";
-        }
-        currentUid.trim(); // Remove trailing whitespace
+    // Hold times and the re-insert grace window also run out between polls
+    if (publishPresenceChanges(currentTime)) {
+        updateStatusLed();
     }
     
-    // Print debug only on state change or new UID
-    if (success != lastSuccess || (success && currentUid != lastUid)) {
-        // Update lastTagId on successful read
-        if (success) {
-            lastTagId = currentUid;
-        }
-
-        DEBUG_SERIAL.println("\nRFID Poll Result:");
-        DEBUG_SERIAL.printf("Timestamp: %s\n", wifiManager.getFormattedTime().c_str());
-        DEBUG_SERIAL.printf("Tag Present: %s\n", success ? "YES" : "NO");
-        DEBUG_SERIAL.printf("Tag ID: %s\n", success ? currentUid.c_str() : lastTagId.c_str());
-        
-        if (success) {
-            String tagType = currentTagType == MIFARE_CLASSIC ? "Mifare Classic (4-byte)" :
-                           currentTagType == ISO14443_4 ? "ISO14443-4 (7-byte)" : "Unknown";
-            DEBUG_SERIAL.printf("Tag Type: %s\n", tagType.c_str());
-            
-            // Print WiFi and time sync status
-            String wifiStatus;
-            String timeStatus;
-            if (wifiManager.isConnected()) {
-                wifiStatus = String("Connected to ") + wifiManager.getCurrentSSID() + 
-                           String(" (") + String(wifiManager.getRSSI()) + String(" dBm)");
-                timeStatus = wifiManager.isTimeSynced() ? "Synced with NTP" : "Not synced";
-                DEBUG_SERIAL.printf("WiFi: %s\n", wifiStatus.c_str());
-                DEBUG_SERIAL.printf("Time_Status: %s\n", timeStatus.c_str());
-            } else {
-                DEBUG_SERIAL.println("WiFi: Disconnected");
-                DEBUG_SERIAL.println("Time_Status: Not synced (No WiFi)");
-            }
-        }
-
-        // Send webhook if WiFi connected (for both tag insert and removal)
-        if (wifiManager.isConnected()) {
-            String wifiStatus = String("Connected to ") + wifiManager.getCurrentSSID() + 
-                              String(" (") + String(wifiManager.getRSSI()) + String(" dBm)");
-            String timeStatus = wifiManager.isTimeSynced() ? "Synced with NTP" : "Not synced";
-            String tagType = success ? (currentTagType == MIFARE_CLASSIC ? "Mifare Classic (4-byte)" :
-                                      currentTagType == ISO14443_4 ? "ISO14443-4 (7-byte)" : "Unknown") : "";
-            
-            webhookManager.sendPollResult(
-                success,
-                currentUid,
-                lastTagId,
-                tagType,
-                wifiStatus,
-                timeStatus,
-                wifiManager.getFormattedTime(),
-                deviceId
-            );
-        }
+    if (readerPool.getOnlineCount() == 0) {
+        powerManager.idle(POLL_IDLE_MAX_INTERVAL, canSleep());
+        return;
     }
     
-    // Update LED state based on WiFi and tag status
-    if (success && currentTagType != UNKNOWN) {
-        pixels.setPixelColor(0, COLOR_TAG_PRESENT);  // Green when tag present
-    } else if (wifiManager.isConnected()) {
-        pixels.setPixelColor(0, COLOR_WIFI_CONNECTED);  // Blue when WiFi connected
+    if (readerPool.getReader(0).hasIrq()) {
+        // IRQ mode: no fixed poll interval, results arrive as soon as the PN532 has them
+        if (!readerPool.pollIrq(currentTime, systemClock)) {
+            // Sleep until the IRQ fires; while a tag is present the absence timeout must be watched
+            powerManager.idle(readerPool.isAwaitingIrq() ? LOW_POWER_MAX_SLEEP : 10, canSleep());
+            return;
+        }
     } else {
-        pixels.setPixelColor(0, COLOR_WIFI_CONNECTING);  // Blinking blue when connecting
+        // Fallback polling mode: every reader's scheduler sets its rate, the pool picks which one goes
+        int reader = readerPool.nextDue(currentTime);
+        if (reader < 0) {
+            powerManager.idle(readerPool.timeUntilDue(currentTime), canSleep());
+            return;
+        }
+        
+        powerManager.prepareReader(reader, readerPool.getReader(reader));
+        bool present = readerPool.poll(reader, systemClock);
+        powerManager.releaseReader(reader, readerPool.getReader(reader), present);
     }
-    pixels.show();
     
-    // Store state for next comparison
-    lastSuccess = success;
-    lastUid = currentUid;
-    lastTagType = currentTagType;
+    // Only debounced changes become events
+    publishPresenceChanges(systemClock.millis());
+    updateStatusLed();
 }
@@ -0,0 +1,133 @@
+#include "metrics.h"
+#include "config.h"
+
+MetricsRegistry metrics;
+
+static const uint32_t HISTOGRAM_BOUNDS[HISTOGRAM_BUCKETS] = {
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000
+};
+
+static const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+    "nfc_full_polls",
+    "nfc_empty_polls",
+    "nfc_multi_target_polls",
+    "nfc_presence_checks",
+    "tag_events",
+    "presence_changes_dropped",
+    "sessions",
+    "webhook_requests",
+    "webhook_failures",
+    "webhook_retries",
+    "webhook_short_circuits",
+    "breaker_opens",
+    "webhook_failovers",
+    "events_rejected",
+    "http_2xx",
+    "http_4xx",
+    "http_5xx",
+    "http_no_response",
+    "wifi_disconnects",
+    "wifi_reconnects",
+    "heartbeats"
+};
+
+static const char* const GAUGE_NAMES[GAUGE_COUNT] = {
+    "free_heap",
+    "min_free_heap",
+    "max_loop_stall_ms",
+    "queue_depth",
+    "journal_backlog",
+    "wifi_rssi",
+    "clock_drift_ppm",
+    "open_circuits",
+    "presence_events_saved"
+};
+
+static const char* const HISTOGRAM_NAMES[HISTOGRAM_COUNT] = {
+    "nfc_poll_ms",
+    "webhook_rtt_ms",
+    "wifi_reconnect_ms"
+};
+
+MetricsRegistry::MetricsRegistry() {
+    memset((void*)counters, 0, sizeof(counters));
+    memset((void*)gauges, 0, sizeof(gauges));
+    memset(histograms, 0, sizeof(histograms));
+}
+
+void MetricsRegistry::observe(HistogramId id, uint32_t value) {
+    Histogram& histogram = histograms[id];
+    uint8_t bucket = 0;
+    while (bucket < HISTOGRAM_BUCKETS && value > HISTOGRAM_BOUNDS[bucket]) {
+        bucket++;
+    }
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    histogram.sum += value;
+    if (value > histogram.max) {
+        histogram.max = value;
+    }
+}
+
+void MetricsRegistry::printMetrics() {
+    DEBUG_SERIAL.println("\n--- Metrics ---");
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        DEBUG_SERIAL.printf("%-24s %u\n", COUNTER_NAMES[i], counters[i]);
+    }
+    for (int i = 0; i < GAUGE_COUNT; i++) {
+        DEBUG_SERIAL.printf("%-24s %d\n", GAUGE_NAMES[i], gauges[i]);
+    }
+    for (int i = 0; i < HISTOGRAM_COUNT; i++) {
+        const Histogram& histogram = histograms[i];
+        DEBUG_SERIAL.printf("%-24s count %u, avg %u, max %u\n", HISTOGRAM_NAMES[i], histogram.count,
+                            histogram.count ? histogram.sum / histogram.count : 0, histogram.max);
+        if (histogram.count == 0) {
+            continue;
+        }
+        DEBUG_SERIAL.print("  ");
+        for (int b = 0; b <= HISTOGRAM_BUCKETS; b++) {
+            if (histogram.buckets[b] == 0) {
+                continue;
+            }
+            if (b < HISTOGRAM_BUCKETS) {
+                DEBUG_SERIAL.printf("<=%u: %u  ", HISTOGRAM_BOUNDS[b], histogram.buckets[b]);
+            } else {
+                DEBUG_SERIAL.printf(">%u: %u", HISTOGRAM_BOUNDS[HISTOGRAM_BUCKETS - 1], histogram.buckets[b]);
+            }
+        }
+        DEBUG_SERIAL.println();
+    }
+    DEBUG_SERIAL.println("--- End Metrics ---\n");
+}
+
+void MetricsRegistry::writeJson(JsonObject object) const {
+    JsonArray bounds = object.createNestedArray("bucket_bounds_ms");
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        bounds.add(HISTOGRAM_BOUNDS[b]);
+    }
+
+    // Names are string literals, stored by reference in the document
+    JsonObject counterObject = object.createNestedObject("counters");
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        counterObject[COUNTER_NAMES[i]] = counters[i];
+    }
+
+    JsonObject gaugeObject = object.createNestedObject("gauges");
+    for (int i = 0; i < GAUGE_COUNT; i++) {
+        gaugeObject[GAUGE_NAMES[i]] = gauges[i];
+    }
+
+    // Bucket bounds are fixed, so only the counts are sent
+    JsonObject histogramObject = object.createNestedObject("histograms");
+    for (int i = 0; i < HISTOGRAM_COUNT; i++) {
+        const Histogram& histogram = histograms[i];
+        JsonObject entry = histogramObject.createNestedObject(HISTOGRAM_NAMES[i]);
+        entry["count"] = histogram.count;
+        entry["sum"] = histogram.sum;
+        entry["max"] = histogram.max;
+        JsonArray buckets = entry.createNestedArray("buckets");
+        for (int b = 0; b <= HISTOGRAM_BUCKETS; b++) {
+            buckets.add(histogram.buckets[b]);
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Metric ids index fixed arrays, so updates in hot paths are a single array write.
+// Keep the name tables in metrics.cpp in the same order.
+enum CounterId : uint8_t {
+    COUNTER_NFC_FULL_POLLS,         // InListPassiveTarget calls, all readers
+    COUNTER_NFC_EMPTY_POLLS,        // ... that found no tag (or failed on the bus)
+    COUNTER_NFC_MULTI_TARGET_POLLS, // ... that found two cards (NFC_MAX_TARGETS 2)
+    COUNTER_NFC_PRESENCE_CHECKS,
+    COUNTER_TAG_EVENTS,
+    COUNTER_PRESENCE_CHANGES_DROPPED, // Confirmed presence changes lost to a full filter buffer
+    COUNTER_SESSIONS,               // Completed sessions sent in SESSION_MODE
+    COUNTER_WEBHOOK_REQUESTS,
+    COUNTER_WEBHOOK_FAILURES,       // Connection errors and non-2xx answers
+    COUNTER_WEBHOOK_RETRIES,        // Journal replays after a failed send
+    COUNTER_WEBHOOK_SHORT_CIRCUITS, // Sends refused without a request while the circuit was open
+    COUNTER_BREAKER_OPENS,
+    COUNTER_WEBHOOK_FAILOVERS,      // Requests moved to the next endpoint after a failure
+    COUNTER_EVENTS_REJECTED,        // Events dropped from the backlog after a 4xx refusal (dead letters)
+    COUNTER_HTTP_2XX,
+    COUNTER_HTTP_4XX,
+    COUNTER_HTTP_5XX,
+    COUNTER_HTTP_NO_RESPONSE,
+    COUNTER_WIFI_DISCONNECTS,
+    COUNTER_WIFI_RECONNECTS,
+    COUNTER_HEARTBEATS,
+    COUNTER_COUNT
+};
+
+enum GaugeId : uint8_t {
+    GAUGE_FREE_HEAP,
+    GAUGE_MIN_FREE_HEAP,
+    GAUGE_MAX_LOOP_STALL,           // ms
+    GAUGE_QUEUE_DEPTH,
+    GAUGE_JOURNAL_BACKLOG,
+    GAUGE_WIFI_RSSI,                // dBm, 0 when disconnected
+    GAUGE_CLOCK_DRIFT_PPM,
+    GAUGE_OPEN_CIRCUITS,            // Webhook endpoints currently skipped
+    GAUGE_PRESENCE_EVENTS_SAVED,    // Flapping reads the presence filter did not turn into events
+    GAUGE_COUNT
+};
+
+enum HistogramId : uint8_t {
+    HISTOGRAM_NFC_POLL_MS,          // Full poll or presence check duration
+    HISTOGRAM_WEBHOOK_RTT_MS,       // Connect + request + response
+    HISTOGRAM_WIFI_RECONNECT_MS,
+    HISTOGRAM_COUNT
+};
+
+// Upper bounds (ms) of the histogram buckets; one extra bucket counts larger values
+static const uint8_t HISTOGRAM_BUCKETS = 12;
+
+struct Histogram {
+    uint32_t buckets[HISTOGRAM_BUCKETS + 1];
+    uint32_t count;
+    uint32_t sum;
+    uint32_t max;
+};
+
+/**
+ * Fixed set of counters, gauges and histograms, updated in place without
+ * allocation. Each metric should be written from a single task; readers on
+ * other tasks may see a slightly stale snapshot, which is fine for reporting.
+ */
+class MetricsRegistry {
+    private:
+        volatile uint32_t counters[COUNTER_COUNT];
+        volatile int32_t gauges[GAUGE_COUNT];
+        Histogram histograms[HISTOGRAM_COUNT];
+
+    public:
+        MetricsRegistry();
+
+        void increment(CounterId id, uint32_t amount = 1) { counters[id] += amount; }
+        void setGauge(GaugeId id, int32_t value) { gauges[id] = value; }
+        void observe(HistogramId id, uint32_t value);
+
+        uint32_t getCounter(CounterId id) const { return counters[id]; }
+        int32_t getGauge(GaugeId id) const { return gauges[id]; }
+        const Histogram& getHistogram(HistogramId id) const { return histograms[id]; }
+
+        void printMetrics();
+        void writeJson(JsonObject object) const;  // For the heartbeat payload
+};
+
+extern MetricsRegistry metrics;
+
+#endif // METRICS_H
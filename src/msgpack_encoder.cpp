@@ -0,0 +1,163 @@
+#include "msgpack_encoder.h"
+#include <string.h>
+#include "config.h"
+
+MsgPackWriter::MsgPackWriter(uint8_t* buffer, size_t size)
+    : buffer(buffer), size(size), pos(0), overflow(false) {
+}
+
+void MsgPackWriter::writeByte(uint8_t value) {
+    if (pos >= size) {
+        overflow = true;
+        return;
+    }
+    buffer[pos++] = value;
+}
+
+void MsgPackWriter::writeBigEndian(uint64_t value, uint8_t bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+        writeByte((uint8_t)(value >> shift));
+    }
+}
+
+void MsgPackWriter::writeBytes(const uint8_t* data, size_t length) {
+    if (pos + length > size) {
+        overflow = true;
+        return;
+    }
+    memcpy(buffer + pos, data, length);
+    pos += length;
+}
+
+void MsgPackWriter::writeNil() {
+    writeByte(0xC0);
+}
+
+void MsgPackWriter::writeBool(bool value) {
+    writeByte(value ? 0xC3 : 0xC2);
+}
+
+void MsgPackWriter::writeUInt(uint64_t value) {
+    if (value < 0x80) {
+        writeByte((uint8_t)value);              // positive fixint
+    } else if (value <= 0xFF) {
+        writeByte(0xCC);
+        writeBigEndian(value, 1);
+    } else if (value <= 0xFFFF) {
+        writeByte(0xCD);
+        writeBigEndian(value, 2);
+    } else if (value <= 0xFFFFFFFF) {
+        writeByte(0xCE);
+        writeBigEndian(value, 4);
+    } else {
+        writeByte(0xCF);
+        writeBigEndian(value, 8);
+    }
+}
+
+void MsgPackWriter::writeInt(int64_t value) {
+    if (value >= 0) {
+        writeUInt((uint64_t)value);
+    } else if (value >= -32) {
+        writeByte((uint8_t)(int8_t)value);      // negative fixint
+    } else if (value >= INT8_MIN) {
+        writeByte(0xD0);
+        writeBigEndian((uint64_t)value, 1);
+    } else if (value >= INT16_MIN) {
+        writeByte(0xD1);
+        writeBigEndian((uint64_t)value, 2);
+    } else if (value >= INT32_MIN) {
+        writeByte(0xD2);
+        writeBigEndian((uint64_t)value, 4);
+    } else {
+        writeByte(0xD3);
+        writeBigEndian((uint64_t)value, 8);
+    }
+}
+
+void MsgPackWriter::writeStr(const char* value) {
+    size_t length = strlen(value);
+    if (length < 32) {
+        writeByte(0xA0 | (uint8_t)length);      // fixstr
+    } else {
+        writeByte(0xD9);
+        writeBigEndian(length, 1);
+    }
+    writeBytes(reinterpret_cast<const uint8_t*>(value), length);
+}
+
+void MsgPackWriter::writeBin(const uint8_t* data, size_t length) {
+    writeByte(0xC4);
+    writeBigEndian(length, 1);
+    writeBytes(data, length);
+}
+
+void MsgPackWriter::writeArrayHeader(uint16_t count) {
+    if (count < 16) {
+        writeByte(0x90 | (uint8_t)count);       // fixarray
+    } else {
+        writeByte(0xDC);
+        writeBigEndian(count, 2);
+    }
+}
+
+void MsgPackWriter::writeMapHeader(uint16_t count) {
+    if (count < 16) {
+        writeByte(0x80 | (uint8_t)count);       // fixmap
+    } else {
+        writeByte(0xDE);
+        writeBigEndian(count, 2);
+    }
+}
+
+size_t encodeEventsMsgPack(const PollEvent* events, size_t count, const char* deviceId,
+                           uint8_t* buffer, size_t size, size_t& packed) {
+    // Envelope: fixmap + "v" + version + "device_id" + id + "events" + array header
+    size_t envelopeSize = 1 + 2 + 1 + 10 + 2 + strlen(deviceId) + 7 + 3;
+    packed = 0;
+    if (size <= envelopeSize) {
+        return 0;
+    }
+    
+    // The array header carries the count, so decide up front how many events fit
+    size_t fit = (size - envelopeSize) / MSGPACK_EVENT_MAX_SIZE;
+    size_t eventCount = count < fit ? count : fit;
+    if (eventCount == 0) {
+        return 0;
+    }
+    
+    MsgPackWriter writer(buffer, size);
+    writer.writeMapHeader(3);
+    writer.writeStr("v");
+    writer.writeUInt(MSGPACK_PAYLOAD_VERSION);
+    writer.writeStr("device_id");
+    writer.writeStr(deviceId);
+    writer.writeStr("events");
+    writer.writeArrayHeader(eventCount);
+    
+    for (size_t i = 0; i < eventCount; i++) {
+        const PollEvent& event = events[i];
+        bool session = event.kind == EVENT_SESSION;
+        writer.writeArrayHeader((session ? 9 : 7) + (NFC_READER_COUNT > 1 ? 1 : 0));
+        writer.writeUInt(session ? 2 : (event.tagPresent ? 1 : 0));
+        writer.writeBin(event.uid, event.uidLength);
+        writer.writeUInt(event.tagType);
+        writer.writeUInt(event.epochMs);
+        writer.writeInt(event.rssi);
+        writer.writeUInt(event.networkIndex);
+        writer.writeBool(event.timeSynced);
+        if (session) {
+            writer.writeUInt(event.durationMs);
+            writer.writeBool(event.endEstimated);
+        }
+        if (NFC_READER_COUNT > 1) {
+            writer.writeUInt(event.readerIndex);
+        }
+    }
+    
+    if (writer.overflowed()) {
+        return 0;
+    }
+    packed = eventCount;
+    return writer.length();
+}
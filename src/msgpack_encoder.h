@@ -0,0 +1,59 @@
+#ifndef MSGPACK_ENCODER_H
+#define MSGPACK_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "poll_event.h"
+
+// Compact payload format version, sent as "v" so the ingest decoder can check it
+#define MSGPACK_PAYLOAD_VERSION 3
+
+/**
+ * Minimal MessagePack writer into a caller-provided buffer.
+ * Stops writing and reports overflow instead of truncating silently.
+ */
+class MsgPackWriter {
+    private:
+        uint8_t* buffer;
+        size_t size;
+        size_t pos;
+        bool overflow;
+
+        void writeByte(uint8_t value);
+        void writeBigEndian(uint64_t value, uint8_t bytes);
+        void writeBytes(const uint8_t* data, size_t length);
+
+    public:
+        MsgPackWriter(uint8_t* buffer, size_t size);
+
+        void writeNil();
+        void writeBool(bool value);
+        void writeUInt(uint64_t value);
+        void writeInt(int64_t value);
+        void writeStr(const char* value);
+        void writeBin(const uint8_t* data, size_t length);
+        void writeArrayHeader(uint16_t count);
+        void writeMapHeader(uint16_t count);
+
+        size_t length() const { return pos; }
+        bool overflowed() const { return overflow; }
+};
+
+// Worst-case encoded size of one event, used to enforce the per-request byte cap
+static const size_t MSGPACK_EVENT_MAX_SIZE = 1 + 1 + (2 + MAX_UID_LENGTH) + 1 + 9 + 2 + 2 + 1 + 5 + 1 + 1;
+
+/**
+ * Encodes events as {"v": 3, "device_id": str, "events": [[...], ...]}.
+ * Each event is a positional array:
+ *   [event_type (0 removed, 1 insert, 2 session), tag_id (bin), tag_type (TagType),
+ *    timestamp (UTC epoch ms, 0 if not synced; session start), rssi (dBm),
+ *    network (index, 255 offline), time_synced (bool)]
+ * Sessions append duration (ms) and end_estimated (bool). With NFC_READER_COUNT > 1
+ * every event ends with its reader index. Version 1 had no sessions, version 2 no reader.
+ * Packs as many events as fit in size. Returns the encoded length (0 on error)
+ * and the number of events packed in packed.
+ */
+size_t encodeEventsMsgPack(const PollEvent* events, size_t count, const char* deviceId,
+                           uint8_t* buffer, size_t size, size_t& packed);
+
+#endif // MSGPACK_ENCODER_H
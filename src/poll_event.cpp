@@ -0,0 +1,128 @@
+#include "poll_event.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "credentials.h"
+
+TagType detectTagType(uint8_t uidLength) {
+    switch (uidLength) {
+        case 4:
+            return MIFARE_CLASSIC;
+        case 7:
+            return ISO14443_4;
+        default:
+            return UNKNOWN;
+    }
+}
+
+const char* tagTypeName(TagType tagType) {
+    switch (tagType) {
+        case MIFARE_CLASSIC:
+            return "Mifare Classic (4-byte)";
+        case ISO14443_4:
+            return "ISO14443-4 (7-byte)";
+        default:
+            return "Unknown";
+    }
+}
+
+const char* timeStatusText(const PollEvent& event) {
+    if (event.timeSynced) {
+        return "Synced with NTP";
+    }
+    if (event.epochMs != 0) {
+        return "Corrected after NTP sync";
+    }
+    return event.networkIndex == POLL_EVENT_NO_NETWORK ? "Not synced (No WiFi)" : "Not synced";
+}
+
+void formatTagId(const uint8_t* uid, uint8_t uidLength, char* buffer, size_t size) {
+    // Lowercase hex bytes separated by spaces, e.g. "dd 54 2a 83"
+    static const char hexDigits[] = "0123456789abcdef";
+    size_t pos = 0;
+    
+    for (uint8_t i = 0; i < uidLength && i < MAX_UID_LENGTH && pos + 3 < size; i++) {
+        if (i > 0) {
+            buffer[pos++] = ' ';
+        }
+        buffer[pos++] = hexDigits[uid[i] >> 4];
+        buffer[pos++] = hexDigits[uid[i] & 0x0F];
+    }
+    if (size > 0) {
+        buffer[pos] = '\0';
+    }
+}
+
+bool parseTagId(const char* text, uint8_t* uid, uint8_t& uidLength) {
+    uidLength = 0;
+    while (*text != '\0') {
+        if (*text == ' ') {
+            text++;
+            continue;
+        }
+        unsigned value;
+        int consumed;
+        if (uidLength == MAX_UID_LENGTH || sscanf(text, "%2x%n", &value, &consumed) != 1 || consumed != 2) {
+            return false;
+        }
+        uid[uidLength++] = (uint8_t)value;
+        text += consumed;
+    }
+    return uidLength > 0;
+}
+
+const char* assignmentName(TagAssignment assignment) {
+    switch (assignment) {
+        case ASSIGNMENT_UNKNOWN:
+            return "unknown";
+        case ASSIGNMENT_UNASSIGNED:
+            return "unassigned";
+        case ASSIGNMENT_ASSIGNED:
+            return "assigned";
+        default:
+            return "not_checked";
+    }
+}
+
+void formatTimestamp(uint64_t epochMs, char* buffer, size_t size) {
+    if (epochMs == 0) {
+        snprintf(buffer, size, "Time not synced");
+        return;
+    }
+    
+    // ISO-8601 local time with milliseconds and UTC offset, e.g. "2024-02-24T12:53:04.123+01:00"
+    time_t seconds = (time_t)(epochMs / 1000);
+    struct tm timeinfo;
+    localtime_r(&seconds, &timeinfo);
+    
+    char dateTime[20];
+    char offset[6];
+    strftime(dateTime, sizeof(dateTime), "%Y-%m-%dT%H:%M:%S", &timeinfo);
+    if (strftime(offset, sizeof(offset), "%z", &timeinfo) != 5) {
+        strcpy(offset, "+0000");
+    }
+    snprintf(buffer, size, "%s.%03u%.3s:%.2s", dateTime, (unsigned)(epochMs % 1000), offset, offset + 3);
+}
+
+void formatWifiStatus(const PollEvent& event, char* buffer, size_t size) {
+    if (event.networkIndex >= WIFI_NETWORKS_COUNT) {
+        snprintf(buffer, size, "Disconnected");
+        return;
+    }
+    snprintf(buffer, size, "Connected to %s (%d dBm)",
+             WIFI_NETWORKS[event.networkIndex].ssid, event.rssi);
+}
+
+bool resolveEventTime(PollEvent& event, uint32_t bootId, uint32_t nowMs, uint64_t nowEpochMs) {
+    if (event.epochMs != 0) {
+        return true;
+    }
+    if (event.bootId != bootId || nowEpochMs == 0) {
+        return false;
+    }
+    
+    // Unsigned subtraction handles the millis() rollover
+    uint32_t age = nowMs - event.monotonicMs;
+    event.epochMs = nowEpochMs - age;
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef POLL_EVENT_H
+#define POLL_EVENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+static const uint8_t MAX_UID_LENGTH = 7;          // Maximum UID length we'll handle
+static const uint8_t POLL_EVENT_NO_NETWORK = 0xFF;
+
+// Buffer sizes for the text fields rendered at serialization time
+static const size_t TAG_ID_TEXT_SIZE = MAX_UID_LENGTH * 3;  // "dd 54 2a 83 ..." + NUL
+static const size_t TIMESTAMP_TEXT_SIZE = 32;             // "2024-02-24T12:53:04.123+01:00" + NUL
+static const size_t WIFI_STATUS_TEXT_SIZE = 64;
+
+// Tag type detection
+enum TagType : uint8_t {
+    UNKNOWN,
+    MIFARE_CLASSIC,    // 4-byte UID
+    ISO14443_4         // 7-byte UID
+};
+
+// What a PollEvent reports
+enum EventKind : uint8_t {
+    EVENT_TAG_CHANGE,  // tag_insert or tag_removed
+    EVENT_SESSION      // One completed session (SESSION_MODE), epochMs is its start
+};
+
+// Tag assignment as found in the local tag cache
+enum TagAssignment : uint8_t {
+    ASSIGNMENT_NOT_CHECKED,  // Tag cache disabled or never synced
+    ASSIGNMENT_UNKNOWN,      // Tag not in tag_assignments (yet)
+    ASSIGNMENT_UNASSIGNED,   // Listed, but without a project
+    ASSIGNMENT_ASSIGNED
+};
+
+// Fixed-size binary event record shared by the event queue and the journal.
+// Copied by value and written to flash as-is, so it must stay a plain struct.
+// Changing it changes the journal record size: journaled events of older firmware
+// no longer pass their CRC and are dropped.
+// Text (tag ID, timestamp, WiFi status) is only rendered when serializing.
+struct PollEvent {
+    uint64_t epochMs;               // UTC epoch milliseconds at detection, 0 if time was not synced
+    uint32_t monotonicMs;           // millis() at detection, used to fix epochMs after a late sync
+    uint32_t bootId;                // Random per boot, monotonicMs is only comparable within one boot
+    uint32_t durationMs;            // Session length, sessions only
+    uint32_t assignmentId;          // tag_assignments.id if the tag is assigned, else 0
+    EventKind kind;
+    bool endEstimated;              // Session cut short by a reboot, its end is the last checkpoint
+    uint8_t uid[MAX_UID_LENGTH];    // Current tag on insert, last seen tag on removal or session
+    uint8_t uidLength;
+    TagType tagType;
+    bool tagPresent;
+    bool timeSynced;
+    uint8_t networkIndex;           // Index into WIFI_NETWORKS, POLL_EVENT_NO_NETWORK if offline
+    int8_t rssi;                    // dBm, 0 if offline
+    TagAssignment assignment;
+    uint8_t readerIndex;            // Reader pool index of the reader that saw the tag
+};
+
+// Formatting helpers, all writing into caller-provided buffers
+TagType detectTagType(uint8_t uidLength);
+const char* tagTypeName(TagType tagType);
+const char* timeStatusText(const PollEvent& event);
+void formatTagId(const uint8_t* uid, uint8_t uidLength, char* buffer, size_t size);
+bool parseTagId(const char* text, uint8_t* uid, uint8_t& uidLength);  // Inverse of formatTagId()
+const char* assignmentName(TagAssignment assignment);
+void formatTimestamp(uint64_t epochMs, char* buffer, size_t size);
+void formatWifiStatus(const PollEvent& event, char* buffer, size_t size);
+
+/**
+ * Fills in epochMs for an event detected before NTP sync, from the monotonic
+ * offset between its detection and now. Only works for events of the current boot.
+ * Returns true if the event has a timestamp.
+ */
+bool resolveEventTime(PollEvent& event, uint32_t bootId, uint32_t nowMs, uint64_t nowEpochMs);
+
+#endif // POLL_EVENT_H
@@ -0,0 +1,80 @@
+#include "poll_scheduler.h"
+
+// Polls never run closer together than this, giving the I2C bus time to settle
+static const unsigned long POLL_MIN_INTERVAL = 100;
+
+PollScheduler::PollScheduler()
+    : tagPresent(false), presenceCheckSupported(true), lastPollTime(0), lastPresentTime(0),
+      idleSince(0), fullPolls(0), presenceChecks(0), lastRemovalLatency(0), maxRemovalLatency(0) {
+}
+
+unsigned long PollScheduler::currentInterval(unsigned long now) const {
+    unsigned long interval;
+    
+    if (tagPresent) {
+        interval = POLL_PRESENT_INTERVAL;
+    } else {
+        unsigned long idleFor = now - idleSince;
+        if (idleFor < POLL_FAST_PERIOD) {
+            interval = POLL_FAST_INTERVAL;
+        } else {
+            // Double the interval for every POLL_BACKOFF_STEP spent idle
+            unsigned long steps = (idleFor - POLL_FAST_PERIOD) / POLL_BACKOFF_STEP + 1;
+            interval = POLL_FAST_INTERVAL;
+            while (steps-- > 0 && interval < POLL_IDLE_MAX_INTERVAL) {
+                interval *= 2;
+            }
+            interval = min(interval, (unsigned long)POLL_IDLE_MAX_INTERVAL);
+        }
+    }
+    
+    return max(interval, POLL_MIN_INTERVAL);
+}
+
+bool PollScheduler::isDue(unsigned long now) const {
+    return now - lastPollTime >= currentInterval(now);
+}
+
+unsigned long PollScheduler::timeUntilDue(unsigned long now) const {
+    unsigned long interval = currentInterval(now);
+    unsigned long elapsed = now - lastPollTime;
+    return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+PollKind PollScheduler::nextKind() const {
+    return (tagPresent && presenceCheckSupported) ? POLL_PRESENCE : POLL_FULL;
+}
+
+void PollScheduler::onPollResult(unsigned long now, PollKind kind, bool present) {
+    lastPollTime = now;
+    if (kind == POLL_PRESENCE) {
+        presenceChecks++;
+    } else {
+        fullPolls++;
+    }
+    
+    if (present) {
+        if (!tagPresent) {
+            presenceCheckSupported = true;  // New tag, try cheap checks again
+        }
+        tagPresent = true;
+        lastPresentTime = now;
+    } else if (tagPresent) {
+        tagPresent = false;
+        idleSince = now;
+        lastRemovalLatency = now - lastPresentTime;
+        if (lastRemovalLatency > maxRemovalLatency) {
+            maxRemovalLatency = lastRemovalLatency;
+        }
+    }
+}
+
+void PollScheduler::printSchedulerStatus(unsigned long now) {
+    DEBUG_SERIAL.println("\n--- Poll Scheduler Status ---");
+    DEBUG_SERIAL.printf("Tag present: %s, presence check: %s\n",
+                        tagPresent ? "YES" : "NO", presenceCheckSupported ? "supported" : "full polls");
+    DEBUG_SERIAL.printf("Current interval: %lu ms\n", currentInterval(now));
+    DEBUG_SERIAL.printf("Full polls: %u, Presence checks: %u\n", fullPolls, presenceChecks);
+    DEBUG_SERIAL.printf("Removal latency: last %lu ms, max %lu ms\n", lastRemovalLatency, maxRemovalLatency);
+    DEBUG_SERIAL.println("--- End Poll Scheduler Status ---\n");
+}
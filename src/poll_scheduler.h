@@ -0,0 +1,51 @@
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+enum PollKind {
+    POLL_FULL,      // Full InListPassiveTarget with anti-collision
+    POLL_PRESENCE   // Cheap presence check on the already selected tag
+};
+
+/**
+ * Decides when the next RFID poll is due and which kind of poll to run.
+ * While a tag sits on the reader only cheap presence checks are scheduled;
+ * when idle it polls fast right after a removal and backs off over time.
+ * Pure timing logic, no hardware access.
+ */
+class PollScheduler {
+    private:
+        bool tagPresent;
+        bool presenceCheckSupported;  // Cleared when the current tag rejects presence checks
+        unsigned long lastPollTime;
+        unsigned long lastPresentTime;  // Last time the tag was confirmed present
+        unsigned long idleSince;
+
+        // Statistics
+        uint32_t fullPolls;
+        uint32_t presenceChecks;
+        unsigned long lastRemovalLatency;  // Upper bound: removal seen this long after last confirmation
+        unsigned long maxRemovalLatency;
+
+    public:
+        PollScheduler();
+
+        bool isDue(unsigned long now) const;
+        unsigned long timeUntilDue(unsigned long now) const;  // 0 if due
+        PollKind nextKind() const;
+        unsigned long currentInterval(unsigned long now) const;
+
+        void onPollResult(unsigned long now, PollKind kind, bool present);
+        void onPresenceCheckUnsupported() { presenceCheckSupported = false; }
+
+        // Status and info
+        uint32_t getFullPolls() const { return fullPolls; }
+        uint32_t getPresenceChecks() const { return presenceChecks; }
+        unsigned long getLastRemovalLatency() const { return lastRemovalLatency; }
+        unsigned long getMaxRemovalLatency() const { return maxRemovalLatency; }
+        void printSchedulerStatus(unsigned long now);
+};
+
+#endif // POLL_SCHEDULER_H
@@ -0,0 +1,109 @@
+#include "power_manager.h"
+
+// Typical currents in uA, only used for the budget estimate
+static const uint32_t CURRENT_CPU_AWAKE = 28000;
+static const uint32_t CURRENT_CPU_AWAKE_LOW_POWER = 22000;                 // Incl. WiFi modem sleep average
+static const uint32_t CURRENT_CPU_LIGHT_SLEEP = 1500;                      // Incl. WiFi beacon wake-ups
+static const uint32_t CURRENT_PN532_ACTIVE = 45000;
+static const uint32_t CURRENT_PN532_POWERDOWN = 10;
+
+PowerManager::PowerManager(SleepController& sleep, Clock& clock, int wakePin, bool enabled)
+    : sleep(sleep), clock(clock), wakePin(wakePin), enabled(enabled), autoSleep(false), startedAt(0),
+      sleepTime(0), readerDownTime(0), sleepCount(0) {
+    for (uint8_t i = 0; i < NFC_READER_COUNT; i++) {
+        readerDown[i] = false;
+        readerDownSince[i] = 0;
+    }
+}
+
+void PowerManager::begin() {
+    startedAt = clock.millis();
+    
+    if (enabled) {
+        sleep.setCpuFrequency(LOW_POWER_CPU_MHZ);
+        sleep.enableModemSleep();
+        autoSleep = sleep.enableAutoLightSleep(wakePin);
+        if (autoSleep) {
+            DEBUG_SERIAL.printf("Low-power mode: CPU %d MHz, automatic light sleep between polls\n", LOW_POWER_CPU_MHZ);
+        } else {
+            DEBUG_SERIAL.printf("Low-power mode: CPU %d MHz, modem sleep only (light sleep needs tickless idle)\n",
+                                LOW_POWER_CPU_MHZ);
+        }
+    }
+}
+
+void PowerManager::prepareReader(uint8_t index, NfcReader& reader) {
+    if (!readerDown[index]) {
+        return;
+    }
+    reader.wakeUp();
+    readerDownTime += clock.millis() - readerDownSince[index];
+    readerDown[index] = false;
+}
+
+void PowerManager::releaseReader(uint8_t index, NfcReader& reader, bool tagPresent) {
+    // In IRQ mode the PN532 searches on its own; a present tag must stay selected for presence checks
+    if (!enabled || readerDown[index] || tagPresent || reader.hasIrq()) {
+        return;
+    }
+    if (reader.powerDown()) {
+        readerDown[index] = true;
+        readerDownSince[index] = clock.millis();
+    }
+}
+
+void PowerManager::idle(unsigned long maxMs, bool canSleep) {
+    if (!autoSleep || !canSleep || maxMs < LOW_POWER_MIN_SLEEP) {
+        clock.delay(min(maxMs, 10UL));  // Small yield delay
+        return;
+    }
+    
+    // Only this wait lifts the no-sleep lock; the other tasks keep running and wake the chip as needed
+    unsigned long start = clock.millis();
+    sleep.allowLightSleep(true);
+    sleep.waitForWake(min(maxMs, (unsigned long)LOW_POWER_MAX_SLEEP));
+    sleep.allowLightSleep(false);
+    sleepTime += clock.millis() - start;
+    sleepCount++;
+}
+
+uint32_t PowerManager::getDutyCyclePermille() const {
+    unsigned long total = clock.millis() - startedAt;
+    if (total == 0) {
+        return 1000;
+    }
+    return (uint32_t)((uint64_t)(total - sleepTime) * 1000 / total);
+}
+
+uint32_t PowerManager::getEstimatedCurrent() const {
+    unsigned long now = clock.millis();
+    unsigned long total = now - startedAt;
+    uint32_t cpuAwake = enabled ? CURRENT_CPU_AWAKE_LOW_POWER : CURRENT_CPU_AWAKE;
+    if (total == 0) {
+        return cpuAwake + CURRENT_PN532_ACTIVE * NFC_READER_COUNT;
+    }
+    
+    uint64_t downTime = readerDownTime;
+    for (uint8_t i = 0; i < NFC_READER_COUNT; i++) {
+        downTime += readerDown[i] ? now - readerDownSince[i] : 0;
+    }
+    uint64_t charge = (uint64_t)cpuAwake * (total - sleepTime) +
+                      (uint64_t)CURRENT_CPU_LIGHT_SLEEP * sleepTime +
+                      (uint64_t)CURRENT_PN532_ACTIVE * ((uint64_t)total * NFC_READER_COUNT - downTime) +
+                      (uint64_t)CURRENT_PN532_POWERDOWN * downTime;
+    return (uint32_t)(charge / total);
+}
+
+void PowerManager::printPowerStatus(unsigned long detectionLatency) {
+    uint32_t dutyCycle = getDutyCyclePermille();
+    
+    DEBUG_SERIAL.println("\n--- Power Status ---");
+    DEBUG_SERIAL.printf("Mode: %s\n", autoSleep ? "low-power (automatic light sleep)" :
+                                       enabled ? "low-power (modem sleep only)" : "always on");
+    DEBUG_SERIAL.printf("Duty cycle: %u.%u%% awake, %u waits with light sleep allowed\n",
+                        dutyCycle / 10, dutyCycle % 10, sleepCount);
+    DEBUG_SERIAL.printf("Detection latency: up to %lu ms\n", detectionLatency);
+    DEBUG_SERIAL.printf("Estimated average current: %u.%u mA\n",
+                        getEstimatedCurrent() / 1000, (getEstimatedCurrent() % 1000) / 100);
+    DEBUG_SERIAL.println("--- End Power Status ---\n");
+}
@@ -0,0 +1,48 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "hal.h"
+
+/**
+ * Duty cycling between RFID polls. With LOW_POWER_MODE each PN532 is put into
+ * PowerDown while no tag is on it, and the gaps between polls are spent blocked with
+ * automatic light sleep allowed, so the chip sleeps once the other tasks are idle too.
+ * WiFi stays associated in modem sleep; the timer or the PN532 IRQ ends the wait.
+ * Keeps a time budget of awake/asleep and reader on/off to estimate current draw.
+ */
+class PowerManager {
+    private:
+        SleepController& sleep;
+        Clock& clock;
+        int wakePin;                    // PN532 IRQ, -1 for timer wake-up only
+        bool enabled;                   // LOW_POWER_MODE
+        bool autoSleep;                 // Automatic light sleep is configured
+        bool readerDown[NFC_READER_COUNT];
+        unsigned long startedAt;
+        unsigned long readerDownSince[NFC_READER_COUNT];
+
+        // Time budget (ms)
+        unsigned long sleepTime;        // Waited with light sleep allowed, an upper bound of time asleep
+        unsigned long readerDownTime;   // Summed over all readers
+        uint32_t sleepCount;
+
+    public:
+        PowerManager(SleepController& sleep, Clock& clock, int wakePin = -1, bool enabled = LOW_POWER_MODE);
+        void begin();
+
+        // Per reader pool index: before a poll wake the PN532 if it is powered down,
+        // after a poll power it down unless a tag must stay selected
+        void prepareReader(uint8_t index, NfcReader& reader);
+        void releaseReader(uint8_t index, NfcReader& reader, bool tagPresent);
+        void idle(unsigned long maxMs, bool canSleep);  // Wait up to maxMs for the next poll
+
+        // Status and info
+        bool isAutoSleepEnabled() const { return autoSleep; }
+        uint32_t getDutyCyclePermille() const;       // Awake share of the time since begin()
+        uint32_t getEstimatedCurrent() const;        // Average in uA, from typical datasheet figures
+        void printPowerStatus(unsigned long detectionLatency);
+};
+
+#endif // POWER_MANAGER_H
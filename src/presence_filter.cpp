@@ -0,0 +1,159 @@
+#include "presence_filter.h"
+#include "logger.h"
+#include "metrics.h"
+
+PresenceFilter::PresenceFilter()
+    : stablePresent(false), stableUidLength(0), candidateSince(0), candidatePresent(false),
+      candidateUidLength(0), candidateAgreed(0), candidateContrary(0), removalPending(false), changeCount(0),
+      rawPresent(false), rawUidLength(0), rawChanges(0), emittedChanges(0), flapsRejected(0),
+      reinsertsSuppressed(0), droppedChanges(0) {
+    memset(&pendingRemoval, 0, sizeof(pendingRemoval));
+}
+
+bool PresenceFilter::sameUid(const uint8_t* a, uint8_t aLength, const uint8_t* b, uint8_t bLength) {
+    return aLength == bLength && memcmp(a, b, aLength) == 0;
+}
+
+void PresenceFilter::startCandidate(unsigned long now, bool present, const uint8_t* uid, uint8_t uidLength) {
+    candidateSince = now != 0 ? now : 1;  // 0 means "no candidate"
+    candidatePresent = present;
+    candidateUidLength = uidLength;
+    memcpy(candidateUid, uid, uidLength);
+    candidateAgreed = 0;
+    candidateContrary = 0;
+}
+
+void PresenceFilter::observe(unsigned long now, bool present, const uint8_t* uid, uint8_t uidLength) {
+    uidLength = present ? min(uidLength, MAX_UID_LENGTH) : 0;
+
+    // Every raw change would have been a webhook call without the filter
+    if (present != rawPresent || !sameUid(uid, uidLength, rawUid, rawUidLength)) {
+        rawChanges++;
+    }
+    rawPresent = present;
+    rawUidLength = uidLength;
+    memcpy(rawUid, uid, uidLength);
+
+    bool matchesStable = present == stablePresent && sameUid(uid, uidLength, stableUid, stableUidLength);
+    if (!matchesStable) {
+        bool matchesCandidate = candidateSince != 0 && present == candidatePresent &&
+                                sameUid(uid, uidLength, candidateUid, candidateUidLength);
+        if (!matchesCandidate) {
+            startCandidate(now, present, uid, uidLength);
+        }
+        if (candidateAgreed < 0xFF) {
+            candidateAgreed++;
+        }
+    } else if (candidateSince != 0) {
+        candidateContrary++;
+        if (candidateContrary > PRESENCE_WINDOW - PRESENCE_CONFIRM) {
+            candidateSince = 0;
+            flapsRejected++;
+        }
+    }
+
+    evaluate(now);
+}
+
+void PresenceFilter::evaluate(unsigned long now) {
+    if (candidateSince != 0) {
+        unsigned long hold = candidatePresent ? PRESENCE_INSERT_HOLD : PRESENCE_REMOVE_HOLD;
+        // IRQ mode reports a removal once, so an uncontested removal needs no further polls
+        bool confirmed = candidateAgreed >= PRESENCE_CONFIRM || (!candidatePresent && candidateContrary == 0);
+        if (confirmed && now - candidateSince >= hold) {
+            commit();
+        }
+    }
+
+    if (removalPending && now - pendingRemoval.at >= PRESENCE_REINSERT_GRACE) {
+        removalPending = false;
+        emit(pendingRemoval);
+    }
+}
+
+void PresenceFilter::commit() {
+    PresenceChange change;
+    change.at = candidateSince;
+    change.reader = 0;
+
+    if (stablePresent) {
+        change.present = false;
+        change.uidLength = stableUidLength;
+        memcpy(change.uid, stableUid, stableUidLength);
+        if (!candidatePresent && PRESENCE_REINSERT_GRACE > 0) {
+            // The same tag may come straight back; hold the removal until the grace window ends
+            pendingRemoval = change;
+            removalPending = true;
+        } else {
+            emit(change);  // Replaced by another tag
+        }
+    }
+
+    if (candidatePresent) {
+        change.present = true;
+        change.uidLength = candidateUidLength;
+        memcpy(change.uid, candidateUid, candidateUidLength);
+        if (removalPending && sameUid(change.uid, change.uidLength, pendingRemoval.uid, pendingRemoval.uidLength)) {
+            removalPending = false;
+            reinsertsSuppressed++;
+        } else {
+            if (removalPending) {
+                removalPending = false;
+                emit(pendingRemoval);
+            }
+            emit(change);
+        }
+    }
+
+    stablePresent = candidatePresent;
+    stableUidLength = candidateUidLength;
+    memcpy(stableUid, candidateUid, candidateUidLength);
+    candidateSince = 0;
+}
+
+void PresenceFilter::emit(const PresenceChange& change) {
+    if (changeCount >= CHANGE_SLOTS) {
+        droppedChanges++;
+        metrics.increment(COUNTER_PRESENCE_CHANGES_DROPPED);
+        LOG_ERROR("Presence change dropped, %u uncollected", (unsigned)changeCount);
+        return;
+    }
+    changes[changeCount++] = change;
+    emittedChanges++;
+}
+
+bool PresenceFilter::nextChange(unsigned long now, PresenceChange& change) {
+    evaluate(now);
+    if (changeCount == 0) {
+        return false;
+    }
+
+    change = changes[0];
+    changeCount--;
+    for (uint8_t i = 0; i < changeCount; i++) {
+        changes[i] = changes[i + 1];
+    }
+    return true;
+}
+
+bool PresenceFilter::tracks(const uint8_t* uid, uint8_t uidLength) const {
+    return (stablePresent && sameUid(uid, uidLength, stableUid, stableUidLength)) ||
+           (candidateSince != 0 && candidatePresent && sameUid(uid, uidLength, candidateUid, candidateUidLength)) ||
+           (removalPending && sameUid(uid, uidLength, pendingRemoval.uid, pendingRemoval.uidLength));
+}
+
+bool PresenceFilter::isIdle() const {
+    return !stablePresent && !removalPending && (candidateSince == 0 || !candidatePresent);
+}
+
+void PresenceFilter::printFilterStatus() {
+    DEBUG_SERIAL.println("\n--- Presence Filter Status ---");
+    DEBUG_SERIAL.printf("Confirm: %d of %d polls, hold: insert %d ms, removal %d ms, re-insert grace %d ms\n",
+                        PRESENCE_CONFIRM, PRESENCE_WINDOW, PRESENCE_INSERT_HOLD, PRESENCE_REMOVE_HOLD,
+                        PRESENCE_REINSERT_GRACE);
+    DEBUG_SERIAL.printf("Raw changes: %u, Events sent: %u, Saved: %u\n",
+                        rawChanges, emittedChanges, getSavedEvents());
+    DEBUG_SERIAL.printf("Flaps rejected: %u, Re-inserts suppressed: %u, Dropped: %u\n",
+                        flapsRejected, reinsertsSuppressed, droppedChanges);
+    DEBUG_SERIAL.println("--- End Presence Filter Status ---\n");
+}
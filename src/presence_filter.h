@@ -0,0 +1,94 @@
+#ifndef PRESENCE_FILTER_H
+#define PRESENCE_FILTER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "poll_event.h"
+
+// A confirmed tag_insert or tag_removed, stamped with when it actually happened
+struct PresenceChange {
+    bool present;
+    uint8_t uid[MAX_UID_LENGTH];    // Inserted tag, or the tag that was removed
+    uint8_t uidLength;
+    unsigned long at;               // millis() of the first poll that saw the change
+    uint8_t reader;                 // Reader pool index, set by the pool
+};
+
+/**
+ * Debounces raw poll results into stable insert/removal events.
+ *
+ * A change of state (or of UID) becomes a candidate on the first poll that
+ * disagrees with the stable state. It is confirmed once PRESENCE_CONFIRM polls
+ * agreed with it and its hold time (PRESENCE_INSERT_HOLD / PRESENCE_REMOVE_HOLD)
+ * has passed; more than PRESENCE_WINDOW - PRESENCE_CONFIRM contrary polls drop
+ * it as a flap. A removal nothing contradicted is confirmed by its hold time
+ * alone, since IRQ mode reports a removal only once; an insert always needs
+ * PRESENCE_CONFIRM reads.
+ * A confirmed removal is held back for PRESENCE_REINSERT_GRACE; if the same tag
+ * comes back in that time, both events are dropped.
+ * Pure timing logic, no hardware access.
+ */
+class PresenceFilter {
+    private:
+        // Stable (reported) state
+        bool stablePresent;
+        uint8_t stableUid[MAX_UID_LENGTH];
+        uint8_t stableUidLength;
+
+        // Candidate change, candidateSince == 0 if none
+        unsigned long candidateSince;
+        bool candidatePresent;
+        uint8_t candidateUid[MAX_UID_LENGTH];
+        uint8_t candidateUidLength;
+        uint8_t candidateAgreed;
+        uint8_t candidateContrary;
+
+        // Removal waiting out the re-insert grace window
+        bool removalPending;
+        PresenceChange pendingRemoval;
+
+        // Confirmed changes not yet collected by nextChange(). One evaluation confirms at most a
+        // removal and an insert; the spare slots cover a poll whose changes were not collected yet
+        static const uint8_t CHANGE_SLOTS = 4;
+        PresenceChange changes[CHANGE_SLOTS];
+        uint8_t changeCount;
+
+        // Raw poll state, to count the events unfiltered polling would have sent
+        bool rawPresent;
+        uint8_t rawUid[MAX_UID_LENGTH];
+        uint8_t rawUidLength;
+
+        // Statistics
+        uint32_t rawChanges;
+        uint32_t emittedChanges;
+        uint32_t flapsRejected;
+        uint32_t reinsertsSuppressed;
+        uint32_t droppedChanges;        // Confirmed but lost to a full change buffer
+
+        static bool sameUid(const uint8_t* a, uint8_t aLength, const uint8_t* b, uint8_t bLength);
+        void startCandidate(unsigned long now, bool present, const uint8_t* uid, uint8_t uidLength);
+        void evaluate(unsigned long now);
+        void commit();
+        void emit(const PresenceChange& change);
+
+    public:
+        PresenceFilter();
+
+        void observe(unsigned long now, bool present, const uint8_t* uid, uint8_t uidLength);
+        bool nextChange(unsigned long now, PresenceChange& change);  // Also applies hold/grace timeouts
+
+        bool tracks(const uint8_t* uid, uint8_t uidLength) const;  // Tag is present, pending or in its grace window here
+        bool isIdle() const;                                       // Nothing present, pending or in its grace window
+
+        // Status and info
+        bool isPresent() const { return stablePresent; }
+        uint32_t getRawChanges() const { return rawChanges; }
+        uint32_t getEmittedChanges() const { return emittedChanges; }
+        uint32_t getSavedEvents() const { return rawChanges > emittedChanges ? rawChanges - emittedChanges : 0; }
+        uint32_t getFlapsRejected() const { return flapsRejected; }
+        uint32_t getReinsertsSuppressed() const { return reinsertsSuppressed; }
+        uint32_t getDroppedChanges() const { return droppedChanges; }
+        void printFilterStatus();
+};
+
+#endif // PRESENCE_FILTER_H
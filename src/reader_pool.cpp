@@ -0,0 +1,311 @@
+#include "reader_pool.h"
+#include "metrics.h"
+#include "logger.h"
+
+// Upper bound for one full poll; NFC_ACTIVATION_RETRIES ends polls sooner
+static const uint16_t TAG_READ_TIMEOUT = 1000;  // ms
+
+static const uint8_t NO_UID[MAX_UID_LENGTH] = { 0 };
+
+ReaderPool::ReaderPool()
+    : count(0), lastPolled(0), detectionArmed(false), irqTagPresent(false), detectionArmedAt(0), lastDetectionTime(0) {
+}
+
+bool ReaderPool::addReader(NfcReader& reader, uint8_t priority) {
+    if (count >= NFC_READER_COUNT) {
+        return false;
+    }
+    Slot& slot = slots[count++];
+    slot.reader = &reader;
+    slot.priority = priority;
+    slot.online = false;
+    slot.selected.uidLength = 0;
+    return true;
+}
+
+uint8_t ReaderPool::begin() {
+    uint8_t online = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        Slot& slot = slots[i];
+        if (slot.online) {
+            online++;
+            continue;
+        }
+        if (!slot.reader->begin()) {
+            LOG_ERROR("Error: Could not initialize PN532 reader %u!", i);
+            continue;
+        }
+
+        uint32_t versiondata = slot.reader->getFirmwareVersion();
+        if (!versiondata) {
+            LOG_ERROR("Error: Did not find PN532 board for reader %u!", i);
+            continue;
+        }
+        LOG_INFO("Reader %u: found chip PN5%X, firmware ver. %u.%u", i,
+                 (unsigned)((versiondata >> 24) & 0xFF), (unsigned)((versiondata >> 16) & 0xFF),
+                 (unsigned)((versiondata >> 8) & 0xFF));
+
+        slot.reader->configure();
+
+        // In polling mode, stop each search after a few attempts instead of waiting for TAG_READ_TIMEOUT
+        if (!slot.reader->hasIrq()) {
+            slot.reader->setActivationRetries(NFC_ACTIVATION_RETRIES);
+        }
+        slot.online = true;
+        online++;
+    }
+
+    lastPolled = count - 1;  // Reader 0 goes first
+    if (count > 1 || NFC_MAX_TARGETS > 1) {
+        LOG_INFO("Reader pool: %u of %u readers online, up to %d cards per reader",
+                 online, count, NFC_MAX_TARGETS);
+    }
+    return online;
+}
+
+uint8_t ReaderPool::getOnlineCount() const {
+    uint8_t online = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        online += slots[i].online ? 1 : 0;
+    }
+    return online;
+}
+
+int ReaderPool::nextDue(unsigned long now) const {
+    int best = -1;
+    for (uint8_t step = 1; step <= count; step++) {
+        uint8_t i = (lastPolled + step) % count;
+        if (!slots[i].online || !slots[i].scheduler.isDue(now)) {
+            continue;
+        }
+        if (best < 0 || slots[i].priority > slots[best].priority) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+unsigned long ReaderPool::timeUntilDue(unsigned long now) const {
+    unsigned long wait = POLL_IDLE_MAX_INTERVAL;
+    for (uint8_t i = 0; i < count; i++) {
+        if (slots[i].online) {
+            wait = min(wait, slots[i].scheduler.timeUntilDue(now));
+        }
+    }
+    return wait;
+}
+
+unsigned long ReaderPool::currentInterval(unsigned long now) const {
+    unsigned long interval = POLL_IDLE_MAX_INTERVAL;
+    for (uint8_t i = 0; i < count; i++) {
+        if (slots[i].online) {
+            interval = min(interval, slots[i].scheduler.currentInterval(now));
+        }
+    }
+    return interval;
+}
+
+bool ReaderPool::poll(uint8_t index, Clock& clock) {
+    Slot& slot = slots[index];
+    lastPolled = index;
+
+    // A presence check would miss a second card arriving next to the selected one
+    PollKind kind = NFC_MAX_TARGETS > 1 ? POLL_FULL : slot.scheduler.nextKind();
+    NfcTarget targets[NFC_MAX_TARGETS];
+    uint8_t found = 0;
+    unsigned long pollStart = clock.millis();
+
+    if (kind == POLL_PRESENCE) {
+        PresenceResult presence = slot.reader->checkPresence();
+        if (presence == PRESENCE_UNSUPPORTED) {
+            slot.scheduler.onPresenceCheckUnsupported();
+            kind = POLL_FULL;
+        } else if (presence == PRESENCE_PRESENT) {
+            // Same tag still selected: reuse its UID without a new anti-collision round
+            targets[0] = slot.selected;
+            found = 1;
+        }
+    }
+
+    if (kind == POLL_FULL) {
+        // ISO14443A detection
+        found = slot.reader->readPassiveTargets(targets, NFC_MAX_TARGETS, TAG_READ_TIMEOUT);
+        if (found > 0) {
+            slot.selected = targets[0];
+        }
+    }
+
+    metrics.observe(HISTOGRAM_NFC_POLL_MS, clock.millis() - pollStart);
+    if (kind == POLL_PRESENCE) {
+        metrics.increment(COUNTER_NFC_PRESENCE_CHECKS);
+    } else {
+        metrics.increment(COUNTER_NFC_FULL_POLLS);
+        if (found == 0) {
+            metrics.increment(COUNTER_NFC_EMPTY_POLLS);
+        } else if (found > 1) {
+            metrics.increment(COUNTER_NFC_MULTI_TARGET_POLLS);
+        }
+    }
+
+    // Stamp the poll result now, before any debug output or queueing delays it
+    unsigned long now = clock.millis();
+    slot.scheduler.onPollResult(now, kind, found > 0);
+    observe(index, now, targets, found);
+    return found > 0;
+}
+
+bool ReaderPool::pollIrq(unsigned long now, Clock& clock) {
+    NfcReader& reader = *slots[0].reader;
+    if (!detectionArmed) {
+        // While a tag is present, re-check its presence every NFC_REARM_INTERVAL
+        if (irqTagPresent && now - lastDetectionTime < NFC_REARM_INTERVAL) {
+            return false;
+        }
+        detectionArmed = reader.startDetection();
+        detectionArmedAt = now;
+        return false;
+    }
+
+    NfcTarget target;
+    if (reader.isDetectionReady()) {
+        detectionArmed = false;
+        unsigned long readStart = clock.millis();
+        bool success = reader.readDetectedTarget(target);
+        metrics.observe(HISTOGRAM_NFC_POLL_MS, clock.millis() - readStart);
+        metrics.increment(COUNTER_NFC_FULL_POLLS);
+        if (!success) {
+            metrics.increment(COUNTER_NFC_EMPTY_POLLS);
+        }
+        lastDetectionTime = now;
+        irqTagPresent = success;
+
+        // Stamp the poll result now, before any debug output or queueing delays it
+        observe(0, clock.millis(), &target, success ? 1 : 0);
+        return true;
+    }
+
+    if (irqTagPresent && now - detectionArmedAt >= NFC_ABSENT_TIMEOUT) {
+        // No answer: the tag left the field. Detection stays armed for the next tag
+        irqTagPresent = false;
+        observe(0, clock.millis(), &target, 0);
+        return true;
+    }
+
+    return false;
+}
+
+void ReaderPool::observe(uint8_t index, unsigned long now, const NfcTarget* targets, uint8_t found) {
+    if (index < count) {
+        feedFilters(slots[index], now, targets, min(found, (uint8_t)NFC_MAX_TARGETS));
+    }
+}
+
+void ReaderPool::feedFilters(Slot& slot, unsigned long now, const NfcTarget* targets, uint8_t found) {
+    // A card goes back to the filter already following it, a new card to an idle filter.
+    // The PN532 does not report cards in a stable order, so the position in targets means nothing
+    int8_t assigned[NFC_MAX_TARGETS];  // Card per filter, -1 for none
+    bool placed[NFC_MAX_TARGETS];
+    for (uint8_t f = 0; f < NFC_MAX_TARGETS; f++) {
+        assigned[f] = -1;
+        placed[f] = false;
+    }
+
+    for (uint8_t t = 0; t < found; t++) {
+        for (uint8_t f = 0; f < NFC_MAX_TARGETS; f++) {
+            if (assigned[f] < 0 && slot.filters[f].tracks(targets[t].uid, targets[t].uidLength)) {
+                assigned[f] = t;
+                placed[t] = true;
+                break;
+            }
+        }
+    }
+
+    for (uint8_t t = 0; t < found; t++) {
+        if (placed[t]) {
+            continue;
+        }
+        // Prefer an idle filter; otherwise the card replaces one that lost its card
+        int target = -1;
+        for (uint8_t f = 0; f < NFC_MAX_TARGETS; f++) {
+            if (assigned[f] < 0 && (target < 0 || slot.filters[f].isIdle())) {
+                target = f;
+                if (slot.filters[f].isIdle()) {
+                    break;
+                }
+            }
+        }
+        if (target >= 0) {
+            assigned[target] = t;
+        }
+    }
+
+    for (uint8_t f = 0; f < NFC_MAX_TARGETS; f++) {
+        if (assigned[f] >= 0) {
+            const NfcTarget& target = targets[assigned[f]];
+            slot.filters[f].observe(now, true, target.uid, target.uidLength);
+        } else {
+            slot.filters[f].observe(now, false, NO_UID, 0);
+        }
+    }
+}
+
+bool ReaderPool::nextChange(unsigned long now, PresenceChange& change) {
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t f = 0; f < NFC_MAX_TARGETS; f++) {
+            if (slots[i].filters[f].nextChange(now, change)) {
+                change.reader = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ReaderPool::isAnyPresent() const {
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t f = 0; f < NFC_MAX_TARGETS; f++) {
+            if (slots[i].filters[f].isPresent()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+uint32_t ReaderPool::getSavedEvents() const {
+    uint32_t saved = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t f = 0; f < NFC_MAX_TARGETS; f++) {
+            saved += slots[i].filters[f].getSavedEvents();
+        }
+    }
+    return saved;
+}
+
+void ReaderPool::printPoolStatus(unsigned long now) {
+    DEBUG_SERIAL.println("\n--- Reader Pool Status ---");
+    DEBUG_SERIAL.printf("Readers: %u, Cards per poll: %d, Two-card polls: %u\n",
+                        count, NFC_MAX_TARGETS, metrics.getCounter(COUNTER_NFC_MULTI_TARGET_POLLS));
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t present = 0;
+        for (uint8_t f = 0; f < NFC_MAX_TARGETS; f++) {
+            present += slots[i].filters[f].isPresent() ? 1 : 0;
+        }
+        DEBUG_SERIAL.printf("Reader %u: %s, priority %u, cards present: %u\n", i,
+                            slots[i].online ? "online" : "OFFLINE", slots[i].priority, present);
+    }
+    DEBUG_SERIAL.println("--- End Reader Pool Status ---\n");
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (!slots[i].online) {
+            continue;
+        }
+        if (count > 1) {
+            DEBUG_SERIAL.printf("Reader %u:\n", i);
+        }
+        slots[i].scheduler.printSchedulerStatus(now);
+        for (uint8_t f = 0; f < NFC_MAX_TARGETS; f++) {
+            slots[i].filters[f].printFilterStatus();
+        }
+    }
+}
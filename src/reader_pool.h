@@ -0,0 +1,82 @@
+#ifndef READER_POOL_H
+#define READER_POOL_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "hal.h"
+#include "poll_scheduler.h"
+#include "presence_filter.h"
+
+#if NFC_READER_COUNT < 1 || NFC_READER_COUNT > 8
+#error "NFC_READER_COUNT must be 1 to 8 (TCA9548A channels)"
+#endif
+#if NFC_MAX_TARGETS < 1 || NFC_MAX_TARGETS > 2
+#error "NFC_MAX_TARGETS must be 1 or 2 (PN532 InListPassiveTarget MaxTg)"
+#endif
+#if PN532_IRQ >= 0 && (NFC_READER_COUNT > 1 || NFC_MAX_TARGETS > 1)
+#error "IRQ mode drives one reader with one card: set PN532_IRQ to -1 for a reader pool or NFC_MAX_TARGETS 2"
+#endif
+
+/**
+ * Polls several PN532 readers from the one loop, with presence state per reader.
+ *
+ * Every reader has its own PollScheduler, so a reader with a tag on it is checked
+ * at POLL_PRESENT_INTERVAL while idle ones back off. When several are due at once
+ * the highest NFC_READER_PRIORITIES entry goes first and equal ones take turns.
+ * With NFC_MAX_TARGETS 2 each full poll activates up to two cards, and each
+ * reader has a PresenceFilter per card, so two cards on one pad give two
+ * independent insert/removal streams. Presence checks only reach the one selected
+ * card, so in that mode every poll is a full one.
+ *
+ * In IRQ mode (PN532_IRQ wired, one reader) pollIrq() replaces nextDue()/poll():
+ * one InListPassiveTarget stays outstanding and the bus is only touched once the
+ * IRQ line signals its result.
+ */
+class ReaderPool {
+    private:
+        struct Slot {
+            NfcReader* reader;
+            uint8_t priority;
+            bool online;
+            PollScheduler scheduler;
+            PresenceFilter filters[NFC_MAX_TARGETS];  // One per card the reader can hold
+            NfcTarget selected;                       // Card left selected by the last full poll
+        };
+
+        Slot slots[NFC_READER_COUNT];
+        uint8_t count;
+        uint8_t lastPolled;             // Equal priorities take turns after this reader
+
+        // IRQ mode detection state (reader 0)
+        bool detectionArmed;
+        bool irqTagPresent;
+        unsigned long detectionArmedAt;
+        unsigned long lastDetectionTime;
+
+        void feedFilters(Slot& slot, unsigned long now, const NfcTarget* targets, uint8_t found);
+
+    public:
+        ReaderPool();
+        bool addReader(NfcReader& reader, uint8_t priority);
+        uint8_t begin();  // Brings up every reader not online yet, returns how many are online
+
+        int nextDue(unsigned long now) const;  // Reader to poll now, -1 if none is due
+        unsigned long timeUntilDue(unsigned long now) const;
+        bool poll(uint8_t index, Clock& clock);  // Presence check or full poll, true if a card is there
+        void observe(uint8_t index, unsigned long now, const NfcTarget* targets, uint8_t found);
+        bool pollIrq(unsigned long now, Clock& clock);  // IRQ mode: true when a poll result was observed
+        bool isAwaitingIrq() const { return detectionArmed && !irqTagPresent; }  // Only the IRQ line can change anything
+        bool nextChange(unsigned long now, PresenceChange& change);  // Changes of all readers
+
+        // Status and info
+        uint8_t getCount() const { return count; }
+        uint8_t getOnlineCount() const;
+        NfcReader& getReader(uint8_t index) { return *slots[index].reader; }
+        const PollScheduler& getScheduler(uint8_t index) const { return slots[index].scheduler; }
+        bool isAnyPresent() const;
+        unsigned long currentInterval(unsigned long now) const;  // Shortest poll interval of all readers
+        uint32_t getSavedEvents() const;
+        void printPoolStatus(unsigned long now);
+};
+
+#endif // READER_POOL_H
@@ -0,0 +1,204 @@
+#include "session_tracker.h"
+#include "logger.h"
+
+SessionTracker::SessionTracker()
+    : bootId(0), uidLength(0), startEpochMs(0), carriedMs(0), carriedBootId(0), segmentStart(0), lastCheckpoint(0),
+      checkpointStored(false), checkpointStale(false), restoredPending(false), restoredAt(0), sessionsClosed(0),
+      sessionsResumed(0), sessionsEstimated(0), checkpointWrites(0) {
+    memset(&restored, 0, sizeof(restored));
+}
+
+void SessionTracker::begin(uint32_t bootId, unsigned long now) {
+    this->bootId = bootId;
+
+    Preferences prefs;
+    if (!prefs.begin("session", true)) {
+        return;
+    }
+    restoredPending = prefs.getBytesLength("open") == sizeof(restored) &&
+                      prefs.getBytes("open", &restored, sizeof(restored)) == sizeof(restored) &&
+                      restored.version == SESSION_CHECKPOINT_VERSION &&
+                      restored.uidLength > 0 && restored.uidLength <= MAX_UID_LENGTH;
+    prefs.end();
+
+    if (restoredPending) {
+        restoredAt = now;
+        checkpointStored = true;
+        char tagId[TAG_ID_TEXT_SIZE];
+        formatTagId(restored.uid, restored.uidLength, tagId, sizeof(tagId));
+        DEBUG_SERIAL.printf("Checkpointed session: %s, %lu s so far\n", tagId, (unsigned long)restored.elapsedMs / 1000);
+    }
+}
+
+void SessionTracker::resolveStart(unsigned long now, uint64_t nowEpochMs) {
+    // Carried-over time does not include the downtime, so only a session of this boot can be dated back
+    if (startEpochMs == 0 && nowEpochMs != 0 && carriedMs == 0) {
+        startEpochMs = nowEpochMs - elapsed(now);
+    }
+}
+
+bool SessionTracker::onChange(const PresenceChange& change, uint64_t changeEpochMs, PollEvent& session) {
+    if (!change.present) {
+        if (!isOpen() || change.uidLength != uidLength || memcmp(change.uid, uid, uidLength) != 0) {
+            return false;
+        }
+        closeSession(change.at, changeEpochMs, session);
+        clearCheckpoint();
+        return true;
+    }
+
+    bool completed = false;
+    if (restoredPending) {
+        restoredPending = false;
+        if (change.uidLength == restored.uidLength && memcmp(change.uid, restored.uid, restored.uidLength) == 0) {
+            // Same tag back after the reboot: carry on with the checkpointed session
+            memcpy(uid, restored.uid, restored.uidLength);
+            uidLength = restored.uidLength;
+            startEpochMs = restored.startEpochMs;
+            carriedMs = restored.elapsedMs;
+            carriedBootId = restored.bootId;
+            segmentStart = change.at;
+            lastCheckpoint = change.at;
+            checkpointStale = true;  // Still names the previous boot
+            sessionsResumed++;
+            LOG_INFO("Resumed checkpointed session");
+            return false;
+        }
+        closeRestored(session);
+        completed = true;
+    } else if (isOpen()) {
+        // Another tag without a removal in between
+        closeSession(change.at, changeEpochMs, session);
+        completed = true;
+    }
+    if (completed) {
+        clearCheckpoint();  // Must not be closed a second time after a reboot
+    }
+
+    // Checkpointed by update(), not on the path that publishes the change
+    openSession(change, changeEpochMs);
+    return completed;
+}
+
+bool SessionTracker::update(unsigned long now, uint64_t nowEpochMs, PollEvent& session) {
+    if (restoredPending && now - restoredAt >= SESSION_RESUME_WINDOW) {
+        // The tag did not come back: the session ended while the device was down
+        restoredPending = false;
+        closeRestored(session);
+        clearCheckpoint();
+        return true;
+    }
+
+    unsigned long interval = checkpointStale ? SESSION_CHECKPOINT_DELAY : SESSION_CHECKPOINT_INTERVAL;
+    if (isOpen() && now - lastCheckpoint >= interval) {
+        saveCheckpoint(now, nowEpochMs);
+    }
+    return false;
+}
+
+void SessionTracker::openSession(const PresenceChange& change, uint64_t changeEpochMs) {
+    memcpy(uid, change.uid, change.uidLength);
+    uidLength = change.uidLength;
+    startEpochMs = changeEpochMs;
+    carriedMs = 0;
+    carriedBootId = 0;
+    segmentStart = change.at;
+    lastCheckpoint = change.at;
+    checkpointStale = true;
+}
+
+void SessionTracker::closeSession(unsigned long at, uint64_t atEpochMs, PollEvent& session) {
+    resolveStart(at, atEpochMs);
+
+    memset(&session, 0, sizeof(session));
+    session.kind = EVENT_SESSION;
+    session.durationMs = elapsed(at);
+    session.epochMs = startEpochMs;
+    session.monotonicMs = segmentStart;  // Start in this boot's millis(), for a late sync
+    if (carriedMs != 0) {
+        session.bootId = carriedBootId;  // Started before a reboot: never resolved against this boot's clock
+    }
+    memcpy(session.uid, uid, uidLength);
+    session.uidLength = uidLength;
+    session.tagType = detectTagType(uidLength);
+    session.timeSynced = startEpochMs != 0;
+
+    uidLength = 0;
+    sessionsClosed++;
+}
+
+void SessionTracker::closeRestored(PollEvent& session) {
+    memset(&session, 0, sizeof(session));
+    session.kind = EVENT_SESSION;
+    session.durationMs = restored.elapsedMs;
+    session.endEstimated = true;
+    session.epochMs = restored.startEpochMs;
+    session.bootId = restored.bootId;  // Never resolved against this boot's clock
+    memcpy(session.uid, restored.uid, restored.uidLength);
+    session.uidLength = restored.uidLength;
+    session.tagType = detectTagType(restored.uidLength);
+    session.timeSynced = restored.startEpochMs != 0;
+
+    sessionsClosed++;
+    sessionsEstimated++;
+}
+
+void SessionTracker::saveCheckpoint(unsigned long now, uint64_t nowEpochMs) {
+    resolveStart(now, nowEpochMs);
+    lastCheckpoint = now;
+
+    SessionCheckpoint checkpoint;
+    memset(&checkpoint, 0, sizeof(checkpoint));
+    checkpoint.version = SESSION_CHECKPOINT_VERSION;
+    memcpy(checkpoint.uid, uid, uidLength);
+    checkpoint.uidLength = uidLength;
+    checkpoint.bootId = bootId;
+    checkpoint.elapsedMs = elapsed(now);
+    checkpoint.startEpochMs = startEpochMs;
+
+    Preferences prefs;
+    if (!prefs.begin("session", false)) {
+        return;
+    }
+    if (prefs.putBytes("open", &checkpoint, sizeof(checkpoint)) == sizeof(checkpoint)) {
+        checkpointWrites++;
+        checkpointStored = true;
+        checkpointStale = false;
+    }
+    prefs.end();
+}
+
+void SessionTracker::clearCheckpoint() {
+    if (!checkpointStored) {
+        return;  // Session ended before its first checkpoint
+    }
+    Preferences prefs;
+    if (!prefs.begin("session", false)) {
+        return;
+    }
+    prefs.remove("open");
+    prefs.end();
+    checkpointStored = false;
+}
+
+void SessionTracker::printSessionStatus(unsigned long now) {
+    char tagId[TAG_ID_TEXT_SIZE];
+    DEBUG_SERIAL.println("\n--- Session Status ---");
+    if (isOpen()) {
+        char started[TIMESTAMP_TEXT_SIZE];
+        formatTagId(uid, uidLength, tagId, sizeof(tagId));
+        formatTimestamp(startEpochMs, started, sizeof(started));
+        DEBUG_SERIAL.printf("Open session: %s, %lu s (started %s)\n", tagId, (unsigned long)elapsed(now) / 1000, started);
+    } else {
+        DEBUG_SERIAL.println("Open session: None");
+    }
+    if (restoredPending) {
+        formatTagId(restored.uid, restored.uidLength, tagId, sizeof(tagId));
+        DEBUG_SERIAL.printf("Checkpointed session %s waiting for its tag: %lu ms left\n",
+                            tagId, SESSION_RESUME_WINDOW - (now - restoredAt));
+    }
+    DEBUG_SERIAL.printf("Closed: %u, Resumed after reboot: %u, Estimated ends: %u\n",
+                        sessionsClosed, sessionsResumed, sessionsEstimated);
+    DEBUG_SERIAL.printf("Checkpoint every %d ms, written: %u\n", SESSION_CHECKPOINT_INTERVAL, checkpointWrites);
+    DEBUG_SERIAL.println("--- End Session Status ---\n");
+}
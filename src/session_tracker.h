@@ -0,0 +1,90 @@
+#ifndef SESSION_TRACKER_H
+#define SESSION_TRACKER_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "poll_event.h"
+#include "presence_filter.h"
+
+#if SESSION_MODE && (NFC_READER_COUNT > 1 || NFC_MAX_TARGETS > 1)
+#error "SESSION_MODE follows one tag at a time: use one reader and NFC_MAX_TARGETS 1"
+#endif
+
+#define SESSION_CHECKPOINT_VERSION 1
+
+// Open session as stored in NVS, so it survives a reboot or power loss
+struct SessionCheckpoint {
+    uint8_t version;
+    uint8_t uid[MAX_UID_LENGTH];
+    uint8_t uidLength;
+    uint32_t bootId;                // Boot that wrote the checkpoint
+    uint32_t elapsedMs;             // Session length up to the checkpoint
+    uint64_t startEpochMs;          // 0 if the clock was never synced during the session
+};
+
+/**
+ * Turns confirmed insert/removal changes into completed sessions (SESSION_MODE):
+ * an insert opens a session, the removal closes it into one EVENT_SESSION event
+ * with the start time and duration.
+ *
+ * The open session is checkpointed to NVS from update(), never while a change
+ * is published: SESSION_CHECKPOINT_DELAY after it starts or resumes (shorter
+ * sessions and tag swaps cost no flash write), then every
+ * SESSION_CHECKPOINT_INTERVAL. After a reboot, the same tag showing up within
+ * SESSION_RESUME_WINDOW resumes it (the downtime is not counted); otherwise it
+ * is closed at its last checkpoint and flagged as estimated.
+ * A resumed session whose start was never synced keeps an unknown start: this
+ * boot's clock cannot account for the downtime.
+ */
+class SessionTracker {
+    private:
+        uint32_t bootId;
+
+        // Open session, uidLength == 0 if none
+        uint8_t uid[MAX_UID_LENGTH];
+        uint8_t uidLength;
+        uint64_t startEpochMs;          // 0 until the clock is synced
+        uint32_t carriedMs;             // Session time from earlier boots, downtime excluded
+        uint32_t carriedBootId;         // Boot that checkpointed carriedMs, 0 if none
+        unsigned long segmentStart;     // millis() this boot's part of the session began
+        unsigned long lastCheckpoint;   // millis() of the last checkpoint, or of the start/resume
+        bool checkpointStored;          // NVS holds a checkpoint (this session's or the restored one)
+        bool checkpointStale;           // ... that does not describe the open session yet
+
+        // Checkpointed session from the previous boot, waiting for its tag
+        bool restoredPending;
+        SessionCheckpoint restored;
+        unsigned long restoredAt;
+
+        // Statistics
+        uint32_t sessionsClosed;
+        uint32_t sessionsResumed;
+        uint32_t sessionsEstimated;
+        uint32_t checkpointWrites;
+
+        uint32_t elapsed(unsigned long now) const { return carriedMs + (now - segmentStart); }
+        void resolveStart(unsigned long now, uint64_t nowEpochMs);
+        void openSession(const PresenceChange& change, uint64_t changeEpochMs);
+        void closeSession(unsigned long at, uint64_t atEpochMs, PollEvent& session);
+        void closeRestored(PollEvent& session);
+        void saveCheckpoint(unsigned long now, uint64_t nowEpochMs);
+        void clearCheckpoint();
+
+    public:
+        SessionTracker();
+        void begin(uint32_t bootId, unsigned long now);  // Loads the checkpoint of the previous boot
+
+        // Both return true and fill session when a session was completed
+        bool onChange(const PresenceChange& change, uint64_t changeEpochMs, PollEvent& session);
+        bool update(unsigned long now, uint64_t nowEpochMs, PollEvent& session);  // Checkpoints, resume window
+
+        // Status and info
+        bool isOpen() const { return uidLength != 0; }
+        uint32_t getSessionsClosed() const { return sessionsClosed; }
+        uint32_t getSessionsResumed() const { return sessionsResumed; }
+        uint32_t getCheckpointWrites() const { return checkpointWrites; }
+        void printSessionStatus(unsigned long now);
+};
+
+#endif // SESSION_TRACKER_H
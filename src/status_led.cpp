@@ -0,0 +1,170 @@
+#include "status_led.h"
+
+StatusLed statusLed;
+
+static const uint16_t PROGRAM_ERROR = 0x100;    // | error code
+static const uint16_t PROGRAM_FLASH = 0x200;
+static const uint16_t PROGRAM_NONE = 0xFFFF;
+static const uint32_t COLOR_UNKNOWN = 0xFFFFFFFF;  // Forces the first write
+
+static const LedStep OFF_STEPS[] = { { 0, 0 } };
+static const LedStep CONNECTING_STEPS[] = {
+    { COLOR_WIFI_CONNECTING, LED_SLOW_BLINK_INTERVAL },
+    { 0, LED_SLOW_BLINK_INTERVAL }
+};
+static const LedStep CONNECTED_STEPS[] = { { COLOR_WIFI_CONNECTED, 0 } };
+static const LedStep TAG_PRESENT_STEPS[] = { { COLOR_TAG_PRESENT, 0 } };
+static const LedStep TAG_UNASSIGNED_STEPS[] = { { COLOR_TAG_UNASSIGNED, 0 } };
+
+struct PatternSteps {
+    const LedStep* steps;
+    uint8_t count;
+};
+
+static const PatternSteps PATTERNS[LED_PATTERN_COUNT] = {
+    { OFF_STEPS, 1 },
+    { CONNECTING_STEPS, 2 },
+    { CONNECTED_STEPS, 1 },
+    { TAG_PRESENT_STEPS, 1 },
+    { TAG_UNASSIGNED_STEPS, 1 }
+};
+
+StatusLed::StatusLed()
+    : pixels(1, BUILTIN_LED_PIN, NEO_GRB + NEO_KHZ800), ledTask(nullptr), pattern(LED_PATTERN_CONNECTING),
+      errors(0), flashColor(0), flashDuration(0), flashRequested(false), program(PROGRAM_NONE), step(0),
+      stepStart(0), flashing(false), flashStart(0), shownColor(COLOR_UNKNOWN) {
+}
+
+void StatusLed::ledTaskEntry(void* param) {
+    static_cast<StatusLed*>(param)->ledLoop();
+}
+
+void StatusLed::ledLoop() {
+    for (;;) {
+        // Sleeps until the next animation step, or until a setter changes the state
+        unsigned long wait = advance(millis());
+        TickType_t ticks = wait != 0 ? max((TickType_t)1, (TickType_t)pdMS_TO_TICKS(wait)) : portMAX_DELAY;
+        ulTaskNotifyTake(pdTRUE, ticks);
+    }
+}
+
+bool StatusLed::begin() {
+    pixels.begin();
+    pixels.setBrightness(LED_BRIGHTNESS);
+    advance(millis());
+
+    if (xTaskCreate(ledTaskEntry, "status_led", LED_TASK_STACK_SIZE,
+                    this, LED_TASK_PRIORITY, &ledTask) != pdPASS) {
+        DEBUG_SERIAL.println("Error: Could not start status LED task!");
+        return false;
+    }
+    return true;
+}
+
+uint16_t StatusLed::currentProgram() const {
+    if (flashing) {
+        return PROGRAM_FLASH;
+    }
+    uint32_t active = errors.load();
+    if (active != 0) {
+        return PROGRAM_ERROR | __builtin_ctz(active);  // Lowest code first
+    }
+    return pattern.load();
+}
+
+uint8_t StatusLed::stepCount(uint16_t program) const {
+    if (program == PROGRAM_FLASH) {
+        return 1;
+    }
+    if (program & PROGRAM_ERROR) {
+        return (program & 0xFF) * 2;  // On and off per blink
+    }
+    return program < LED_PATTERN_COUNT ? PATTERNS[program].count : 1;
+}
+
+LedStep StatusLed::stepOf(uint16_t program, uint8_t step) const {
+    if (program == PROGRAM_FLASH) {
+        return { flashColor.load(), 0 };
+    }
+    if (program & PROGRAM_ERROR) {
+        // N blinks, the last dark phase stretched into the pause between sequences
+        if (step % 2 == 0) {
+            return { COLOR_ERROR, LED_ERROR_BLINK_INTERVAL };
+        }
+        return { 0, (uint16_t)(step + 1 == stepCount(program) ? LED_ERROR_SEQUENCE_PAUSE : LED_ERROR_BLINK_INTERVAL) };
+    }
+    return program < LED_PATTERN_COUNT ? PATTERNS[program].steps[step] : OFF_STEPS[0];
+}
+
+unsigned long StatusLed::advance(unsigned long now) {
+    if (flashRequested.exchange(false)) {
+        flashing = true;
+        flashStart = now;
+    }
+    if (flashing && now - flashStart >= flashDuration.load()) {
+        flashing = false;
+    }
+
+    // A new state starts its animation from the first step
+    uint16_t next = currentProgram();
+    if (next != program) {
+        program = next;
+        step = 0;
+        stepStart = now;
+    }
+
+    LedStep current = stepOf(program, step);
+    if (current.duration != 0 && now - stepStart >= current.duration) {
+        step = (step + 1) % stepCount(program);
+        stepStart = now;
+        current = stepOf(program, step);
+    }
+    show(current.color);
+
+    if (flashing) {
+        return flashDuration.load() - (now - flashStart);
+    }
+    return current.duration != 0 ? current.duration - (now - stepStart) : 0;
+}
+
+void StatusLed::show(uint32_t color) {
+    if (color == shownColor) {
+        return;
+    }
+    pixels.setPixelColor(0, color);
+    pixels.show();
+    shownColor = color;
+}
+
+void StatusLed::wake() {
+    if (ledTask != nullptr) {
+        xTaskNotifyGive(ledTask);
+    }
+}
+
+void StatusLed::setPattern(LedPattern newPattern) {
+    if (pattern.exchange(newPattern) != newPattern) {
+        wake();
+    }
+}
+
+void StatusLed::setError(LedError code) {
+    uint32_t bit = 1UL << code;
+    if ((errors.fetch_or(bit) & bit) == 0) {
+        wake();
+    }
+}
+
+void StatusLed::clearError(LedError code) {
+    uint32_t bit = 1UL << code;
+    if ((errors.fetch_and(~bit) & bit) != 0) {
+        wake();
+    }
+}
+
+void StatusLed::flash(uint32_t color, uint16_t duration) {
+    flashColor = color;
+    flashDuration = duration;
+    flashRequested = true;
+    wake();
+}
@@ -0,0 +1,91 @@
+#ifndef STATUS_LED_H
+#define STATUS_LED_H
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "config.h"
+
+// What the LED shows when no error or flash is active
+enum LedPattern : uint8_t {
+    LED_PATTERN_OFF,
+    LED_PATTERN_CONNECTING,         // Blue, slow blink
+    LED_PATTERN_CONNECTED,          // Solid blue
+    LED_PATTERN_TAG_PRESENT,        // Solid green
+    LED_PATTERN_TAG_UNASSIGNED,     // Solid amber
+    LED_PATTERN_COUNT
+};
+
+// Error codes, shown as that many red blinks and a pause; the lowest active code is shown
+enum LedError : uint8_t {
+    LED_ERROR_NFC = 1,              // No PN532 reader answered
+    LED_ERROR_NO_NETWORK = 2,       // Every configured network failed, waiting to retry
+    LED_ERROR_WIFI_CONFIG = 3       // No WiFi networks configured
+};
+
+// One step of a pattern; duration 0 holds the color until the pattern changes
+struct LedStep {
+    uint32_t color;
+    uint16_t duration;              // ms
+};
+
+/**
+ * Status LED driven by its own task, so no caller waits on an animation or on
+ * the NeoPixel write.
+ *
+ * Modules only set state: the base pattern, error codes and one-shot flashes.
+ * Each setter stores the state and wakes the task, which works out what the LED
+ * should show (flash over error over pattern), writes the pixel only when the
+ * color changes and sleeps until the next step of the animation. Errors stay
+ * set until the module that raised them clears them, so the device keeps
+ * running and recovers instead of stopping in a blink loop.
+ */
+class StatusLed {
+    private:
+        Adafruit_NeoPixel pixels;
+        TaskHandle_t ledTask;
+
+        // Requested state, written by any task
+        std::atomic<uint8_t> pattern;
+        std::atomic<uint32_t> errors;           // Bit per LedError code
+        std::atomic<uint32_t> flashColor;
+        std::atomic<uint16_t> flashDuration;
+        std::atomic<bool> flashRequested;
+
+        // Animation state, owned by the LED task
+        uint16_t program;                       // Pattern, error or flash being shown
+        uint8_t step;
+        unsigned long stepStart;
+        bool flashing;
+        unsigned long flashStart;
+        uint32_t shownColor;
+
+        static void ledTaskEntry(void* param);
+        void ledLoop();
+        unsigned long advance(unsigned long now);  // Returns ms until the next change, 0 to wait for new state
+        uint16_t currentProgram() const;
+        uint8_t stepCount(uint16_t program) const;
+        LedStep stepOf(uint16_t program, uint8_t step) const;
+        void show(uint32_t color);
+        void wake();
+
+    public:
+        StatusLed();
+        bool begin();  // Lights the LED and starts the LED task
+
+        void setPattern(LedPattern newPattern);
+        void setError(LedError code);
+        void clearError(LedError code);
+        void flash(uint32_t color, uint16_t duration);  // Shows color for duration ms, then returns to the state
+
+        // Status and info
+        LedPattern getPattern() const { return (LedPattern)pattern.load(); }
+        uint32_t getErrors() const { return errors.load(); }
+        uint32_t getShownColor() const { return shownColor; }  // Last color written to the pixel
+};
+
+extern StatusLed statusLed;
+
+#endif // STATUS_LED_H
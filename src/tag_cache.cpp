@@ -0,0 +1,317 @@
+#include "tag_cache.h"
+#include <new>
+#include "logger.h"
+
+static const char* TAG_CACHE_PATH = "/tags.bin";
+static const char* TAG_CACHE_TEMP_PATH = "/tags_tmp.bin";
+
+TagCache::TagCache()
+    : fileLock(nullptr), loaded(false), count(0), version(0), lastSyncTime(0), syncIncomplete(false),
+      sync(nullptr), changeCount(0), lookupCount(0), syncCount(0), syncFailures(0), changesApplied(0), lastLookupTime(0),
+      lastMergeTime(0) {
+}
+
+int TagCache::compare(const TagCacheEntry& a, const TagCacheEntry& b) {
+    int order = memcmp(a.uid, b.uid, MAX_UID_LENGTH);
+    if (order != 0) {
+        return order;
+    }
+    return (int)a.uidLength - (int)b.uidLength;
+}
+
+bool TagCache::begin() {
+    DEBUG_SERIAL.println("\nInitializing Tag Cache...");
+
+    fileLock = xSemaphoreCreateMutex();
+    if (fileLock == nullptr) {
+        DEBUG_SERIAL.println("Error: Could not allocate tag cache lock!");
+        return false;
+    }
+
+    // A power cut between removing the old table and renaming the new one leaves only the new one
+    if (!SPIFFS.exists(TAG_CACHE_PATH) && SPIFFS.exists(TAG_CACHE_TEMP_PATH)) {
+        SPIFFS.rename(TAG_CACHE_TEMP_PATH, TAG_CACHE_PATH);
+    }
+    SPIFFS.remove(TAG_CACHE_TEMP_PATH);
+
+    loaded = load();
+    printCacheStatus();
+    return true;
+}
+
+bool TagCache::load() {
+    File file = SPIFFS.open(TAG_CACHE_PATH, FILE_READ);
+    if (!file) {
+        return false;
+    }
+
+    TagCacheHeader header;
+    bool valid = file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+                 header.magic == TAG_CACHE_MAGIC &&
+                 file.size() == sizeof(header) + header.count * sizeof(TagCacheEntry);
+
+    if (valid) {
+        table = file;
+        count = header.count;
+        version = header.version;
+    } else {
+        file.close();
+        LOG_WARN("Tag cache: table invalid, starting over with a full sync");
+        SPIFFS.remove(TAG_CACHE_PATH);
+        count = 0;
+        version = 0;
+    }
+    return valid;
+}
+
+TagAssignment TagCache::lookup(const uint8_t* uid, uint8_t uidLength, uint32_t& assignmentId) {
+    assignmentId = 0;
+    if (!loaded || fileLock == nullptr) {
+        return ASSIGNMENT_NOT_CHECKED;
+    }
+
+    unsigned long start = micros();
+    TagCacheEntry key;
+    memset(&key, 0, sizeof(key));
+    key.uidLength = min(uidLength, MAX_UID_LENGTH);
+    memcpy(key.uid, uid, key.uidLength);
+
+    TagAssignment result = ASSIGNMENT_NOT_CHECKED;
+    xSemaphoreTake(fileLock, portMAX_DELAY);
+    if (table) {
+        // Binary search straight on flash
+        result = ASSIGNMENT_UNKNOWN;
+        uint32_t low = 0;
+        uint32_t high = count;
+        while (low < high) {
+            uint32_t mid = low + (high - low) / 2;
+            TagCacheEntry entry;
+            if (!table.seek(sizeof(TagCacheHeader) + mid * sizeof(entry)) ||
+                table.read(reinterpret_cast<uint8_t*>(&entry), sizeof(entry)) != sizeof(entry)) {
+                result = ASSIGNMENT_NOT_CHECKED;
+                break;
+            }
+            int order = compare(entry, key);
+            if (order == 0) {
+                assignmentId = entry.assignmentId;
+                result = entry.assignmentId != 0 ? ASSIGNMENT_ASSIGNED : ASSIGNMENT_UNASSIGNED;
+                break;
+            }
+            if (order < 0) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+    }
+    xSemaphoreGive(fileLock);
+
+    lookupCount++;
+    lastLookupTime = micros() - start;
+    return result;
+}
+
+bool TagCache::syncIfDue(WebhookManager& webhook, const String& deviceId) {
+    if (fileLock == nullptr ||
+        (!syncIncomplete && lastSyncTime != 0 && millis() - lastSyncTime < TAG_CACHE_SYNC_INTERVAL)) {
+        return false;
+    }
+    lastSyncTime = millis();
+
+    sync = new (std::nothrow) TagCacheSyncBuffers;
+    if (sync == nullptr) {
+        syncFailures++;
+        LOG_WARN("Tag cache: not enough memory for a sync, retrying next interval");
+        return false;
+    }
+    bool success = fetchAndMerge(webhook, deviceId);
+    delete sync;
+    sync = nullptr;
+    return success;
+}
+
+bool TagCache::fetchAndMerge(WebhookManager& webhook, const String& deviceId) {
+    // Collect pages until the merge buffer is full or the server has nothing more
+    changeCount = 0;
+    uint64_t syncedVersion = version;
+    bool more = true;
+    bool success = true;
+    while (more && changeCount + TAG_CACHE_SYNC_PAGE <= TAG_CACHE_MERGE_BATCH) {
+        String response;
+        uint64_t pageVersion = 0;
+        if (!webhook.fetchAssignments(deviceId, syncedVersion, TAG_CACHE_SYNC_PAGE, response) ||
+            !parsePage(response, pageVersion, more)) {
+            success = false;
+            more = false;
+            break;
+        }
+        syncedVersion = max(syncedVersion, pageVersion);
+    }
+    syncIncomplete = success && more;
+
+    if (!success) {
+        syncFailures++;
+        LOG_WARN("Tag cache: sync failed, retrying next interval");
+    } else {
+        syncCount++;
+    }
+
+    // Pages received before a failure are still applied; the watermark only covers them.
+    // A first sync that got nothing must not create an empty table (every tag would look unknown)
+    if ((syncedVersion == version && loaded) || (!success && changeCount == 0)) {
+        return success;
+    }
+    return merge(syncedVersion) && success;
+}
+
+bool TagCache::parsePage(const String& response, uint64_t& pageVersion, bool& more) {
+    DeserializationError error = deserializeJson(sync->doc, response);
+    if (error) {
+        LOG_ERROR("Tag cache: invalid sync response (%s)", error.c_str());
+        return false;
+    }
+
+    JsonArray rows = sync->doc["assignments"];
+    if (rows.isNull() || rows.size() > TAG_CACHE_SYNC_PAGE) {
+        LOG_ERROR("Tag cache: unexpected sync response");
+        return false;
+    }
+    pageVersion = sync->doc["version"].as<uint64_t>();
+    more = sync->doc["more"].as<bool>();
+
+    for (JsonObject row : rows) {
+        TagCacheEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        const char* tagId = row["tag_id"];
+        if (tagId == nullptr || !parseTagId(tagId, entry.uid, entry.uidLength)) {
+            continue;
+        }
+        bool assigned = row["assigned"].as<bool>();
+        entry.assignmentId = assigned ? row["id"].as<uint32_t>() : 0;
+        addChange(entry, row["removed"].as<bool>());
+    }
+    return true;
+}
+
+void TagCache::addChange(const TagCacheEntry& entry, bool isRemoval) {
+    // Kept sorted; a later change of the same tag replaces the earlier one
+    size_t position = changeCount;
+    while (position > 0 && compare(sync->changes[position - 1], entry) > 0) {
+        position--;
+    }
+    if (position > 0 && compare(sync->changes[position - 1], entry) == 0) {
+        sync->changes[position - 1] = entry;
+        sync->removed[position - 1] = isRemoval;
+        return;
+    }
+    if (changeCount == TAG_CACHE_MERGE_BATCH) {
+        return;  // Cannot happen: pages are only requested while a full one fits
+    }
+    for (size_t i = changeCount; i > position; i--) {
+        sync->changes[i] = sync->changes[i - 1];
+        sync->removed[i] = sync->removed[i - 1];
+    }
+    sync->changes[position] = entry;
+    sync->removed[position] = isRemoval;
+    changeCount++;
+}
+
+bool TagCache::merge(uint64_t newVersion) {
+    unsigned long start = millis();
+    File target = SPIFFS.open(TAG_CACHE_TEMP_PATH, FILE_WRITE);
+    if (!target) {
+        return false;
+    }
+
+    // Placeholder header without the magic, so a torn table is never taken for a valid one
+    TagCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    bool ok = target.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+
+    // Merge the sorted table with the sorted changes into the new table
+    File source;
+    if (loaded) {
+        source = SPIFFS.open(TAG_CACHE_PATH, FILE_READ);
+        ok = ok && source && source.seek(sizeof(TagCacheHeader));
+    }
+    TagCacheEntry current;
+    bool haveCurrent = loaded && ok &&
+                       source.read(reinterpret_cast<uint8_t*>(&current), sizeof(current)) == sizeof(current);
+    size_t next = 0;
+    uint32_t written = 0;
+
+    while (ok && (haveCurrent || next < changeCount)) {
+        int order = !haveCurrent ? 1 : (next == changeCount ? -1 : compare(current, sync->changes[next]));
+        if (order < 0) {
+            ok = target.write(reinterpret_cast<const uint8_t*>(&current), sizeof(current)) == sizeof(current);
+            written++;
+            haveCurrent = source.read(reinterpret_cast<uint8_t*>(&current), sizeof(current)) == sizeof(current);
+            continue;
+        }
+        const TagCacheEntry& change = sync->changes[next];
+        if (!sync->removed[next]) {
+            ok = target.write(reinterpret_cast<const uint8_t*>(&change), sizeof(change)) == sizeof(change);
+            written++;
+        }
+        if (order == 0) {
+            haveCurrent = source.read(reinterpret_cast<uint8_t*>(&current), sizeof(current)) == sizeof(current);
+        }
+        next++;
+    }
+    if (source) {
+        source.close();
+    }
+
+    header.magic = TAG_CACHE_MAGIC;
+    header.count = written;
+    header.version = newVersion;
+    ok = ok && target.seek(0) &&
+         target.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+    target.close();
+
+    if (!ok) {
+        LOG_ERROR("Tag cache: could not write the new table");
+        SPIFFS.remove(TAG_CACHE_TEMP_PATH);
+        return false;
+    }
+
+    // Swap in the new table; lookups wait for this, not for the merge
+    xSemaphoreTake(fileLock, portMAX_DELAY);
+    table.close();
+    SPIFFS.remove(TAG_CACHE_PATH);
+    ok = SPIFFS.rename(TAG_CACHE_TEMP_PATH, TAG_CACHE_PATH);
+    if (ok) {
+        table = SPIFFS.open(TAG_CACHE_PATH, FILE_READ);
+        ok = (bool)table;
+    }
+    if (ok) {
+        count = written;
+        version = newVersion;
+        loaded = true;
+    } else {
+        loaded = false;
+    }
+    xSemaphoreGive(fileLock);
+
+    changesApplied += changeCount;
+    lastMergeTime = millis() - start;
+    LOG_INFO("Tag cache: %u changes applied, %u tags, version %llu (%lu ms)",
+             (unsigned)changeCount, count, (unsigned long long)version, lastMergeTime);
+    return ok;
+}
+
+void TagCache::printCacheStatus() {
+    DEBUG_SERIAL.println("\n--- Tag Cache Status ---");
+    if (loaded) {
+        DEBUG_SERIAL.printf("Tags: %u (%u bytes on flash), version %llu\n", count,
+                            (unsigned)(sizeof(TagCacheHeader) + count * sizeof(TagCacheEntry)),
+                            (unsigned long long)version);
+    } else {
+        DEBUG_SERIAL.println("Tags: none yet, waiting for the first sync");
+    }
+    DEBUG_SERIAL.printf("Syncs: %u, Failed: %u, Changes applied: %u%s\n",
+                        syncCount, syncFailures, changesApplied, syncIncomplete ? " (more pending)" : "");
+    DEBUG_SERIAL.printf("Lookups: %u, Last lookup: %lu us, Last merge: %lu ms\n",
+                        lookupCount, lastLookupTime, lastMergeTime);
+    DEBUG_SERIAL.println("--- End Tag Cache Status ---\n");
+}
@@ -0,0 +1,94 @@
+#ifndef TAG_CACHE_H
+#define TAG_CACHE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <SPIFFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+#include "poll_event.h"
+#include "webhook_manager.h"
+
+#define TAG_CACHE_MAGIC 0x54414731      // "TAG1"
+
+// JSON document for one sync page: {"version", "more", "assignments": [{"id", "tag_id", "assigned"}, ...]}
+#define TAG_CACHE_SYNC_DOC_CAPACITY (256 + TAG_CACHE_SYNC_PAGE * 160)
+
+// One cached tag; the file holds them sorted by UID after a TagCacheHeader
+struct TagCacheEntry {
+    uint32_t assignmentId;          // tag_assignments.id, 0 if the tag has no project
+    uint8_t uid[MAX_UID_LENGTH];    // Zero padded, so entries compare with memcmp
+    uint8_t uidLength;
+};
+
+struct TagCacheHeader {
+    uint32_t magic;
+    uint32_t count;
+    uint64_t version;               // Highest tag_assignments version applied (sync watermark)
+};
+
+// Working memory of one sync (about 8.7 KB), allocated only while the sync runs
+struct TagCacheSyncBuffers {
+    StaticJsonDocument<TAG_CACHE_SYNC_DOC_CAPACITY> doc;
+    TagCacheEntry changes[TAG_CACHE_MERGE_BATCH];
+    bool removed[TAG_CACHE_MERGE_BATCH];
+};
+
+/**
+ * Local copy of tag_assignments: UID -> assignment, so a tap gets its LED
+ * feedback and its payload enrichment without a round trip.
+ *
+ * The table lives in a SPIFFS file as entries sorted by UID and is searched in
+ * place (binary search, about 14 reads for 10k tags), so RAM use does not grow
+ * with the number of tags. Syncs only fetch assignments changed since the
+ * stored version watermark, TAG_CACHE_SYNC_PAGE at a time through the webhook.
+ * Up to TAG_CACHE_MERGE_BATCH changes are merged into a new copy of the file,
+ * which then replaces the old one. The table stays open between syncs, so a
+ * lookup costs no SPIFFS open, and the merge buffers only exist during a sync.
+ * Lookups run on the loop task, syncs on the sender task; fileLock covers the swap.
+ */
+class TagCache {
+    private:
+        SemaphoreHandle_t fileLock;
+        File table;                     // Open while loaded, for lookups
+        bool loaded;                    // A valid table is on flash
+        uint32_t count;
+        uint64_t version;
+        unsigned long lastSyncTime;
+        bool syncIncomplete;            // More changes are waiting on the server
+
+        // Kept off the sender task stack, and off the heap between syncs
+        TagCacheSyncBuffers* sync;
+        size_t changeCount;
+
+        // Statistics
+        uint32_t lookupCount;
+        uint32_t syncCount;
+        uint32_t syncFailures;
+        uint32_t changesApplied;
+        unsigned long lastLookupTime;   // us
+        unsigned long lastMergeTime;    // ms
+
+        static int compare(const TagCacheEntry& a, const TagCacheEntry& b);
+        bool load();
+        bool fetchAndMerge(WebhookManager& webhook, const String& deviceId);
+        bool parsePage(const String& response, uint64_t& pageVersion, bool& more);
+        void addChange(const TagCacheEntry& entry, bool isRemoval);
+        bool merge(uint64_t newVersion);
+
+    public:
+        TagCache();
+        bool begin();  // Needs SPIFFS mounted (EventJournal::begin)
+
+        TagAssignment lookup(const uint8_t* uid, uint8_t uidLength, uint32_t& assignmentId);
+        bool syncIfDue(WebhookManager& webhook, const String& deviceId);  // Sender task only
+
+        // Status and info
+        bool isLoaded() const { return loaded; }
+        uint32_t getCount() const { return count; }
+        uint64_t getVersion() const { return version; }
+        void printCacheStatus();
+};
+
+#endif // TAG_CACHE_H
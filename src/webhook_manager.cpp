@@ -1,22 +1,153 @@
 #include "webhook_manager.h"
 #include "config.h"
-#include <WiFiClient.h>
+#include "logger.h"
 
-WebhookManager::WebhookManager() {
-    webhookUrl = WEBHOOK_URL;
+static const char* const ENDPOINT_URLS[] = WEBHOOK_URLS;
+
+// 4xx other than 408 and 429 refuse the payload itself, so retrying it cannot succeed
+static bool isRejection(int httpResponseCode) {
+    return httpResponseCode >= 400 && httpResponseCode < 500 && httpResponseCode != 408 && httpResponseCode != 429;
+}
+
+WebhookManager::WebhookManager(HttpTransport& transport, Clock& clock)
+    : transport(transport), clock(clock), endpointCount(0), connectedEndpoint(-1),
+      requestCount(0), reusedCount(0), reconnectCount(0),
+      totalDnsTime(0), totalConnectTime(0), totalRequestTime(0),
+      totalEncodeTime(0), totalPayloadBytes(0), totalPayloadEvents(0), failoverCount(0), lastRejected(0) {
+    memset(&lastTiming, 0, sizeof(lastTiming));
+    
+    size_t configured = sizeof(ENDPOINT_URLS) / sizeof(ENDPOINT_URLS[0]);
+    for (size_t i = 0; i < configured && endpointCount < WEBHOOK_MAX_ENDPOINTS; i++) {
+        WebhookEndpoint& endpoint = endpoints[endpointCount];
+        endpoint.url = ENDPOINT_URLS[i];
+        endpoint.resolvedAt = 0;
+        endpoint.latencyEwma = 0;
+        endpoint.errorEwma = 0;
+        endpoint.lastSampleAt = 0;
+        endpoint.requestCount = 0;
+        endpoint.failureCount = 0;
+        if (parseEndpoint(endpoint.url, endpoint)) {
+            endpointCount++;
+        }
+    }
+}
+
+bool WebhookManager::parseEndpoint(const String& url, WebhookEndpoint& endpoint) {
+    endpoint.host = "";
+    endpoint.port = 80;
+    endpoint.path = "/";
+    endpoint.hostIsIP = false;
+    
+    int protocolEnd = url.indexOf("://");
+    if (protocolEnd <= 0) {
+        return false;
+    }
+    
+    int hostStart = protocolEnd + 3;
+    int pathStart = url.indexOf("/", hostStart);
+    int hostEnd = pathStart >= 0 ? pathStart : url.length();
+    int portStart = url.indexOf(":", hostStart);
+    
+    if (portStart > 0 && portStart < hostEnd) {
+        endpoint.port = url.substring(portStart + 1, hostEnd).toInt();
+        hostEnd = portStart;
+    }
+    endpoint.host = url.substring(hostStart, hostEnd);
+    if (pathStart >= 0) {
+        endpoint.path = url.substring(pathStart);
+    }
+    
+    IPAddress literal;
+    endpoint.hostIsIP = literal.fromString(endpoint.host.c_str());
+    return !endpoint.host.isEmpty() && endpoint.port > 0;
+}
+
+bool WebhookManager::resolveHost(WebhookEndpoint& endpoint, RequestTiming& timing) {
+    if (endpoint.resolvedAt != 0 && clock.millis() - endpoint.resolvedAt < DNS_CACHE_TTL) {
+        timing.dnsCached = true;
+        return true;
+    }
+    
+    unsigned long start = clock.millis();
+    bool success = transport.resolve(endpoint.host.c_str(), endpoint.resolvedIP);
+    timing.dnsTime = clock.millis() - start;
+    
+    if (!success) {
+        endpoint.resolvedAt = 0;
+        LOG_ERROR("Error: Could not resolve %s", endpoint.host.c_str());
+        return false;
+    }
+    
+    endpoint.resolvedAt = clock.millis();
+    if (endpoint.resolvedAt == 0) {
+        endpoint.resolvedAt = 1;  // 0 means "not resolved"
+    }
+    return true;
+}
+
+bool WebhookManager::ensureConnected(size_t index, RequestTiming& timing) {
+    if (transport.connected()) {
+        if (connectedEndpoint == (int)index) {
+            timing.connectionReused = true;
+            return true;
+        }
+        // One transport: switching endpoints closes the other keep-alive connection
+        transport.stop();
+    }
+    connectedEndpoint = -1;
+    
+    WebhookEndpoint& endpoint = endpoints[index];
+    if (!resolveHost(endpoint, timing)) {
+        return false;
+    }
+    
+    unsigned long start = clock.millis();
+    bool connected = transport.connect(endpoint.resolvedIP, endpoint.port, HTTP_TIMEOUT);
+    timing.connectTime = clock.millis() - start;
+    
+    if (!connected) {
+        endpoint.resolvedAt = 0;  // The host may have moved; look it up again next time
+        return false;
+    }
+    
+    connectedEndpoint = index;
+    reconnectCount++;
+    return true;
 }
 
-bool WebhookManager::testConnection(const String& host, int port) {
-    WiFiClient client;
-    DEBUG_SERIAL.printf("Testing connection to %s:%d...\n", host.c_str(), port);
+void WebhookManager::recordTiming(const RequestTiming& timing) {
+    lastTiming = timing;
+    requestCount++;
+    if (timing.connectionReused) {
+        reusedCount++;
+    }
+    totalDnsTime += timing.dnsTime;
+    totalConnectTime += timing.connectTime;
+    totalRequestTime += timing.requestTime;
+    totalEncodeTime += timing.encodeTime;
+    totalPayloadBytes += timing.payloadBytes;
+    metrics.observe(HISTOGRAM_WEBHOOK_RTT_MS, timing.dnsTime + timing.connectTime +
+                                              timing.requestTime + timing.responseTime);
     
-    unsigned long timeout = millis();
-    bool connected = client.connect(host.c_str(), port);
-    unsigned long connectionTime = millis() - timeout;
+    LOG_DEBUG("Timing: encode %lu us (%u bytes), dns %lu ms%s, connect %lu ms%s, request %lu ms, response %lu ms",
+              timing.encodeTime, (unsigned)timing.payloadBytes,
+              timing.dnsTime, timing.dnsCached ? " (cached)" : "",
+              timing.connectTime, timing.connectionReused ? " (reused)" : "",
+              timing.requestTime, timing.responseTime);
+}
+
+bool WebhookManager::testConnection(size_t index) {
+    const WebhookEndpoint& endpoint = endpoints[index];
+    DEBUG_SERIAL.printf("Testing connection to %s:%d...\n", endpoint.host.c_str(), endpoint.port);
     
-    if (connected) {
-        DEBUG_SERIAL.printf("Connection successful! Response time: %lu ms\n", connectionTime);
-        client.stop();
+    // Opens the persistent connection, so the first webhook call can reuse it
+    RequestTiming timing;
+    memset(&timing, 0, sizeof(timing));
+    
+    if (ensureConnected(index, timing)) {
+        DEBUG_SERIAL.printf("Connection successful! DNS: %lu ms, Connect: %lu ms%s\n",
+                            timing.dnsTime, timing.connectTime,
+                            timing.connectionReused ? " (already open)" : "");
         return true;
     } else {
         DEBUG_SERIAL.println("Connection failed!");
@@ -24,42 +155,117 @@ bool WebhookManager::testConnection(const String& host, int port) {
     }
 }
 
-bool WebhookManager::begin() {
-    DEBUG_SERIAL.println("\nInitializing Webhook Manager...");
-    DEBUG_SERIAL.printf("Webhook URL: %s\n", webhookUrl.c_str());
+bool WebhookManager::circuitAllows() {
+    if (timeUntilAvailable(clock.millis()) == 0) {
+        return true;
+    }
+    
+    // Fails without encoding, DNS or a connect timeout; the event stays journaled
+    metrics.increment(COUNTER_WEBHOOK_SHORT_CIRCUITS);
+    LOG_WARN("All webhook circuits open, request skipped (probe in %lu ms)",
+             timeUntilAvailable(clock.millis()));
+    return false;
+}
+
+unsigned long WebhookManager::timeUntilAvailable(unsigned long now) const {
+    unsigned long wait = 0;
+    for (size_t i = 0; i < endpointCount; i++) {
+        unsigned long untilProbe = endpoints[i].breaker.timeUntilProbe(now);
+        if (untilProbe == 0) {
+            return 0;
+        }
+        wait = (i == 0) ? untilProbe : min(wait, untilProbe);
+    }
+    return wait;
+}
+
+void WebhookManager::probeNow() {
+    for (size_t i = 0; i < endpointCount; i++) {
+        endpoints[i].breaker.expireCooldown();
+    }
+}
+
+uint32_t WebhookManager::healthScore(const WebhookEndpoint& endpoint, size_t index, unsigned long now) const {
+    // Lower is better: recent latency, plus a penalty for recent errors and for the list position.
+    // The error rate halves every WEBHOOK_HEALTH_DECAY without requests, so a preferred endpoint
+    // that failed earlier is tried again eventually.
+    uint32_t halvings = endpoint.lastSampleAt != 0 ? (now - endpoint.lastSampleAt) / WEBHOOK_HEALTH_DECAY : 0;
+    uint32_t errorRate = halvings < 32 ? endpoint.errorEwma >> halvings : 0;
+    return endpoint.latencyEwma + errorRate * WEBHOOK_ERROR_PENALTY / 1000 + index * WEBHOOK_PRIORITY_PENALTY;
+}
+
+size_t WebhookManager::rankEndpoints(uint8_t* order) const {
+    // Insertion sort by score; equal scores keep the configured order
+    unsigned long now = clock.millis();
+    uint32_t scores[WEBHOOK_MAX_ENDPOINTS];
+    for (size_t i = 0; i < endpointCount; i++) {
+        uint32_t score = healthScore(endpoints[i], i, now);
+        size_t position = i;
+        while (position > 0 && scores[position - 1] > score) {
+            scores[position] = scores[position - 1];
+            order[position] = order[position - 1];
+            position--;
+        }
+        scores[position] = score;
+        order[position] = i;
+    }
+    return endpointCount;
+}
+
+void WebhookManager::recordOutcome(WebhookEndpoint& endpoint, int httpResponseCode, unsigned long roundTrip) {
+    // Connection errors, 5xx, 408 and 429 mean the endpoint is unhealthy; other 4xx are payload problems
+    bool healthy = httpResponseCode > 0 && httpResponseCode < 500 && httpResponseCode != 408 && httpResponseCode != 429;
+    unsigned long now = clock.millis();
     
-    // Extract host and port from URL for connection testing
-    String host = "";
-    int port = 80;
+    // Moving averages with weight 1/4 for the new sample, starting from the decayed error rate
+    uint32_t halvings = endpoint.lastSampleAt != 0 ? (now - endpoint.lastSampleAt) / WEBHOOK_HEALTH_DECAY : 0;
+    uint32_t errorRate = halvings < 32 ? endpoint.errorEwma >> halvings : 0;
+    endpoint.errorEwma = (errorRate * 3 + (healthy ? 0 : 1000)) / 4;
+    if (healthy) {
+        endpoint.latencyEwma = endpoint.requestCount == endpoint.failureCount
+                               ? roundTrip : (endpoint.latencyEwma * 3 + roundTrip) / 4;
+    }
+    endpoint.lastSampleAt = now != 0 ? now : 1;
+    endpoint.requestCount++;
     
-    // Simple URL parsing (assumes http:// format)
-    int protocolEnd = webhookUrl.indexOf("://");
-    if (protocolEnd > 0) {
-        int hostStart = protocolEnd + 3;
-        int hostEnd = webhookUrl.indexOf(":", hostStart);
-        if (hostEnd < 0) {
-            hostEnd = webhookUrl.indexOf("/", hostStart);
+    if (healthy) {
+        if (endpoint.breaker.getState() != BREAKER_CLOSED) {
+            LOG_INFO("Webhook circuit closed, %s recovered", endpoint.host.c_str());
         }
-        
-        if (hostEnd > 0) {
-            host = webhookUrl.substring(hostStart, hostEnd);
-            
-            // Try to extract port
-            int portStart = webhookUrl.indexOf(":", hostStart);
-            if (portStart > 0 && portStart < webhookUrl.indexOf("/", hostStart)) {
-                int portEnd = webhookUrl.indexOf("/", portStart);
-                String portStr = webhookUrl.substring(portStart + 1, portEnd);
-                port = portStr.toInt();
-            }
+        endpoint.breaker.onSuccess();
+    } else {
+        endpoint.failureCount++;
+        uint32_t openCount = endpoint.breaker.getOpenCount();
+        endpoint.breaker.onFailure(now);
+        if (endpoint.breaker.getOpenCount() != openCount) {
+            metrics.increment(COUNTER_BREAKER_OPENS);
+            LOG_WARN("Webhook circuit for %s opened after %u failures, next probe in %lu ms",
+                     endpoint.host.c_str(), endpoint.breaker.getConsecutiveFailures(),
+                     endpoint.breaker.timeUntilProbe(now));
         }
     }
     
-    DEBUG_SERIAL.printf("Webhook Host: %s, Port: %d\n", host.c_str(), port);
+    int32_t openCircuits = 0;
+    for (size_t i = 0; i < endpointCount; i++) {
+        if (endpoints[i].breaker.getState() == BREAKER_OPEN) {
+            openCircuits++;
+        }
+    }
+    metrics.setGauge(GAUGE_OPEN_CIRCUITS, openCircuits);
+}
+
+bool WebhookManager::begin() {
+    DEBUG_SERIAL.println("\nInitializing Webhook Manager...");
+    if (endpointCount == 0) {
+        DEBUG_SERIAL.println("Warning: Could not parse webhook URL!");
+    }
     
-    // Test connection to the webhook server
-    if (!host.isEmpty() && port > 0) {
-        bool connectionSuccess = testConnection(host, port);
-        if (!connectionSuccess) {
+    // Test in reverse, so the preferred endpoint's connection is the one left open
+    for (size_t i = endpointCount; i-- > 0;) {
+        const WebhookEndpoint& endpoint = endpoints[i];
+        DEBUG_SERIAL.printf("Webhook URL %u: %s\n", (unsigned)i, endpoint.url.c_str());
+        DEBUG_SERIAL.printf("Webhook Host: %s, Port: %d\n", endpoint.host.c_str(), endpoint.port);
+        if (!testConnection(i)) {
             DEBUG_SERIAL.println("Warning: Could not connect to webhook server!");
             DEBUG_SERIAL.println("Webhook calls may fail. Check if n8n is running and accessible.");
         }
@@ -71,128 +277,336 @@ bool WebhookManager::begin() {
 
 void WebhookManager::printWebhookStatus() {
     DEBUG_SERIAL.println("\n--- Webhook Status ---");
-    DEBUG_SERIAL.printf("Webhook URL: %s\n", webhookUrl.c_str());
+    unsigned long now = clock.millis();
+    for (size_t i = 0; i < endpointCount; i++) {
+        const WebhookEndpoint& endpoint = endpoints[i];
+        DEBUG_SERIAL.printf("Endpoint %u: %s\n", (unsigned)i, endpoint.url.c_str());
+        DEBUG_SERIAL.printf("  Host: %s, Port: %d, Path: %s\n",
+                            endpoint.host.c_str(), endpoint.port, endpoint.path.c_str());
+        if (endpoint.resolvedAt != 0) {
+            DEBUG_SERIAL.printf("  Resolved IP: %s (cached for %lu ms)\n",
+                                endpoint.resolvedIP.toString().c_str(), (unsigned long)DNS_CACHE_TTL);
+        }
+        DEBUG_SERIAL.printf("  Health score: %u (latency %u ms, errors %u permille, %u/%u requests failed)\n",
+                            healthScore(endpoint, i, now), endpoint.latencyEwma, endpoint.errorEwma,
+                            endpoint.failureCount, endpoint.requestCount);
+        DEBUG_SERIAL.printf("  Circuit: %s (%u consecutive failures, opened %u times, %u requests skipped)\n",
+                            endpoint.breaker.getStateName(), endpoint.breaker.getConsecutiveFailures(),
+                            endpoint.breaker.getOpenCount(), endpoint.breaker.getRejectedCount());
+    }
+    DEBUG_SERIAL.printf("Failovers: %u, Dual write: %s\n", failoverCount, WEBHOOK_DUAL_WRITE ? "ON" : "OFF");
     
-    // Extract host and port from URL
-    String host = "";
-    int port = 80;
-    String path = "/";
+    // Test connection to the preferred endpoint
+    if (endpointCount > 0) {
+        testConnection(0);
+    }
     
-    // Simple URL parsing (assumes http:// format)
-    int protocolEnd = webhookUrl.indexOf("://");
-    if (protocolEnd > 0) {
-        int hostStart = protocolEnd + 3;
-        int hostEnd = webhookUrl.indexOf(":", hostStart);
-        if (hostEnd < 0) {
-            hostEnd = webhookUrl.indexOf("/", hostStart);
-        }
-        
-        if (hostEnd > 0) {
-            host = webhookUrl.substring(hostStart, hostEnd);
-            
-            // Try to extract port
-            int portStart = webhookUrl.indexOf(":", hostStart);
-            if (portStart > 0 && portStart < webhookUrl.indexOf("/", hostStart)) {
-                int portEnd = webhookUrl.indexOf("/", portStart);
-                String portStr = webhookUrl.substring(portStart + 1, portEnd);
-                port = portStr.toInt();
-                
-                // Extract path
-                path = webhookUrl.substring(portEnd);
-            } else {
-                // Extract path without port
-                int pathStart = webhookUrl.indexOf("/", hostStart);
-                if (pathStart > 0) {
-                    path = webhookUrl.substring(pathStart);
-                }
-            }
+    if (requestCount > 0) {
+        DEBUG_SERIAL.printf("Requests: %u, Reused connections: %u, Reconnects: %u\n",
+                            requestCount, reusedCount, reconnectCount);
+        DEBUG_SERIAL.printf("Avg DNS: %lu ms, Avg connect: %lu ms, Avg request: %lu ms\n",
+                            totalDnsTime / requestCount, totalConnectTime / requestCount,
+                            totalRequestTime / requestCount);
+        if (totalPayloadEvents > 0) {
+            DEBUG_SERIAL.printf("Avg payload: %u bytes/event, Avg encode: %lu us/event (%s)\n",
+                                totalPayloadBytes / totalPayloadEvents, totalEncodeTime / totalPayloadEvents,
+                                WEBHOOK_CONTENT_TYPE);
         }
     }
     
-    DEBUG_SERIAL.printf("Host: %s\n", host.c_str());
-    DEBUG_SERIAL.printf("Port: %d\n", port);
-    DEBUG_SERIAL.printf("Path: %s\n", path.c_str());
+    DEBUG_SERIAL.println("--- End Webhook Status ---\n");
+}
+
+bool WebhookManager::sendPollResult(const PollEvent& event, const String& deviceId) {
+    lastRejected = 0;
+    if (!circuitAllows()) {
+        return false;
+    }
+    
+    LOG_DEBUG("\n--- Webhook Call ---");
+    
+    // Encode into the preallocated payload buffer, timed without the debug output
+    size_t packed = 0;
+    unsigned long encodeStart = clock.micros();
+#if WEBHOOK_PAYLOAD_FORMAT == PAYLOAD_FORMAT_MSGPACK
+    size_t length = encodeMsgPack(&event, 1, deviceId, packed);
+#else
+    size_t length = encodeJson(&event, 1, deviceId, false, packed);
+#endif
+    unsigned long encodeTime = clock.micros() - encodeStart;
+    
+#if WEBHOOK_PAYLOAD_FORMAT == PAYLOAD_FORMAT_MSGPACK
+    LOG_DEBUG("MessagePack Payload: %u bytes", (unsigned)length);
+#else
+    // Debug output - print JSON payload (cut to LOG_RECORD_SIZE)
+    LOG_DEBUG("JSON Payload: %s", payloadBuffer);
+#endif
+
+    bool success = length > 0 && postPayload(payloadBuffer, length, WEBHOOK_CONTENT_TYPE, packed, encodeTime);
+    
+    LOG_DEBUG("--- End Webhook Call ---\n");
+    return success;
+}
+
+size_t WebhookManager::encodeJson(const PollEvent* events, size_t count, const String& deviceId,
+                                  bool batch, size_t& packed) {
+    // Reuse the preallocated JSON document
+    return encodeEventsJson(doc, events, count, deviceId.c_str(), batch, WEBHOOK_BATCH_MAX_BYTES,
+                            payloadBuffer, sizeof(payloadBuffer), packed);
+}
+
+size_t WebhookManager::encodeMsgPack(const PollEvent* events, size_t count, const String& deviceId,
+                                     size_t& packed) {
+    // Same byte cap as the JSON batches; the buffer has one spare byte for JSON's terminator
+    return encodeEventsMsgPack(events, count, deviceId.c_str(),
+                               reinterpret_cast<uint8_t*>(payloadBuffer), WEBHOOK_BATCH_MAX_BYTES, packed);
+}
+
+void WebhookManager::printEncodingComparison(const String& deviceId) {
+    // Encodes a worst-case sample event both ways; reuses the payload buffers,
+    // so only call this while the sender is idle (as at startup)
+    const int runs = 20;
+    PollEvent sample;
+    memset(&sample, 0, sizeof(sample));
+    static const uint8_t sampleUid[] = { 0x04, 0xA2, 0x3B, 0x52, 0x6C, 0x1D, 0x80 };
+    memcpy(sample.uid, sampleUid, sizeof(sampleUid));
+    sample.uidLength = sizeof(sampleUid);
+    sample.tagType = ISO14443_4;
+    sample.tagPresent = true;
+    sample.timeSynced = true;
+    sample.epochMs = 1735689600123ULL;
+    sample.networkIndex = 0;
+    sample.rssi = -49;
     
-    // Test connection
-    if (!host.isEmpty() && port > 0) {
-        testConnection(host, port);
+    size_t packed;
+    size_t jsonBytes = 0;
+    size_t msgpackBytes = 0;
+    
+    unsigned long start = clock.micros();
+    for (int i = 0; i < runs; i++) {
+        jsonBytes = encodeJson(&sample, 1, deviceId, false, packed);
     }
+    unsigned long jsonTime = (clock.micros() - start) / runs;
     
-    DEBUG_SERIAL.println("--- End Webhook Status ---\n");
+    start = clock.micros();
+    for (int i = 0; i < runs; i++) {
+        msgpackBytes = encodeMsgPack(&sample, 1, deviceId, packed);
+    }
+    unsigned long msgpackTime = (clock.micros() - start) / runs;
+    
+    DEBUG_SERIAL.printf("Encoding (1 event): JSON %u bytes / %lu us, MessagePack %u bytes / %lu us\n",
+                        (unsigned)jsonBytes, jsonTime, (unsigned)msgpackBytes, msgpackTime);
 }
 
-bool WebhookManager::sendPollResult(bool tagPresent, String currentTagId, String lastTagId,
-                                  String tagType, String wifiStatus, String timeStatus,
-                                  String timestamp, String deviceId) {
-    DEBUG_SERIAL.println("\n--- Webhook Call ---");
-    DEBUG_SERIAL.printf("Webhook URL: %s\n", webhookUrl.c_str());
+bool WebhookManager::sendHeartbeat(const String& deviceId) {
+    if (!circuitAllows()) {
+        return false;
+    }
+    
+    LOG_DEBUG("\n--- Webhook Heartbeat ---");
+    
+    // Separate document: the event document is sized for events only
+    StaticJsonDocument<HEARTBEAT_DOC_CAPACITY> heartbeatDoc;
+    JsonObject heartbeat = heartbeatDoc.createNestedObject("heartbeat");
+    heartbeat["device_id"] = deviceId.c_str();
+    heartbeat["uptime_ms"] = clock.millis();
+    metrics.writeJson(heartbeat);
+    
+    if (heartbeatDoc.overflowed()) {
+        LOG_ERROR("Error: Heartbeat does not fit HEARTBEAT_DOC_CAPACITY");
+        return false;
+    }
+    size_t length = serializeJson(heartbeatDoc, payloadBuffer, sizeof(payloadBuffer));
+    LOG_DEBUG("Heartbeat: %u bytes", (unsigned)length);
     
-    // Create JSON document
-    StaticJsonDocument<512> doc;
-    JsonObject rfidPollResult = doc.createNestedObject("rfid_poll_result");
+    bool success = postPayload(payloadBuffer, length, "application/json", 0, 0);
+    if (success) {
+        metrics.increment(COUNTER_HEARTBEATS);
+    }
     
-    rfidPollResult["timestamp"] = timestamp;
-    rfidPollResult["event_type"] = tagPresent ? "tag_insert" : "tag_removed";
-    rfidPollResult["tag_present"] = tagPresent;
-    rfidPollResult["tag_id"] = tagPresent ? currentTagId : lastTagId;
-    rfidPollResult["device_id"] = deviceId;
+    LOG_DEBUG("--- End Webhook Heartbeat ---\n");
+    return success;
+}
+
+bool WebhookManager::fetchAssignments(const String& deviceId, uint64_t sinceVersion, size_t limit,
+                                      String& response) {
+    if (!circuitAllows()) {
+        return false;
+    }
     
-    if (tagPresent) {
-        rfidPollResult["tag_type"] = tagType;
-        rfidPollResult["wifi_status"] = wifiStatus;
-        rfidPollResult["time_status"] = timeStatus;
+    // Same webhook; n8n answers this request instead of storing it, see sql_scripts.md
+    StaticJsonDocument<192> request;
+    request["assignments_since"] = sinceVersion;
+    request["limit"] = limit;
+    request["device_id"] = deviceId.c_str();
+    size_t length = serializeJson(request, payloadBuffer, sizeof(payloadBuffer));
+    return postPayload(payloadBuffer, length, "application/json", 0, 0, &response);
+}
+
+size_t WebhookManager::sendPollResults(const PollEvent* events, size_t count, const String& deviceId) {
+    lastRejected = 0;
+    if (count == 0 || !circuitAllows()) {
+        return 0;
     }
 
-    // Serialize JSON to string
-    String jsonString;
-    serializeJson(doc, jsonString);
+    LOG_DEBUG("\n--- Webhook Batch Call ---");
+    
+    size_t packed = 0;
+    unsigned long encodeStart = clock.micros();
+#if WEBHOOK_PAYLOAD_FORMAT == PAYLOAD_FORMAT_MSGPACK
+    size_t length = encodeMsgPack(events, count, deviceId, packed);
+#else
+    size_t length = encodeJson(events, count, deviceId, true, packed);
+#endif
+    unsigned long encodeTime = clock.micros() - encodeStart;
+    
+    LOG_INFO("Batch: %u of %u events, %u bytes",
+             (unsigned)packed, (unsigned)count, (unsigned)length);
+    
+    bool success = length > 0 && postPayload(payloadBuffer, length, WEBHOOK_CONTENT_TYPE, packed, encodeTime);
+    
+    LOG_DEBUG("--- End Webhook Batch Call ---\n");
+    return success ? packed : 0;
+}
+
+bool WebhookManager::postPayload(const char* payload, size_t length, const char* contentType,
+                                 size_t events, unsigned long encodeTime, String* response) {
+    // Healthiest endpoint first; on failure the next one is tried within the same call
+    uint8_t order[WEBHOOK_MAX_ENDPOINTS];
+    size_t candidates = rankEndpoints(order);
+    size_t wanted = WEBHOOK_DUAL_WRITE && response == nullptr ? 2 : 1;  // Queries need one answer
+    size_t delivered = 0;
+    size_t attempts = 0;
+    size_t rejections = 0;
+    
+    for (size_t i = 0; i < candidates && delivered < wanted; i++) {
+        WebhookEndpoint& endpoint = endpoints[order[i]];
+        if (!endpoint.breaker.allowRequest(clock.millis())) {
+            continue;
+        }
+        if (attempts > delivered) {
+            failoverCount++;
+            metrics.increment(COUNTER_WEBHOOK_FAILOVERS);
+            LOG_WARN("Failing over to %s", endpoint.host.c_str());
+        }
+        attempts++;
+        int httpResponseCode = postToEndpoint(order[i], payload, length, contentType, encodeTime, response);
+        if (httpResponseCode > 0 && httpResponseCode < 300) {
+            delivered++;
+        } else if (isRejection(httpResponseCode)) {
+            rejections++;
+        }
+    }
     
-    // Debug output - print JSON payload
-    DEBUG_SERIAL.println("JSON Payload:");
-    DEBUG_SERIAL.println(jsonString);
+    // Refused for good only if no endpoint took it and none failed in a way a retry could fix
+    lastRejected = delivered == 0 && attempts > 0 && rejections == attempts ? events : 0;
+    
+    if (attempts == 0) {
+        metrics.increment(COUNTER_WEBHOOK_SHORT_CIRCUITS);
+    }
+    totalPayloadEvents += events;
+    
+    // One accepted copy is enough; with dual write the second one is best effort
+    return delivered > 0;
+}
 
-    // Send HTTP POST request
-    http.begin(webhookUrl);
-    http.addHeader("Content-Type", "application/json");
+int WebhookManager::postToEndpoint(size_t index, const char* payload, size_t length, const char* contentType,
+                                   unsigned long encodeTime, String* response) {
+    WebhookEndpoint& endpoint = endpoints[index];
+    RequestTiming timing;
+    int httpResponseCode = -1;  // Connection refused
     
-    DEBUG_SERIAL.println("Sending webhook POST request...");
-    int httpResponseCode = http.POST(jsonString);
+    // A reused keep-alive connection may have been closed by the server; retry once on a fresh one
+    for (int attempt = 0; attempt < 2; attempt++) {
+        memset(&timing, 0, sizeof(timing));
+        if (!ensureConnected(index, timing)) {
+            httpResponseCode = -1;
+            break;
+        }
+        
+        // Send HTTP POST request over the persistent connection
+        LOG_DEBUG("Sending webhook POST request to %s...", endpoint.host.c_str());
+        unsigned long start = clock.millis();
+        httpResponseCode = transport.post(endpoint.host, endpoint.port, endpoint.path,
+                                          contentType,
+                                          reinterpret_cast<const uint8_t*>(payload), length);
+        timing.requestTime = clock.millis() - start;
+        
+        if (httpResponseCode > 0 || !timing.connectionReused) {
+            break;
+        }
+        LOG_DEBUG("Kept-alive connection was closed, reconnecting...");
+        transport.endRequest();
+        transport.stop();
+        connectedEndpoint = -1;
+    }
     
     // Process response
     bool success = (httpResponseCode > 0 && httpResponseCode < 300);
     
-    DEBUG_SERIAL.printf("HTTP Response Code: %d\n", httpResponseCode);
+    metrics.increment(COUNTER_WEBHOOK_REQUESTS);
+    if (!success) {
+        metrics.increment(COUNTER_WEBHOOK_FAILURES);
+    }
+    if (httpResponseCode <= 0) {
+        metrics.increment(COUNTER_HTTP_NO_RESPONSE);
+    } else if (httpResponseCode < 300) {
+        metrics.increment(COUNTER_HTTP_2XX);
+    } else if (httpResponseCode >= 400 && httpResponseCode < 500) {
+        metrics.increment(COUNTER_HTTP_4XX);
+    } else if (httpResponseCode >= 500) {
+        metrics.increment(COUNTER_HTTP_5XX);
+    }
+    
+    LOG_INFO("HTTP Response Code: %d", httpResponseCode);
     
     if (httpResponseCode > 0) {
+        // Always read the body so the connection can be reused
+        unsigned long start = clock.millis();
+        String body = transport.readResponse();
+        timing.responseTime = clock.millis() - start;
+        
         if (success) {
-            DEBUG_SERIAL.println("Webhook call successful!");
-            String response = http.getString();
-            if (response.length() > 0) {
-                DEBUG_SERIAL.println("Response:");
-                DEBUG_SERIAL.println(response);
+            LOG_INFO("Webhook call successful!");
+            if (response != nullptr) {
+                *response = body;  // Handed to the caller instead of printed
+            } else if (body.length() > 0) {
+                LOG_DEBUG("Response: %s", body.c_str());
             }
         } else {
             // Error handling based on status code
             if (httpResponseCode == 404) {
-                DEBUG_SERIAL.println("Error: Webhook URL not found (404)");
-                DEBUG_SERIAL.println("Check if the n8n webhook URL is correct and the server is running");
+                LOG_ERROR("Error: Webhook URL not found (404)");
+                LOG_ERROR("Check if the n8n webhook URL is correct and the server is running");
             } else if (httpResponseCode >= 500) {
-                DEBUG_SERIAL.println("Error: Server error on n8n side");
+                LOG_ERROR("Error: Server error on n8n side");
+            } else if (isRejection(httpResponseCode)) {
+                LOG_ERROR("Error: Payload refused with code %d, retrying will not help", httpResponseCode);
             } else {
-                DEBUG_SERIAL.printf("Error: HTTP request failed with code %d\n", httpResponseCode);
+                LOG_ERROR("Error: HTTP request failed with code %d", httpResponseCode);
             }
         }
     } else {
-        DEBUG_SERIAL.println("Error: Connection failed");
-        DEBUG_SERIAL.println("Possible causes:");
-        DEBUG_SERIAL.println("- n8n server is not running");
-        DEBUG_SERIAL.println("- IP address in webhook URL is incorrect");
-        DEBUG_SERIAL.println("- Network connectivity issues");
-        DEBUG_SERIAL.println("- Firewall blocking the connection");
+        LOG_ERROR("Error: Connection failed");
+        // Only explain the first failure of a streak; retries would repeat it
+        if (endpoint.breaker.getConsecutiveFailures() == 0) {
+            LOG_ERROR("Possible causes:");
+            LOG_ERROR("- n8n server is not running");
+            LOG_ERROR("- IP address in webhook URL is incorrect");
+            LOG_ERROR("- Network connectivity issues");
+            LOG_ERROR("- Firewall blocking the connection");
+        }
+        transport.stop();
+        connectedEndpoint = -1;
     }
     
-    DEBUG_SERIAL.println("--- End Webhook Call ---\n");
+    recordOutcome(endpoint, httpResponseCode,
+                  timing.dnsTime + timing.connectTime + timing.requestTime + timing.responseTime);
+    timing.encodeTime = encodeTime;
+    timing.payloadBytes = length;
+    recordTiming(timing);
     
-    http.end();
-    return success;
+    // Keeps the socket open when the server allows keep-alive
+    transport.endRequest();
+    return httpResponseCode;
 }
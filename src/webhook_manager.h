@@ -2,23 +2,125 @@
 #define WEBHOOK_MANAGER_H
 
 #include <Arduino.h>
-#include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include "credentials.h"
+#include "hal.h"
+#include "config.h"
+#include "poll_event.h"
+#include "msgpack_encoder.h"
+#include "event_json.h"
+#include "metrics.h"
+#include "circuit_breaker.h"
+
+// JSON document capacity: one event, or a full batch when batching is enabled
+#define WEBHOOK_DOC_CAPACITY (WEBHOOK_BATCH_MAX_EVENTS > 1 ? 2 * WEBHOOK_BATCH_MAX_BYTES : 512)
+
+// Heartbeat document: device info plus every metric (built on the sender task stack)
+#define HEARTBEAT_DOC_CAPACITY 2048
+
+#if WEBHOOK_PAYLOAD_FORMAT == PAYLOAD_FORMAT_MSGPACK
+#define WEBHOOK_CONTENT_TYPE "application/msgpack"
+#else
+#define WEBHOOK_CONTENT_TYPE "application/json"
+#endif
+
+// Endpoints in order of preference. credentials.h may define WEBHOOK_URLS as a
+// braced list of URLs; otherwise the single WEBHOOK_URL is used.
+#ifndef WEBHOOK_URLS
+#define WEBHOOK_URLS { WEBHOOK_URL }
+#endif
+
+// Webhook endpoint, parsed once from its URL (assumes http:// format), with its health
+struct WebhookEndpoint {
+    String url;
+    String host;
+    uint16_t port;
+    String path;
+    bool hostIsIP;               // No DNS lookup needed
+    IPAddress resolvedIP;
+    unsigned long resolvedAt;    // millis() of the last successful lookup, 0 if none
+    CircuitBreaker breaker;      // Skips the endpoint while it keeps failing
+
+    // Health, see WebhookManager::healthScore()
+    uint32_t latencyEwma;        // ms, round trip of successful requests
+    uint32_t errorEwma;          // Recent failure rate in permille, decays while unused
+    unsigned long lastSampleAt;
+    uint32_t requestCount;
+    uint32_t failureCount;
+};
+
+// Per-request timings in ms, used to measure connection reuse savings
+struct RequestTiming {
+    unsigned long dnsTime;       // Host lookup (0 when cached)
+    unsigned long connectTime;   // TCP handshake (0 when reused)
+    unsigned long requestTime;   // Sending the POST until the status line arrives
+    unsigned long responseTime;  // Reading the response body
+    unsigned long encodeTime;    // Building the payload, in microseconds
+    size_t payloadBytes;
+    bool dnsCached;
+    bool connectionReused;
+};
 
 class WebhookManager {
     private:
-        HTTPClient http;
-        String webhookUrl;
-        bool testConnection(const String& host, int port);
+        HttpTransport& transport;    // Keeps its connection open between posts (HTTP keep-alive)
+        Clock& clock;
+        WebhookEndpoint endpoints[WEBHOOK_MAX_ENDPOINTS];
+        size_t endpointCount;
+        int connectedEndpoint;       // Endpoint the transport's open connection belongs to, -1 if none
+
+        // Preallocated once, so serializing an event does not touch the heap
+        StaticJsonDocument<WEBHOOK_DOC_CAPACITY> doc;
+        char payloadBuffer[WEBHOOK_BATCH_MAX_BYTES + 1];
+
+        // Timing statistics
+        RequestTiming lastTiming;
+        uint32_t requestCount;
+        uint32_t reusedCount;
+        uint32_t reconnectCount;
+        unsigned long totalDnsTime;
+        unsigned long totalConnectTime;
+        unsigned long totalRequestTime;
+        unsigned long totalEncodeTime;   // us
+        uint32_t totalPayloadBytes;
+        uint32_t totalPayloadEvents;
+        uint32_t failoverCount;
+        size_t lastRejected;         // Events in the last payload every endpoint refused for good
+
+        static bool parseEndpoint(const String& url, WebhookEndpoint& endpoint);
+        bool resolveHost(WebhookEndpoint& endpoint, RequestTiming& timing);
+        bool ensureConnected(size_t index, RequestTiming& timing);
+        void recordTiming(const RequestTiming& timing);
+        bool testConnection(size_t index);
+        bool circuitAllows();
+        uint32_t healthScore(const WebhookEndpoint& endpoint, size_t index, unsigned long now) const;
+        size_t rankEndpoints(uint8_t* order) const;
+        void recordOutcome(WebhookEndpoint& endpoint, int httpResponseCode, unsigned long roundTrip);
+        int postToEndpoint(size_t index, const char* payload, size_t length, const char* contentType,
+                           unsigned long encodeTime, String* response);  // Returns the HTTP code, <= 0 if none
+        size_t encodeJson(const PollEvent* events, size_t count, const String& deviceId, bool batch, size_t& packed);
+        size_t encodeMsgPack(const PollEvent* events, size_t count, const String& deviceId, size_t& packed);
+        bool postPayload(const char* payload, size_t length, const char* contentType,
+                         size_t events, unsigned long encodeTime, String* response = nullptr);
 
     public:
-        WebhookManager();
+        WebhookManager(HttpTransport& transport, Clock& clock);
         bool begin();
-        bool sendPollResult(bool tagPresent, String currentTagId, String lastTagId, 
-                          String tagType, String wifiStatus, String timeStatus,
-                          String timestamp, String deviceId);
+        bool sendPollResult(const PollEvent& event, const String& deviceId);
+        size_t sendPollResults(const PollEvent* events, size_t count, const String& deviceId);  // Returns events delivered
+        // Events of the last send refused with a 4xx other than 408/429; retrying them cannot succeed
+        size_t getLastRejected() const { return lastRejected; }
+        bool sendHeartbeat(const String& deviceId);  // Metrics snapshot, always JSON
+        // Tag assignments changed after sinceVersion (TagCache sync); response gets the JSON answer
+        bool fetchAssignments(const String& deviceId, uint64_t sinceVersion, size_t limit, String& response);
         void printWebhookStatus();
+        void printEncodingComparison(const String& deviceId);  // Call only while the sender task is idle
+        size_t getEndpointCount() const { return endpointCount; }
+        const WebhookEndpoint& getEndpoint(size_t index) const { return endpoints[index]; }
+        const RequestTiming& getLastTiming() const { return lastTiming; }
+        uint32_t getFailoverCount() const { return failoverCount; }
+        unsigned long timeUntilAvailable(unsigned long now) const;  // 0 unless every circuit is open
+        void probeNow();  // Let the next send test every open circuit
 };
 
 #endif // WEBHOOK_MANAGER_H
@@ -1,214 +1,463 @@
 #include "wifi_manager.h"
-#include <Adafruit_NeoPixel.h>
+#include <Preferences.h>
+#include "boot_timing.h"
+#include "metrics.h"
+#include "logger.h"
+#include "status_led.h"
+#include <esp_sntp.h>
 
-// External reference to NeoPixel object from main.cpp
-extern Adafruit_NeoPixel pixels;
+static const uint8_t WIFI_CACHE_VERSION = 2;
 
-WiFiManager::WiFiManager() : _isConnected(false), _timeIsSynced(false), _lastSyncTime(0), _currentSSID("") {
+// System time before this is the power-up default, not a real date
+static const time_t WIFI_VALID_TIME = 1704067200;  // 2024-01-01
+
+WiFiManager* WiFiManager::_syncInstance = nullptr;
+
+WiFiManager::WiFiManager(NetworkInterface& network, Clock& clock)
+    : _network(network), _clock(clock), _state(WIFI_STATE_IDLE), _stateSince(0), _isConnected(false),
+    _timeIsSynced(false), _timeSyncPending(false), _timeSyncSlowReported(false),
+    _sntpStarted(false), _syncStartedAt(0), _lastSyncTime(0), _currentSSID(""), _networkIndex(-1),
+    _candidateIndex(-1), _candidates(0), _scannedThisRound(false), _attemptTimeout(WIFI_TIMEOUT), _cacheValid(false), _directAttempt(false),
+    _directFailed(false), _staticIpActive(false), _linkRestoredCallback(nullptr),
+    _gotIpEvent(false), _disconnectedEvent(false),
+    _syncEvent(false), _syncEventEpochMs(0), _syncEventMillis(0),
+    _linkLostAt(0), _lastReconnectTime(0), _maxReconnectTime(0), _reconnectCount(0),
+    _prevSyncEpochMs(0), _prevSyncMillis(0), _lastClockError(0), _driftPpm(0), _syncCount(0) {
 }
 
-void WiFiManager::updateLEDStatus(uint32_t color) {
-    pixels.setPixelColor(0, color);
-    pixels.show();
+void WiFiManager::handleNetworkEvent(NetworkEvent event, void* context) {
+    // Runs on the network event task: only flag the event, update() acts on it
+    WiFiManager* manager = static_cast<WiFiManager*>(context);
+    if (event == NETWORK_EVENT_GOT_IP) {
+        manager->_gotIpEvent = true;
+    } else {
+        manager->_disconnectedEvent = true;
+    }
+}
+
+void WiFiManager::setState(WiFiState state) {
+    _state = state;
+    _stateSince = _clock.millis();
 }
 
 bool WiFiManager::begin() {
     DEBUG_SERIAL.println("\nInitializing WiFi...");
-    WiFi.mode(WIFI_STA);
-    
-    if (!connect()) {
+    if (WIFI_NETWORKS_COUNT == 0) {
+        DEBUG_SERIAL.println("No WiFi networks configured!");
         return false;
     }
     
-    // Once connected, sync time
-    DEBUG_SERIAL.println("Syncing time with NTP server...");
-    if (syncTime()) {
-        DEBUG_SERIAL.printf("Time synced: %s\n", getFormattedTime().c_str());
-        return true;
+    _network.setStationMode();
+    _network.setEventHandler(handleNetworkEvent, this);
+    
+    // Try the last good access point first; scan only if that fails
+    loadCache();
+    if (_cacheValid) {
+        _candidates = 1UL << _cache.networkIndex;
+        _scannedThisRound = false;
+        tryNextCandidate();
     } else {
-        DEBUG_SERIAL.println("Failed to sync time!");
-        return false;
+        startScan();
     }
+    return true;
 }
 
-bool WiFiManager::connectToNetwork(const char* ssid, const char* password) {
-    DEBUG_SERIAL.printf("Attempting to connect to %s\n", ssid);
-    
-    WiFi.begin(ssid, password);
-    unsigned long startAttemptTime = millis();
-    
-    // Connection attempt loop with LED feedback
-    while (WiFi.status() != WL_CONNECTED && 
-           millis() - startAttemptTime < WIFI_TIMEOUT) {
-        updateLEDStatus(COLOR_WIFI_CONNECTING);
-        delay(LED_FAST_BLINK_INTERVAL);
-        updateLEDStatus(0);
-        delay(LED_FAST_BLINK_INTERVAL);
-        DEBUG_SERIAL.print(".");
+void WiFiManager::loadCache() {
+    Preferences prefs;
+    _cacheValid = false;
+    if (!prefs.begin("wifi", true)) {
+        return;
     }
-    DEBUG_SERIAL.println();
     
-    if (WiFi.status() == WL_CONNECTED) {
-        _isConnected = true;
-        _currentSSID = ssid;
-        updateLEDStatus(COLOR_WIFI_CONNECTED);
-        DEBUG_SERIAL.printf("Connected to %s\n", ssid);
-        DEBUG_SERIAL.printf("IP address: %s\n", WiFi.localIP().toString().c_str());
-        return true;
+    if (prefs.getBytesLength("link") == sizeof(_cache) &&
+        prefs.getBytes("link", &_cache, sizeof(_cache)) == sizeof(_cache)) {
+        _cache.ssid[sizeof(_cache.ssid) - 1] = '\0';
+        _cacheValid = _cache.version == WIFI_CACHE_VERSION &&
+                      _cache.networkIndex < WIFI_NETWORKS_COUNT &&
+                      strcmp(_cache.ssid, WIFI_NETWORKS[_cache.networkIndex].ssid) == 0 &&
+                      _cache.link.channel >= 1 && _cache.link.channel <= 14;
     }
+    prefs.end();
     
-    DEBUG_SERIAL.printf("Failed to connect to %s\n", ssid);
-    return false;
+    if (_cacheValid) {
+        DEBUG_SERIAL.printf("Cached network: %s (channel %u)\n", _cache.ssid, _cache.link.channel);
+    }
 }
 
-bool WiFiManager::connect() {
-    if (_isConnected) {
-        return true;
+void WiFiManager::saveCache() {
+    WiFiLinkCache current;
+    memset(&current, 0, sizeof(current));
+    if (!_network.getLinkInfo(current.link)) {
+        return;
     }
+    current.version = WIFI_CACHE_VERSION;
+    current.networkIndex = _networkIndex;
+    strlcpy(current.ssid, WIFI_NETWORKS[_networkIndex].ssid, sizeof(current.ssid));
+    current.leaseObtainedAt = currentLeaseObtainedAt();
     
-    DEBUG_SERIAL.println("Scanning available networks...");
-    int numNetworks = WiFi.scanNetworks();
+    // Only write when something changed, to spare the flash
+    if (_cacheValid && memcmp(&current, &_cache, sizeof(current)) == 0) {
+        return;
+    }
     
-    if (numNetworks == 0) {
-        DEBUG_SERIAL.println("No networks found!");
-        updateLEDStatus(COLOR_ERROR);
+    Preferences prefs;
+    if (!prefs.begin("wifi", false)) {
+        return;
+    }
+    if (prefs.putBytes("link", &current, sizeof(current)) == sizeof(current)) {
+        _cache = current;
+        _cacheValid = true;
+    }
+    prefs.end();
+}
+
+uint32_t WiFiManager::currentLeaseObtainedAt() const {
+    if (_staticIpActive) {
+        return _cache.leaseObtainedAt;  // Reused address, DHCP did not renew it
+    }
+    time_t now = time(nullptr);
+    if (now < WIFI_VALID_TIME) {
+        return 0;  // Stamped by updateTimeSync() once the time is known
+    }
+    return now - (_clock.millis() - _stateSince) / 1000;  // DHCP finished when the link came up
+}
+
+bool WiFiManager::cachedLeaseUsable() const {
+    // The DHCP server may hand the address to another host once the lease runs out. Without a
+    // system clock that kept running since the lease was stamped (a power cycle resets it), the
+    // lease age is unknown and DHCP is used.
+    time_t now = time(nullptr);
+    if (_cache.leaseObtainedAt == 0 || now < WIFI_VALID_TIME || now < (time_t)_cache.leaseObtainedAt) {
         return false;
     }
+    return (uint64_t)(now - _cache.leaseObtainedAt) * 1000 < WIFI_STATIC_IP_MAX_AGE;
+}
+
+void WiFiManager::useCachedLease(bool enable) {
+    if (enable) {
+        _network.setStaticIP(_cache.link);
+    } else if (_staticIpActive) {
+        _network.useDhcp();
+    }
+    _staticIpActive = enable;
+}
+
+void WiFiManager::update() {
+    switch (_state) {
+        case WIFI_STATE_IDLE:
+            break;
+            
+        case WIFI_STATE_SCANNING: {
+            int numNetworks = _network.scanResult();
+            if (numNetworks == -1 && _clock.millis() - _stateSince < WIFI_SCAN_TIMEOUT) {
+                break;  // Still scanning
+            }
+            handleScanResult(numNetworks);
+            break;
+        }
+            
+        case WIFI_STATE_CONNECTING:
+            if (_gotIpEvent || _network.isLinkUp()) {
+                onConnected();
+            } else if (_clock.millis() - _stateSince >= _attemptTimeout) {
+                LOG_WARN("Failed to connect to %s", WIFI_NETWORKS[_candidateIndex].ssid);
+                _network.disconnect();
+                if (_directAttempt) {
+                    // The access point or lease may have changed; fall back to scan and DHCP
+                    _directFailed = true;
+                    useCachedLease(false);
+                }
+                tryNextCandidate();
+            }
+            break;
+            
+        case WIFI_STATE_CONNECTED:
+            if (_disconnectedEvent || !_network.isLinkUp()) {
+                onDisconnected();
+            }
+            break;
+            
+        case WIFI_STATE_WAIT_RETRY:
+            if (_clock.millis() - _stateSince >= WIFI_RETRY_INTERVAL) {
+                startScan();
+            }
+            break;
+    }
     
-    // Try to connect to each configured network in order
-    for (int i = 0; i < WIFI_NETWORKS_COUNT; i++) {
-        const char* targetSSID = WIFI_NETWORKS[i].ssid;
-        const char* targetPass = WIFI_NETWORKS[i].password;
-        
-        // Check if this network is visible in scan results
-        bool networkFound = false;
-        for (int j = 0; j < numNetworks; j++) {
-            if (WiFi.SSID(j) == targetSSID) {
-                networkFound = true;
-                DEBUG_SERIAL.printf("Found configured network: %s\n", targetSSID);
-                break;
+    updateTimeSync();
+}
+
+void WiFiManager::startScan() {
+    LOG_INFO("Scanning available networks...");
+    _scannedThisRound = true;
+    if (!_network.startScan()) {
+        handleScanResult(-2);
+        return;
+    }
+    setState(WIFI_STATE_SCANNING);
+}
+
+void WiFiManager::handleScanResult(int numNetworks) {
+    _candidates = 0;
+    
+    if (numNetworks <= 0) {
+        LOG_WARN("%s", numNetworks == 0 ? "No networks found!" : "Network scan failed!");
+    } else {
+        // Try configured networks in order, but only those visible in the scan
+        for (int i = 0; i < WIFI_NETWORKS_COUNT && i < 32; i++) {
+            for (int j = 0; j < numNetworks; j++) {
+                if (_network.scannedSSID(j) == WIFI_NETWORKS[i].ssid) {
+                    LOG_INFO("Found configured network: %s", WIFI_NETWORKS[i].ssid);
+                    _candidates |= 1UL << i;
+                    break;
+                }
             }
         }
-        
-        if (networkFound && connectToNetwork(targetSSID, targetPass)) {
-            return true;
+    }
+    _network.clearScan();
+    
+    tryNextCandidate();
+}
+
+void WiFiManager::tryNextCandidate() {
+    int next = -1;
+    for (int i = 0; i < WIFI_NETWORKS_COUNT && i < 32; i++) {
+        if (_candidates & (1UL << i)) {
+            next = i;
+            break;
+        }
+    }
+    
+    if (next < 0) {
+        if (!_scannedThisRound) {
+            // The direct reconnect failed, look for any configured network
+            startScan();
+            return;
         }
+        LOG_WARN("No network available, retrying in %lu s", (unsigned long)WIFI_RETRY_INTERVAL / 1000);
+        statusLed.setError(LED_ERROR_NO_NETWORK);
+        setState(WIFI_STATE_WAIT_RETRY);
+        return;
     }
     
-    // If we get here, all connection attempts failed
-    updateLEDStatus(COLOR_ERROR);
-    return false;
+    _candidates &= ~(1UL << next);
+    _candidateIndex = next;
+    _gotIpEvent = false;
+    _disconnectedEvent = false;
+    
+    _directAttempt = _cacheValid && !_directFailed && next == _cache.networkIndex;
+    if (_directAttempt) {
+        // Known access point: no channel scan, and no DHCP handshake while the cached lease is fresh
+        bool staticIp = WIFI_FAST_CONNECT_STATIC_IP && cachedLeaseUsable();
+        LOG_INFO("Attempting fast connect to %s (channel %u, %s)",
+                 WIFI_NETWORKS[next].ssid, _cache.link.channel, staticIp ? "cached IP" : "DHCP");
+        useCachedLease(staticIp);
+        _network.beginDirect(WIFI_NETWORKS[next].ssid, WIFI_NETWORKS[next].password,
+                             _cache.link.channel, _cache.link.bssid);
+        _attemptTimeout = WIFI_FAST_CONNECT_TIMEOUT;
+    } else {
+        LOG_INFO("Attempting to connect to %s", WIFI_NETWORKS[next].ssid);
+        useCachedLease(false);
+        _network.begin(WIFI_NETWORKS[next].ssid, WIFI_NETWORKS[next].password);
+        _attemptTimeout = WIFI_TIMEOUT;
+    }
+    setState(WIFI_STATE_CONNECTING);
+}
+
+void WiFiManager::onConnected() {
+    _isConnected = true;
+    _networkIndex = _candidateIndex;
+    _currentSSID = WIFI_NETWORKS[_candidateIndex].ssid;
+    _disconnectedEvent = false;
+    setState(WIFI_STATE_CONNECTED);
+    
+    statusLed.clearError(LED_ERROR_NO_NETWORK);
+    LOG_INFO("Connected to %s", _currentSSID.c_str());
+    LOG_INFO("IP address: %s", _network.localIP().toString().c_str());
+    markBootPhase(BOOT_PHASE_WIFI_CONNECTED);
+    
+    _directFailed = false;
+    saveCache();
+    
+    if (_linkLostAt != 0) {
+        _lastReconnectTime = _clock.millis() - _linkLostAt;
+        if (_lastReconnectTime > _maxReconnectTime) {
+            _maxReconnectTime = _lastReconnectTime;
+        }
+        _reconnectCount++;
+        _linkLostAt = 0;
+        metrics.increment(COUNTER_WIFI_RECONNECTS);
+        metrics.observe(HISTOGRAM_WIFI_RECONNECT_MS, _lastReconnectTime);
+        LOG_INFO("WiFi connection restored after %lu ms (max %lu ms)",
+                 _lastReconnectTime, _maxReconnectTime);
+        if (_linkRestoredCallback) {
+            _linkRestoredCallback();
+        }
+    }
+    
+    if (!_sntpStarted) {
+        syncTime();
+    }
+}
+
+void WiFiManager::onDisconnected() {
+    _isConnected = false;
+    _currentSSID = "";
+    _linkLostAt = _clock.millis();
+    if (_linkLostAt == 0) {
+        _linkLostAt = 1;  // 0 means "connected"
+    }
+    LOG_WARN("WiFi connection lost!");
+    metrics.increment(COUNTER_WIFI_DISCONNECTS);
+    
+    // Try the network we just lost first, without a scan
+    _candidates = 1UL << _networkIndex;
+    _networkIndex = -1;
+    _scannedThisRound = false;
+    tryNextCandidate();
 }
 
 void WiFiManager::disconnect() {
     if (_isConnected) {
-        WiFi.disconnect();
+        _network.disconnect();
         _isConnected = false;
         _currentSSID = "";
-        updateLEDStatus(COLOR_ERROR);
-        DEBUG_SERIAL.println("WiFi disconnected");
+        _networkIndex = -1;
+        setState(WIFI_STATE_IDLE);
+        LOG_INFO("WiFi disconnected");
     }
 }
 
 String WiFiManager::getIPAddress() const {
     if (_isConnected) {
-        return WiFi.localIP().toString();
+        return _network.localIP().toString();
     }
     return "Not Connected";
 }
 
 int WiFiManager::getRSSI() const {
     if (_isConnected) {
-        return WiFi.RSSI();
+        return _network.rssi();
     }
     return 0;
 }
 
-bool WiFiManager::checkConnection() {
-    bool currentStatus = WiFi.status() == WL_CONNECTED;
-    
-    if (_isConnected != currentStatus) {
-        _isConnected = currentStatus;
-        if (!_isConnected) {
-            _currentSSID = "";
-            updateLEDStatus(COLOR_ERROR);
-            DEBUG_SERIAL.println("WiFi connection lost!");
-        }
-    }
-    
-    return _isConnected;
+const char* WiFiManager::getStateName() const {
+    static const char* stateNames[] = { "Idle", "Scanning", "Connecting", "Connected", "Waiting to retry" };
+    return stateNames[_state];
 }
 
-bool WiFiManager::reconnectIfNeeded() {
-    if (!checkConnection()) {
-        DEBUG_SERIAL.println("Attempting to reconnect...");
-        return connect();
+void WiFiManager::printWiFiStatus() {
+    DEBUG_SERIAL.println("\n--- WiFi Status ---");
+    DEBUG_SERIAL.printf("State: %s\n", getStateName());
+    if (_isConnected) {
+        DEBUG_SERIAL.printf("SSID: %s (%d dBm)\n", _currentSSID.c_str(), getRSSI());
+        DEBUG_SERIAL.printf("IP address: %s\n", getIPAddress().c_str());
     }
-    return true;
+    DEBUG_SERIAL.printf("Time synced: %s (%u syncs, TZ %s)\n", _timeIsSynced ? "yes" : "no", _syncCount, TIME_ZONE);
+    if (_syncCount > 1) {
+        DEBUG_SERIAL.printf("Clock drift: %ld ppm, last correction %ld ms, error bound %lu ms\n",
+                            (long)_driftPpm, (long)_lastClockError, getTimestampErrorBound());
+    }
+    DEBUG_SERIAL.printf("Reconnects: %u, Last: %lu ms, Max: %lu ms\n",
+                        _reconnectCount, _lastReconnectTime, _maxReconnectTime);
+    DEBUG_SERIAL.println("--- End WiFi Status ---\n");
 }
 
-bool WiFiManager::isDST(struct tm timeinfo) {
-    // Implement your logic to determine if DST is in effect
-    // For example, in Brussels, DST starts on the last Sunday of March and ends on the last Sunday of October
-    if (timeinfo.tm_mon > 2 && timeinfo.tm_mon < 9) {
-        return true;
-    }
-    if (timeinfo.tm_mon == 2 && (timeinfo.tm_mday - timeinfo.tm_wday) >= 25) {
-        return true;
-    }
-    if (timeinfo.tm_mon == 9 && (timeinfo.tm_mday - timeinfo.tm_wday) < 25) {
-        return true;
+void WiFiManager::onSntpSync(struct timeval* tv) {
+    // Runs on the SNTP task: record the sync, updateTimeSync() evaluates it
+    WiFiManager* manager = _syncInstance;
+    if (manager == nullptr || tv == nullptr) {
+        return;
     }
-    return false;
+    uint64_t epochMs = (uint64_t)tv->tv_sec * 1000 + tv->tv_usec / 1000;
+    unsigned long syncMillis = manager->_clock.millis();
+    portENTER_CRITICAL(&manager->_syncLock);
+    manager->_syncEventEpochMs = epochMs;
+    manager->_syncEventMillis = syncMillis;
+    manager->_syncEvent = true;
+    portEXIT_CRITICAL(&manager->_syncLock);
 }
 
 bool WiFiManager::syncTime() {
     if (!_isConnected) {
-        DEBUG_SERIAL.println("Cannot sync time: WiFi not connected");
+        LOG_WARN("Cannot sync time: WiFi not connected");
         return false;
     }
     
-    configTime(GMT_OFFSET_SEC, 0, NTP_SERVER);
+    LOG_INFO("Syncing time with NTP server...");
+    _timeSyncPending = true;
+    _timeSyncSlowReported = false;
+    _syncStartedAt = _clock.millis();
     
-    // Wait for sync with timeout
-    int retry = 0;
-    const int maxRetries = 10;  // 5 seconds total (500ms * 10)
-    time_t now;
+    if (_sntpStarted) {
+        sntp_restart();
+        return true;
+    }
     
-    while (time(&now) < 1000000000 && retry < maxRetries) {
-        delay(500);
-        retry++;
-        DEBUG_SERIAL.print(".");
+    // SNTP runs in the background and resyncs every NTP_SYNC_INTERVAL on its own.
+    // The TZ rules handle daylight saving for local time rendering.
+    _syncInstance = this;
+    sntp_set_time_sync_notification_cb(onSntpSync);
+    sntp_set_sync_interval(NTP_SYNC_INTERVAL);
+    configTzTime(TIME_ZONE, NTP_SERVER);
+    _sntpStarted = true;
+    return true;
+}
+
+void WiFiManager::updateTimeSync() {
+    portENTER_CRITICAL(&_syncLock);
+    bool syncEvent = _syncEvent;
+    uint64_t syncEpochMs = _syncEventEpochMs;
+    unsigned long syncMillis = _syncEventMillis;
+    _syncEvent = false;
+    portEXIT_CRITICAL(&_syncLock);
+    
+    if (!syncEvent) {
+        if (_timeSyncPending && !_timeSyncSlowReported &&
+            _clock.millis() - _syncStartedAt >= NTP_SYNC_TIMEOUT) {
+            LOG_WARN("Time sync is taking long, still waiting in the background");
+            _timeSyncSlowReported = true;
+        }
+        return;
     }
-    DEBUG_SERIAL.println();
     
-    if (time(&now) > 1000000000) {
-        // Check if DST is in effect and adjust the offset
-        struct tm timeinfo;
-        gmtime_r(&now, &timeinfo);
-        
-        if (isDST(timeinfo)) {
-            configTime(GMT_OFFSET_SEC, DAYLIGHT_OFFSET_SEC, NTP_SERVER);
-            DEBUG_SERIAL.println("Daylight Saving Time is in effect.");
-        } else {
-            configTime(GMT_OFFSET_SEC, 0, NTP_SERVER);
-            DEBUG_SERIAL.println("Standard Time is in effect.");
+    if (_timeIsSynced) {
+        // Where the clock would be now without this correction, extrapolated from the last sync
+        unsigned long elapsed = syncMillis - _prevSyncMillis;
+        uint64_t expectedEpochMs = _prevSyncEpochMs + elapsed;
+        _lastClockError = (int32_t)(int64_t)(syncEpochMs - expectedEpochMs);
+        if (elapsed > 0) {
+            _driftPpm = (int32_t)((int64_t)_lastClockError * 1000000 / (int64_t)elapsed);
         }
-        
+        metrics.setGauge(GAUGE_CLOCK_DRIFT_PPM, _driftPpm);
+        LOG_INFO("Time resynced: clock was off by %ld ms after %lu s (%ld ppm)",
+                 (long)_lastClockError, elapsed / 1000, (long)_driftPpm);
+    }
+    
+    _prevSyncEpochMs = syncEpochMs;
+    _prevSyncMillis = syncMillis;
+    _syncCount++;
+    _timeSyncPending = false;
+    _lastSyncTime = (time_t)(syncEpochMs / 1000);
+    statusLed.flash(COLOR_TIME_SYNC, LED_SYNC_FLASH_DURATION);
+    
+    if (!_timeIsSynced) {
         _timeIsSynced = true;
-        _lastSyncTime = now;
+        LOG_INFO("Time synced: %s", getFormattedTime().c_str());
+        markBootPhase(BOOT_PHASE_TIME_SYNCED);
         
-        // Brief purple flash to indicate successful time sync
-        updateLEDStatus(0xFF00FF);  // Purple
-        delay(200);
-        updateLEDStatus(_isConnected ? COLOR_WIFI_CONNECTED : COLOR_WIFI_CONNECTING);
-        
-        return true;
+        // A lease obtained before the first sync could not be dated yet
+        if (_state == WIFI_STATE_CONNECTED && _cacheValid && _cache.leaseObtainedAt == 0) {
+            saveCache();
+        }
     }
+}
 
-    DEBUG_SERIAL.println("Time sync failed!");
-    _timeIsSynced = false;
-    return false;
+unsigned long WiFiManager::getTimestampErrorBound() const {
+    // Worst case drift accumulated just before the next scheduled resync
+    int32_t ppm = _driftPpm < 0 ? -_driftPpm : _driftPpm;
+    return (unsigned long)((uint64_t)ppm * NTP_SYNC_INTERVAL / 1000000);
 }
 
 time_t WiFiManager::getCurrentTime() const {
@@ -217,6 +466,16 @@ time_t WiFiManager::getCurrentTime() const {
     return now;
 }
 
+uint64_t WiFiManager::getEpochMillis() const {
+    if (!_timeIsSynced) {
+        return 0;
+    }
+    
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
 String WiFiManager::getFormattedTime() const {
     if (!_timeIsSynced) {
         return "Time not synced";
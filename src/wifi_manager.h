@@ -2,53 +2,136 @@
 #define WIFI_MANAGER_H
 
 #include <Arduino.h>
-#include <WiFi.h>
 #include <time.h>
+#include <freertos/FreeRTOS.h>
 #include "config.h"
 #include "credentials.h"
+#include "hal.h"
+
+// Connection states, advanced by update() from loop()
+enum WiFiState {
+    WIFI_STATE_IDLE,        // Not started
+    WIFI_STATE_SCANNING,    // Asynchronous scan running
+    WIFI_STATE_CONNECTING,  // Association/DHCP running for one candidate network
+    WIFI_STATE_CONNECTED,
+    WIFI_STATE_WAIT_RETRY   // Every candidate failed, waiting WIFI_RETRY_INTERVAL before scanning again
+};
+
+// Last good link, stored in NVS so the next boot can skip the scan and DHCP
+struct WiFiLinkCache {
+    uint8_t version;
+    uint8_t networkIndex;           // Into WIFI_NETWORKS
+    char ssid[33];                  // Detects credentials.h changes
+    NetworkLinkInfo link;
+    uint32_t leaseObtainedAt;       // UTC seconds when DHCP handed out link.ip, 0 if unknown
+};
 
 class WiFiManager {
 private:
+    NetworkInterface& _network;
+    Clock& _clock;
+    WiFiState _state;
+    unsigned long _stateSince;
     bool _isConnected;
     bool _timeIsSynced;
+    bool _timeSyncPending;
+    bool _timeSyncSlowReported;
+    bool _sntpStarted;
+    unsigned long _syncStartedAt;
     time_t _lastSyncTime;
     String _currentSSID;
-    
+    int _networkIndex;              // Connected network, -1 if none
+    int _candidateIndex;            // Network being tried
+    uint32_t _candidates;           // Bit per WIFI_NETWORKS entry still to try in this round
+    bool _scannedThisRound;
+    unsigned long _attemptTimeout;  // WIFI_TIMEOUT, or WIFI_FAST_CONNECT_TIMEOUT for a direct connect
+    WiFiLinkCache _cache;
+    bool _cacheValid;
+    bool _directAttempt;            // Current attempt uses the cached BSSID/channel
+    bool _directFailed;             // Cached AP did not answer, scan and use DHCP until the next success
+    bool _staticIpActive;           // The cached lease is configured as a static IP
+    void (*_linkRestoredCallback)();
+
+    // Set from the network event task, consumed by update()
+    volatile bool _gotIpEvent;
+    volatile bool _disconnectedEvent;
+
+    // Set from the SNTP task on every sync, consumed by updateTimeSync(); the
+    // 64-bit epoch is not written atomically on this core, so all three go under _syncLock
+    static WiFiManager* _syncInstance;
+    portMUX_TYPE _syncLock = portMUX_INITIALIZER_UNLOCKED;
+    bool _syncEvent;
+    uint64_t _syncEventEpochMs;
+    unsigned long _syncEventMillis;
+
+    // Metrics
+    unsigned long _linkLostAt;      // 0 while connected
+    unsigned long _lastReconnectTime;
+    unsigned long _maxReconnectTime;
+    uint32_t _reconnectCount;
+
+    // Clock drift, measured between consecutive NTP syncs
+    uint64_t _prevSyncEpochMs;
+    unsigned long _prevSyncMillis;
+    int32_t _lastClockError;        // ms the clock was behind (+) or ahead (-) at the last resync
+    int32_t _driftPpm;
+    uint32_t _syncCount;
+
     // Constants
-    static const int NTP_SYNC_INTERVAL = 3600;  // Resync every hour
-    static const int NTP_SYNC_TIMEOUT = 5000;   // 5 seconds timeout for sync
-    
+    static const int NTP_SYNC_TIMEOUT = 5000;   // Report a slow sync after 5 seconds
+
     // Helper functions
-    void updateLEDStatus(uint32_t color);
-    bool connectToNetwork(const char* ssid, const char* password);
+    static void handleNetworkEvent(NetworkEvent event, void* context);
+    static void onSntpSync(struct timeval* tv);
+    void setState(WiFiState state);
+    void startScan();
+    void handleScanResult(int numNetworks);
+    void tryNextCandidate();
+    void onConnected();
+    void onDisconnected();
+    void updateTimeSync();
+    void loadCache();
+    void saveCache();
+    bool cachedLeaseUsable() const;
+    uint32_t currentLeaseObtainedAt() const;
+    void useCachedLease(bool enable);
 
 public:
-    WiFiManager();
-    
+    WiFiManager(NetworkInterface& network, Clock& clock);
+
     // Core WiFi functions
-    bool begin();  // Initialize WiFi and attempt connection
-    bool connect();  // Try to connect to any available network
+    bool begin();  // Starts connecting in the background, returns immediately
+    void update();  // Advances the connection state machine, never blocks
     void disconnect();
     bool isConnected() const { return _isConnected; }
-    
+
     // Status and info
+    WiFiState getState() const { return _state; }
+    const char* getStateName() const;
     String getCurrentSSID() const { return _currentSSID; }
+    int getNetworkIndex() const { return _networkIndex; }  // Index into WIFI_NETWORKS, -1 if not connected
     String getIPAddress() const;
     int getRSSI() const;
-    
+    uint32_t getReconnectCount() const { return _reconnectCount; }
+    unsigned long getLastReconnectTime() const { return _lastReconnectTime; }  // ms from link loss to link up
+    unsigned long getMaxReconnectTime() const { return _maxReconnectTime; }
+    void printWiFiStatus();
+
     // Connection management
-    bool checkConnection();  // Verify current connection status
-    bool reconnectIfNeeded();  // Attempt reconnection if disconnected
-    
+    void onLinkRestored(void (*callback)()) { _linkRestoredCallback = callback; }
+
     // Time synchronization
-    bool syncTime();  // Force NTP sync
+    bool syncTime();  // Start background SNTP (or force a resync), completes in update()
     bool isTimeSynced() const { return _timeIsSynced; }
     time_t getLastSyncTime() const { return _lastSyncTime; }
-    bool isDST(struct tm timeinfo); // Check for Daylight Saving Time
-    
+    int32_t getDriftPpm() const { return _driftPpm; }  // Local clock vs NTP, 0 until the first resync
+    int32_t getLastClockError() const { return _lastClockError; }
+    unsigned long getTimestampErrorBound() const;  // ms of drift possible before the next resync
+
     // Time getters
     String getFormattedTime() const;  // Returns current time as string
     time_t getCurrentTime() const;    // Returns current time as unix timestamp
+    uint64_t getEpochMillis() const;  // UTC epoch milliseconds, 0 if not synced
 };
 
 #endif // WIFI_MANAGER_H
@@ -0,0 +1,117 @@
+-- Tag Assignment Sync for Time Tracker Project
+-- Lets devices keep a local copy of tag_assignments (TAG_CACHE_ENABLED in config.h)
+-- Every insert, update and delete gets a new version number; devices only fetch
+-- the tags changed since the highest version they have seen
+-- Run after tag_assignments.sql; safe on a table that already has rows
+
+-- Version counter shared by assignments and deletions
+CREATE SEQUENCE IF NOT EXISTS tag_assignments_version_seq;
+
+ALTER TABLE tag_assignments
+    ADD COLUMN IF NOT EXISTS version BIGINT NOT NULL DEFAULT nextval('tag_assignments_version_seq');
+
+CREATE INDEX IF NOT EXISTS idx_tag_assignments_version ON tag_assignments(version);
+
+-- Deleted assignments, so devices can drop them without a full reload
+CREATE TABLE IF NOT EXISTS tag_assignment_deletions (
+    tag_id TEXT NOT NULL,
+    version BIGINT NOT NULL DEFAULT nextval('tag_assignments_version_seq'),
+    deleted_at TIMESTAMPTZ DEFAULT NOW()
+);
+
+CREATE INDEX IF NOT EXISTS idx_tag_assignment_deletions_version ON tag_assignment_deletions(version);
+
+-- Enable RLS
+ALTER TABLE tag_assignment_deletions ENABLE ROW LEVEL SECURITY;
+
+-- Allow full access to all authenticated users (which is only you)
+CREATE POLICY "Full access for authenticated users"
+ON tag_assignment_deletions
+FOR ALL
+TO authenticated
+USING (true)
+WITH CHECK (true);
+
+-- Function to give an updated assignment a new version
+CREATE OR REPLACE FUNCTION bump_tag_assignment_version()
+RETURNS TRIGGER AS $$
+BEGIN
+    NEW.version := nextval('tag_assignments_version_seq');
+    RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER bump_tag_assignment_version
+BEFORE UPDATE ON tag_assignments
+FOR EACH ROW
+EXECUTE FUNCTION bump_tag_assignment_version();
+
+-- Function to remember deleted assignments
+CREATE OR REPLACE FUNCTION record_tag_assignment_deletion()
+RETURNS TRIGGER AS $$
+BEGIN
+    IF OLD.tag_id IS NOT NULL THEN
+        INSERT INTO tag_assignment_deletions (tag_id)
+        VALUES (OLD.tag_id);
+    END IF;
+    RETURN OLD;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER record_tag_assignment_deletion
+AFTER DELETE ON tag_assignments
+FOR EACH ROW
+EXECUTE FUNCTION record_tag_assignment_deletion();
+
+-- Tags changed after since_version, oldest change first, max_rows at a time:
+-- {"version": <since_version for the next call>, "more": <true if more changes wait>,
+--  "assignments": [{"tag_id", "id", "assigned", "removed"}, ...]}
+-- Each tag appears once with its current state; "removed" means it has no row anymore
+CREATE OR REPLACE FUNCTION tag_assignments_since(since_version BIGINT, max_rows INTEGER DEFAULT 32)
+RETURNS JSONB AS $$
+DECLARE
+    result JSONB;
+BEGIN
+    WITH changed AS (
+        SELECT c.tag_id, MAX(c.version) AS version
+        FROM (
+            SELECT tag_id, version FROM tag_assignments WHERE version > since_version
+            UNION ALL
+            SELECT tag_id, version FROM tag_assignment_deletions WHERE version > since_version
+        ) AS c
+        WHERE c.tag_id IS NOT NULL
+        GROUP BY c.tag_id
+        ORDER BY MAX(c.version)
+        LIMIT max_rows + 1
+    ),
+    page AS (
+        SELECT tag_id, version FROM changed ORDER BY version LIMIT max_rows
+    ),
+    latest AS (
+        -- tag_id is not unique; the most recently changed row wins
+        SELECT DISTINCT ON (tag_id) tag_id, id, project_name
+        FROM tag_assignments
+        WHERE tag_id IN (SELECT tag_id FROM page)
+        ORDER BY tag_id, version DESC
+    )
+    SELECT jsonb_build_object(
+        'version', COALESCE((SELECT MAX(version) FROM page), since_version),
+        'more', (SELECT COUNT(*) FROM changed) > max_rows,
+        'assignments', COALESCE((
+            SELECT jsonb_agg(jsonb_build_object(
+                'tag_id', p.tag_id,
+                'id', l.id,
+                'assigned', l.project_name IS NOT NULL,
+                'removed', l.tag_id IS NULL
+            ) ORDER BY p.version)
+            FROM page p
+            LEFT JOIN latest l ON l.tag_id = p.tag_id
+        ), '[]'::jsonb)
+    ) INTO result;
+
+    RETURN result;
+END;
+$$ LANGUAGE plpgsql STABLE;
+
+-- Example: the first page for a device with an empty cache
+SELECT tag_assignments_since(0, 32);
@@ -0,0 +1,39 @@
+#ifndef HOST_ADAFRUIT_NEOPIXEL_H
+#define HOST_ADAFRUIT_NEOPIXEL_H
+
+#include <Arduino.h>
+#include <vector>
+
+#define NEO_GRB 0x52
+#define NEO_KHZ800 0x0000
+
+// Keeps the pixel colors; show() counts writes to the strip
+class Adafruit_NeoPixel {
+    private:
+        std::vector<uint32_t> colors;
+        uint8_t brightness;
+        uint32_t shows;
+
+    public:
+        Adafruit_NeoPixel(uint16_t count, int16_t pin, uint16_t type)
+            : colors(count, 0), brightness(255), shows(0) { (void)pin; (void)type; }
+
+        void begin() {}
+        void show() { shows++; }
+        void setBrightness(uint8_t value) { brightness = value; }
+        void setPixelColor(uint16_t index, uint32_t color) {
+            if (index < colors.size()) {
+                colors[index] = color;
+            }
+        }
+        void clear() { std::fill(colors.begin(), colors.end(), 0); }
+        uint32_t getPixelColor(uint16_t index) const { return index < colors.size() ? colors[index] : 0; }
+        uint8_t getBrightness() const { return brightness; }
+        uint32_t getShowCount() const { return shows; }
+
+        static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+            return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+        }
+};
+
+#endif // HOST_ADAFRUIT_NEOPIXEL_H
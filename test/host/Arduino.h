@@ -0,0 +1,371 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Arduino core subset for the native test build ([env:native]). Only what the
+// firmware modules built on the host use; time comes from host_sim.h.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <mutex>
+#include <random>
+#include <string>
+#include "host_sim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define IRAM_ATTR
+#define HEX 16
+#define DEC 10
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define FALLING 0x02
+
+class String {
+    private:
+        std::string text;
+
+    public:
+        String() {}
+        String(const char* value) : text(value != nullptr ? value : "") {}
+        String(const std::string& value) : text(value) {}
+        explicit String(char value) : text(1, value) {}
+        explicit String(int value, unsigned char base = 10) { format(value, base, true); }
+        explicit String(unsigned int value, unsigned char base = 10) { format(value, base, false); }
+        explicit String(long value, unsigned char base = 10) { format(value, base, true); }
+        explicit String(unsigned long value, unsigned char base = 10) { format(value, base, false); }
+
+        const char* c_str() const { return text.c_str(); }
+        unsigned int length() const { return text.size(); }
+        bool isEmpty() const { return text.empty(); }
+        bool reserve(unsigned int size) { text.reserve(size); return true; }
+        char charAt(unsigned int index) const { return index < text.size() ? text[index] : 0; }
+        char operator[](unsigned int index) const { return charAt(index); }
+
+        int indexOf(char c, unsigned int from = 0) const { return position(text.find(c, from)); }
+        int indexOf(const char* s, unsigned int from = 0) const { return position(text.find(s, from)); }
+        int indexOf(const String& s, unsigned int from = 0) const { return position(text.find(s.text, from)); }
+        String substring(unsigned int from) const { return from < text.size() ? String(text.substr(from)) : String(); }
+        String substring(unsigned int from, unsigned int to) const {
+            return from < to && from < text.size() ? String(text.substr(from, to - from)) : String();
+        }
+        bool startsWith(const String& prefix) const { return text.compare(0, prefix.text.size(), prefix.text) == 0; }
+        bool endsWith(const String& suffix) const {
+            return text.size() >= suffix.text.size() &&
+                   text.compare(text.size() - suffix.text.size(), suffix.text.size(), suffix.text) == 0;
+        }
+        long toInt() const { return strtol(text.c_str(), nullptr, 10); }
+        void trim() {
+            size_t first = text.find_first_not_of(" \t\r\n");
+            size_t last = text.find_last_not_of(" \t\r\n");
+            text = first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+        }
+
+        bool concat(const char* s) { text += s != nullptr ? s : ""; return true; }
+        bool concat(const char* s, unsigned int length) { text.append(s, length); return true; }
+        bool concat(const String& s) { text += s.text; return true; }
+        bool concat(char c) { text += c; return true; }
+        String& operator+=(const char* s) { concat(s); return *this; }
+        String& operator+=(const String& s) { concat(s); return *this; }
+        String& operator+=(char c) { concat(c); return *this; }
+        friend String operator+(const String& a, const String& b) { return String(a.text + b.text); }
+        friend String operator+(const String& a, const char* b) { return String(a.text + b); }
+        friend String operator+(const char* a, const String& b) { return String(a + b.text); }
+
+        bool equals(const String& other) const { return text == other.text; }
+        bool operator==(const String& other) const { return text == other.text; }
+        bool operator==(const char* other) const { return text == (other != nullptr ? other : ""); }
+        bool operator!=(const String& other) const { return text != other.text; }
+        bool operator!=(const char* other) const { return !(*this == other); }
+        bool operator<(const String& other) const { return text < other.text; }
+
+    private:
+        static int position(size_t found) { return found == std::string::npos ? -1 : (int)found; }
+        void format(long long value, unsigned char base, bool isSigned) {
+            char buffer[40];
+            if (base == 16) {
+                snprintf(buffer, sizeof(buffer), "%llx", (unsigned long long)value);
+            } else if (isSigned) {
+                snprintf(buffer, sizeof(buffer), "%lld", value);
+            } else {
+                snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)value);
+            }
+            text = buffer;
+        }
+};
+
+class Print {
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t* buffer, size_t size) {
+            size_t n = 0;
+            while (n < size && write(buffer[n])) {
+                n++;
+            }
+            return n;
+        }
+        size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+        size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+            char stackBuffer[256];
+            va_list args;
+            va_start(args, format);
+            int length = vsnprintf(stackBuffer, sizeof(stackBuffer), format, args);
+            va_end(args);
+            if (length < 0) {
+                return 0;
+            }
+            if ((size_t)length < sizeof(stackBuffer)) {
+                return write((const uint8_t*)stackBuffer, length);
+            }
+            std::string heapBuffer(length + 1, '\0');
+            va_start(args, format);
+            vsnprintf(&heapBuffer[0], heapBuffer.size(), format, args);
+            va_end(args);
+            return write((const uint8_t*)heapBuffer.data(), length);
+        }
+
+        size_t print(const char* s) { return write(s); }
+        size_t print(const String& s) { return write(s.c_str()); }
+        size_t print(char c) { return write((uint8_t)c); }
+        size_t print(long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+        size_t print(unsigned long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+        size_t print(int value, int base = DEC) { return print((long)value, base); }
+        size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+        size_t print(double value, int digits = 2) { return printf("%.*f", digits, value); }
+        size_t println() { return write("\r\n"); }
+        template <typename T>
+        size_t println(const T& value) { size_t n = print(value); return n + println(); }
+        template <typename T>
+        size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+        virtual void flush() {}
+};
+
+class Stream : public Print {
+    public:
+        virtual int available() = 0;
+        virtual int read() = 0;
+};
+
+// Serial output is kept for the tests to inspect; input is whatever a test queues
+class HardwareSerial : public Stream {
+    private:
+        mutable std::mutex guard;
+        std::string output;
+        std::string input;
+
+    public:
+        void begin(unsigned long baud) { (void)baud; }
+        operator bool() const { return true; }
+        size_t write(uint8_t c) override {
+            std::lock_guard<std::mutex> lock(guard);
+            output += (char)c;
+            return 1;
+        }
+        size_t write(const uint8_t* buffer, size_t size) override {
+            std::lock_guard<std::mutex> lock(guard);
+            output.append((const char*)buffer, size);
+            return size;
+        }
+        using Print::write;
+        int available() override {
+            std::lock_guard<std::mutex> lock(guard);
+            return input.size();
+        }
+        int read() override {
+            std::lock_guard<std::mutex> lock(guard);
+            if (input.empty()) {
+                return -1;
+            }
+            int c = (uint8_t)input[0];
+            input.erase(0, 1);
+            return c;
+        }
+
+        // Test helpers
+        std::string takeOutput() {
+            std::lock_guard<std::mutex> lock(guard);
+            std::string taken;
+            taken.swap(output);
+            return taken;
+        }
+        void queueInput(const char* text) {
+            std::lock_guard<std::mutex> lock(guard);
+            input += text;
+        }
+};
+
+inline HardwareSerial Serial;
+
+class IPAddress {
+    private:
+        uint8_t octets[4];
+
+    public:
+        IPAddress() : octets{0, 0, 0, 0} {}
+        IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+        IPAddress(uint32_t address) { memcpy(octets, &address, sizeof(octets)); }
+        operator uint32_t() const {
+            uint32_t address;
+            memcpy(&address, octets, sizeof(address));
+            return address;
+        }
+        uint8_t operator[](int index) const { return octets[index]; }
+        bool operator==(const IPAddress& other) const { return memcmp(octets, other.octets, sizeof(octets)) == 0; }
+        bool fromString(const char* text) {
+            unsigned int parts[4];
+            char extra;
+            if (sscanf(text, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &extra) != 4) {
+                return false;
+            }
+            for (int i = 0; i < 4; i++) {
+                if (parts[i] > 255) {
+                    return false;
+                }
+                octets[i] = parts[i];
+            }
+            return true;
+        }
+        String toString() const {
+            char text[16];
+            snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+            return String(text);
+        }
+};
+
+class EspClass {
+    public:
+        uint32_t getFreeHeap() { return 200000; }
+        uint32_t getMinFreeHeap() { return 150000; }
+        uint32_t getMaxAllocHeap() { return 100000; }
+        uint32_t getHeapSize() { return 320000; }
+        uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+        void restart() {}
+};
+
+inline EspClass ESP;
+
+// Time: simulated unless a test switched to real time
+inline unsigned long millis() {
+    return (unsigned long)(uint32_t)(host::nowMicros() / 1000);
+}
+
+inline unsigned long micros() {
+    return (unsigned long)(uint32_t)host::nowMicros();
+}
+
+inline void delay(unsigned long ms) {
+    std::unique_lock<std::mutex> guard(host::lock());
+    host::waitFor(guard, ms, []() { return false; });
+}
+
+inline void delayMicroseconds(unsigned int us) {
+    host::advanceMicros(us);
+}
+
+inline void yield() {}
+
+// Deterministic unless a test reseeds it
+inline std::mt19937& hostRandom() {
+    static std::mt19937 generator(12345);
+    return generator;
+}
+
+inline void randomSeed(unsigned long seed) {
+    hostRandom().seed(seed);
+}
+
+inline long random(long howBig) {
+    return howBig > 0 ? (long)(hostRandom()() % (unsigned long)howBig) : 0;
+}
+
+inline long random(long howSmall, long howBig) {
+    return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+inline uint32_t esp_random() {
+    return hostRandom()();
+}
+
+// GPIO: pins read high (PN532 IRQ idle) unless a test drives them
+inline uint8_t* hostPinLevels() {
+    static uint8_t levels[64];
+    static bool initialized = false;
+    if (!initialized) {
+        memset(levels, HIGH, sizeof(levels));
+        initialized = true;
+    }
+    return levels;
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+inline int digitalRead(uint8_t pin) { return hostPinLevels()[pin & 63]; }
+inline void digitalWrite(uint8_t pin, uint8_t value) { hostPinLevels()[pin & 63] = value; }
+
+template <typename T>
+const T& min(const T& a, const T& b) { return b < a ? b : a; }
+template <typename T>
+const T& max(const T& a, const T& b) { return a < b ? b : a; }
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// glibc has no strlcpy before 2.38
+inline size_t hostStrlcpy(char* destination, const char* source, size_t size) {
+    size_t length = strlen(source);
+    if (size > 0) {
+        size_t copied = length < size - 1 ? length : size - 1;
+        memcpy(destination, source, copied);
+        destination[copied] = '\0';
+    }
+    return length;
+}
+#define strlcpy hostStrlcpy
+
+// SNTP setup is a no-op; tests drive sync callbacks through esp_sntp.h
+inline void configTime(long gmtOffset, int daylightOffset, const char* server1,
+                       const char* server2 = nullptr, const char* server3 = nullptr) {
+    (void)gmtOffset; (void)daylightOffset; (void)server1; (void)server2; (void)server3;
+}
+
+inline void configTzTime(const char* tz, const char* server1, const char* server2 = nullptr,
+                         const char* server3 = nullptr) {
+    (void)tz; (void)server1; (void)server2; (void)server3;
+}
+
+// System time follows the simulated clock; host::setWallClock() (or an SNTP sync) sets it
+inline time_t hostTime(time_t* result) {
+    time_t now = (time_t)(host::wallClockMs() / 1000);
+    if (result != nullptr) {
+        *result = now;
+    }
+    return now;
+}
+
+inline int hostGettimeofday(struct timeval* tv, void* tz) {
+    (void)tz;
+    uint64_t now = host::wallClockMs();
+    tv->tv_sec = now / 1000;
+    tv->tv_usec = (now % 1000) * 1000;
+    return 0;
+}
+
+#define time(result) hostTime(result)
+#define gettimeofday(tv, tz) hostGettimeofday(tv, tz)
+
+inline bool getLocalTime(struct tm* info, uint32_t ms = 5000) {
+    (void)ms;
+    time_t now = time(nullptr);
+    localtime_r(&now, info);
+    return info->tm_year > (2016 - 1900);
+}
+
+#endif // HOST_ARDUINO_H
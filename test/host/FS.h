@@ -0,0 +1,246 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+namespace fs {
+
+class FS;
+
+// Flash is not RAM: the simulated files take their memory straight from malloc, so
+// they stay out of the operator new heap that test_event_heap measures
+template <typename T>
+struct FlashAllocator {
+    typedef T value_type;
+
+    FlashAllocator() = default;
+    template <typename U>
+    FlashAllocator(const FlashAllocator<U>&) {}
+
+    T* allocate(size_t count) {
+        T* block = static_cast<T*>(malloc(count * sizeof(T)));
+        if (block == nullptr) {
+            throw std::bad_alloc();
+        }
+        return block;
+    }
+    void deallocate(T* block, size_t) { free(block); }
+
+    template <typename U>
+    bool operator==(const FlashAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const FlashAllocator<U>&) const { return false; }
+};
+
+typedef std::vector<uint8_t, FlashAllocator<uint8_t>> FileBytes;
+typedef std::basic_string<char, std::char_traits<char>, FlashAllocator<char>> FilePath;
+
+// A file's bytes; open File objects share them, like handles on flash
+typedef std::shared_ptr<FileBytes> FileData;
+
+inline FileData newFileData() { return std::allocate_shared<FileBytes>(FlashAllocator<FileBytes>()); }
+
+class File {
+    private:
+        FS* owner;
+        FileData data;
+        size_t position;
+        bool writable;
+
+    public:
+        File() : owner(nullptr), position(0), writable(false) {}
+        File(FS* owner, FileData data, size_t position, bool writable)
+            : owner(owner), data(data), position(position), writable(writable) {}
+
+        operator bool() const { return data != nullptr; }
+        size_t size() const { return data ? data->size() : 0; }
+        size_t available() const { return data && position < data->size() ? data->size() - position : 0; }
+
+        size_t read(uint8_t* buffer, size_t size);
+        size_t write(const uint8_t* buffer, size_t size);
+        size_t write(uint8_t c) { return write(&c, 1); }
+
+        bool seek(uint32_t offset, SeekMode mode = SeekSet) {
+            if (!data) {
+                return false;
+            }
+            size_t base = mode == SeekSet ? 0 : mode == SeekCur ? position : data->size();
+            if (base + offset > data->size()) {
+                return false;
+            }
+            position = base + offset;
+            return true;
+        }
+
+        void flush() {}
+        void close() { data.reset(); }
+};
+
+/**
+ * In-memory flash for the native build, with SPIFFS semantics where the firmware
+ * depends on them: "w" truncates at open, rename fails if the target exists.
+ * Fault injection: powerCutAfter(n) lets n more bytes reach flash, then freezes
+ * every change (writes, truncation, remove, rename) until restorePower(), which
+ * is what a reboot finds. failNextOpens(n) makes the next n opens fail while the
+ * files stay intact, like a transient SPIFFS error.
+ * Opens and read calls are counted, as each one costs a flash access on the device.
+ */
+class FS {
+    private:
+        std::map<FilePath, FileData, std::less<>, FlashAllocator<std::pair<const FilePath, FileData>>> files;
+        bool mounted;
+        long writeBudget;   // Bytes until the power cut, -1 = no cut pending
+        bool frozen;
+        int failingOpens;
+        uint32_t openCount;
+        uint32_t readCount;
+
+    public:
+        FS() : mounted(false), writeBudget(-1), frozen(false), failingOpens(0), openCount(0), readCount(0) {}
+
+        bool begin(bool formatOnFail = false, const char* basePath = "/spiffs", uint8_t maxOpenFiles = 10,
+                   const char* partitionLabel = nullptr) {
+            (void)formatOnFail; (void)basePath; (void)maxOpenFiles; (void)partitionLabel;
+            mounted = true;
+            return true;
+        }
+        void end() { mounted = false; }
+        bool format() { files.clear(); return true; }
+
+        bool exists(const char* path) const { return files.find(path) != files.end(); }
+        bool exists(const String& path) const { return exists(path.c_str()); }
+
+        File open(const char* path, const char* mode = FILE_READ, bool create = false) {
+            (void)create;
+            openCount++;
+            if (failingOpens > 0) {
+                failingOpens--;
+                return File();
+            }
+            auto found = files.find(path);
+            if (mode[0] == 'r') {
+                return found != files.end() ? File(this, found->second, 0, false) : File();
+            }
+            if (frozen) {
+                // Nothing reaches flash any more; hand out a detached file that swallows writes
+                return File(this, newFileData(), 0, true);
+            }
+            if (found == files.end()) {
+                found = files.emplace(path, newFileData()).first;
+            } else if (mode[0] == 'w') {
+                found->second->clear();
+            }
+            return File(this, found->second, mode[0] == 'a' ? found->second->size() : 0, true);
+        }
+        File open(const String& path, const char* mode = FILE_READ) { return open(path.c_str(), mode); }
+
+        bool remove(const char* path) {
+            if (frozen) {
+                return false;
+            }
+            auto found = files.find(path);
+            if (found == files.end()) {
+                return false;
+            }
+            files.erase(found);
+            return true;
+        }
+        bool remove(const String& path) { return remove(path.c_str()); }
+
+        bool rename(const char* from, const char* to) {
+            auto found = files.find(from);
+            if (frozen || found == files.end() || files.find(to) != files.end()) {
+                return false;
+            }
+            FileData data = found->second;
+            files.erase(found);
+            files.emplace(to, data);
+            return true;
+        }
+        bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+
+        size_t totalBytes() const { return 1024 * 1024; }
+        size_t usedBytes() const {
+            size_t used = 0;
+            for (const auto& file : files) {
+                used += file.second->size();
+            }
+            return used;
+        }
+
+        // Test helpers
+        void powerCutAfter(size_t bytes) { writeBudget = bytes; }
+        void restorePower() { writeBudget = -1; frozen = false; }
+        bool isPowerCut() const { return frozen; }
+        void failNextOpens(int count) { failingOpens = count; }
+        void wipe() { files.clear(); writeBudget = -1; frozen = false; failingOpens = 0; openCount = 0; readCount = 0; }
+        uint32_t getOpens() const { return openCount; }
+        uint32_t getReads() const { return readCount; }
+        void countRead() { readCount++; }
+        FileBytes* contents(const char* path) {
+            auto found = files.find(path);
+            return found != files.end() ? found->second.get() : nullptr;
+        }
+
+        // How many of size bytes may still reach flash
+        size_t admit(size_t size) {
+            if (frozen) {
+                return 0;
+            }
+            if (writeBudget < 0) {
+                return size;
+            }
+            size_t admitted = min(size, (size_t)writeBudget);
+            writeBudget -= admitted;
+            if (admitted < size) {
+                frozen = true;
+            }
+            return admitted;
+        }
+};
+
+inline size_t File::read(uint8_t* buffer, size_t size) {
+    if (!data || writable) {
+        return 0;
+    }
+    owner->countRead();
+    size_t count = min(size, available());
+    memcpy(buffer, data->data() + position, count);
+    position += count;
+    return count;
+}
+
+inline size_t File::write(const uint8_t* buffer, size_t size) {
+    if (!data || !writable) {
+        return 0;
+    }
+    size_t admitted = owner->admit(size);
+    if (position + admitted > data->size()) {
+        data->resize(position + admitted);
+    }
+    memcpy(data->data() + position, buffer, admitted);
+    position += admitted;
+    return admitted;
+}
+
+}  // namespace fs
+
+using fs::File;
+
+#endif // HOST_FS_H
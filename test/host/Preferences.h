@@ -0,0 +1,93 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+// NVS in memory; contents survive Preferences objects like they survive reboots
+namespace host {
+
+struct Nvs {
+    std::map<std::string, std::map<std::string, std::vector<uint8_t>>> namespaces;
+    uint32_t writes = 0;  // putBytes calls that reached flash
+};
+
+inline Nvs& nvs() {
+    static Nvs instance;
+    return instance;
+}
+
+}  // namespace host
+
+class Preferences {
+    private:
+        std::string name;
+        bool opened;
+        bool readOnly;
+
+        std::map<std::string, std::vector<uint8_t>>* space() {
+            auto found = host::nvs().namespaces.find(name);
+            return found != host::nvs().namespaces.end() ? &found->second : nullptr;
+        }
+
+    public:
+        Preferences() : opened(false), readOnly(false) {}
+
+        // Like NVS, a read-only open fails until the namespace was written once
+        bool begin(const char* ns, bool readOnlyMode = false, const char* partition = nullptr) {
+            (void)partition;
+            name = ns;
+            readOnly = readOnlyMode;
+            if (readOnly && space() == nullptr) {
+                return false;
+            }
+            if (!readOnly) {
+                host::nvs().namespaces[name];
+            }
+            opened = true;
+            return true;
+        }
+        void end() { opened = false; }
+
+        size_t getBytesLength(const char* key) {
+            auto* values = opened ? space() : nullptr;
+            if (values == nullptr || values->count(key) == 0) {
+                return 0;
+            }
+            return (*values)[key].size();
+        }
+        size_t getBytes(const char* key, void* buffer, size_t length) {
+            size_t stored = getBytesLength(key);
+            if (stored == 0 || stored > length) {
+                return 0;
+            }
+            memcpy(buffer, (*space())[key].data(), stored);
+            return stored;
+        }
+        size_t putBytes(const char* key, const void* value, size_t length) {
+            if (!opened || readOnly) {
+                return 0;
+            }
+            const uint8_t* bytes = (const uint8_t*)value;
+            (*space())[key].assign(bytes, bytes + length);
+            host::nvs().writes++;
+            return length;
+        }
+        bool remove(const char* key) {
+            if (!opened || readOnly) {
+                return false;
+            }
+            return space()->erase(key) != 0;
+        }
+        bool clear() {
+            if (!opened || readOnly) {
+                return false;
+            }
+            space()->clear();
+            return true;
+        }
+        bool isKey(const char* key) { return getBytesLength(key) != 0; }
+};
+
+#endif // HOST_PREFERENCES_H
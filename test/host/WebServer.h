@@ -0,0 +1,155 @@
+#ifndef HOST_WEBSERVER_H
+#define HOST_WEBSERVER_H
+
+#include <Arduino.h>
+#include <functional>
+#include <map>
+#include <vector>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+enum HTTPMethod {
+    HTTP_ANY,
+    HTTP_GET,
+    HTTP_POST
+};
+
+// The requesting client; a test can make it hang up after some bytes
+class WiFiClient {
+    public:
+        size_t disconnectAfter = (size_t)-1;
+        size_t received = 0;
+        bool connected() const { return received < disconnectAfter; }
+};
+
+/**
+ * WebServer stand-in: no socket. request() dispatches a GET to the registered
+ * handler, like handleClient() would, and returns what the handler sent.
+ * Request headers set with setRequestHeader() go with every request() until
+ * cleared. The most recently constructed server is reachable through
+ * WebServer::last(), for classes that own theirs.
+ */
+class WebServer {
+    public:
+        typedef std::function<void()> Handler;
+
+        struct Response {
+            int code = 0;
+            std::string contentType;
+            std::map<std::string, std::string> headers;  // sendHeader() calls
+            std::string body;       // send() content followed by every sendContent() chunk
+            size_t chunks = 0;      // sendContent() calls, the final empty one included
+        };
+
+    private:
+        std::map<std::string, Handler> handlers;
+        Handler notFound;
+        std::map<std::string, std::string> args;
+        std::map<std::string, std::string> requestHeaders;
+        WiFiClient requestClient;
+        Response response;
+        bool started;
+
+        static WebServer*& latest() {
+            static WebServer* server = nullptr;
+            return server;
+        }
+
+    public:
+        explicit WebServer(int port = 80) : started(false) {
+            (void)port;
+            latest() = this;
+        }
+        ~WebServer() {
+            if (latest() == this) {
+                latest() = nullptr;
+            }
+        }
+        static WebServer* last() { return latest(); }
+
+        void on(const char* uri, HTTPMethod method, Handler handler) {
+            (void)method;
+            handlers[uri] = handler;
+        }
+        void onNotFound(Handler handler) { notFound = handler; }
+        void begin() { started = true; }
+        void handleClient() {}
+        bool isStarted() const { return started; }
+
+        bool hasArg(const char* name) const { return args.count(name) != 0; }
+        String arg(const char* name) const {
+            auto found = args.find(name);
+            return found != args.end() ? String(found->second) : String();
+        }
+        WiFiClient& client() { return requestClient; }
+        void collectHeaders(const char* headerKeys[], size_t headerKeysCount) {
+            (void)headerKeys;
+            (void)headerKeysCount;
+        }
+        String header(const char* name) const {
+            auto found = requestHeaders.find(name);
+            return found != requestHeaders.end() ? String(found->second) : String();
+        }
+        void sendHeader(const String& name, const String& value, bool first = false) {
+            (void)first;
+            response.headers[name.c_str()] = value.c_str();
+        }
+
+        void setContentLength(size_t length) { (void)length; }
+        void send(int code, const char* contentType, const String& content) {
+            response.code = code;
+            response.contentType = contentType;
+            append(content.c_str(), content.length());
+        }
+        void sendContent(const char* content, size_t length) {
+            response.chunks++;
+            append(content, length);
+        }
+        void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+
+        // Test helpers: headers for the following requests, then "GET uri", query string included
+        void setRequestHeader(const char* name, const char* value) { requestHeaders[name] = value; }
+        void clearRequestHeaders() { requestHeaders.clear(); }
+
+        Response request(const char* uri, size_t disconnectAfter = (size_t)-1) {
+            std::string path = uri;
+            args.clear();
+            size_t query = path.find('?');
+            if (query != std::string::npos) {
+                std::string rest = path.substr(query + 1);
+                path = path.substr(0, query);
+                size_t start = 0;
+                while (start <= rest.size()) {
+                    size_t end = rest.find('&', start);
+                    std::string pair = rest.substr(start, end == std::string::npos ? std::string::npos : end - start);
+                    size_t equals = pair.find('=');
+                    if (!pair.empty()) {
+                        args[pair.substr(0, equals)] = equals == std::string::npos ? "" : pair.substr(equals + 1);
+                    }
+                    if (end == std::string::npos) {
+                        break;
+                    }
+                    start = end + 1;
+                }
+            }
+
+            response = Response();
+            requestClient = WiFiClient();
+            requestClient.disconnectAfter = disconnectAfter;
+            auto found = handlers.find(path);
+            if (found != handlers.end()) {
+                found->second();
+            } else if (notFound) {
+                notFound();
+            }
+            return response;
+        }
+
+    private:
+        void append(const char* content, size_t length) {
+            response.body.append(content, length);
+            requestClient.received += length;
+        }
+};
+
+#endif // HOST_WEBSERVER_H
@@ -0,0 +1,25 @@
+#ifndef CREDENTIALS_H
+#define CREDENTIALS_H
+
+// Credentials for the native test build. platformio.ini force-includes this
+// file, so a developer's src/credentials.h (same guard) is never used by tests.
+// Two networks and two webhook endpoints, for the WiFi and failover tests,
+// and the local HTTP API token.
+
+struct WiFiNetwork {
+    const char* ssid;
+    const char* password;
+};
+
+const WiFiNetwork WIFI_NETWORKS[] = {
+    {"test-office", "office-secret"},
+    {"test-backup", ""}
+};
+
+const int WIFI_NETWORKS_COUNT = sizeof(WIFI_NETWORKS) / sizeof(WiFiNetwork);
+
+#define WEBHOOK_URL "http://primary.test:5678/webhook/tags"
+#define WEBHOOK_URLS { WEBHOOK_URL, "http://backup.test:5678/webhook/tags" }
+#define HTTP_API_TOKEN "test-token"
+
+#endif // CREDENTIALS_H
@@ -0,0 +1,51 @@
+#ifndef HOST_ESP_SNTP_H
+#define HOST_ESP_SNTP_H
+
+#include <sys/time.h>
+#include <stdint.h>
+#include "host_sim.h"
+
+// SNTP client stand-in: tests call host::sntpSync() where lwIP would set the system time
+// and report the sync
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+
+namespace host {
+
+struct Sntp {
+    sntp_sync_time_cb_t callback = nullptr;
+    uint32_t interval = 0;
+    uint32_t restarts = 0;
+};
+
+inline Sntp& sntp() {
+    static Sntp instance;
+    return instance;
+}
+
+inline void sntpSync(uint64_t epochMs) {
+    struct timeval tv;
+    tv.tv_sec = epochMs / 1000;
+    tv.tv_usec = (epochMs % 1000) * 1000;
+    setWallClock(epochMs);
+    if (sntp().callback != nullptr) {
+        sntp().callback(&tv);
+    }
+}
+
+}  // namespace host
+
+inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) {
+    host::sntp().callback = callback;
+}
+
+inline void sntp_set_sync_interval(uint32_t interval) {
+    host::sntp().interval = interval;
+}
+
+inline bool sntp_restart() {
+    host::sntp().restarts++;
+    return true;
+}
+
+#endif // HOST_ESP_SNTP_H
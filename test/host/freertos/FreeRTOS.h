@@ -0,0 +1,42 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <mutex>
+#include "../host_sim.h"
+
+// FreeRTOS types and critical sections for the native build, on top of host_sim.h
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY host::WAIT_FOREVER
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+// Critical sections: one recursive lock stands in for every spinlock
+struct portMUX_TYPE {
+    int unused;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+inline std::recursive_mutex& hostCriticalLock() {
+    static std::recursive_mutex instance;
+    return instance;
+}
+
+#define portENTER_CRITICAL(mux) hostCriticalLock().lock()
+#define portEXIT_CRITICAL(mux) hostCriticalLock().unlock()
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL(mux)
+#define taskENTER_CRITICAL(mux) portENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL(mux) portEXIT_CRITICAL(mux)
+
+#endif // HOST_FREERTOS_H
@@ -0,0 +1,66 @@
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include <string.h>
+#include <vector>
+#include "FreeRTOS.h"
+
+// Items are copied into storage allocated once at creation, as in FreeRTOS
+struct HostQueue {
+    std::vector<uint8_t> storage;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head = 0;
+    UBaseType_t count = 0;
+};
+
+typedef HostQueue* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    HostQueue* queue = new HostQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    queue->storage.resize(length * itemSize);
+    return queue;
+}
+
+inline void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    {
+        std::unique_lock<std::mutex> guard(host::lock());
+        if (!host::waitFor(guard, ticks, [queue]() { return queue->count < queue->length; })) {
+            return pdFAIL;
+        }
+        UBaseType_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(&queue->storage[tail * queue->itemSize], item, queue->itemSize);
+        queue->count++;
+    }
+    host::notifyChanged();
+    return pdPASS;
+}
+
+#define xQueueSendToBack xQueueSend
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    {
+        std::unique_lock<std::mutex> guard(host::lock());
+        if (!host::waitFor(guard, ticks, [queue]() { return queue->count > 0; })) {
+            return pdFALSE;
+        }
+        memcpy(item, &queue->storage[queue->head * queue->itemSize], queue->itemSize);
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+    }
+    host::notifyChanged();
+    return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(host::lock());
+    return queue->count;
+}
+
+#endif // HOST_FREERTOS_QUEUE_H
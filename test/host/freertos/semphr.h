@@ -0,0 +1,39 @@
+#ifndef HOST_FREERTOS_SEMPHR_H
+#define HOST_FREERTOS_SEMPHR_H
+
+#include <thread>
+#include "FreeRTOS.h"
+
+struct HostSemaphore {
+    bool taken;
+};
+
+typedef HostSemaphore* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new HostSemaphore{false};
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(host::lock());
+    if (!host::waitFor(guard, ticks, [semaphore]() { return !semaphore->taken; })) {
+        return pdFALSE;
+    }
+    semaphore->taken = true;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    {
+        std::lock_guard<std::mutex> guard(host::lock());
+        semaphore->taken = false;
+    }
+    host::notifyChanged();
+    return pdTRUE;
+}
+
+#endif // HOST_FREERTOS_SEMPHR_H
@@ -0,0 +1,77 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef host::Task* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+// Registers the task; tests run it with host::runTask() or host::startTasks()
+inline BaseType_t xTaskCreate(TaskFunction_t entry, const char* name, uint32_t stackDepth, void* param,
+                              UBaseType_t priority, TaskHandle_t* handle) {
+    (void)stackDepth;
+    (void)priority;
+    host::Task* task = new host::Task();
+    task->entry = entry;
+    task->param = param;
+    task->name = name;
+    task->notifications = 0;
+    {
+        std::lock_guard<std::mutex> guard(host::lock());
+        host::state().tasks.push_back(task);
+    }
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+inline void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == host::currentTask()) {
+        throw host::TaskStopped();
+    }
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(host::lock());
+    host::waitFor(guard, ticks, []() { return false; });
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return host::currentTask();
+}
+
+inline TickType_t xTaskGetTickCount() {
+    return (TickType_t)(host::nowMicros() / 1000);
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> guard(host::lock());
+        task->notifications++;
+    }
+    host::notifyChanged();
+    return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    host::Task* task = host::currentTask();
+    if (task == nullptr) {
+        vTaskDelay(ticks);  // The test thread has no notification slot
+        return 0;
+    }
+    std::unique_lock<std::mutex> guard(host::lock());
+    host::waitFor(guard, ticks, [task]() { return task->notifications > 0; });
+    uint32_t value = task->notifications;
+    if (value > 0) {
+        task->notifications = clearOnExit ? 0 : value - 1;
+    }
+    return value;
+}
+
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 1024;
+}
+
+#endif // HOST_FREERTOS_TASK_H
@@ -0,0 +1,416 @@
+#ifndef HAL_FAKES_H
+#define HAL_FAKES_H
+
+#include <Arduino.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "hal.h"
+
+// Simulated implementations of the interfaces in hal.h, for the native tests.
+// Operations that take time on the device advance the simulated clock by a
+// configurable amount, so timings measured by the firmware stay meaningful.
+
+class FakeClock : public Clock {
+    public:
+        unsigned long millis() override { return ::millis(); }
+        unsigned long micros() override { return ::micros(); }
+        void delay(unsigned long ms) override { ::delay(ms); }
+};
+
+/**
+ * PN532 stand-in. Cards are placed and taken away by the test; a read script
+ * can override what the next full polls see (true = card read, false = miss),
+ * for flapping and bad-coupling traces.
+ * With irq set, startDetection() leaves a search running and the IRQ line goes
+ * low fullPollHitTime after a card is in the field, as the PN532 needs that long
+ * to activate it.
+ */
+class FakeNfcReader : public NfcReader {
+    public:
+        // Bus time per operation, in ms
+        unsigned long fullPollHitTime = 30;
+        unsigned long fullPollMissTime = 20;
+        unsigned long presenceCheckTime = 4;
+        bool responding = true;
+        bool presenceSupported = true;
+        bool irq = false;
+
+        std::vector<NfcTarget> cards;
+        std::deque<bool> readScript;
+
+        uint32_t fullPolls = 0;
+        uint32_t presenceChecks = 0;
+        uint32_t powerDowns = 0;
+        uint32_t wakeUps = 0;
+        bool poweredDown = false;
+        bool detecting = false;
+        unsigned long irqReadTime = 2;  // Reading the result after the IRQ
+
+        void placeCard(const uint8_t* uid, uint8_t length) {
+            NfcTarget target;
+            memcpy(target.uid, uid, length);
+            target.uidLength = length;
+            if (cards.empty()) {
+                placedAt = ::millis();
+            }
+            cards.push_back(target);
+        }
+        void removeCards() { cards.clear(); }
+
+        bool begin() override { return responding; }
+        uint32_t getFirmwareVersion() override { return responding ? 0x32010607 : 0; }
+        bool configure() override { return responding; }
+
+        uint8_t readPassiveTargets(NfcTarget* targets, uint8_t maxTargets, uint16_t timeout) override {
+            (void)timeout;
+            fullPolls++;
+            bool visible = !cards.empty();
+            if (!readScript.empty()) {
+                visible = readScript.front() && !cards.empty();
+                readScript.pop_front();
+            }
+            if (!visible || !responding) {
+                host::advance(fullPollMissTime);
+                activated = false;
+                return 0;
+            }
+            host::advance(fullPollHitTime);
+            uint8_t found = min((uint8_t)cards.size(), maxTargets);
+            for (uint8_t i = 0; i < found; i++) {
+                targets[i] = cards[i];
+            }
+            activated = true;
+            activeUid = cards[0];
+            return found;
+        }
+
+        bool setActivationRetries(uint8_t retries) override { (void)retries; return responding; }
+
+        PresenceResult checkPresence() override {
+            presenceChecks++;
+            host::advance(presenceCheckTime);
+            if (!presenceSupported || !activated) {
+                return PRESENCE_UNSUPPORTED;
+            }
+            for (const NfcTarget& card : cards) {
+                if (card.uidLength == activeUid.uidLength && memcmp(card.uid, activeUid.uid, card.uidLength) == 0) {
+                    return PRESENCE_PRESENT;
+                }
+            }
+            activated = false;
+            return PRESENCE_ABSENT;
+        }
+
+        bool powerDown() override {
+            if (!poweredDown) {
+                powerDowns++;
+                poweredDown = true;
+                activated = false;
+            }
+            return true;
+        }
+        bool wakeUp() override {
+            if (poweredDown) {
+                wakeUps++;
+                poweredDown = false;
+            }
+            return true;
+        }
+
+        bool hasIrq() override { return irq; }
+        bool startDetection() override {
+            detecting = responding;
+            detectionStartedAt = ::millis();
+            return detecting;
+        }
+        bool isIrqLow() const {
+            return detecting && !cards.empty() && ::millis() >= max(detectionStartedAt, placedAt) + fullPollHitTime;
+        }
+        bool isDetectionReady() override { return isIrqLow(); }
+        bool readDetectedTarget(NfcTarget& target) override {
+            if (!isIrqLow()) {
+                return false;
+            }
+            lastIrqLatency = ::millis() - (max(detectionStartedAt, placedAt) + fullPollHitTime);
+            host::advance(irqReadTime);
+            lastIrqLatency += irqReadTime;
+            detecting = false;
+            target = cards[0];
+            activated = true;
+            activeUid = cards[0];
+            return true;
+        }
+        unsigned long getLastIrqLatency() override { return lastIrqLatency; }
+
+    private:
+        bool activated = false;
+        NfcTarget activeUid;
+        unsigned long placedAt = 0;
+        unsigned long detectionStartedAt = 0;
+        unsigned long lastIrqLatency = 0;
+};
+
+class FakeSleep : public SleepController {
+    public:
+        uint32_t cpuFrequency = 160;
+        bool modemSleep = false;
+        bool autoSleepSupported = true;
+        int wakePin = -1;
+        bool allowed = false;
+        uint32_t sleeps = 0;
+        unsigned long sleptTime = 0;
+        unsigned long wakeAt = 0;  // millis() at which the wake pin goes low, 0 = never
+
+        void setCpuFrequency(uint32_t mhz) override { cpuFrequency = mhz; }
+        void enableModemSleep() override { modemSleep = true; }
+        bool enableAutoLightSleep(int pin) override {
+            wakePin = autoSleepSupported ? pin : -1;
+            return autoSleepSupported;
+        }
+        void allowLightSleep(bool allowedNow) override { allowed = allowedNow; }
+        void waitForWake(unsigned long ms) override {
+            unsigned long now = ::millis();
+            if (wakePin >= 0 && wakeAt > now && wakeAt - now < ms) {
+                ms = wakeAt - now;
+            }
+            if (allowed) {
+                sleeps++;
+                sleptTime += ms;
+            }
+            host::advance(ms);
+        }
+};
+
+/**
+ * Access points in range and a station that joins them. Association and DHCP
+ * complete at once if the network is in range; the test drops the link with
+ * dropLink(), which raises the same event the WiFi driver would.
+ */
+class FakeNetwork : public NetworkInterface {
+    public:
+        std::vector<std::string> inRange;
+        uint8_t bssid[6] = {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+        uint8_t channel = 6;
+        uint32_t ip = IPAddress(192, 168, 1, 50);
+        uint32_t gateway = IPAddress(192, 168, 1, 1);
+        uint32_t subnet = IPAddress(255, 255, 255, 0);
+        int signal = -55;
+
+        uint32_t scans = 0;
+        uint32_t joins = 0;
+        uint32_t directJoins = 0;
+        bool staticIp = false;           // setStaticIP() since the last useDhcp()
+        NetworkLinkInfo staticLease;
+
+        bool isInRange(const char* ssid) const {
+            for (const std::string& name : inRange) {
+                if (name == ssid) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        void dropLink() {
+            if (linkUp) {
+                linkUp = false;
+                if (handler != nullptr) {
+                    handler(NETWORK_EVENT_DISCONNECTED, context);
+                }
+            }
+        }
+
+        void setStationMode() override {}
+        void setEventHandler(NetworkEventHandler eventHandler, void* eventContext) override {
+            handler = eventHandler;
+            context = eventContext;
+        }
+        bool startScan() override { scans++; return true; }
+        int scanResult() override { return inRange.size(); }
+        String scannedSSID(int index) override { return String(inRange[index].c_str()); }
+        void clearScan() override {}
+        void begin(const char* ssid, const char* password) override {
+            (void)password;
+            joins++;
+            join(ssid);
+        }
+        void beginDirect(const char* ssid, const char* password, uint8_t directChannel,
+                         const uint8_t* directBssid) override {
+            (void)password;
+            directJoins++;
+            if (directChannel == channel && memcmp(directBssid, bssid, sizeof(bssid)) == 0) {
+                join(ssid);
+            }
+        }
+        void setStaticIP(const NetworkLinkInfo& lease) override { staticIp = true; staticLease = lease; }
+        void useDhcp() override { staticIp = false; }
+        bool getLinkInfo(NetworkLinkInfo& info) override {
+            if (!linkUp) {
+                return false;
+            }
+            memcpy(info.bssid, bssid, sizeof(info.bssid));
+            info.channel = channel;
+            info.ip = ip;
+            info.gateway = gateway;
+            info.subnet = subnet;
+            info.dns = gateway;
+            return true;
+        }
+        void disconnect() override { linkUp = false; }
+        bool isLinkUp() override { return linkUp; }
+        String currentSSID() override { return linkUp ? String(ssid.c_str()) : String(); }
+        int rssi() override { return linkUp ? signal : 0; }
+        IPAddress localIP() override { return linkUp ? IPAddress(ip) : IPAddress(); }
+
+    private:
+        bool linkUp = false;
+        std::string ssid;
+        NetworkEventHandler handler = nullptr;
+        void* context = nullptr;
+
+        void join(const char* name) {
+            if (!isInRange(name)) {
+                return;
+            }
+            ssid = name;
+            linkUp = true;
+            if (handler != nullptr) {
+                handler(NETWORK_EVENT_GOT_IP, context);
+            }
+        }
+};
+
+// One webhook receiver behind FakeHttpTransport
+struct FakeSink {
+    IPAddress address;
+    bool down = false;                 // Connections time out
+    int status = 200;                  // Answer to every POST ...
+    std::deque<int> script;            // ... unless a scripted answer is queued
+    std::string refuse;                // Payloads containing this get 400, e.g. a poison tag id
+    unsigned long latency = 15;        // ms from POST to status line
+    bool keepAlive = true;
+    String responseBody;
+    std::function<std::string(const std::string&)> respond;  // Answer built per request, instead of responseBody
+    size_t bytesReceived = 0;          // Request payload bytes
+    size_t bytesSent = 0;              // Response body bytes
+    bool record = true;                // false: only count POSTs, so the sink's memory stays flat
+    uint32_t received = 0;             // POSTs that reached the sink
+    std::vector<std::string> bodies;   // Every POST that reached the sink, while recording
+    std::vector<int> answers;          // Status returned for each of them
+};
+
+/**
+ * HTTP client over simulated webhook receivers, one per host name. Each sink
+ * records the payloads it received and answers with a configurable status.
+ */
+class FakeHttpTransport : public HttpTransport {
+    public:
+        unsigned long dnsTime = 5;
+        unsigned long connectTime = 10;
+        uint32_t resolves = 0;
+        uint32_t connects = 0;
+
+        FakeSink& sink(const char* host) {
+            auto found = sinks.find(host);
+            if (found == sinks.end()) {
+                found = sinks.emplace(host, FakeSink()).first;
+                found->second.address = IPAddress(10, 0, 0, sinks.size());
+            }
+            return found->second;
+        }
+
+        bool resolve(const char* host, IPAddress& ip) override {
+            resolves++;
+            if (ip.fromString(host)) {
+                return true;
+            }
+            host::advance(dnsTime);
+            auto found = sinks.find(host);
+            if (found == sinks.end()) {
+                return false;
+            }
+            ip = found->second.address;
+            return true;
+        }
+
+        bool connect(const IPAddress& ip, uint16_t port, uint32_t timeout) override {
+            (void)port;
+            connects++;
+            current = nullptr;
+            for (auto& entry : sinks) {
+                if (entry.second.address == ip) {
+                    if (entry.second.down) {
+                        host::advance(timeout);
+                        return false;
+                    }
+                    host::advance(connectTime);
+                    current = &entry.second;
+                    currentHost = entry.first;
+                    return true;
+                }
+            }
+            host::advance(timeout);
+            return false;
+        }
+
+        bool connected() override { return current != nullptr && !current->down; }
+        void stop() override { current = nullptr; }
+
+        int post(const String& hostName, uint16_t port, const String& path,
+                 const char* contentType, const uint8_t* payload, size_t length) override {
+            (void)port;
+            (void)path;
+            lastContentType = contentType;
+            if (current == nullptr || currentHost != hostName.c_str()) {
+                return -1;  // HTTPC_ERROR_CONNECTION_REFUSED
+            }
+            FakeSink& target = *current;
+            if (target.down) {
+                host::advance(HTTP_TIMEOUT);
+                current = nullptr;
+                return -11;  // HTTPC_ERROR_READ_TIMEOUT
+            }
+            host::advance(target.latency);
+            int status = target.status;
+            if (!target.script.empty()) {
+                status = target.script.front();
+                target.script.pop_front();
+            }
+            target.received++;
+            if (!target.refuse.empty() &&
+                std::string((const char*)payload, length).find(target.refuse) != std::string::npos) {
+                status = 400;
+            }
+            if (target.record) {
+                target.bodies.emplace_back((const char*)payload, length);
+                target.answers.push_back(status);
+            }
+            if (target.respond) {
+                lastBody = target.respond(std::string((const char*)payload, length)).c_str();
+            } else {
+                lastBody = target.responseBody;
+            }
+            target.bytesReceived += length;
+            target.bytesSent += lastBody.length();
+            if (!target.keepAlive) {
+                current = nullptr;
+            }
+            return status;
+        }
+
+        String readResponse() override { return lastBody; }
+        void endRequest() override {}
+
+        std::string lastContentType;
+
+    private:
+        std::map<std::string, FakeSink> sinks;
+        FakeSink* current = nullptr;
+        std::string currentHost;
+        String lastBody;
+};
+
+#endif // HAL_FAKES_H
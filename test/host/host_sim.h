@@ -0,0 +1,244 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Simulated time and tasks behind the native build's Arduino and FreeRTOS shims.
+//
+// Time is simulated by default: millis() only moves when a test calls
+// host::advance() or when firmware code blocks (delay, vTaskDelay, a queue or
+// notification wait), which jumps the clock by the whole timeout. Tasks the
+// firmware creates are registered, not started. host::runTask() runs one in the
+// calling thread until a simulated deadline and then unwinds it by throwing
+// host::TaskStopped from its next blocking call. The firmware's task loops keep
+// their state in members and block at the top of each pass, so running the
+// entry again later behaves like resuming it.
+//
+// host::useRealTime() switches to the steady clock and real threads, for tests
+// that need tasks to run concurrently (host::startTasks() / host::stopTasks()).
+
+namespace host {
+
+static const uint32_t WAIT_FOREVER = 0xFFFFFFFF;  // portMAX_DELAY
+
+struct TaskStopped {};
+
+struct Task {
+    void (*entry)(void*);
+    void* param;
+    std::string name;
+    uint32_t notifications;
+    std::thread thread;
+};
+
+struct State {
+    bool realTime = false;
+    std::atomic<uint64_t> simMicros{0};
+    std::chrono::steady_clock::time_point realStart = std::chrono::steady_clock::now();
+    std::vector<Task*> tasks;
+    int64_t wallClockOffsetMs = 0;   // System time minus uptime; 0 = never set, like after power-up
+    uint64_t deadline = UINT64_MAX;  // Simulated us at which the running task is unwound
+    bool stopping = false;           // Real time: stopTasks() is unwinding the task threads
+};
+
+inline State& state() {
+    static State instance;
+    return instance;
+}
+
+// One lock and one condition for every simulated primitive; contention is not what these tests measure
+inline std::mutex& lock() {
+    static std::mutex instance;
+    return instance;
+}
+
+inline std::condition_variable& changed() {
+    static std::condition_variable instance;
+    return instance;
+}
+
+inline Task*& currentTask() {
+    static thread_local Task* task = nullptr;
+    return task;
+}
+
+inline uint64_t nowMicros() {
+    State& s = state();
+    if (s.realTime) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - s.realStart).count();
+    }
+    return s.simMicros.load();
+}
+
+// Time an operation takes: simulated time jumps, real time sleeps
+inline void advanceMicros(uint64_t us) {
+    State& s = state();
+    if (s.realTime) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    } else {
+        s.simMicros += us;
+    }
+}
+
+inline void advance(uint64_t ms) {
+    advanceMicros(ms * 1000);
+}
+
+// System time (time(), gettimeofday()): uptime plus whatever the last SNTP sync set
+inline uint64_t wallClockMs() {
+    return (uint64_t)((int64_t)(nowMicros() / 1000) + state().wallClockOffsetMs);
+}
+
+inline void setWallClock(uint64_t epochMs) {
+    state().wallClockOffsetMs = (int64_t)epochMs - (int64_t)(nowMicros() / 1000);
+}
+
+// Wakes blocked waits after a simulated primitive changed; call with lock() released
+inline void notifyChanged() {
+    changed().notify_all();
+}
+
+/**
+ * Blocks the caller until ready() holds or timeoutMs passes; guard must hold lock().
+ * Simulated time cannot make progress elsewhere while the only thread waits, so a
+ * wait that is not ready at once jumps the clock by its timeout and returns false.
+ */
+template <typename Predicate>
+bool waitFor(std::unique_lock<std::mutex>& guard, uint32_t timeoutMs, Predicate ready) {
+    State& s = state();
+    if (ready()) {
+        return true;
+    }
+    if (timeoutMs == 0) {
+        return false;
+    }
+
+    if (s.realTime) {
+        auto awake = [&]() { return ready() || s.stopping; };
+        if (timeoutMs == WAIT_FOREVER) {
+            changed().wait(guard, awake);
+        } else {
+            changed().wait_for(guard, std::chrono::milliseconds(timeoutMs), awake);
+        }
+        if (s.stopping && currentTask() != nullptr) {
+            throw TaskStopped();
+        }
+        return ready();
+    }
+
+    uint64_t wake = timeoutMs == WAIT_FOREVER ? UINT64_MAX : s.simMicros.load() + (uint64_t)timeoutMs * 1000;
+    if (currentTask() != nullptr && wake >= s.deadline) {
+        // The task may already have run past the deadline inside a slow operation; never go back
+        if (s.simMicros.load() < s.deadline) {
+            s.simMicros = s.deadline;
+        }
+        throw TaskStopped();
+    }
+    if (wake == UINT64_MAX) {
+        throw TaskStopped();  // Nothing could ever wake the test thread
+    }
+    s.simMicros = wake;
+    return ready();
+}
+
+inline Task* findTask(const char* name) {
+    std::lock_guard<std::mutex> guard(lock());
+    for (Task* task : state().tasks) {
+        if (task->name == name) {
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+// Simulated time: runs a registered task in this thread for ms of simulated time
+inline void runTask(Task* task, unsigned long ms) {
+    State& s = state();
+    uint64_t deadline = s.simMicros.load() + (uint64_t)ms * 1000;
+    s.deadline = deadline;
+    Task* previous = currentTask();
+    currentTask() = task;
+    try {
+        task->entry(task->param);
+    } catch (TaskStopped&) {
+    }
+    currentTask() = previous;
+    s.deadline = UINT64_MAX;
+    if (s.simMicros.load() < deadline) {
+        s.simMicros = deadline;
+    }
+}
+
+inline bool runTask(const char* name, unsigned long ms) {
+    Task* task = findTask(name);
+    if (task == nullptr) {
+        return false;
+    }
+    runTask(task, ms);
+    return true;
+}
+
+inline void useRealTime(bool enabled) {
+    State& s = state();
+    s.realTime = enabled;
+    s.realStart = std::chrono::steady_clock::now();
+}
+
+// Real time: every registered task gets its own thread
+inline void startTasks() {
+    std::lock_guard<std::mutex> guard(lock());
+    for (Task* task : state().tasks) {
+        if (!task->thread.joinable()) {
+            task->thread = std::thread([task]() {
+                currentTask() = task;
+                try {
+                    task->entry(task->param);
+                } catch (TaskStopped&) {
+                }
+            });
+        }
+    }
+}
+
+inline void stopTasks() {
+    State& s = state();
+    {
+        std::lock_guard<std::mutex> guard(lock());
+        s.stopping = true;
+    }
+    notifyChanged();
+    for (Task* task : s.tasks) {
+        if (task->thread.joinable()) {
+            task->thread.join();
+        }
+    }
+    std::lock_guard<std::mutex> guard(lock());
+    s.stopping = false;
+}
+
+// Between tests: forget every task (their owners are gone) and restart the clock
+inline void reset() {
+    stopTasks();
+    State& s = state();
+    std::lock_guard<std::mutex> guard(lock());
+    for (Task* task : s.tasks) {
+        delete task;
+    }
+    s.tasks.clear();
+    s.realTime = false;
+    s.simMicros = 0;
+    s.wallClockOffsetMs = 0;
+    s.deadline = UINT64_MAX;
+}
+
+}  // namespace host
+
+#endif // HOST_SIM_H
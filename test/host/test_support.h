@@ -0,0 +1,130 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include <SPIFFS.h>
+#include <vector>
+#include "hal_fakes.h"
+#include "event_queue.h"
+#include "tag_cache.h"
+#include "webhook_manager.h"
+#include "wifi_manager.h"
+
+// Shared fixtures for the native tests
+
+// Fresh simulated device: clock at 0, no tasks, empty flash and NVS
+inline void resetHost() {
+    host::reset();
+    SPIFFS.wipe();
+    host::nvs().namespaces.clear();
+    host::nvs().writes = 0;
+    Serial.takeOutput();
+}
+
+// Tag event whose 4-byte UID carries id, so deliveries can be checked for order and duplicates
+inline PollEvent makeEvent(uint32_t id, bool present = true) {
+    PollEvent event;
+    memset(&event, 0, sizeof(event));
+    event.kind = EVENT_TAG_CHANGE;
+    event.uid[0] = id >> 24;
+    event.uid[1] = id >> 16;
+    event.uid[2] = id >> 8;
+    event.uid[3] = id;
+    event.uidLength = 4;
+    event.tagType = MIFARE_CLASSIC;
+    event.tagPresent = present;
+    event.networkIndex = POLL_EVENT_NO_NETWORK;
+    event.monotonicMs = millis();
+    return event;
+}
+
+inline uint32_t eventId(const char* tagId) {
+    uint8_t uid[MAX_UID_LENGTH];
+    uint8_t uidLength = 0;
+    if (tagId == nullptr || !parseTagId(tagId, uid, uidLength) || uidLength != 4) {
+        return 0xFFFFFFFF;
+    }
+    return ((uint32_t)uid[0] << 24) | ((uint32_t)uid[1] << 16) | ((uint32_t)uid[2] << 8) | uid[3];
+}
+
+// Event ids in the JSON payloads a sink accepted (2xx), in arrival order
+inline std::vector<uint32_t> deliveredIds(const FakeSink& sink) {
+    std::vector<uint32_t> ids;
+    DynamicJsonDocument doc(2 * WEBHOOK_BATCH_MAX_BYTES + 4096);
+    for (size_t i = 0; i < sink.bodies.size(); i++) {
+        if (sink.answers[i] < 200 || sink.answers[i] >= 300 ||
+            deserializeJson(doc, sink.bodies[i].c_str()) != DeserializationError::Ok) {
+            continue;
+        }
+        JsonObject single = doc["rfid_poll_result"].as<JsonObject>();
+        if (!single.isNull()) {
+            ids.push_back(eventId(single["tag_id"].as<const char*>()));
+        }
+        JsonArray many = doc["rfid_poll_results"].as<JsonArray>();
+        for (JsonObject result : many) {
+            ids.push_back(eventId(result["tag_id"].as<const char*>()));
+        }
+    }
+    return ids;
+}
+
+inline std::vector<uint32_t> idRange(uint32_t first, uint32_t count) {
+    std::vector<uint32_t> ids;
+    for (uint32_t i = 0; i < count; i++) {
+        ids.push_back(first + i);
+    }
+    return ids;
+}
+
+/**
+ * The sender side of the firmware on simulated hardware: WiFi, both webhook
+ * endpoints of test/host/credentials.h ("primary.test", "backup.test"), the
+ * journal on the fake SPIFFS and the event queue with its sender task.
+ */
+struct DeviceRig {
+    FakeClock clock;
+    FakeNetwork network;
+    FakeHttpTransport transport;
+    WiFiManager wifi;
+    WebhookManager webhook;
+    TagCache tagCache;
+    EventQueue queue;
+    FakeSink& primary;
+    FakeSink& backup;
+
+    DeviceRig()
+        : wifi(network, clock), webhook(transport, clock), queue(webhook, wifi, tagCache),
+          primary(transport.sink("primary.test")), backup(transport.sink("backup.test")) {
+        network.inRange.push_back(WIFI_NETWORKS[0].ssid);
+    }
+
+    bool begin() {
+        return queue.begin("test-device");
+    }
+
+    // Runs the WiFi state machine until the link is up (or clearly will not come up)
+    bool connect() {
+        if (wifi.getState() == WIFI_STATE_IDLE) {
+            wifi.begin();
+        }
+        for (int i = 0; i < 10 && !wifi.isConnected(); i++) {
+            wifi.update();
+        }
+        return wifi.isConnected();
+    }
+
+    void runSender(unsigned long ms) {
+        host::runTask("webhook_sender", ms);
+    }
+
+    std::vector<uint32_t> delivered() const {
+        std::vector<uint32_t> ids = deliveredIds(primary);
+        std::vector<uint32_t> more = deliveredIds(backup);
+        ids.insert(ids.end(), more.begin(), more.end());
+        return ids;
+    }
+};
+
+#endif // TEST_SUPPORT_H
@@ -0,0 +1,222 @@
+#include <unity.h>
+#include "test_support.h"
+#include "circuit_breaker.h"
+
+// CircuitBreaker and retry backoff on their own, then the sender against flaky and refusing sinks
+
+static DeviceRig* rig;
+
+void setUp(void) {
+    resetHost();
+    rig = new DeviceRig();
+    TEST_ASSERT_TRUE(rig->begin());
+}
+
+void tearDown(void) {
+    delete rig;
+}
+
+static void enqueueRange(uint32_t first, uint32_t count) {
+    for (uint32_t id = first; id < first + count; id++) {
+        TEST_ASSERT_TRUE(rig->queue.enqueue(makeEvent(id)));
+    }
+}
+
+static size_t requestCount() {
+    return rig->primary.bodies.size() + rig->backup.bodies.size();
+}
+
+void test_breaker_opens_probes_and_closes(void) {
+    CircuitBreaker breaker;
+    unsigned long now = 1000;
+    for (int i = 0; i < BREAKER_FAILURE_THRESHOLD - 1; i++) {
+        TEST_ASSERT_TRUE(breaker.allowRequest(now));
+        breaker.onFailure(now);
+    }
+    TEST_ASSERT_EQUAL(BREAKER_CLOSED, breaker.getState());
+
+    breaker.onFailure(now);
+    TEST_ASSERT_EQUAL(BREAKER_OPEN, breaker.getState());
+    TEST_ASSERT_EQUAL_UINT32(1, breaker.getOpenCount());
+    TEST_ASSERT_EQUAL_UINT32(BREAKER_COOLDOWN, breaker.timeUntilProbe(now));
+
+    // Open: refused without a request until the cooldown is over
+    TEST_ASSERT_FALSE(breaker.allowRequest(now + BREAKER_COOLDOWN - 1));
+    TEST_ASSERT_EQUAL_UINT32(1, breaker.getRejectedCount());
+
+    // One probe; its failure reopens the circuit with a doubled cooldown
+    now += BREAKER_COOLDOWN;
+    TEST_ASSERT_TRUE(breaker.allowRequest(now));
+    TEST_ASSERT_EQUAL(BREAKER_HALF_OPEN, breaker.getState());
+    breaker.onFailure(now);
+    TEST_ASSERT_EQUAL(BREAKER_OPEN, breaker.getState());
+    TEST_ASSERT_EQUAL_UINT32(min(2UL * BREAKER_COOLDOWN, (unsigned long)BREAKER_MAX_COOLDOWN),
+                             breaker.timeUntilProbe(now));
+
+    // A successful probe closes it and resets the cooldown
+    now += BREAKER_MAX_COOLDOWN;
+    TEST_ASSERT_TRUE(breaker.allowRequest(now));
+    breaker.onSuccess();
+    TEST_ASSERT_EQUAL(BREAKER_CLOSED, breaker.getState());
+    TEST_ASSERT_EQUAL_UINT32(0, breaker.getConsecutiveFailures());
+    for (int i = 0; i < BREAKER_FAILURE_THRESHOLD; i++) {
+        breaker.onFailure(now);
+    }
+    TEST_ASSERT_EQUAL_UINT32(BREAKER_COOLDOWN, breaker.timeUntilProbe(now));
+}
+
+void test_failed_probes_cap_the_cooldown(void) {
+    CircuitBreaker breaker;
+    unsigned long now = 1000;
+    for (int i = 0; i < BREAKER_FAILURE_THRESHOLD; i++) {
+        breaker.onFailure(now);
+    }
+    for (int probe = 0; probe < 20; probe++) {
+        now += breaker.timeUntilProbe(now);
+        TEST_ASSERT_TRUE(breaker.allowRequest(now));
+        breaker.onFailure(now);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(BREAKER_MAX_COOLDOWN, breaker.timeUntilProbe(now));
+    }
+    TEST_ASSERT_EQUAL_UINT32(BREAKER_MAX_COOLDOWN, breaker.timeUntilProbe(now));
+
+    // WiFi came back: the next request probes at once
+    breaker.expireCooldown();
+    TEST_ASSERT_TRUE(breaker.allowRequest(now));
+}
+
+void test_backoff_grows_with_jitter(void) {
+    for (uint32_t attempt = 1; attempt <= 12; attempt++) {
+        unsigned long full = WEBHOOK_RETRY_BASE_DELAY;
+        for (uint32_t i = 1; i < attempt && full < WEBHOOK_RETRY_MAX_DELAY; i++) {
+            full *= 2;
+        }
+        full = min(full, (unsigned long)WEBHOOK_RETRY_MAX_DELAY);
+
+        unsigned long lowest = full;
+        unsigned long highest = 0;
+        for (int sample = 0; sample < 200; sample++) {
+            unsigned long delay = retryBackoffDelay(attempt);
+            lowest = min(lowest, delay);
+            highest = max(highest, delay);
+        }
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(full / 2, lowest);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(full, highest);
+        TEST_ASSERT_GREATER_THAN_UINT32(lowest, highest);  // Devices do not retry in lockstep
+    }
+}
+
+void test_refused_event_is_dropped_and_later_events_flow(void) {
+    TEST_ASSERT_TRUE(rig->connect());
+    PollEvent poison = makeEvent(3);
+    char tagId[3 * MAX_UID_LENGTH + 1];
+    formatTagId(poison.uid, poison.uidLength, tagId, sizeof(tagId));
+    rig->primary.refuse = tagId;
+    rig->backup.refuse = tagId;
+    uint32_t rejectedBefore = metrics.getCounter(COUNTER_EVENTS_REJECTED);
+
+    enqueueRange(1, 6);
+    rig->runSender(10000);
+
+    std::vector<uint32_t> expected = { 1, 2, 4, 5, 6 };
+    TEST_ASSERT_TRUE(rig->delivered() == expected);
+    TEST_ASSERT_EQUAL_UINT32(1, rig->queue.getRejectedCount());
+    TEST_ASSERT_EQUAL_UINT32(1, metrics.getCounter(COUNTER_EVENTS_REJECTED) - rejectedBefore);
+    TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getBacklogCount());
+    TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getRetryAttempt());
+
+    // Payload problems do not count against the endpoints
+    TEST_ASSERT_EQUAL(BREAKER_CLOSED, rig->webhook.getEndpoint(0).breaker.getState());
+    TEST_ASSERT_EQUAL_UINT32(0, rig->webhook.getEndpoint(0).errorEwma);
+}
+
+void test_refusal_by_one_endpoint_fails_over(void) {
+    TEST_ASSERT_TRUE(rig->connect());
+    rig->primary.status = 404;
+    enqueueRange(1, 3);
+    rig->runSender(10000);
+
+    TEST_ASSERT_TRUE(deliveredIds(rig->backup) == idRange(1, 3));
+    TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getRejectedCount());
+}
+
+void test_transient_answers_are_retried_not_dropped(void) {
+    const int codes[] = { 408, 429, 500, 503 };
+    for (int code : codes) {
+        delete rig;
+        resetHost();
+        rig = new DeviceRig();
+        TEST_ASSERT_TRUE(rig->begin());
+        TEST_ASSERT_TRUE(rig->connect());
+        rig->primary.status = code;
+        rig->backup.status = code;
+
+        enqueueRange(1, 3);
+        rig->runSender(10000);
+        TEST_ASSERT_TRUE(rig->delivered().empty());
+        TEST_ASSERT_EQUAL_UINT32(3, rig->queue.getBacklogCount());
+        TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getRejectedCount());
+        TEST_ASSERT_GREATER_THAN_UINT32(0, rig->queue.getRetryAttempt());
+
+        rig->primary.status = 200;
+        rig->backup.status = 200;
+        rig->runSender(WEBHOOK_RETRY_MAX_DELAY + BREAKER_MAX_COOLDOWN);
+        TEST_ASSERT_TRUE(rig->delivered() == idRange(1, 3));
+    }
+}
+
+void test_open_circuits_cost_no_requests(void) {
+    TEST_ASSERT_TRUE(rig->connect());
+    rig->primary.down = true;
+    rig->backup.down = true;
+    enqueueRange(1, 3);
+    rig->runSender(WEBHOOK_RETRY_MAX_DELAY);
+    TEST_ASSERT_EQUAL(BREAKER_OPEN, rig->webhook.getEndpoint(0).breaker.getState());
+    TEST_ASSERT_EQUAL(BREAKER_OPEN, rig->webhook.getEndpoint(1).breaker.getState());
+
+    // While both circuits are open the sender waits without posting (skip past a probe due right now)
+    for (int i = 0; i < 100 && rig->webhook.timeUntilAvailable(millis()) == 0; i++) {
+        rig->runSender(1000);
+    }
+    size_t requests = requestCount();
+    uint32_t connects = rig->transport.connects;
+    unsigned long untilProbe = rig->webhook.timeUntilAvailable(millis());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, untilProbe);
+    rig->runSender(untilProbe - 1);
+    TEST_ASSERT_EQUAL_UINT32(requests, requestCount());
+    TEST_ASSERT_EQUAL_UINT32(connects, rig->transport.connects);
+
+    // Recovered: the probe closes the circuit and the backlog drains once, in order
+    rig->primary.down = false;
+    rig->backup.down = false;
+    rig->runSender(WEBHOOK_RETRY_MAX_DELAY + BREAKER_MAX_COOLDOWN);
+    TEST_ASSERT_TRUE(rig->delivered() == idRange(1, 3));
+    TEST_ASSERT_EQUAL(BREAKER_CLOSED, rig->webhook.getEndpoint(0).breaker.getState());
+}
+
+void test_flaky_sink_delivers_everything_once(void) {
+    TEST_ASSERT_TRUE(rig->connect());
+    rig->backup.down = true;
+    // Every success follows a run of failures long enough to open the circuit
+    for (int i = 0; i < 20 * (BREAKER_FAILURE_THRESHOLD + 1); i++) {
+        rig->primary.script.push_back(i % (BREAKER_FAILURE_THRESHOLD + 1) == BREAKER_FAILURE_THRESHOLD ? 200 : 500);
+    }
+    enqueueRange(1, 20);
+    rig->runSender(60UL * 60 * 1000);
+
+    TEST_ASSERT_TRUE(rig->delivered() == idRange(1, 20));
+    TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getBacklogCount());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, rig->webhook.getEndpoint(0).breaker.getOpenCount());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_breaker_opens_probes_and_closes);
+    RUN_TEST(test_failed_probes_cap_the_cooldown);
+    RUN_TEST(test_backoff_grows_with_jitter);
+    RUN_TEST(test_refused_event_is_dropped_and_later_events_flow);
+    RUN_TEST(test_refusal_by_one_endpoint_fails_over);
+    RUN_TEST(test_transient_answers_are_retried_not_dropped);
+    RUN_TEST(test_open_circuits_cost_no_requests);
+    RUN_TEST(test_flaky_sink_delivers_everything_once);
+    return UNITY_END();
+}
@@ -0,0 +1,110 @@
+#include <unity.h>
+#include <cstddef>
+#include <new>
+#include <stdlib.h>
+#include <type_traits>
+#include "test_support.h"
+#include "logger.h"
+
+// Heap use of the event path: enqueue() on the poll side, storeEvent() and drainJournal() on the sender task
+
+static_assert(std::is_trivially_copyable<PollEvent>::value, "PollEvent is copied by value and written to flash as-is");
+static_assert(std::is_trivially_copyable<JournalRecord>::value, "JournalRecord is copied by value and written to flash as-is");
+
+// Every operator new in this binary goes through here, so the live and peak heap can be read like
+// ESP.getFreeHeap() and ESP.getMinFreeHeap() on the device. Each block carries its size in front.
+static const size_t HEADER_SIZE = alignof(std::max_align_t);
+static size_t liveBytes = 0;
+static size_t peakBytes = 0;
+static uint32_t allocationCount = 0;
+
+void* operator new(size_t size) {
+    uint8_t* block = static_cast<uint8_t*>(malloc(size + HEADER_SIZE));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    liveBytes += size;
+    peakBytes = max(peakBytes, liveBytes);
+    allocationCount++;
+    return block + HEADER_SIZE;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (pointer == nullptr) {
+        return;
+    }
+    uint8_t* block = static_cast<uint8_t*>(pointer) - HEADER_SIZE;
+    liveBytes -= *reinterpret_cast<size_t*>(block);
+    free(block);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* pointer) noexcept { operator delete(pointer); }
+void operator delete(void* pointer, size_t) noexcept { operator delete(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { operator delete(pointer); }
+
+static DeviceRig* rig;
+
+void setUp(void) {
+    resetHost();
+    rig = new DeviceRig();
+    TEST_ASSERT_TRUE(rig->begin());
+    TEST_ASSERT_TRUE(rig->connect());
+
+    // Log lines wait in the fixed ring (and are dropped once it is full) instead of piling up in Serial
+    TEST_ASSERT_TRUE(logger.begin());
+
+    // The sink counts requests instead of keeping every payload
+    rig->primary.record = false;
+}
+
+void tearDown(void) {
+    delete rig;
+}
+
+// id..id+count through the queue and the sender, one queue load at a time
+static void produce(uint32_t first, uint32_t count) {
+    for (uint32_t id = first; id < first + count; id += EVENT_QUEUE_LENGTH) {
+        for (uint32_t i = id; i < min(first + count, id + EVENT_QUEUE_LENGTH); i++) {
+            TEST_ASSERT_TRUE(rig->queue.enqueue(makeEvent(i)));
+        }
+        rig->runSender(100);
+    }
+}
+
+void test_event_path_does_not_move_the_heap_watermark(void) {
+    // Warm-up: one full turn of the journal ring, so every segment and the cursor compaction
+    // have run once and anything allocated on first use is already in place
+    const uint32_t capacity = JOURNAL_SEGMENT_COUNT * (JOURNAL_SEGMENT_SIZE / sizeof(JournalRecord));
+    const uint32_t warmUp = capacity + JOURNAL_SEGMENT_SIZE / sizeof(JournalRecord);
+    produce(1, warmUp);
+    TEST_ASSERT_EQUAL_UINT32(warmUp, rig->queue.getSentCount());
+    TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getBacklogCount());
+
+    const uint32_t events = 2000;
+    size_t liveBefore = liveBytes;
+    size_t watermark = peakBytes;
+    uint32_t allocationsBefore = allocationCount;
+    produce(warmUp + 1, events);
+    uint32_t allocations = allocationCount - allocationsBefore;
+
+    char report[140];
+    snprintf(report, sizeof(report), "%u events: live heap %+ld bytes, watermark %+ld bytes, %u.%02u allocations per event",
+             events, (long)liveBytes - (long)liveBefore, (long)peakBytes - (long)watermark,
+             allocations / events, allocations % events * 100 / events);
+    TEST_MESSAGE(report);
+
+    TEST_ASSERT_EQUAL_UINT32(warmUp + events, rig->queue.getSentCount());
+    TEST_ASSERT_EQUAL_UINT32(warmUp + events, rig->primary.received);
+    TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getBacklogCount());
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+    TEST_ASSERT_EQUAL_UINT32(liveBefore, liveBytes);
+    TEST_ASSERT_EQUAL_UINT32(watermark, peakBytes);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_event_path_does_not_move_the_heap_watermark);
+    return UNITY_END();
+}
@@ -0,0 +1,209 @@
+#include <unity.h>
+#include "test_support.h"
+#include "event_journal.h"
+
+// EventJournal on the in-memory SPIFFS, with power cuts and transient failures
+
+static const char* CURSOR_PATH = "/journal_cursor.bin";
+static const char* CURSOR_TEMP_PATH = "/journal_cursor_tmp.bin";
+
+static EventJournal* journal;
+
+void setUp(void) {
+    resetHost();
+    journal = new EventJournal();
+    TEST_ASSERT_TRUE(journal->begin());
+}
+
+void tearDown(void) {
+    delete journal;
+}
+
+// What the next boot finds on flash
+static void reboot() {
+    SPIFFS.restorePower();
+    delete journal;
+    journal = new EventJournal();
+    TEST_ASSERT_TRUE(journal->begin());
+}
+
+static uint32_t idOf(const PollEvent& event) {
+    return ((uint32_t)event.uid[0] << 24) | ((uint32_t)event.uid[1] << 16) |
+           ((uint32_t)event.uid[2] << 8) | event.uid[3];
+}
+
+static void appendRange(uint32_t first, uint32_t count) {
+    for (uint32_t id = first; id < first + count; id++) {
+        TEST_ASSERT_TRUE(journal->append(makeEvent(id)));
+    }
+}
+
+// Peeks and acks everything pending, returning the ids in replay order
+static std::vector<uint32_t> drain() {
+    std::vector<uint32_t> ids;
+    PollEvent events[8];
+    size_t count;
+    while ((count = journal->peek(events, 8)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            ids.push_back(idOf(events[i]));
+        }
+        journal->ack(count);
+    }
+    return ids;
+}
+
+static uint32_t recordsPerSegment() {
+    return JOURNAL_SEGMENT_SIZE / sizeof(JournalRecord);
+}
+
+void test_events_replay_in_order_and_ack_persists(void) {
+    appendRange(1, 10);
+    PollEvent events[4];
+    TEST_ASSERT_EQUAL(4, journal->peek(events, 4));
+    TEST_ASSERT_EQUAL_UINT32(1, idOf(events[0]));
+    TEST_ASSERT_TRUE(journal->ack(4));
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(10, journal->getHeadSeq());
+    TEST_ASSERT_EQUAL_UINT32(6, journal->pendingCount());
+    TEST_ASSERT_TRUE(drain() == idRange(5, 6));
+}
+
+void test_wrap_recycles_oldest_segment_and_counts_loss(void) {
+    uint32_t capacity = journal->getCapacity();
+    uint32_t extra = 2 * recordsPerSegment() + 3;
+    appendRange(1, capacity + extra);
+
+    // Two full segments were recycled while unsent
+    TEST_ASSERT_EQUAL_UINT32(3 * recordsPerSegment(), journal->getOldestSeq());
+    TEST_ASSERT_EQUAL_UINT32(3 * recordsPerSegment(), journal->getOverwrittenCount());
+    TEST_ASSERT_EQUAL_UINT32(journal->getOldestSeq(), journal->getReadSeq());
+
+    reboot();
+    std::vector<uint32_t> ids = drain();
+    TEST_ASSERT_TRUE(ids == idRange(3 * recordsPerSegment() + 1, capacity + extra - 3 * recordsPerSegment()));
+}
+
+void test_thousands_of_events_survive_power_cut_mid_append(void) {
+    appendRange(1, 3000);
+    std::vector<uint32_t> sent;
+    PollEvent events[8];
+    while (sent.size() < 1000) {
+        size_t count = journal->peek(events, 8);
+        for (size_t i = 0; i < count; i++) {
+            sent.push_back(idOf(events[i]));
+        }
+        journal->ack(count);
+    }
+
+    // The power fails halfway through the next record
+    SPIFFS.powerCutAfter(sizeof(JournalRecord) / 2);
+    journal->append(makeEvent(3001));
+    TEST_ASSERT_TRUE(SPIFFS.isPowerCut());
+
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(3000, journal->getHeadSeq());
+    std::vector<uint32_t> replayed = drain();
+    TEST_ASSERT_TRUE(replayed == idRange(1001, 2000));
+    TEST_ASSERT_EQUAL_UINT32(0, journal->getCorruptCount());
+
+    // The torn tail was cut off, so appending continues at the right slot
+    appendRange(5000, 3);
+    reboot();
+    TEST_ASSERT_TRUE(drain() == idRange(5000, 3));
+}
+
+// Acks until the next saveCursor() compacts the cursor file
+static void ackUntilCompaction() {
+    for (int i = 0; i < JOURNAL_CURSOR_MAX_ENTRIES - 1; i++) {
+        PollEvent event;
+        TEST_ASSERT_EQUAL(1, journal->peek(&event, 1));
+        TEST_ASSERT_TRUE(journal->ack(1));
+    }
+}
+
+void test_power_cut_during_cursor_compaction_keeps_cursor(void) {
+    appendRange(1, 100);
+    ackUntilCompaction();
+    uint32_t saved = journal->getReadSeq();
+
+    // Nothing of the compaction reaches flash
+    SPIFFS.powerCutAfter(0);
+    journal->ack(1);
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(saved, journal->getReadSeq());  // At most the last ack replays
+
+    // Power lost between removing the old cursor and renaming the new one
+    journal->ack(1);
+    uint32_t acked = journal->getReadSeq();
+    TEST_ASSERT_TRUE(SPIFFS.exists(CURSOR_PATH));
+    SPIFFS.rename(CURSOR_PATH, CURSOR_TEMP_PATH);
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(acked, journal->getReadSeq());
+
+    // The interrupted rewrite is finished by the next save
+    journal->ack(1);
+    TEST_ASSERT_FALSE(SPIFFS.exists(CURSOR_TEMP_PATH));
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(acked + 1, journal->getReadSeq());
+    TEST_ASSERT_TRUE(drain() == idRange(acked + 2, 100 - acked - 1));
+}
+
+void test_torn_cursor_append_is_ignored(void) {
+    appendRange(1, 10);
+    journal->ack(3);
+    SPIFFS.powerCutAfter(3);
+    journal->ack(1);
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(3, journal->getReadSeq());
+
+    // Later entries are not appended behind the torn one
+    journal->ack(2);
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(5, journal->getReadSeq());
+}
+
+void test_transient_open_failure_does_not_skip_records(void) {
+    appendRange(1, 3);
+    PollEvent events[4];
+    SPIFFS.failNextOpens(1);
+    TEST_ASSERT_EQUAL(0, journal->peek(events, 4));
+    TEST_ASSERT_EQUAL_UINT32(0, journal->getReadSeq());
+    TEST_ASSERT_EQUAL_UINT32(0, journal->getCorruptCount());
+
+    JournalRecord records[4];
+    uint32_t nextSeq = 0;
+    SPIFFS.failNextOpens(1);
+    TEST_ASSERT_EQUAL(0, journal->read(0, records, 4, nextSeq));
+    TEST_ASSERT_EQUAL_UINT32(0, nextSeq);
+
+    TEST_ASSERT_TRUE(drain() == idRange(1, 3));
+}
+
+void test_crc_mismatch_is_skipped_and_counted(void) {
+    appendRange(1, 3);
+    fs::FileBytes* segment = SPIFFS.contents("/journal_00.bin");
+    TEST_ASSERT_NOT_NULL(segment);
+    (*segment)[sizeof(JournalRecord) + offsetof(JournalRecord, event) + 1] ^= 0xFF;
+
+    std::vector<uint32_t> ids = drain();
+    TEST_ASSERT_TRUE(ids == std::vector<uint32_t>({ 1, 3 }));
+    TEST_ASSERT_EQUAL_UINT32(1, journal->getCorruptCount());
+
+    JournalRecord records[4];
+    uint32_t nextSeq = 0;
+    TEST_ASSERT_EQUAL(2, journal->read(0, records, 4, nextSeq));
+    TEST_ASSERT_EQUAL_UINT32(3, nextSeq);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_events_replay_in_order_and_ack_persists);
+    RUN_TEST(test_wrap_recycles_oldest_segment_and_counts_loss);
+    RUN_TEST(test_thousands_of_events_survive_power_cut_mid_append);
+    RUN_TEST(test_power_cut_during_cursor_compaction_keeps_cursor);
+    RUN_TEST(test_torn_cursor_append_is_ignored);
+    RUN_TEST(test_transient_open_failure_does_not_skip_records);
+    RUN_TEST(test_crc_mismatch_is_skipped_and_counted);
+    return UNITY_END();
+}
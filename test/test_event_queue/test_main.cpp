@@ -0,0 +1,150 @@
+#include <unity.h>
+#include <algorithm>
+#include "test_support.h"
+
+// EventQueue and its sender task on simulated WiFi, webhook receivers and flash
+
+static DeviceRig* rig;
+
+void setUp(void) {
+    resetHost();
+    rig = new DeviceRig();
+    TEST_ASSERT_TRUE(rig->begin());
+}
+
+void tearDown(void) {
+    delete rig;
+}
+
+static void enqueueRange(uint32_t first, uint32_t count) {
+    for (uint32_t id = first; id < first + count; id++) {
+        TEST_ASSERT_TRUE(rig->queue.enqueue(makeEvent(id)));
+    }
+}
+
+void test_events_are_delivered_in_order(void) {
+    TEST_ASSERT_TRUE(rig->connect());
+    enqueueRange(1, 10);
+    rig->runSender(5000);
+
+    TEST_ASSERT_TRUE(rig->delivered() == idRange(1, 10));
+    TEST_ASSERT_EQUAL_UINT32(10, rig->queue.getSentCount());
+    TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getBacklogCount());
+}
+
+void test_outage_is_journaled_and_replayed_after_reconnect(void) {
+    enqueueRange(1, 20);
+    rig->runSender(5000);
+    TEST_ASSERT_TRUE(rig->delivered().empty());
+    TEST_ASSERT_EQUAL_UINT32(20, rig->queue.getBacklogCount());
+
+    TEST_ASSERT_TRUE(rig->connect());
+    rig->queue.requestReplay();
+    rig->runSender(5000);
+    TEST_ASSERT_TRUE(rig->delivered() == idRange(1, 20));
+    TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getBacklogCount());
+}
+
+void test_failed_sends_are_retried_and_delivered_once(void) {
+    TEST_ASSERT_TRUE(rig->connect());
+    rig->primary.status = 500;
+    rig->backup.status = 500;
+    enqueueRange(1, 5);
+    rig->runSender(10000);
+
+    TEST_ASSERT_TRUE(rig->delivered().empty());
+    TEST_ASSERT_EQUAL_UINT32(5, rig->queue.getBacklogCount());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, rig->queue.getRetryAttempt());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, rig->queue.getNextRetryIn());
+
+    // Recovered: picked up after the backoff and the breaker cooldown, without a reconnect
+    rig->primary.status = 200;
+    rig->backup.status = 200;
+    rig->runSender(WEBHOOK_RETRY_MAX_DELAY + BREAKER_MAX_COOLDOWN);
+    TEST_ASSERT_TRUE(rig->delivered() == idRange(1, 5));
+    TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getRetryAttempt());
+}
+
+void test_full_queue_counts_overflow_and_keeps_order(void) {
+    TEST_ASSERT_TRUE(rig->connect());
+    enqueueRange(1, EVENT_QUEUE_LENGTH);
+    for (uint32_t id = EVENT_QUEUE_LENGTH + 1; id <= EVENT_QUEUE_LENGTH + 5; id++) {
+        TEST_ASSERT_FALSE(rig->queue.enqueue(makeEvent(id)));
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, rig->queue.getOverflowCount());
+    TEST_ASSERT_EQUAL_UINT32(EVENT_QUEUE_LENGTH, rig->queue.getPeakDepth());
+
+    rig->runSender(5000);
+    TEST_ASSERT_TRUE(rig->delivered() == idRange(1, EVENT_QUEUE_LENGTH));
+    TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getDepth());
+}
+
+// Poll loop on the test thread, sender task on its own thread, both in real time
+void test_slow_webhook_does_not_stall_polling(void) {
+    const unsigned long pollInterval = 10;
+    const int polls = 100;
+    TEST_ASSERT_TRUE(rig->connect());
+    rig->primary.latency = 300;
+    rig->backup.latency = 300;  // Otherwise the faster backup takes over
+    host::useRealTime(true);
+    host::startTasks();
+
+    unsigned long slowestEnqueue = 0;
+    unsigned long start = micros();
+    for (int i = 0; i < polls; i++) {
+        unsigned long pollStart = micros();
+        if (i % 10 == 0) {
+            TEST_ASSERT_TRUE(rig->queue.enqueue(makeEvent(i / 10 + 1)));
+        }
+        slowestEnqueue = max(slowestEnqueue, micros() - pollStart);
+        delay(pollInterval);
+    }
+    unsigned long elapsed = (micros() - start) / 1000;
+
+    // Ten 300 ms posts take 3 s; the poll loop must not have waited for them
+    TEST_ASSERT_LESS_THAN_UINT32(2000, slowestEnqueue);
+    TEST_ASSERT_LESS_THAN_UINT32(polls * pollInterval + 250, elapsed);
+    TEST_ASSERT_LESS_THAN_UINT32(10, rig->queue.getSentCount());
+
+    for (int i = 0; i < 100 && rig->queue.getSentCount() < 10; i++) {
+        delay(100);
+    }
+    host::stopTasks();
+
+    // Latency based routing may spread the events over both endpoints
+    std::vector<uint32_t> delivered = rig->delivered();
+    std::sort(delivered.begin(), delivered.end());
+    TEST_ASSERT_TRUE(delivered == idRange(1, 10));
+    TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getOverflowCount());
+}
+
+// While a post hangs, a burst overflows the queue without blocking the caller
+void test_burst_during_slow_post_overflows_without_blocking(void) {
+    TEST_ASSERT_TRUE(rig->connect());
+    rig->primary.latency = 500;
+    rig->backup.latency = 500;
+    host::useRealTime(true);
+    host::startTasks();
+
+    TEST_ASSERT_TRUE(rig->queue.enqueue(makeEvent(1)));
+    delay(100);  // The sender has taken event 1 and is waiting for the sink
+
+    unsigned long start = micros();
+    for (uint32_t id = 2; id <= EVENT_QUEUE_LENGTH + 11; id++) {
+        rig->queue.enqueue(makeEvent(id));
+    }
+    TEST_ASSERT_LESS_THAN_UINT32(5000, micros() - start);
+    TEST_ASSERT_EQUAL_UINT32(10, rig->queue.getOverflowCount());
+    host::stopTasks();
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_events_are_delivered_in_order);
+    RUN_TEST(test_outage_is_journaled_and_replayed_after_reconnect);
+    RUN_TEST(test_failed_sends_are_retried_and_delivered_once);
+    RUN_TEST(test_full_queue_counts_overflow_and_keeps_order);
+    RUN_TEST(test_slow_webhook_does_not_stall_polling);
+    RUN_TEST(test_burst_during_slow_post_overflows_without_blocking);
+    return UNITY_END();
+}
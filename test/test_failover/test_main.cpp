@@ -0,0 +1,121 @@
+#include <unity.h>
+#include <algorithm>
+#include "test_support.h"
+
+// Health-weighted failover between the two sinks while one of them is killed and revived mid-run
+
+static DeviceRig* rig;
+
+void setUp(void) {
+    resetHost();
+    rig = new DeviceRig();
+    TEST_ASSERT_TRUE(rig->begin());
+    TEST_ASSERT_TRUE(rig->connect());
+}
+
+void tearDown(void) {
+    delete rig;
+}
+
+static size_t accepted(const FakeSink& sink) {
+    return std::count_if(sink.answers.begin(), sink.answers.end(), [](int code) { return code >= 200 && code < 300; });
+}
+
+// Enqueues one event and runs the sender until a sink accepted it; returns the time that took
+static unsigned long deliver(uint32_t id) {
+    size_t before = accepted(rig->primary) + accepted(rig->backup);
+    unsigned long start = millis();
+    TEST_ASSERT_TRUE(rig->queue.enqueue(makeEvent(id)));
+    while (accepted(rig->primary) + accepted(rig->backup) == before && millis() - start < 120000) {
+        rig->runSender(10);
+    }
+    TEST_ASSERT_GREATER_THAN_UINT32(before, accepted(rig->primary) + accepted(rig->backup));
+    return millis() - start;
+}
+
+static void idle(unsigned long ms) {
+    rig->runSender(ms);
+}
+
+void test_primary_killed_mid_run_loses_and_duplicates_nothing(void) {
+    uint32_t id = 0;
+    unsigned long healthyLatency = 0;
+    for (int i = 0; i < 80; i++) {
+        healthyLatency = max(healthyLatency, deliver(++id));
+        idle(500);
+    }
+    TEST_ASSERT_EQUAL_UINT32(80, accepted(rig->primary));  // Healthy primary takes everything
+
+    // Killed: the first event waits for one request timeout, then moves on within the same send
+    rig->primary.down = true;
+    unsigned long failoverLatency = deliver(++id);
+    unsigned long worstAfter = 0;
+    for (int i = 0; i < 69; i++) {
+        idle(500);
+        worstAfter = max(worstAfter, deliver(++id));
+    }
+
+    // Revived: traffic returns once the primary's error rate has decayed
+    rig->primary.down = false;
+    size_t primaryBefore = accepted(rig->primary);
+    for (int i = 0; i < 120; i++) {
+        idle(5000);
+        deliver(++id);
+    }
+
+    char report[160];
+    snprintf(report, sizeof(report),
+             "latency healthy %lu ms, failover %lu ms, then up to %lu ms; %u failovers, %u back on primary",
+             healthyLatency, failoverLatency, worstAfter, rig->webhook.getFailoverCount(),
+             (unsigned)(accepted(rig->primary) - primaryBefore));
+    TEST_MESSAGE(report);
+
+    std::vector<uint32_t> ids = rig->delivered();
+    std::sort(ids.begin(), ids.end());
+    TEST_ASSERT_TRUE(ids == idRange(1, id));  // Every event once, none twice
+    TEST_ASSERT_EQUAL_UINT32(0, rig->queue.getBacklogCount());
+
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(HTTP_TIMEOUT + 1000, failoverLatency);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(1000, worstAfter);  // Routed around the dead sink, no more timeouts
+    TEST_ASSERT_GREATER_THAN_UINT32(0, rig->webhook.getFailoverCount());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, accepted(rig->primary) - primaryBefore);
+}
+
+void test_slow_primary_loses_traffic_to_a_faster_backup(void) {
+    rig->primary.latency = WEBHOOK_PRIORITY_PENALTY + 800;
+    uint32_t id = 0;
+    for (int i = 0; i < 20; i++) {
+        deliver(++id);
+        idle(500);
+    }
+
+    // The first request learns the primary's latency; later ones prefer the backup
+    TEST_ASSERT_LESS_THAN_UINT32(5, accepted(rig->primary));
+    TEST_ASSERT_GREATER_THAN_UINT32(15, accepted(rig->backup));
+    std::vector<uint32_t> ids = rig->delivered();
+    std::sort(ids.begin(), ids.end());
+    TEST_ASSERT_TRUE(ids == idRange(1, id));
+}
+
+void test_both_sinks_down_keeps_events_until_one_returns(void) {
+    rig->primary.down = true;
+    rig->backup.down = true;
+    for (uint32_t id = 1; id <= 10; id++) {
+        TEST_ASSERT_TRUE(rig->queue.enqueue(makeEvent(id)));
+        idle(1000);
+    }
+    TEST_ASSERT_EQUAL_UINT32(10, rig->queue.getBacklogCount());
+
+    rig->backup.down = false;
+    idle(WEBHOOK_RETRY_MAX_DELAY + BREAKER_MAX_COOLDOWN);
+    TEST_ASSERT_TRUE(deliveredIds(rig->backup) == idRange(1, 10));
+    TEST_ASSERT_TRUE(rig->primary.bodies.empty());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_primary_killed_mid_run_loses_and_duplicates_nothing);
+    RUN_TEST(test_slow_primary_loses_traffic_to_a_faster_backup);
+    RUN_TEST(test_both_sinks_down_keeps_events_until_one_returns);
+    return UNITY_END();
+}
@@ -0,0 +1,204 @@
+#include <unity.h>
+#include "test_support.h"
+#include "http_api.h"
+
+// The local HTTP API on the WebServer stand-in, with a collector pulling from the journal
+
+static DeviceRig* rig;
+static HttpApi* api;
+
+void setUp(void) {
+    resetHost();
+    rig = new DeviceRig();
+    TEST_ASSERT_TRUE(rig->begin());
+    TEST_ASSERT_TRUE(rig->connect());
+    api = new HttpApi(rig->queue, rig->webhook, rig->wifi);
+    TEST_ASSERT_TRUE(api->begin("test-device"));
+    WebServer::last()->setRequestHeader("Authorization", "Bearer " HTTP_API_TOKEN);
+}
+
+void tearDown(void) {
+    delete api;
+    delete rig;
+}
+
+struct Page {
+    int code;
+    uint32_t oldestSeq;
+    uint32_t nextSeq;
+    uint32_t headSeq;
+    uint32_t count;
+    bool more;
+    std::vector<uint32_t> seqs;
+    std::vector<uint32_t> ids;
+    size_t chunks;
+};
+
+static Page pull(uint32_t since, uint32_t limit = HTTP_API_MAX_EVENTS) {
+    char uri[64];
+    snprintf(uri, sizeof(uri), "/events?since=%u&limit=%u", since, limit);
+    WebServer::Response response = WebServer::last()->request(uri);
+
+    Page page = {};
+    page.code = response.code;
+    page.chunks = response.chunks;
+    DynamicJsonDocument doc(response.body.size() * 2 + 1024);
+    TEST_ASSERT_TRUE(deserializeJson(doc, response.body.c_str()) == DeserializationError::Ok);
+    page.oldestSeq = doc["oldest_seq"];
+    page.nextSeq = doc["next_seq"];
+    page.headSeq = doc["head_seq"];
+    page.count = doc["count"];
+    page.more = doc["more"];
+    for (JsonObject event : doc["events"].as<JsonArray>()) {
+        page.seqs.push_back(event["seq"]);
+        page.ids.push_back(eventId(event["tag_id"].as<const char*>()));
+    }
+    return page;
+}
+
+// Events go through the queue into the journal the way loop() would produce them
+static void produce(uint32_t first, uint32_t count) {
+    for (uint32_t id = first; id < first + count; id += EVENT_QUEUE_LENGTH) {
+        for (uint32_t i = id; i < min(first + count, id + EVENT_QUEUE_LENGTH); i++) {
+            TEST_ASSERT_TRUE(rig->queue.enqueue(makeEvent(i)));
+        }
+        rig->runSender(100);
+    }
+}
+
+void test_collector_pulls_10k_events_without_loss_or_duplicates(void) {
+    const uint32_t total = 10000;
+    const uint32_t perRound = 250;
+
+    std::vector<uint32_t> ids;
+    uint32_t since = 0;
+    uint32_t requests = 0;
+    size_t maxChunks = 0;
+    for (uint32_t produced = 0; produced < total; produced += perRound) {
+        produce(produced + 1, perRound);
+
+        // Page until caught up, resuming from next_seq
+        Page page;
+        do {
+            page = pull(since);
+            requests++;
+            TEST_ASSERT_EQUAL_INT(200, page.code);
+            TEST_ASSERT_LESS_OR_EQUAL_UINT32(since, page.oldestSeq);  // Nothing recycled before the pull
+            TEST_ASSERT_EQUAL_UINT32(page.seqs.size(), page.count);
+            for (size_t i = 0; i < page.seqs.size(); i++) {
+                TEST_ASSERT_EQUAL_UINT32(since + i, page.seqs[i]);
+            }
+            ids.insert(ids.end(), page.ids.begin(), page.ids.end());
+            since = page.nextSeq;
+            maxChunks = max(maxChunks, page.chunks);
+        } while (page.more);
+        TEST_ASSERT_EQUAL_UINT32(page.headSeq, since);
+    }
+
+    char report[100];
+    snprintf(report, sizeof(report), "%u events in %u requests, up to %u chunks per response",
+             (unsigned)ids.size(), requests, (unsigned)maxChunks);
+    TEST_MESSAGE(report);
+
+    TEST_ASSERT_TRUE(ids == idRange(1, total));
+    TEST_ASSERT_EQUAL_UINT32(total, api->getEventsServed());
+    TEST_ASSERT_GREATER_THAN_UINT32(1, maxChunks);  // Streamed, not built in one buffer
+
+    // Caught up: an empty page that keeps the cursor
+    Page last = pull(since);
+    TEST_ASSERT_EQUAL_UINT32(0, last.count);
+    TEST_ASSERT_EQUAL_UINT32(since, last.nextSeq);
+    TEST_ASSERT_FALSE(last.more);
+}
+
+void test_limit_pages_the_backlog(void) {
+    produce(1, 25);
+
+    Page first = pull(0, 10);
+    TEST_ASSERT_EQUAL_UINT32(10, first.count);
+    TEST_ASSERT_TRUE(first.more);
+    TEST_ASSERT_TRUE(first.ids == idRange(1, 10));
+
+    Page second = pull(first.nextSeq, 100);
+    TEST_ASSERT_EQUAL_UINT32(15, second.count);
+    TEST_ASSERT_FALSE(second.more);
+    TEST_ASSERT_TRUE(second.ids == idRange(11, 15));
+}
+
+void test_recycled_events_show_in_oldest_seq(void) {
+    // More events than the ring holds, none pulled
+    const uint32_t capacity = JOURNAL_SEGMENT_COUNT * (JOURNAL_SEGMENT_SIZE / sizeof(JournalRecord));
+    produce(1, capacity + 200);
+
+    Page page = pull(0, 10);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, page.oldestSeq);
+    TEST_ASSERT_EQUAL_UINT32(page.oldestSeq, page.seqs.front());  // Resumes at the oldest retained event
+}
+
+void test_disconnected_client_stops_the_stream(void) {
+    produce(1, 200);
+
+    WebServer::Response response = WebServer::last()->request("/events?since=0", 2 * HTTP_API_CHUNK_SIZE);
+    TEST_ASSERT_EQUAL_INT(200, response.code);
+    TEST_ASSERT_LESS_THAN_UINT32(200, api->getEventsServed());
+    TEST_ASSERT_FALSE(api->isServing());
+}
+
+void test_status_metrics_and_unknown_paths(void) {
+    WebServer::Response status = WebServer::last()->request("/status");
+    TEST_ASSERT_EQUAL_INT(200, status.code);
+    TEST_ASSERT_EQUAL_STRING("application/json", status.contentType.c_str());
+    DynamicJsonDocument doc(8192);
+    TEST_ASSERT_TRUE(deserializeJson(doc, status.body.c_str()) == DeserializationError::Ok);
+
+    WebServer::Response metrics = WebServer::last()->request("/metrics");
+    TEST_ASSERT_EQUAL_INT(200, metrics.code);
+    TEST_ASSERT_TRUE(deserializeJson(doc, metrics.body.c_str()) == DeserializationError::Ok);
+
+    TEST_ASSERT_EQUAL_INT(404, WebServer::last()->request("/nothing").code);
+    TEST_ASSERT_EQUAL_UINT32(2, api->getRequestCount());  // Unknown paths are not counted
+}
+
+void test_requests_without_the_token_get_401(void) {
+    produce(1, 5);
+    WebServer& server = *WebServer::last();
+    server.clearRequestHeaders();
+
+    const char* paths[] = { "/events?since=0", "/status", "/metrics" };
+    for (const char* path : paths) {
+        WebServer::Response response = server.request(path);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(401, response.code, path);
+        TEST_ASSERT_EQUAL_STRING("Bearer", response.headers["WWW-Authenticate"].c_str());
+        TEST_ASSERT_TRUE(response.body.find("tag_id") == std::string::npos);
+    }
+
+    // Wrong or partial tokens, in the header or the query
+    server.setRequestHeader("Authorization", "Bearer wrong-token");
+    TEST_ASSERT_EQUAL_INT(401, server.request("/status").code);
+    server.setRequestHeader("Authorization", "Bearer test-toke");
+    TEST_ASSERT_EQUAL_INT(401, server.request("/status").code);
+    server.setRequestHeader("Authorization", "Basic " HTTP_API_TOKEN);
+    TEST_ASSERT_EQUAL_INT(401, server.request("/status").code);
+    server.clearRequestHeaders();
+    TEST_ASSERT_EQUAL_INT(401, server.request("/status?token=test-token-and-more").code);
+    TEST_ASSERT_EQUAL_UINT32(7, api->getUnauthorizedCount());
+    TEST_ASSERT_EQUAL_UINT32(0, api->getRequestCount());
+    TEST_ASSERT_EQUAL_UINT32(0, api->getEventsServed());
+
+    // The token as a query argument, for clients that cannot set headers
+    TEST_ASSERT_EQUAL_INT(200, server.request("/status?token=" HTTP_API_TOKEN).code);
+    WebServer::Response events = server.request("/events?since=0&token=" HTTP_API_TOKEN);
+    TEST_ASSERT_EQUAL_INT(200, events.code);
+    TEST_ASSERT_EQUAL_UINT32(5, api->getEventsServed());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_collector_pulls_10k_events_without_loss_or_duplicates);
+    RUN_TEST(test_limit_pages_the_backlog);
+    RUN_TEST(test_recycled_events_show_in_oldest_seq);
+    RUN_TEST(test_disconnected_client_stops_the_stream);
+    RUN_TEST(test_status_metrics_and_unknown_paths);
+    RUN_TEST(test_requests_without_the_token_get_401);
+    return UNITY_END();
+}
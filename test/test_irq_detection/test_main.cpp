@@ -0,0 +1,166 @@
+#include <unity.h>
+#include "test_support.h"
+#include "reader_pool.h"
+
+// Detection latency of IRQ mode (simulated PN532 IRQ line) against the polling fallback
+
+static const uint8_t TAG[] = { 0x04, 0x7A, 0x19, 0xC2 };
+
+// Each cycle: the reader idles, then a tag sits on it for TAG_ON_TIME. The idle gaps are long
+// enough for polling to back off to POLL_IDLE_MAX_INTERVAL and differ so insertions land at
+// every phase of the poll interval
+static const int CYCLES = 20;
+static const unsigned long TAG_ON_TIME = 2000;
+static const unsigned long IDLE_BASE = 5UL * 60 * 1000;
+static const unsigned long IDLE_STEP = 137;
+
+// Idle waits of loop() in IRQ mode: up to LOW_POWER_MAX_SLEEP, ended by the IRQ line going low
+// (1 ms steps while a tag is in the field stand for that wake-up), 10 ms while the absence
+// timeout runs
+static const unsigned long IRQ_WAKE_STEP = 1;
+static const unsigned long IRQ_WATCH_STEP = 10;
+
+struct DetectionResult {
+    uint32_t inserts;
+    uint32_t removals;
+    unsigned long maxInsertLatency;    // ms from the tag arriving to the poll that saw it
+    unsigned long maxRemovalLatency;   // ms from the tag leaving to the poll that missed it
+    unsigned long maxIrqLatency;       // ms from the IRQ edge to the result read
+    uint32_t fullPolls;
+    uint32_t presenceChecks;
+};
+
+void setUp(void) {
+    resetHost();
+}
+
+void tearDown(void) {
+}
+
+static DetectionResult run(bool irq) {
+    FakeClock clock;
+    FakeNfcReader reader;
+    reader.irq = irq;
+    ReaderPool pool;
+    pool.addReader(reader, 0);
+    TEST_ASSERT_EQUAL(1, pool.begin());
+
+    DetectionResult result = {};
+    unsigned long insertAt = 0;
+    unsigned long removeAt = 0;
+    unsigned long cycleStart = millis();
+    int cycle = 0;
+    while (cycle < CYCLES || !reader.cards.empty() || result.removals < result.inserts) {
+        unsigned long now = millis();
+
+        // Tag schedule for the current cycle
+        unsigned long idle = IDLE_BASE + cycle * IDLE_STEP;
+        if (cycle < CYCLES && reader.cards.empty() && now >= cycleStart + idle) {
+            reader.placeCard(TAG, sizeof(TAG));
+            insertAt = now;
+        } else if (!reader.cards.empty() && now >= insertAt + TAG_ON_TIME) {
+            reader.removeCards();
+            removeAt = now;
+            cycleStart = now;
+            cycle++;
+        }
+
+        unsigned long wait = 0;
+        if (irq) {
+            if (!pool.pollIrq(now, clock)) {
+                wait = !pool.isAwaitingIrq() ? IRQ_WATCH_STEP : reader.cards.empty() ? LOW_POWER_MAX_SLEEP : IRQ_WAKE_STEP;
+            } else if (!reader.cards.empty()) {
+                result.maxIrqLatency = max(result.maxIrqLatency, reader.getLastIrqLatency());
+            }
+        } else if (pool.nextDue(now) < 0) {
+            wait = max(pool.timeUntilDue(now), 1UL);
+        } else {
+            pool.poll(0, clock);
+        }
+
+        // Wake for the next tag arrival or removal, so they happen on time and not at a poll
+        if (wait > 0) {
+            unsigned long nextTagChange = reader.cards.empty() ? cycleStart + IDLE_BASE + cycle * IDLE_STEP
+                                                               : insertAt + TAG_ON_TIME;
+            if (cycle < CYCLES && nextTagChange > now) {
+                wait = min(wait, nextTagChange - now);
+            }
+            host::advance(wait);
+        }
+
+        PresenceChange change;
+        while (pool.nextChange(millis(), change)) {
+            if (change.present) {
+                result.inserts++;
+                result.maxInsertLatency = max(result.maxInsertLatency, change.at - insertAt);
+            } else {
+                result.removals++;
+                result.maxRemovalLatency = max(result.maxRemovalLatency, change.at - removeAt);
+            }
+        }
+    }
+    result.fullPolls = reader.fullPolls;
+    result.presenceChecks = reader.presenceChecks;
+    return result;
+}
+
+static void report(const char* mode, const DetectionResult& result) {
+    char text[160];
+    snprintf(text, sizeof(text), "%s: %u inserts, worst detection %lu ms, worst removal %lu ms, "
+             "%u full polls, %u presence checks",
+             mode, result.inserts, result.maxInsertLatency, result.maxRemovalLatency,
+             result.fullPolls, result.presenceChecks);
+    TEST_MESSAGE(text);
+}
+
+void test_irq_mode_detects_within_one_activation(void) {
+    DetectionResult result = run(true);
+    report("IRQ", result);
+
+    TEST_ASSERT_EQUAL_UINT32(CYCLES, result.inserts);
+    TEST_ASSERT_EQUAL_UINT32(CYCLES, result.removals);
+
+    // The PN532's own activation time, plus the wake-up and reading the result
+    FakeNfcReader reader;
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(reader.fullPollHitTime + IRQ_WAKE_STEP + reader.irqReadTime,
+                                     result.maxInsertLatency);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(IRQ_WAKE_STEP + reader.irqReadTime, result.maxIrqLatency);
+
+    // Removal: the re-check after NFC_REARM_INTERVAL gets no IRQ within NFC_ABSENT_TIMEOUT
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(NFC_REARM_INTERVAL + NFC_ABSENT_TIMEOUT + IRQ_WATCH_STEP + reader.irqReadTime,
+                                     result.maxRemovalLatency);
+
+    // Every result came through the IRQ; no blocking search or presence check was needed
+    TEST_ASSERT_EQUAL_UINT32(0, result.fullPolls);
+    TEST_ASSERT_EQUAL_UINT32(0, result.presenceChecks);
+}
+
+void test_polling_mode_detects_within_one_idle_interval(void) {
+    DetectionResult result = run(false);
+    report("Polling", result);
+
+    TEST_ASSERT_EQUAL_UINT32(CYCLES, result.inserts);
+    TEST_ASSERT_EQUAL_UINT32(CYCLES, result.removals);
+
+    // A tag arriving just after a miss waits out the idle interval, then one full poll
+    FakeNfcReader reader;
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(POLL_IDLE_MAX_INTERVAL + reader.fullPollHitTime, result.maxInsertLatency);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(POLL_PRESENT_INTERVAL + reader.presenceCheckTime, result.maxRemovalLatency);
+}
+
+void test_irq_mode_detects_faster_than_polling(void) {
+    DetectionResult irq = run(true);
+    host::reset();
+    DetectionResult polled = run(false);
+
+    // Idle insertions: the IRQ needs no poll interval to come round
+    TEST_ASSERT_LESS_THAN_UINT32(polled.maxInsertLatency / 10, irq.maxInsertLatency);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_irq_mode_detects_within_one_activation);
+    RUN_TEST(test_polling_mode_detects_within_one_idle_interval);
+    RUN_TEST(test_irq_mode_detects_faster_than_polling);
+    return UNITY_END();
+}
@@ -0,0 +1,171 @@
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include "test_support.h"
+#include "logger.h"
+
+// Logger: every conversion captured by write() and rendered by the log task must read like snprintf
+
+static Logger* ringLog;
+
+void setUp(void) {
+    resetHost();
+    ringLog = new Logger();
+    TEST_ASSERT_TRUE(ringLog->begin());  // Ring mode; the log task only runs when a test drives it
+}
+
+void tearDown(void) {
+    delete ringLog;
+}
+
+// Prints every waiting message and returns what reached the serial port
+static std::string drained() {
+    ringLog->flush();
+    return Serial.takeOutput();
+}
+
+// write() must not print, and the rendered line must equal snprintf's
+#define ASSERT_ROUND_TRIP(format, ...) do { \
+        char line[LOG_LINE_SIZE]; \
+        snprintf(line, sizeof(line), format, ##__VA_ARGS__); \
+        std::string expected = std::string(line) + "\r\n"; \
+        ringLog->write(format, ##__VA_ARGS__); \
+        TEST_ASSERT_TRUE_MESSAGE(Serial.takeOutput().empty(), format); \
+        std::string rendered = drained(); \
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(expected.c_str(), rendered.c_str(), format); \
+    } while (0)
+
+void test_integer_conversions_round_trip(void) {
+    ASSERT_ROUND_TRIP("plain text, no arguments");
+    ASSERT_ROUND_TRIP("%d %i %d", -42, 17, INT32_MIN);
+    ASSERT_ROUND_TRIP("%u %x %X %o", 4000000000U, 0xBEEFU, 0xBEEFU, 0755U);
+    ASSERT_ROUND_TRIP("%c%c%c", 'P', 'N', '5');
+    ASSERT_ROUND_TRIP("%hd %hu %hhd %hhu", (short)-1234, (unsigned short)65000, (signed char)-7, (unsigned char)250);
+    ASSERT_ROUND_TRIP("%ld %lu %lx", -123456789L, 4000000000UL, 0xDEADBEEFUL);
+    ASSERT_ROUND_TRIP("%lld %llu %llx", -1234567890123LL, 18446744073709551615ULL, 0x1122334455667788ULL);
+    ASSERT_ROUND_TRIP("%zu %zx", (size_t)65536, (size_t)0xFFFF);
+    ASSERT_ROUND_TRIP("[%5d] [%-5d] [%05d] [%+d] [% d] [%#x] [%#o] [%.3d]", 42, 42, 42, 42, 42, 255U, 8U, 7);
+    ASSERT_ROUND_TRIP("100%% done, %d%%", 50);
+}
+
+void test_float_conversions_round_trip(void) {
+    ASSERT_ROUND_TRIP("%f %F %.2f %8.3f %-8.1f|", 3.14159, -2.5, 0.005, 1234.5678, 9.99);
+    ASSERT_ROUND_TRIP("%e %E %.1e", 6.02214076e23, -1.602e-19, 0.000123);
+    ASSERT_ROUND_TRIP("%g %G %.3g", 0.0001, 1e20, 123456.0);
+    ASSERT_ROUND_TRIP("%.1f dBm, %u.%u%% awake", (double)-67.25f, 4U, 2U);  // float is promoted like in the firmware
+}
+
+void test_string_and_pointer_conversions_round_trip(void) {
+    const char* missing = nullptr;
+    int target = 0;
+    ASSERT_ROUND_TRIP("Tag %s on reader %u", "DD:54:2A:83", 0U);
+    ASSERT_ROUND_TRIP("[%10s] [%-10s] [%.3s]", "abc", "abc", "abcdef");
+    ASSERT_ROUND_TRIP("%s|%s|%s", "", "two", "three");
+    ASSERT_ROUND_TRIP("%p", (void*)&target);
+    ASSERT_ROUND_TRIP("Mixed: %s %d %llu %.2f %c %s", "head", -1, 1ULL << 40, 0.5, 'x', "tail");
+
+    // The string is copied, so changing it after write() does not change the line
+    char buffer[16] = "before";
+    ringLog->write("Copied: %s", buffer);
+    strcpy(buffer, "after");
+    std::string copied = drained();
+    TEST_ASSERT_EQUAL_STRING("Copied: before\r\n", copied.c_str());
+
+    ringLog->write("Null: %s", missing);
+    std::string null = drained();
+    TEST_ASSERT_EQUAL_STRING("Null: (null)\r\n", null.c_str());
+}
+
+void test_arguments_beyond_the_record_end_the_line(void) {
+    // A string longer than the record is cut with "...", and what follows it is lost
+    std::string longText(2 * LOG_RECORD_SIZE, 'a');
+    ringLog->write("Long: %s, then %d", longText.c_str(), 7);
+    std::string line = drained();
+    TEST_ASSERT_EQUAL_STRING("Long: ", line.substr(0, 6).c_str());
+    TEST_ASSERT_LESS_THAN_UINT32(LOG_RECORD_SIZE + 32, line.size());
+    TEST_ASSERT_TRUE(line.find("...") != std::string::npos);
+    TEST_ASSERT_TRUE(line.find(", then 7") == std::string::npos);
+
+    // Too many numbers for the record (17 of 8 bytes in 128): the line ends at the first one missing
+    ringLog->write("%lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld",
+               1LL, 2LL, 3LL, 4LL, 5LL, 6LL, 7LL, 8LL, 9LL, 10LL, 11LL, 12LL, 13LL, 14LL, 15LL, 16LL, 17LL);
+    line = drained();
+    TEST_ASSERT_EQUAL_STRING("1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 ...\r\n", line.c_str());
+}
+
+void test_unsupported_conversions_end_the_line(void) {
+    ringLog->write("Width %*d, after", 5, 42);
+    std::string line = drained();
+    TEST_ASSERT_EQUAL_STRING("Width ...\r\n", line.c_str());
+}
+
+void test_log_task_prints_in_order(void) {
+    for (uint32_t i = 0; i < LOG_RING_SLOTS; i++) {
+        ringLog->write("Message %u", i);
+    }
+    TEST_ASSERT_TRUE(Serial.takeOutput().empty());
+
+    // Full ring: the next message is counted as dropped, the caller does not wait
+    ringLog->write("Dropped");
+    TEST_ASSERT_EQUAL_UINT32(1, ringLog->getDroppedCount());
+
+    host::runTask("log_drain", 100);
+    std::string expected;
+    for (uint32_t i = 0; i < LOG_RING_SLOTS; i++) {
+        expected += "Message " + std::to_string(i) + "\r\n";
+    }
+    expected += "Log: 1 messages dropped (ring full)\n";
+    std::string output = Serial.takeOutput();
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), output.c_str());
+    TEST_ASSERT_TRUE(ringLog->isIdle());
+}
+
+void test_caller_cost_against_formatting_in_the_caller(void) {
+    // Typical firmware lines; the ring is drained between batches so no write takes the drop path
+    const int rounds = 2000;
+    std::chrono::steady_clock::duration ringTime(0);
+    std::chrono::steady_clock::duration printTime(0);
+    for (int round = 0; round < rounds; round++) {
+        auto start = std::chrono::steady_clock::now();
+        ringLog->write("Event queued (depth %u)", (unsigned)round);
+        ringLog->write("Tag %s, %d dBm, %.1f ms", "04:A2:3B:52:6C:1D:80", -67, 12.5);
+        ringLog->write("Webhook %s answered %d after %lu ms", "primary.test", 200, (unsigned long)round);
+        ringTime += std::chrono::steady_clock::now() - start;
+        ringLog->flush();
+        Serial.takeOutput();
+
+        // What LOG_ASYNC 0 costs the caller: format and print every line
+        start = std::chrono::steady_clock::now();
+        char line[LOG_LINE_SIZE];
+        snprintf(line, sizeof(line), "Event queued (depth %u)", (unsigned)round);
+        Serial.println(line);
+        snprintf(line, sizeof(line), "Tag %s, %d dBm, %.1f ms", "04:A2:3B:52:6C:1D:80", -67, 12.5);
+        Serial.println(line);
+        snprintf(line, sizeof(line), "Webhook %s answered %d after %lu ms", "primary.test", 200, (unsigned long)round);
+        Serial.println(line);
+        printTime += std::chrono::steady_clock::now() - start;
+        Serial.takeOutput();
+    }
+
+    unsigned ringNs = std::chrono::duration_cast<std::chrono::nanoseconds>(ringTime).count() / (3 * rounds);
+    unsigned printNs = std::chrono::duration_cast<std::chrono::nanoseconds>(printTime).count() / (3 * rounds);
+    char report[120];
+    snprintf(report, sizeof(report), "caller cost per message on the host: %u ns ring, %u ns format and print",
+             ringNs, printNs);
+    TEST_MESSAGE(report);
+
+    TEST_ASSERT_EQUAL_UINT32(3 * rounds, ringLog->getWrittenCount());
+    TEST_ASSERT_EQUAL_UINT32(0, ringLog->getDroppedCount());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_integer_conversions_round_trip);
+    RUN_TEST(test_float_conversions_round_trip);
+    RUN_TEST(test_string_and_pointer_conversions_round_trip);
+    RUN_TEST(test_arguments_beyond_the_record_end_the_line);
+    RUN_TEST(test_unsupported_conversions_end_the_line);
+    RUN_TEST(test_log_task_prints_in_order);
+    RUN_TEST(test_caller_cost_against_formatting_in_the_caller);
+    return UNITY_END();
+}
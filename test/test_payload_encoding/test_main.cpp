@@ -0,0 +1,334 @@
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "test_support.h"
+#include "event_json.h"
+#include "msgpack_encoder.h"
+
+// The same events encoded as JSON and as MessagePack: what the compact payload saves, and that it loses nothing
+
+static const char* DEVICE_ID = "rfid-a1b2c3d4e5f6";
+static const uint64_t EPOCH = 1708775584123ULL;
+
+void setUp(void) {
+    resetHost();
+}
+
+void tearDown(void) {
+}
+
+static PollEvent tagEvent(uint32_t id, bool present, uint64_t epochMs, bool synced, uint8_t network) {
+    PollEvent event = makeEvent(id, present);
+    event.epochMs = epochMs;
+    event.timeSynced = synced;
+    event.networkIndex = network;
+    event.rssi = network == POLL_EVENT_NO_NETWORK ? 0 : -49;
+    return event;
+}
+
+// One of every case the payloads distinguish, time status branches included
+static std::vector<PollEvent> sampleEvents() {
+    std::vector<PollEvent> events;
+    events.push_back(tagEvent(1, true, EPOCH, true, 0));                         // Synced with NTP
+    events.push_back(tagEvent(1, false, EPOCH + 60000, true, 0));
+    events.push_back(tagEvent(2, true, EPOCH + 61000, false, 1));                // Corrected after NTP sync
+    events.push_back(tagEvent(3, true, 0, false, 0));                            // Not synced
+    events.push_back(tagEvent(4, true, 0, false, POLL_EVENT_NO_NETWORK));        // Not synced (No WiFi)
+
+    PollEvent longUid = tagEvent(5, true, EPOCH + 62000, true, 0);
+    const uint8_t uid[] = { 0x04, 0xA2, 0x3B, 0x52, 0x6C, 0x1D, 0x80 };
+    memcpy(longUid.uid, uid, sizeof(uid));
+    longUid.uidLength = sizeof(uid);
+    longUid.tagType = ISO14443_4;
+    events.push_back(longUid);
+
+    PollEvent session = tagEvent(1, false, EPOCH, true, 0);
+    session.kind = EVENT_SESSION;
+    session.durationMs = 3600000;
+    session.endEstimated = true;
+    events.push_back(session);
+    return events;
+}
+
+// The firmware's single-event path: one StaticJsonDocument<512> per event
+static size_t encodeJson(const PollEvent& event, char* buffer, size_t size) {
+    StaticJsonDocument<512> doc;
+    size_t packed = 0;
+    size_t length = encodeEventsJson(doc, &event, 1, DEVICE_ID, false, size, buffer, size, packed);
+    TEST_ASSERT_EQUAL_UINT32(1, packed);
+    return length;
+}
+
+static size_t encodeMsgPack(const PollEvent& event, uint8_t* buffer, size_t size) {
+    size_t packed = 0;
+    size_t length = encodeEventsMsgPack(&event, 1, DEVICE_ID, buffer, size, packed);
+    TEST_ASSERT_EQUAL_UINT32(1, packed);
+    return length;
+}
+
+/**
+ * Reads back the subset of MessagePack the encoder writes, the way
+ * msgpack_decoder.js does on the ingest side.
+ */
+struct MsgPackValue {
+    enum Type { NIL, BOOL, INT, STR, BIN, ARRAY, MAP } type = NIL;
+    int64_t number = 0;
+    std::string bytes;                  // STR and BIN
+    std::vector<MsgPackValue> items;    // ARRAY, and MAP as key, value, key, value...
+
+    const MsgPackValue& operator[](const char* key) const {
+        for (size_t i = 0; i + 1 < items.size(); i += 2) {
+            if (items[i].type == STR && items[i].bytes == key) {
+                return items[i + 1];
+            }
+        }
+        TEST_FAIL_MESSAGE(key);
+        return *this;
+    }
+};
+
+class MsgPackReader {
+    private:
+        const uint8_t* data;
+        size_t length;
+        size_t pos = 0;
+
+        uint64_t bigEndian(uint8_t bytes) {
+            TEST_ASSERT_LESS_OR_EQUAL_UINT32(length, pos + bytes);
+            uint64_t value = 0;
+            for (uint8_t i = 0; i < bytes; i++) {
+                value = (value << 8) | data[pos++];
+            }
+            return value;
+        }
+        void raw(MsgPackValue& value, MsgPackValue::Type type, size_t size) {
+            TEST_ASSERT_LESS_OR_EQUAL_UINT32(length, pos + size);
+            value.type = type;
+            value.bytes.assign(reinterpret_cast<const char*>(data + pos), size);
+            pos += size;
+        }
+        void children(MsgPackValue& value, MsgPackValue::Type type, size_t count) {
+            value.type = type;
+            for (size_t i = 0; i < count; i++) {
+                value.items.push_back(next());
+            }
+        }
+
+    public:
+        MsgPackReader(const uint8_t* data, size_t length) : data(data), length(length) {}
+        bool atEnd() const { return pos == length; }
+
+        MsgPackValue next() {
+            TEST_ASSERT_LESS_THAN_UINT32(length, pos);
+            uint8_t type = data[pos++];
+            MsgPackValue value;
+            value.type = MsgPackValue::INT;
+            if (type < 0x80) {
+                value.number = type;
+            } else if (type >= 0xE0) {
+                value.number = (int8_t)type;
+            } else if ((type & 0xF0) == 0x80) {
+                children(value, MsgPackValue::MAP, 2 * (type & 0x0F));
+            } else if ((type & 0xF0) == 0x90) {
+                children(value, MsgPackValue::ARRAY, type & 0x0F);
+            } else if ((type & 0xE0) == 0xA0) {
+                raw(value, MsgPackValue::STR, type & 0x1F);
+            } else if (type == 0xC0) {
+                value.type = MsgPackValue::NIL;
+            } else if (type == 0xC2 || type == 0xC3) {
+                value.type = MsgPackValue::BOOL;
+                value.number = type == 0xC3;
+            } else if (type == 0xC4) {
+                raw(value, MsgPackValue::BIN, bigEndian(1));
+            } else if (type >= 0xCC && type <= 0xCF) {
+                value.number = (int64_t)bigEndian(1 << (type - 0xCC));
+            } else if (type >= 0xD0 && type <= 0xD3) {
+                uint8_t bytes = 1 << (type - 0xD0);
+                uint64_t bits = bigEndian(bytes);
+                value.number = bytes == 8 ? (int64_t)bits : (int64_t)(bits ^ (1ULL << (8 * bytes - 1))) - (1LL << (8 * bytes - 1));
+            } else if (type == 0xD9) {
+                raw(value, MsgPackValue::STR, bigEndian(1));
+            } else if (type == 0xDC) {
+                children(value, MsgPackValue::ARRAY, bigEndian(2));
+            } else if (type == 0xDE) {
+                children(value, MsgPackValue::MAP, 2 * bigEndian(2));
+            } else {
+                TEST_FAIL_MESSAGE("MessagePack type the decoder does not know");
+            }
+            return value;
+        }
+};
+
+static MsgPackValue decode(const uint8_t* data, size_t length) {
+    MsgPackReader reader(data, length);
+    MsgPackValue payload = reader.next();
+    TEST_ASSERT_TRUE(reader.atEnd());
+    TEST_ASSERT_EQUAL(MsgPackValue::MAP, payload.type);
+    TEST_ASSERT_EQUAL_INT(MSGPACK_PAYLOAD_VERSION, payload["v"].number);
+    TEST_ASSERT_EQUAL_STRING(DEVICE_ID, payload["device_id"].bytes.c_str());
+    return payload;
+}
+
+static void assertText(const char* expected, JsonObject object, const char* key) {
+    const char* value = object[key].as<const char*>();
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(expected, value, key);
+}
+
+// Every column the JSON object fills must follow from the positional MessagePack array
+static void assertSameFields(JsonObject json, const MsgPackValue& packed) {
+    TEST_ASSERT_EQUAL(MsgPackValue::ARRAY, packed.type);
+    const std::vector<MsgPackValue>& fields = packed.items;
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(7, fields.size());
+
+    // Rebuild the event from the array alone, then render it with the firmware's own helpers
+    PollEvent event;
+    memset(&event, 0, sizeof(event));
+    int64_t eventType = fields[0].number;
+    event.kind = eventType == 2 ? EVENT_SESSION : EVENT_TAG_CHANGE;
+    event.tagPresent = eventType == 1;
+    TEST_ASSERT_EQUAL(MsgPackValue::BIN, fields[1].type);
+    event.uidLength = fields[1].bytes.size();
+    memcpy(event.uid, fields[1].bytes.data(), event.uidLength);
+    event.tagType = (TagType)fields[2].number;
+    event.epochMs = fields[3].number;
+    event.rssi = fields[4].number;
+    event.networkIndex = fields[5].number;
+    event.timeSynced = fields[6].number != 0;
+
+    char tagId[TAG_ID_TEXT_SIZE];
+    char timestamp[TIMESTAMP_TEXT_SIZE];
+    formatTagId(event.uid, event.uidLength, tagId, sizeof(tagId));
+    formatTimestamp(event.epochMs, timestamp, sizeof(timestamp));
+    assertText(tagId, json, "tag_id");
+    assertText(DEVICE_ID, json, "device_id");
+    if (event.epochMs != 0) {
+        assertText(timestamp, json, "timestamp");
+    } else {
+        TEST_ASSERT_TRUE(json["timestamp"].isNull());
+    }
+
+    if (event.kind == EVENT_SESSION) {
+        TEST_ASSERT_EQUAL_UINT32(9, fields.size());
+        assertText("session", json, "event_type");
+        TEST_ASSERT_EQUAL_UINT32(json["duration_ms"].as<uint32_t>(), fields[7].number);
+        TEST_ASSERT_EQUAL(json["end_estimated"].as<bool>(), fields[8].number != 0);
+        assertText(tagTypeName(event.tagType), json, "tag_type");
+        return;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(7, fields.size());
+    assertText(event.tagPresent ? "tag_insert" : "tag_removed", json, "event_type");
+    TEST_ASSERT_EQUAL(json["tag_present"].as<bool>(), event.tagPresent);
+    if (event.tagPresent) {
+        char wifiStatus[WIFI_STATUS_TEXT_SIZE];
+        formatWifiStatus(event, wifiStatus, sizeof(wifiStatus));
+        assertText(tagTypeName(event.tagType), json, "tag_type");
+        assertText(wifiStatus, json, "wifi_status");
+        assertText(timeStatusText(event), json, "time_status");
+    }
+}
+
+void test_single_events_carry_the_same_fields(void) {
+    std::vector<PollEvent> events = sampleEvents();
+    size_t jsonBytes = 0;
+    size_t packedBytes = 0;
+    for (const PollEvent& event : events) {
+        char json[512];
+        uint8_t packed[MSGPACK_EVENT_MAX_SIZE + 64];
+        size_t jsonLength = encodeJson(event, json, sizeof(json));
+        size_t packedLength = encodeMsgPack(event, packed, sizeof(packed));
+        TEST_ASSERT_GREATER_THAN_UINT32(0, jsonLength);
+        TEST_ASSERT_GREATER_THAN_UINT32(0, packedLength);
+        jsonBytes += jsonLength;
+        packedBytes += packedLength;
+
+        DynamicJsonDocument doc(1024);
+        TEST_ASSERT_TRUE(deserializeJson(doc, json) == DeserializationError::Ok);
+        MsgPackValue payload = decode(packed, packedLength);
+        TEST_ASSERT_EQUAL_UINT32(1, payload["events"].items.size());
+        assertSameFields(doc["rfid_poll_result"].as<JsonObject>(), payload["events"].items[0]);
+    }
+
+    char report[120];
+    snprintf(report, sizeof(report), "single events: %u bytes JSON, %u bytes MessagePack (%u%%)",
+             (unsigned)jsonBytes, (unsigned)packedBytes, (unsigned)(100 * packedBytes / jsonBytes));
+    TEST_MESSAGE(report);
+    TEST_ASSERT_LESS_THAN_UINT32(jsonBytes * 35 / 100, packedBytes);
+}
+
+void test_batches_carry_the_same_fields(void) {
+    // A backlog drain: the sample cases over and over, as many as one request holds
+    std::vector<PollEvent> sample = sampleEvents();
+    std::vector<PollEvent> events;
+    for (size_t i = 0; i < 20; i++) {
+        events.push_back(sample[i % sample.size()]);
+    }
+
+    DynamicJsonDocument scratch(2 * WEBHOOK_BATCH_MAX_BYTES + 4096);
+    std::vector<char> json(2 * WEBHOOK_BATCH_MAX_BYTES);
+    size_t jsonPacked = 0;
+    size_t jsonLength = encodeEventsJson(scratch, events.data(), events.size(), DEVICE_ID, true,
+                                         WEBHOOK_BATCH_MAX_BYTES, json.data(), json.size(), jsonPacked);
+    std::vector<uint8_t> packed(WEBHOOK_BATCH_MAX_BYTES);
+    size_t msgPacked = 0;
+    size_t packedLength = encodeEventsMsgPack(events.data(), events.size(), DEVICE_ID,
+                                              packed.data(), packed.size(), msgPacked);
+    TEST_ASSERT_EQUAL_UINT32(events.size(), msgPacked);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, jsonPacked);
+
+    DynamicJsonDocument doc(2 * WEBHOOK_BATCH_MAX_BYTES + 4096);
+    TEST_ASSERT_TRUE(deserializeJson(doc, json.data()) == DeserializationError::Ok);
+    JsonArray results = doc["rfid_poll_results"].as<JsonArray>();
+    MsgPackValue payload = decode(packed.data(), packedLength);
+    TEST_ASSERT_EQUAL_UINT32(jsonPacked, results.size());
+    for (size_t i = 0; i < jsonPacked; i++) {
+        assertSameFields(results[i].as<JsonObject>(), payload["events"].items[i]);
+    }
+
+    // Bytes per event, since the JSON batch may have stopped at the byte cap first
+    double jsonPerEvent = (double)jsonLength / jsonPacked;
+    double packedPerEvent = (double)packedLength / msgPacked;
+    char report[140];
+    snprintf(report, sizeof(report), "batch: %u events in %u bytes JSON, %u events in %u bytes MessagePack (%.0f vs %.0f per event)",
+             (unsigned)jsonPacked, (unsigned)jsonLength, (unsigned)msgPacked, (unsigned)packedLength,
+             jsonPerEvent, packedPerEvent);
+    TEST_MESSAGE(report);
+    TEST_ASSERT_TRUE(packedPerEvent < jsonPerEvent * 0.35);
+}
+
+void test_encode_time(void) {
+    std::vector<PollEvent> events = sampleEvents();
+    const int rounds = 2000;
+    char json[512];
+    uint8_t packed[MSGPACK_EVENT_MAX_SIZE + 64];
+    size_t jsonBytes = 0;
+    size_t packedBytes = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        jsonBytes += encodeJson(events[round % events.size()], json, sizeof(json));
+    }
+    auto jsonTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        packedBytes += encodeMsgPack(events[round % events.size()], packed, sizeof(packed));
+    }
+    auto packedTime = std::chrono::steady_clock::now() - start;
+
+    unsigned jsonNs = std::chrono::duration_cast<std::chrono::nanoseconds>(jsonTime).count() / rounds;
+    unsigned packedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(packedTime).count() / rounds;
+    char report[120];
+    snprintf(report, sizeof(report), "encode per event on the host: %u ns JSON, %u ns MessagePack", jsonNs, packedNs);
+    TEST_MESSAGE(report);
+    TEST_ASSERT_GREATER_THAN_UINT32(packedBytes, jsonBytes);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_events_carry_the_same_fields);
+    RUN_TEST(test_batches_carry_the_same_fields);
+    RUN_TEST(test_encode_time);
+    return UNITY_END();
+}
@@ -0,0 +1,152 @@
+#include <unity.h>
+#include "test_support.h"
+#include "poll_scheduler.h"
+#include "reader_pool.h"
+
+// PollScheduler tunables, and a benchmark of the reader pool against a fixed-rate full poll loop
+
+static const uint8_t TAG[] = { 0xDD, 0x54, 0x2A, 0x83 };
+
+void setUp(void) {
+    resetHost();
+}
+
+void tearDown(void) {
+}
+
+void test_interval_follows_presence_and_idle_time(void) {
+    PollScheduler scheduler;
+    scheduler.onPollResult(1000, POLL_FULL, true);
+    TEST_ASSERT_EQUAL(POLL_PRESENCE, scheduler.nextKind());
+    TEST_ASSERT_EQUAL_UINT32(POLL_PRESENT_INTERVAL, scheduler.currentInterval(1000));
+
+    scheduler.onPollResult(2000, POLL_PRESENCE, false);
+    TEST_ASSERT_EQUAL(POLL_FULL, scheduler.nextKind());
+    TEST_ASSERT_EQUAL_UINT32(1000, scheduler.getLastRemovalLatency());
+
+    // Fast right after the removal, then doubling every POLL_BACKOFF_STEP up to the cap
+    TEST_ASSERT_EQUAL_UINT32(POLL_FAST_INTERVAL, scheduler.currentInterval(2000 + POLL_FAST_PERIOD - 1));
+    TEST_ASSERT_EQUAL_UINT32(min(2 * POLL_FAST_INTERVAL, POLL_IDLE_MAX_INTERVAL),
+                             scheduler.currentInterval(2000 + POLL_FAST_PERIOD));
+    TEST_ASSERT_EQUAL_UINT32(min(4 * POLL_FAST_INTERVAL, POLL_IDLE_MAX_INTERVAL),
+                             scheduler.currentInterval(2000 + POLL_FAST_PERIOD + POLL_BACKOFF_STEP));
+    TEST_ASSERT_EQUAL_UINT32(POLL_IDLE_MAX_INTERVAL, scheduler.currentInterval(2000 + 24UL * 3600 * 1000));
+}
+
+void test_tag_rejecting_presence_checks_falls_back_to_full_polls(void) {
+    FakeClock clock;
+    FakeNfcReader reader;
+    reader.presenceSupported = false;
+    ReaderPool pool;
+    pool.addReader(reader, 0);
+    TEST_ASSERT_EQUAL(1, pool.begin());
+    reader.placeCard(TAG, sizeof(TAG));
+
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(pool.poll(0, clock));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, reader.presenceChecks);  // Tried once, then full polls only
+    TEST_ASSERT_EQUAL_UINT32(5, reader.fullPolls);
+}
+
+struct BenchResult {
+    uint32_t fullPolls;
+    uint32_t fullPollsWhilePresent;
+    uint32_t presenceChecks;
+    unsigned long busTime;          // ms the reader was busy
+    unsigned long removalLatency;   // ms from removal to the first poll that missed the tag
+};
+
+// A tag sits on the reader from 1 s to 50 min, then the reader idles until 1 h
+static const unsigned long INSERT_AT = 1000;
+static const unsigned long REMOVE_AT = 50UL * 60 * 1000;
+static const unsigned long BENCH_END = 60UL * 60 * 1000;
+
+static void updateCard(FakeNfcReader& reader, unsigned long now) {
+    bool wanted = now >= INSERT_AT && now < REMOVE_AT;
+    if (wanted && reader.cards.empty()) {
+        reader.placeCard(TAG, sizeof(TAG));
+    } else if (!wanted && !reader.cards.empty()) {
+        reader.removeCards();
+    }
+}
+
+static BenchResult runScheduled() {
+    FakeClock clock;
+    FakeNfcReader reader;
+    ReaderPool pool;
+    pool.addReader(reader, 0);
+    pool.begin();
+
+    BenchResult result = {};
+    bool removalSeen = false;
+    while (millis() < BENCH_END) {
+        unsigned long now = millis();
+        updateCard(reader, now);
+        if (pool.nextDue(now) < 0) {
+            host::advance(max(pool.timeUntilDue(now), 1UL));
+            continue;
+        }
+        uint32_t fullPolls = reader.fullPolls;
+        bool present = pool.poll(0, clock);
+        if (now >= INSERT_AT && now < REMOVE_AT) {
+            result.fullPollsWhilePresent += reader.fullPolls - fullPolls;
+        }
+        result.busTime += millis() - now;
+        if (!present && now >= REMOVE_AT && !removalSeen) {
+            removalSeen = true;
+            result.removalLatency = millis() - REMOVE_AT;
+        }
+    }
+    result.fullPolls = reader.fullPolls;
+    result.presenceChecks = reader.presenceChecks;
+    return result;
+}
+
+// The loop before the scheduler: a full anti-collision poll every POLL_FAST_INTERVAL
+static BenchResult runFixedRate() {
+    FakeNfcReader reader;
+    BenchResult result = {};
+    NfcTarget targets[1];
+    bool removalSeen = false;
+    while (millis() < BENCH_END) {
+        unsigned long now = millis();
+        updateCard(reader, now);
+        bool present = reader.readPassiveTargets(targets, 1, 1000) > 0;
+        result.busTime += millis() - now;
+        if (!present && now >= REMOVE_AT && !removalSeen) {
+            removalSeen = true;
+            result.removalLatency = millis() - REMOVE_AT;
+        }
+        host::advance(POLL_FAST_INTERVAL);
+    }
+    result.fullPolls = reader.fullPolls;
+    return result;
+}
+
+void test_benchmark_scheduler_against_fixed_rate_polling(void) {
+    BenchResult scheduled = runScheduled();
+    host::reset();
+    BenchResult fixed = runFixedRate();
+
+    char report[200];
+    snprintf(report, sizeof(report),
+             "1 h, tag on for 50 min: scheduled %u full + %u checks, bus %lu ms, removal %lu ms; "
+             "fixed %u full, bus %lu ms, removal %lu ms",
+             scheduled.fullPolls, scheduled.presenceChecks, scheduled.busTime, scheduled.removalLatency,
+             fixed.fullPolls, fixed.busTime, fixed.removalLatency);
+    TEST_MESSAGE(report);
+
+    // Presence checks replace full polls while the tag stays; idle polling backs off
+    TEST_ASSERT_EQUAL_UINT32(1, scheduled.fullPollsWhilePresent);
+    TEST_ASSERT_LESS_THAN_UINT32(fixed.busTime / 5, scheduled.busTime);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(POLL_PRESENT_INTERVAL + 4, scheduled.removalLatency);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_interval_follows_presence_and_idle_time);
+    RUN_TEST(test_tag_rejecting_presence_checks_falls_back_to_full_polls);
+    RUN_TEST(test_benchmark_scheduler_against_fixed_rate_polling);
+    return UNITY_END();
+}
@@ -0,0 +1,180 @@
+#include <unity.h>
+#include "test_support.h"
+#include "power_manager.h"
+#include "reader_pool.h"
+
+// PowerManager driving the fallback polling loop of main.cpp on a simulated clock
+
+static const uint8_t TAG[] = { 0x04, 0x9C, 0x31, 0x7A };
+static const int IRQ_PIN = 5;
+
+static FakeClock* fakeClock;
+static FakeSleep* fakeSleep;
+static FakeNfcReader* reader;
+static ReaderPool* pool;
+
+void setUp(void) {
+    resetHost();
+    fakeClock = new FakeClock();
+    fakeSleep = new FakeSleep();
+    reader = new FakeNfcReader();
+    pool = new ReaderPool();
+    pool->addReader(*reader, 0);
+    pool->begin();
+}
+
+void tearDown(void) {
+    delete pool;
+    delete reader;
+    delete fakeSleep;
+    delete fakeClock;
+}
+
+struct LoopTrace {
+    unsigned long detectedAt;     // First poll that saw the tag, 0 if none did
+    uint32_t pollsPoweredDown;    // Polls that found the PN532 still in PowerDown
+};
+
+// One pass of main.cpp's loop() per iteration; the tag sits on the reader during [insertAt, removeAt)
+static LoopTrace runLoop(PowerManager& power, unsigned long until, bool canSleep,
+                         unsigned long insertAt = 0, unsigned long removeAt = 0) {
+    LoopTrace trace = {};
+    while (millis() < until) {
+        unsigned long now = millis();
+        bool wanted = now >= insertAt && now < removeAt;
+        if (wanted && reader->cards.empty()) {
+            reader->placeCard(TAG, sizeof(TAG));
+        } else if (!wanted && !reader->cards.empty()) {
+            reader->removeCards();
+        }
+
+        int index = pool->nextDue(now);
+        if (index < 0) {
+            power.idle(pool->timeUntilDue(now), canSleep);
+            continue;
+        }
+        power.prepareReader(index, pool->getReader(index));
+        if (reader->poweredDown) {
+            trace.pollsPoweredDown++;
+        }
+        bool present = pool->poll(index, *fakeClock);
+        if (present && trace.detectedAt == 0) {
+            trace.detectedAt = millis();
+        }
+        power.releaseReader(index, pool->getReader(index), present);
+    }
+    return trace;
+}
+
+void test_begin_configures_low_power(void) {
+    PowerManager power(*fakeSleep, *fakeClock, IRQ_PIN, true);
+    power.begin();
+
+    TEST_ASSERT_EQUAL_UINT32(LOW_POWER_CPU_MHZ, fakeSleep->cpuFrequency);
+    TEST_ASSERT_TRUE(fakeSleep->modemSleep);
+    TEST_ASSERT_TRUE(power.isAutoSleepEnabled());
+    TEST_ASSERT_EQUAL_INT(IRQ_PIN, fakeSleep->wakePin);
+    TEST_ASSERT_FALSE(fakeSleep->allowed);  // Locked out until the loop idles
+}
+
+void test_always_on_never_sleeps(void) {
+    PowerManager power(*fakeSleep, *fakeClock, IRQ_PIN, false);
+    power.begin();
+    runLoop(power, 60000, true);
+
+    TEST_ASSERT_EQUAL_UINT32(160, fakeSleep->cpuFrequency);
+    TEST_ASSERT_FALSE(fakeSleep->modemSleep);
+    TEST_ASSERT_EQUAL_UINT32(0, fakeSleep->sleeps);
+    TEST_ASSERT_EQUAL_UINT32(0, reader->powerDowns);
+    TEST_ASSERT_EQUAL_UINT32(1000, power.getDutyCyclePermille());
+}
+
+void test_idle_reader_sleeps_between_polls_and_still_sees_tags(void) {
+    PowerManager power(*fakeSleep, *fakeClock, IRQ_PIN, true);
+    power.begin();
+
+    // Ten idle minutes, then a tag for a minute
+    const unsigned long insertAt = 10UL * 60 * 1000 + 123;
+    LoopTrace trace = runLoop(power, insertAt + 60000, true, insertAt, insertAt + 60000);
+
+    char report[120];
+    snprintf(report, sizeof(report), "11 min: %u.%u%% awake, %u waits asleep, %u.%u mA, detected after %lu ms",
+             power.getDutyCyclePermille() / 10, power.getDutyCyclePermille() % 10, fakeSleep->sleeps,
+             power.getEstimatedCurrent() / 1000, (power.getEstimatedCurrent() % 1000) / 100,
+             trace.detectedAt - insertAt);
+    TEST_MESSAGE(report);
+
+    TEST_ASSERT_EQUAL_UINT32(0, trace.pollsPoweredDown);  // Woken before every poll
+    TEST_ASSERT_GREATER_THAN_UINT32(0, reader->powerDowns);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, fakeSleep->sleeps);
+    TEST_ASSERT_FALSE(fakeSleep->allowed);
+    TEST_ASSERT_LESS_THAN_UINT32(100, power.getDutyCyclePermille());
+
+    // Sleep does not stretch the idle poll interval
+    TEST_ASSERT_NOT_EQUAL(0, trace.detectedAt);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(POLL_IDLE_MAX_INTERVAL + reader->fullPollHitTime, trace.detectedAt - insertAt);
+
+    // While the tag is on the reader the PN532 stays up for presence checks
+    TEST_ASSERT_FALSE(reader->poweredDown);
+    PowerManager alwaysOn(*fakeSleep, *fakeClock, IRQ_PIN, false);
+    TEST_ASSERT_LESS_THAN_UINT32(alwaysOn.getEstimatedCurrent(), power.getEstimatedCurrent());
+}
+
+void test_busy_device_stays_awake(void) {
+    PowerManager power(*fakeSleep, *fakeClock, IRQ_PIN, true);
+    power.begin();
+    runLoop(power, 60000, false);
+
+    TEST_ASSERT_EQUAL_UINT32(0, fakeSleep->sleeps);
+    TEST_ASSERT_EQUAL_UINT32(1000, power.getDutyCyclePermille());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, reader->powerDowns);  // Readers power down regardless
+}
+
+void test_without_auto_light_sleep_only_readers_power_down(void) {
+    fakeSleep->autoSleepSupported = false;
+    PowerManager power(*fakeSleep, *fakeClock, IRQ_PIN, true);
+    power.begin();
+    LoopTrace trace = runLoop(power, 60000, true);
+
+    TEST_ASSERT_FALSE(power.isAutoSleepEnabled());
+    TEST_ASSERT_TRUE(fakeSleep->modemSleep);
+    TEST_ASSERT_EQUAL_UINT32(0, fakeSleep->sleeps);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, reader->powerDowns);
+    TEST_ASSERT_EQUAL_UINT32(0, trace.pollsPoweredDown);
+}
+
+void test_idle_wait_bounds(void) {
+    PowerManager power(*fakeSleep, *fakeClock, IRQ_PIN, true);
+    power.begin();
+
+    // Gaps shorter than LOW_POWER_MIN_SLEEP are spent awake
+    unsigned long start = millis();
+    power.idle(LOW_POWER_MIN_SLEEP - 1, true);
+    TEST_ASSERT_EQUAL_UINT32(0, fakeSleep->sleeps);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(10, millis() - start);
+
+    // A single wait is capped at LOW_POWER_MAX_SLEEP
+    start = millis();
+    power.idle(10 * LOW_POWER_MAX_SLEEP, true);
+    TEST_ASSERT_EQUAL_UINT32(LOW_POWER_MAX_SLEEP, millis() - start);
+
+    // The PN532 IRQ ends the wait early
+    start = millis();
+    fakeSleep->wakeAt = start + 70;
+    power.idle(LOW_POWER_MAX_SLEEP, true);
+    TEST_ASSERT_EQUAL_UINT32(70, millis() - start);
+    TEST_ASSERT_EQUAL_UINT32(2, fakeSleep->sleeps);
+    TEST_ASSERT_EQUAL_UINT32(LOW_POWER_MAX_SLEEP + 70, fakeSleep->sleptTime);
+    TEST_ASSERT_FALSE(fakeSleep->allowed);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_configures_low_power);
+    RUN_TEST(test_always_on_never_sleeps);
+    RUN_TEST(test_idle_reader_sleeps_between_polls_and_still_sees_tags);
+    RUN_TEST(test_busy_device_stays_awake);
+    RUN_TEST(test_without_auto_light_sleep_only_readers_power_down);
+    RUN_TEST(test_idle_wait_bounds);
+    return UNITY_END();
+}
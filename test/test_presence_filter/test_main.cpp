@@ -0,0 +1,218 @@
+#include <unity.h>
+#include <string>
+#include "presence_filter.h"
+#include "metrics.h"
+
+// PresenceFilter is pure timing logic: every observe() carries its own timestamp
+
+static const uint8_t TAG_A[] = { 0xDD, 0x54, 0x2A, 0x83 };
+static const uint8_t TAG_B[] = { 0x04, 0xA2, 0x3B, 0x52, 0x6C, 0x1D, 0x80 };
+static const unsigned long POLL = 100;  // ms between polls in these traces
+
+static PresenceFilter* filter;
+
+void setUp(void) {
+    filter = new PresenceFilter();
+}
+
+void tearDown(void) {
+    delete filter;
+}
+
+static void seeTag(unsigned long now, const uint8_t* uid, uint8_t uidLength) {
+    filter->observe(now, true, uid, uidLength);
+}
+
+static void seeNothing(unsigned long now) {
+    filter->observe(now, false, nullptr, 0);
+}
+
+// Polls the same reading every POLL ms in [from, to)
+static void seeTagFor(unsigned long from, unsigned long to, const uint8_t* uid, uint8_t uidLength) {
+    for (unsigned long now = from; now < to; now += POLL) {
+        seeTag(now, uid, uidLength);
+    }
+}
+
+static void seeNothingFor(unsigned long from, unsigned long to) {
+    for (unsigned long now = from; now < to; now += POLL) {
+        seeNothing(now);
+    }
+}
+
+static void assertChange(unsigned long now, bool present, const uint8_t* uid, uint8_t uidLength, unsigned long at) {
+    PresenceChange change;
+    TEST_ASSERT_TRUE_MESSAGE(filter->nextChange(now, change), "expected a change");
+    TEST_ASSERT_EQUAL(present, change.present);
+    TEST_ASSERT_EQUAL_UINT8(uidLength, change.uidLength);
+    TEST_ASSERT_EQUAL_MEMORY(uid, change.uid, uidLength);
+    TEST_ASSERT_EQUAL_UINT32(at, change.at);
+}
+
+static void assertNoChange(unsigned long now) {
+    PresenceChange change;
+    TEST_ASSERT_FALSE_MESSAGE(filter->nextChange(now, change), "unexpected change");
+}
+
+// Every trace starts at 1000: the filter reserves millis() 0 for "no candidate"
+void test_confirmed_insert_is_stamped_with_its_first_poll(void) {
+    seeTagFor(1000, 1000 + PRESENCE_CONFIRM * POLL, TAG_A, sizeof(TAG_A));
+    assertChange(1000 + PRESENCE_CONFIRM * POLL, true, TAG_A, sizeof(TAG_A), 1000);
+    assertNoChange(1000 + PRESENCE_CONFIRM * POLL);
+    TEST_ASSERT_TRUE(filter->isPresent());
+}
+
+void test_removal_waits_for_hold_and_reinsert_grace(void) {
+    seeTagFor(1000, 2000, TAG_A, sizeof(TAG_A));
+    assertChange(2000, true, TAG_A, sizeof(TAG_A), 1000);
+
+    // Confirmed after PRESENCE_REMOVE_HOLD, then held back for PRESENCE_REINSERT_GRACE
+    seeNothingFor(2000, 2000 + PRESENCE_REMOVE_HOLD + POLL);
+    TEST_ASSERT_FALSE(filter->isPresent());
+    assertNoChange(2000 + PRESENCE_REINSERT_GRACE - 1);
+    assertChange(2000 + PRESENCE_REINSERT_GRACE, false, TAG_A, sizeof(TAG_A), 2000);
+    TEST_ASSERT_TRUE(filter->isIdle());
+}
+
+void test_reinsert_within_grace_cancels_both_events(void) {
+    seeTagFor(1000, 2000, TAG_A, sizeof(TAG_A));
+    assertChange(2000, true, TAG_A, sizeof(TAG_A), 1000);
+
+    unsigned long back = 2000 + PRESENCE_REMOVE_HOLD + 500;
+    seeNothingFor(2000, back);
+    seeTagFor(back, back + 1000, TAG_A, sizeof(TAG_A));
+    assertNoChange(back + PRESENCE_REINSERT_GRACE + 1000);
+    TEST_ASSERT_EQUAL_UINT32(1, filter->getReinsertsSuppressed());
+    TEST_ASSERT_TRUE(filter->tracks(TAG_A, sizeof(TAG_A)));
+}
+
+void test_single_missed_read_is_a_flap(void) {
+    seeTagFor(1000, 2000, TAG_A, sizeof(TAG_A));
+    assertChange(2000, true, TAG_A, sizeof(TAG_A), 1000);
+
+    seeNothing(2000);
+    seeTagFor(2100, 3000, TAG_A, sizeof(TAG_A));
+    assertNoChange(3000 + PRESENCE_REINSERT_GRACE + PRESENCE_REMOVE_HOLD);
+    TEST_ASSERT_EQUAL_UINT32(1, filter->getFlapsRejected());
+    TEST_ASSERT_TRUE(filter->isPresent());
+    TEST_ASSERT_EQUAL_UINT32(3, filter->getRawChanges());
+    TEST_ASSERT_EQUAL_UINT32(1, filter->getEmittedChanges());
+}
+
+void test_tag_swap_reports_removal_then_insert(void) {
+    seeTagFor(1000, 2000, TAG_A, sizeof(TAG_A));
+    assertChange(2000, true, TAG_A, sizeof(TAG_A), 1000);
+
+    // No grace for a removal caused by another tag
+    unsigned long now = 2000 + PRESENCE_CONFIRM * POLL;
+    seeTagFor(2000, now, TAG_B, sizeof(TAG_B));
+    assertChange(now, false, TAG_A, sizeof(TAG_A), 2000);
+    assertChange(now, true, TAG_B, sizeof(TAG_B), 2000);
+    assertNoChange(now + PRESENCE_REINSERT_GRACE);
+    TEST_ASSERT_FALSE(filter->tracks(TAG_A, sizeof(TAG_A)));
+}
+
+// Table traces: one character per poll ('A', 'B', '.' for no tag), POLL ms apart from 1000.
+// Events read "+A@3" for an insert of TAG_A stamped with poll 3; the trace is flushed past every hold and grace
+struct Trace {
+    const char* name;
+    const char* reads;
+    const char* events;
+};
+
+static void describe(const PresenceChange& change, std::string& events) {
+    char event[24];
+    char tag = change.uidLength == sizeof(TAG_A) && memcmp(change.uid, TAG_A, sizeof(TAG_A)) == 0 ? 'A' : 'B';
+    snprintf(event, sizeof(event), "%s%c%c@%lu", events.empty() ? "" : " ", change.present ? '+' : '-', tag,
+             (change.at - 1000) / POLL);
+    events += event;
+}
+
+// Collects after every collectEvery-th poll (0 = only at the end), the way main.cpp drains the pool
+static std::string play(const char* reads, int collectEvery) {
+    std::string events;
+    PresenceChange change;
+    unsigned long now = 1000;
+    for (int i = 0; reads[i] != '\0'; i++, now += POLL) {
+        if (reads[i] == 'A') {
+            seeTag(now, TAG_A, sizeof(TAG_A));
+        } else if (reads[i] == 'B') {
+            seeTag(now, TAG_B, sizeof(TAG_B));
+        } else {
+            seeNothing(now);
+        }
+        while (collectEvery > 0 && (i + 1) % collectEvery == 0 && filter->nextChange(now, change)) {
+            describe(change, events);
+        }
+    }
+    while (filter->nextChange(now + PRESENCE_REMOVE_HOLD + PRESENCE_REINSERT_GRACE, change)) {
+        describe(change, events);
+    }
+    return events;
+}
+
+void test_n_of_m_traces(void) {
+    if (PRESENCE_CONFIRM != 3 || PRESENCE_WINDOW != 4 || PRESENCE_INSERT_HOLD > POLL ||
+        PRESENCE_REMOVE_HOLD != 750 || PRESENCE_REINSERT_GRACE != 2000) {
+        TEST_IGNORE_MESSAGE("traces are written for 3 of 4 polls, 750 ms removal hold and 2000 ms grace");
+    }
+    const Trace traces[] = {
+        { "single read, then silence (IRQ mode)", "A", "" },
+        { "single read, then empty polls", "A...", "" },
+        { "N reads confirm an insert", "AAA", "+A@0" },
+        { "N of M reads with one miss", "AA.A", "+A@0" },
+        { "alternating reads never confirm", "A.A.A.", "" },
+        { "insert, then a removal reported once", "AAA.", "+A@0 -A@3" },
+        { "one missed read is a flap", "AAAA.AAAA", "+A@0" },
+        { "removal seen in N of M polls", "AAAA..A.", "+A@0 -A@4" },
+        { "another tag read once", "AAAABAAA", "+A@0" },
+        { "swap reports removal then insert", "AAAABBB.", "+A@0 -A@4 +B@4 -B@7" },
+        { "re-insert within the grace window", "AAAA" ".........." "AAAA.", "+A@0 -A@18" },
+        { "re-insert after the grace window",
+          "AAAA" ".........." ".........." ".........." "AAA.", "+A@0 -A@4 +A@34 -A@37" },
+    };
+    for (const Trace& trace : traces) {
+        delete filter;
+        filter = new PresenceFilter();
+        std::string events = play(trace.reads, 1);
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(trace.events, events.c_str(), trace.name);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, filter->getDroppedChanges(), trace.name);
+    }
+}
+
+void test_single_read_is_not_an_insert(void) {
+    seeTag(1000, TAG_A, sizeof(TAG_A));
+    assertNoChange(1000 + PRESENCE_INSERT_HOLD + PRESENCE_REINSERT_GRACE);
+    TEST_ASSERT_FALSE(filter->isPresent());
+    TEST_ASSERT_TRUE(filter->tracks(TAG_A, sizeof(TAG_A)));  // Still a candidate
+}
+
+void test_buffer_holds_a_skipped_collection(void) {
+    // Swaps confirm a removal and an insert in the same poll; collecting every other poll loses nothing
+    std::string events = play("AAABBBAAABBB.", 2);
+    TEST_ASSERT_EQUAL_STRING("+A@0 -A@3 +B@3 -B@6 +A@6 -A@9 +B@9 -B@12", events.c_str());
+    TEST_ASSERT_EQUAL_UINT32(0, filter->getDroppedChanges());
+}
+
+void test_overflow_is_counted(void) {
+    uint32_t droppedBefore = metrics.getCounter(COUNTER_PRESENCE_CHANGES_DROPPED);
+    std::string events = play("AAABBBAAABBB", 0);
+    TEST_ASSERT_EQUAL_STRING("+A@0 -A@3 +B@3 -B@6", events.c_str());
+    TEST_ASSERT_EQUAL_UINT32(3, filter->getDroppedChanges());
+    TEST_ASSERT_EQUAL_UINT32(3, metrics.getCounter(COUNTER_PRESENCE_CHANGES_DROPPED) - droppedBefore);
+    TEST_ASSERT_EQUAL_UINT32(4, filter->getEmittedChanges());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_confirmed_insert_is_stamped_with_its_first_poll);
+    RUN_TEST(test_removal_waits_for_hold_and_reinsert_grace);
+    RUN_TEST(test_reinsert_within_grace_cancels_both_events);
+    RUN_TEST(test_single_missed_read_is_a_flap);
+    RUN_TEST(test_tag_swap_reports_removal_then_insert);
+    RUN_TEST(test_n_of_m_traces);
+    RUN_TEST(test_single_read_is_not_an_insert);
+    RUN_TEST(test_buffer_holds_a_skipped_collection);
+    RUN_TEST(test_overflow_is_counted);
+    return UNITY_END();
+}
@@ -0,0 +1,169 @@
+#include <unity.h>
+#include "test_support.h"
+#include "reader_pool.h"
+
+// ReaderPool with three readers and two cards per reader (env:native_pool): scheduling,
+// per-reader presence, two-card pads, readers that come up late
+
+static const uint8_t CARD_A[] = { 0x04, 0x11, 0x22, 0x33 };
+static const uint8_t CARD_B[] = { 0x04, 0x44, 0x55, 0x66 };
+
+static FakeClock* fakeClock;
+static FakeNfcReader* readers;
+static ReaderPool* pool;
+
+void setUp(void) {
+    resetHost();
+    fakeClock = new FakeClock();
+    readers = new FakeNfcReader[NFC_READER_COUNT];
+    pool = new ReaderPool();
+}
+
+void tearDown(void) {
+    delete pool;
+    delete[] readers;
+    delete fakeClock;
+}
+
+static void addReaders(const uint8_t* priorities) {
+    for (uint8_t i = 0; i < NFC_READER_COUNT; i++) {
+        TEST_ASSERT_TRUE(pool->addReader(readers[i], priorities[i]));
+    }
+}
+
+// Polls whichever reader is due until `until`, as loop() does
+static void runPolls(unsigned long until) {
+    while (millis() < until) {
+        int reader = pool->nextDue(millis());
+        if (reader < 0) {
+            host::advance(max(pool->timeUntilDue(millis()), 1UL));
+            continue;
+        }
+        pool->poll(reader, *fakeClock);
+    }
+}
+
+static bool isCard(const PresenceChange& change, const uint8_t* uid) {
+    return change.uidLength == 4 && memcmp(change.uid, uid, 4) == 0;
+}
+
+void test_build_has_three_readers_with_two_cards(void) {
+    TEST_ASSERT_EQUAL(3, NFC_READER_COUNT);
+    TEST_ASSERT_EQUAL(2, NFC_MAX_TARGETS);
+
+    const uint8_t priorities[] = { 0, 0, 0 };
+    addReaders(priorities);
+    FakeNfcReader extra;
+    TEST_ASSERT_FALSE(pool->addReader(extra, 0));  // The pool holds NFC_READER_COUNT readers
+    TEST_ASSERT_EQUAL(NFC_READER_COUNT, pool->begin());
+}
+
+void test_equal_priorities_take_turns(void) {
+    const uint8_t priorities[] = { 0, 0, 0 };
+    addReaders(priorities);
+    TEST_ASSERT_EQUAL(NFC_READER_COUNT, pool->begin());
+    host::advance(POLL_IDLE_MAX_INTERVAL);
+
+    // All three are due: reader 0 first, then round robin
+    for (int i = 0; i < 6; i++) {
+        int reader = pool->nextDue(millis());
+        TEST_ASSERT_EQUAL(i % NFC_READER_COUNT, reader);
+        pool->poll(reader, *fakeClock);
+        host::advance(POLL_IDLE_MAX_INTERVAL);
+    }
+}
+
+void test_higher_priority_reader_goes_first(void) {
+    const uint8_t priorities[] = { 0, 0, 5 };
+    addReaders(priorities);
+    TEST_ASSERT_EQUAL(NFC_READER_COUNT, pool->begin());
+    host::advance(POLL_IDLE_MAX_INTERVAL);
+
+    TEST_ASSERT_EQUAL(2, pool->nextDue(millis()));
+    pool->poll(2, *fakeClock);
+    TEST_ASSERT_EQUAL(0, pool->nextDue(millis()));
+    pool->poll(0, *fakeClock);
+    TEST_ASSERT_EQUAL(1, pool->nextDue(millis()));
+}
+
+void test_changes_carry_the_reader_index(void) {
+    const uint8_t priorities[] = { 0, 0, 0 };
+    addReaders(priorities);
+    TEST_ASSERT_EQUAL(NFC_READER_COUNT, pool->begin());
+    readers[1].placeCard(CARD_A, sizeof(CARD_A));
+    runPolls(millis() + 2 * POLL_IDLE_MAX_INTERVAL);
+
+    PresenceChange change;
+    TEST_ASSERT_TRUE(pool->nextChange(millis(), change));
+    TEST_ASSERT_TRUE(change.present);
+    TEST_ASSERT_TRUE(isCard(change, CARD_A));
+    TEST_ASSERT_EQUAL(1, change.reader);
+    TEST_ASSERT_FALSE(pool->nextChange(millis(), change));
+    TEST_ASSERT_TRUE(pool->isAnyPresent());
+}
+
+void test_two_cards_on_one_pad_are_tracked_separately(void) {
+    const uint8_t priorities[] = { 0, 0, 0 };
+    addReaders(priorities);
+    TEST_ASSERT_EQUAL(NFC_READER_COUNT, pool->begin());
+    readers[0].placeCard(CARD_A, sizeof(CARD_A));
+    readers[0].placeCard(CARD_B, sizeof(CARD_B));
+    runPolls(millis() + 2 * POLL_IDLE_MAX_INTERVAL);
+
+    PresenceChange first;
+    PresenceChange second;
+    TEST_ASSERT_TRUE(pool->nextChange(millis(), first));
+    TEST_ASSERT_TRUE(pool->nextChange(millis(), second));
+    TEST_ASSERT_TRUE(first.present && second.present);
+    TEST_ASSERT_TRUE((isCard(first, CARD_A) && isCard(second, CARD_B)) ||
+                     (isCard(first, CARD_B) && isCard(second, CARD_A)));
+    TEST_ASSERT_EQUAL(0, first.reader);
+    TEST_ASSERT_EQUAL(0, second.reader);
+
+    // Card A leaves, B stays: one removal, for A only. The PN532 now reports B first
+    readers[0].removeCards();
+    readers[0].placeCard(CARD_B, sizeof(CARD_B));
+    runPolls(millis() + PRESENCE_REMOVE_HOLD + 2 * POLL_IDLE_MAX_INTERVAL);
+
+    PresenceChange removal;
+    TEST_ASSERT_TRUE(pool->nextChange(millis(), removal));
+    TEST_ASSERT_FALSE(removal.present);
+    TEST_ASSERT_TRUE(isCard(removal, CARD_A));
+    TEST_ASSERT_FALSE(pool->nextChange(millis(), removal));
+    TEST_ASSERT_TRUE(pool->isAnyPresent());
+}
+
+void test_reader_missing_at_boot_comes_up_later(void) {
+    const uint8_t priorities[] = { 0, 0, 0 };
+    addReaders(priorities);
+    readers[2].responding = false;
+    TEST_ASSERT_EQUAL(2, pool->begin());
+    TEST_ASSERT_EQUAL(2, pool->getOnlineCount());
+
+    // The other readers keep polling; the offline one is never picked
+    readers[2].placeCard(CARD_A, sizeof(CARD_A));
+    runPolls(millis() + 3 * POLL_IDLE_MAX_INTERVAL);
+    TEST_ASSERT_EQUAL_UINT32(0, readers[2].fullPolls);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, readers[0].fullPolls);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, readers[1].fullPolls);
+
+    // Retried (NFC_INIT_RETRY_INTERVAL in loop()): it joins the rotation and sees its card
+    readers[2].responding = true;
+    TEST_ASSERT_EQUAL(NFC_READER_COUNT, pool->begin());
+    runPolls(millis() + 2 * POLL_IDLE_MAX_INTERVAL);
+    PresenceChange change;
+    TEST_ASSERT_TRUE(pool->nextChange(millis(), change));
+    TEST_ASSERT_EQUAL(2, change.reader);
+    TEST_ASSERT_TRUE(isCard(change, CARD_A));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_build_has_three_readers_with_two_cards);
+    RUN_TEST(test_equal_priorities_take_turns);
+    RUN_TEST(test_higher_priority_reader_goes_first);
+    RUN_TEST(test_changes_carry_the_reader_index);
+    RUN_TEST(test_two_cards_on_one_pad_are_tracked_separately);
+    RUN_TEST(test_reader_missing_at_boot_comes_up_later);
+    return UNITY_END();
+}
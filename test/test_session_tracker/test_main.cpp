@@ -0,0 +1,208 @@
+#include <unity.h>
+#include "test_support.h"
+#include "session_tracker.h"
+
+// SessionTracker across simulated reboots: each tracker is one boot, NVS survives between them
+
+static const uint8_t TAG_A[] = { 0xDD, 0x54, 0x2A, 0x83 };
+static const uint8_t TAG_B[] = { 0x04, 0xA2, 0x3B, 0x52, 0x6C, 0x1D, 0x80 };
+static const uint32_t BOOT_1 = 0x1111;
+static const uint32_t BOOT_2 = 0x2222;
+static const uint64_t EPOCH = 1700000000000ULL;  // Wall clock at millis() 0 of the boot under test
+
+static SessionTracker* tracker;
+
+void setUp(void) {
+    resetHost();
+    tracker = new SessionTracker();
+    tracker->begin(BOOT_1, 0);
+}
+
+void tearDown(void) {
+    delete tracker;
+}
+
+// A new tracker on the same NVS, as after a power cut
+static void reboot(uint32_t bootId) {
+    delete tracker;
+    tracker = new SessionTracker();
+    tracker->begin(bootId, 0);
+}
+
+static PresenceChange change(bool present, const uint8_t* uid, uint8_t uidLength, unsigned long at) {
+    PresenceChange change;
+    memset(&change, 0, sizeof(change));
+    change.present = present;
+    memcpy(change.uid, uid, uidLength);
+    change.uidLength = uidLength;
+    change.at = at;
+    return change;
+}
+
+// onChange() with the wall clock, or without one if synced is false
+static bool insertTag(const uint8_t* uid, uint8_t uidLength, unsigned long at, bool synced, PollEvent& session) {
+    return tracker->onChange(change(true, uid, uidLength, at), synced ? EPOCH + at : 0, session);
+}
+
+static bool removeTag(const uint8_t* uid, uint8_t uidLength, unsigned long at, bool synced, PollEvent& session) {
+    return tracker->onChange(change(false, uid, uidLength, at), synced ? EPOCH + at : 0, session);
+}
+
+// The loop's update() every 100 ms in [from, to); no session may complete
+static void runUpdates(unsigned long from, unsigned long to, bool synced) {
+    PollEvent session;
+    for (unsigned long now = from; now < to; now += 100) {
+        TEST_ASSERT_FALSE(tracker->update(now, synced ? EPOCH + now : 0, session));
+    }
+}
+
+static bool readCheckpoint(SessionCheckpoint& checkpoint) {
+    Preferences prefs;
+    prefs.begin("session", true);
+    bool found = prefs.getBytes("open", &checkpoint, sizeof(checkpoint)) == sizeof(checkpoint);
+    prefs.end();
+    return found;
+}
+
+void test_short_sessions_and_swaps_cost_no_flash_writes(void) {
+    PollEvent session;
+    unsigned long now = 1000;
+    TEST_ASSERT_FALSE(insertTag(TAG_A, sizeof(TAG_A), now, true, session));
+    for (int i = 0; i < 50; i++) {
+        runUpdates(now, now + 1000, true);
+        now += 1000;
+        const uint8_t* next = i % 2 == 0 ? TAG_B : TAG_A;
+        uint8_t nextLength = i % 2 == 0 ? sizeof(TAG_B) : sizeof(TAG_A);
+        TEST_ASSERT_TRUE(insertTag(next, nextLength, now, true, session));
+        TEST_ASSERT_EQUAL_UINT32(1000, session.durationMs);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, host::nvs().writes);
+
+    // The session that stays is checkpointed once it outlived SESSION_CHECKPOINT_DELAY
+    runUpdates(now, now + SESSION_CHECKPOINT_DELAY + 100, true);
+    TEST_ASSERT_EQUAL_UINT32(1, host::nvs().writes);
+    TEST_ASSERT_EQUAL_UINT32(50, tracker->getSessionsClosed());
+}
+
+void test_checkpoints_follow_delay_then_interval(void) {
+    PollEvent session;
+    TEST_ASSERT_FALSE(insertTag(TAG_A, sizeof(TAG_A), 1000, true, session));
+    TEST_ASSERT_EQUAL_UINT32(0, host::nvs().writes);  // Nothing written while the change is published
+
+    unsigned long end = 1000 + SESSION_CHECKPOINT_DELAY + 3 * SESSION_CHECKPOINT_INTERVAL;
+    runUpdates(1000, end, true);
+    TEST_ASSERT_EQUAL_UINT32(3, tracker->getCheckpointWrites());
+    SessionCheckpoint checkpoint;
+    TEST_ASSERT_TRUE(readCheckpoint(checkpoint));
+    TEST_ASSERT_EQUAL_UINT32(BOOT_1, checkpoint.bootId);
+    TEST_ASSERT_EQUAL_UINT32(SESSION_CHECKPOINT_DELAY + 2 * SESSION_CHECKPOINT_INTERVAL, checkpoint.elapsedMs);
+    TEST_ASSERT_TRUE(checkpoint.startEpochMs == EPOCH + 1000);
+
+    // The removal closes the session and clears the checkpoint
+    TEST_ASSERT_TRUE(removeTag(TAG_A, sizeof(TAG_A), end, true, session));
+    TEST_ASSERT_EQUAL_UINT32(end - 1000, session.durationMs);
+    TEST_ASSERT_FALSE(readCheckpoint(checkpoint));
+}
+
+void test_late_sync_dates_back_to_the_start(void) {
+    PollEvent session;
+    TEST_ASSERT_FALSE(insertTag(TAG_A, sizeof(TAG_A), 1000, false, session));
+    runUpdates(1000, 5000, false);
+    TEST_ASSERT_TRUE(removeTag(TAG_A, sizeof(TAG_A), 5000, true, session));
+
+    TEST_ASSERT_EQUAL_UINT32(4000, session.durationMs);
+    TEST_ASSERT_EQUAL_UINT32(1000, session.monotonicMs);
+    TEST_ASSERT_TRUE(session.epochMs == EPOCH + 1000);
+    TEST_ASSERT_TRUE(session.timeSynced);
+}
+
+void test_resume_rewrites_the_checkpoint_for_this_boot(void) {
+    PollEvent session;
+    TEST_ASSERT_FALSE(insertTag(TAG_A, sizeof(TAG_A), 1000, true, session));
+    unsigned long cut = 1000 + SESSION_CHECKPOINT_DELAY + 500;
+    runUpdates(1000, cut, true);
+
+    // Power cut; the tag is still there when the reader comes back
+    reboot(BOOT_2);
+    TEST_ASSERT_FALSE(insertTag(TAG_A, sizeof(TAG_A), 2000, true, session));
+    TEST_ASSERT_EQUAL_UINT32(1, tracker->getSessionsResumed());
+    SessionCheckpoint checkpoint;
+    TEST_ASSERT_TRUE(readCheckpoint(checkpoint));
+    TEST_ASSERT_EQUAL_UINT32(BOOT_1, checkpoint.bootId);
+
+    runUpdates(2000, 2000 + SESSION_CHECKPOINT_DELAY + 100, true);
+    TEST_ASSERT_TRUE(readCheckpoint(checkpoint));
+    TEST_ASSERT_EQUAL_UINT32(BOOT_2, checkpoint.bootId);
+    TEST_ASSERT_EQUAL_UINT32(SESSION_CHECKPOINT_DELAY + SESSION_CHECKPOINT_DELAY, checkpoint.elapsedMs);
+
+    // Closed with the synced start from before the reboot; the downtime is not counted
+    unsigned long end = 2000 + SESSION_CHECKPOINT_DELAY + 1000;
+    TEST_ASSERT_TRUE(removeTag(TAG_A, sizeof(TAG_A), end, true, session));
+    TEST_ASSERT_EQUAL_UINT32(SESSION_CHECKPOINT_DELAY + end - 2000, session.durationMs);
+    TEST_ASSERT_TRUE(session.epochMs == EPOCH + 1000);
+    TEST_ASSERT_FALSE(session.endEstimated);
+    TEST_ASSERT_FALSE(readCheckpoint(checkpoint));
+}
+
+void test_resumed_session_without_a_synced_start_keeps_it_unknown(void) {
+    PollEvent session;
+    TEST_ASSERT_FALSE(insertTag(TAG_A, sizeof(TAG_A), 1000, false, session));
+    runUpdates(1000, 1000 + SESSION_CHECKPOINT_DELAY + 500, false);
+
+    // Synced after the reboot: this boot's clock knows nothing of the downtime
+    reboot(BOOT_2);
+    TEST_ASSERT_FALSE(insertTag(TAG_A, sizeof(TAG_A), 3000, true, session));
+    runUpdates(3000, 9000, true);
+    TEST_ASSERT_TRUE(removeTag(TAG_A, sizeof(TAG_A), 9000, true, session));
+
+    TEST_ASSERT_EQUAL_UINT32(SESSION_CHECKPOINT_DELAY + 6000, session.durationMs);
+    TEST_ASSERT_TRUE(session.epochMs == 0);
+    TEST_ASSERT_FALSE(session.timeSynced);
+    TEST_ASSERT_EQUAL_UINT32(3000, session.monotonicMs);  // This boot's part, not start minus carried time
+    TEST_ASSERT_EQUAL_UINT32(BOOT_1, session.bootId);
+    TEST_ASSERT_FALSE(resolveEventTime(session, BOOT_2, 10000, EPOCH + 10000));
+}
+
+void test_other_tag_after_reboot_closes_the_old_session_once(void) {
+    PollEvent session;
+    TEST_ASSERT_FALSE(insertTag(TAG_A, sizeof(TAG_A), 1000, true, session));
+    runUpdates(1000, 1000 + SESSION_CHECKPOINT_DELAY + 500, true);
+
+    reboot(BOOT_2);
+    TEST_ASSERT_TRUE(insertTag(TAG_B, sizeof(TAG_B), 2000, true, session));
+    TEST_ASSERT_TRUE(session.endEstimated);
+    TEST_ASSERT_EQUAL_UINT32(SESSION_CHECKPOINT_DELAY, session.durationMs);
+    TEST_ASSERT_EQUAL_MEMORY(TAG_A, session.uid, sizeof(TAG_A));
+
+    // Another reboot before TAG_B's first checkpoint must not report TAG_A again
+    reboot(BOOT_2 + 1);
+    TEST_ASSERT_FALSE(insertTag(TAG_B, sizeof(TAG_B), 2000, true, session));
+    runUpdates(2000, 2000 + SESSION_RESUME_WINDOW + 100, true);
+    TEST_ASSERT_EQUAL_UINT32(0, tracker->getSessionsClosed());
+}
+
+void test_tag_missing_after_reboot_closes_an_estimated_session(void) {
+    PollEvent session;
+    TEST_ASSERT_FALSE(insertTag(TAG_A, sizeof(TAG_A), 1000, true, session));
+    runUpdates(1000, 1000 + SESSION_CHECKPOINT_DELAY + 500, true);
+
+    reboot(BOOT_2);
+    runUpdates(0, SESSION_RESUME_WINDOW, true);
+    TEST_ASSERT_TRUE(tracker->update(SESSION_RESUME_WINDOW, EPOCH + SESSION_RESUME_WINDOW, session));
+    TEST_ASSERT_TRUE(session.endEstimated);
+    TEST_ASSERT_EQUAL_UINT32(BOOT_1, session.bootId);
+    SessionCheckpoint checkpoint;
+    TEST_ASSERT_FALSE(readCheckpoint(checkpoint));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_short_sessions_and_swaps_cost_no_flash_writes);
+    RUN_TEST(test_checkpoints_follow_delay_then_interval);
+    RUN_TEST(test_late_sync_dates_back_to_the_start);
+    RUN_TEST(test_resume_rewrites_the_checkpoint_for_this_boot);
+    RUN_TEST(test_resumed_session_without_a_synced_start_keeps_it_unknown);
+    RUN_TEST(test_other_tag_after_reboot_closes_the_old_session_once);
+    RUN_TEST(test_tag_missing_after_reboot_closes_an_estimated_session);
+    return UNITY_END();
+}
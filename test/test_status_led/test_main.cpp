@@ -0,0 +1,118 @@
+#include <unity.h>
+#include "test_support.h"
+#include "status_led.h"
+
+// StatusLed pattern task: setters never wait, patterns and error codes animate on schedule,
+// flashes and errors give the LED back to the state underneath
+
+static StatusLed* led;
+
+void setUp(void) {
+    resetHost();
+    led = new StatusLed();
+    TEST_ASSERT_TRUE(led->begin());
+}
+
+void tearDown(void) {
+    delete led;
+}
+
+// Runs the LED task until the simulated time `at`, then reads the pixel
+static uint32_t colorAt(unsigned long at) {
+    if (at > millis()) {
+        host::runTask("status_led", at - millis());
+    }
+    return led->getShownColor();
+}
+
+// Red blinks between `from` and `to`, sampled in the middle of every LED_ERROR_BLINK_INTERVAL
+static uint32_t countBlinks(unsigned long from, unsigned long to) {
+    uint32_t blinks = 0;
+    bool wasOn = false;
+    for (unsigned long t = from + LED_ERROR_BLINK_INTERVAL / 2; t < to; t += LED_ERROR_BLINK_INTERVAL) {
+        bool on = colorAt(t) == COLOR_ERROR;
+        blinks += on && !wasOn;
+        wasOn = on;
+    }
+    return blinks;
+}
+
+void test_setters_never_wait_for_the_led(void) {
+    unsigned long start = millis();
+    led->setPattern(LED_PATTERN_CONNECTED);
+    led->setError(LED_ERROR_NFC);
+    led->flash(COLOR_TIME_SYNC, LED_SYNC_FLASH_DURATION);
+    led->clearError(LED_ERROR_NFC);
+    TEST_ASSERT_EQUAL_UINT32(start, millis());  // Only state was stored; the task does the rest
+
+    TEST_ASSERT_EQUAL(LED_PATTERN_CONNECTED, led->getPattern());
+    TEST_ASSERT_EQUAL_UINT32(0, led->getErrors());
+}
+
+void test_connecting_blinks_and_connected_holds(void) {
+    unsigned long start = millis();
+    TEST_ASSERT_EQUAL_HEX32(COLOR_WIFI_CONNECTING, colorAt(start + LED_SLOW_BLINK_INTERVAL / 2));
+    TEST_ASSERT_EQUAL_HEX32(0, colorAt(start + LED_SLOW_BLINK_INTERVAL * 3 / 2));
+    TEST_ASSERT_EQUAL_HEX32(COLOR_WIFI_CONNECTING, colorAt(start + LED_SLOW_BLINK_INTERVAL * 5 / 2));
+
+    led->setPattern(LED_PATTERN_CONNECTED);
+    TEST_ASSERT_EQUAL_HEX32(COLOR_WIFI_CONNECTED, colorAt(millis() + 1));
+    TEST_ASSERT_EQUAL_HEX32(COLOR_WIFI_CONNECTED, colorAt(millis() + 10 * LED_SLOW_BLINK_INTERVAL));
+}
+
+void test_error_code_blinks_its_number_and_recovers(void) {
+    led->setPattern(LED_PATTERN_TAG_PRESENT);
+    led->setError(LED_ERROR_WIFI_CONFIG);
+
+    // One sequence: three blinks, then the pause
+    const unsigned long sequence = (2 * LED_ERROR_WIFI_CONFIG - 1) * LED_ERROR_BLINK_INTERVAL + LED_ERROR_SEQUENCE_PAUSE;
+    unsigned long start = millis();
+    TEST_ASSERT_EQUAL_UINT32(LED_ERROR_WIFI_CONFIG, countBlinks(start, start + sequence));
+    TEST_ASSERT_EQUAL_UINT32(LED_ERROR_WIFI_CONFIG, countBlinks(start + sequence, start + 2 * sequence));
+
+    // Cleared by the module that raised it: back to the pattern, nothing to reboot
+    led->clearError(LED_ERROR_WIFI_CONFIG);
+    TEST_ASSERT_EQUAL_HEX32(COLOR_TAG_PRESENT, colorAt(millis() + 1));
+    TEST_ASSERT_EQUAL_UINT32(0, led->getErrors());
+}
+
+void test_lowest_error_code_is_shown_first(void) {
+    led->setError(LED_ERROR_NO_NETWORK);
+    led->setError(LED_ERROR_NFC);
+
+    const unsigned long nfcSequence = LED_ERROR_BLINK_INTERVAL + LED_ERROR_SEQUENCE_PAUSE;
+    unsigned long start = millis();
+    TEST_ASSERT_EQUAL_UINT32(1, countBlinks(start, start + nfcSequence));
+
+    led->clearError(LED_ERROR_NFC);
+    const unsigned long networkSequence = 3 * LED_ERROR_BLINK_INTERVAL + LED_ERROR_SEQUENCE_PAUSE;
+    start = millis();
+    TEST_ASSERT_EQUAL_UINT32(2, countBlinks(start, start + networkSequence));
+}
+
+void test_flash_returns_to_the_current_state(void) {
+    led->setPattern(LED_PATTERN_CONNECTED);
+    colorAt(millis() + 1);
+
+    led->flash(COLOR_TIME_SYNC, LED_SYNC_FLASH_DURATION);
+    unsigned long start = millis();
+    TEST_ASSERT_EQUAL_HEX32(COLOR_TIME_SYNC, colorAt(start + LED_SYNC_FLASH_DURATION / 2));
+    TEST_ASSERT_EQUAL_HEX32(COLOR_WIFI_CONNECTED, colorAt(start + LED_SYNC_FLASH_DURATION + 1));
+
+    // A flash also shows over an error, which comes back afterwards
+    led->setError(LED_ERROR_NFC);
+    led->flash(COLOR_TIME_SYNC, LED_SYNC_FLASH_DURATION);
+    start = millis();
+    TEST_ASSERT_EQUAL_HEX32(COLOR_TIME_SYNC, colorAt(start + LED_SYNC_FLASH_DURATION / 2));
+    TEST_ASSERT_EQUAL_HEX32(COLOR_ERROR, colorAt(start + LED_SYNC_FLASH_DURATION + LED_ERROR_BLINK_INTERVAL / 2));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_setters_never_wait_for_the_led);
+    RUN_TEST(test_connecting_blinks_and_connected_holds);
+    RUN_TEST(test_error_code_blinks_its_number_and_recovers);
+    RUN_TEST(test_lowest_error_code_is_shown_first);
+    RUN_TEST(test_flash_returns_to_the_current_state);
+    return UNITY_END();
+}
@@ -0,0 +1,273 @@
+#include <unity.h>
+#include <chrono>
+#include "test_support.h"
+
+// TagCache on a 10k-tag table: lookups straight from the fake SPIFFS, a delta sync merged into it,
+// and the bytes a full sync of 10k tags moves against a delta sync
+
+static const uint32_t TAG_COUNT = 10000;
+static const uint64_t TABLE_VERSION = 42;
+
+static DeviceRig* rig;
+
+void setUp(void) {
+    resetHost();
+    rig = new DeviceRig();
+    TEST_ASSERT_TRUE(rig->begin());  // Mounts SPIFFS
+}
+
+void tearDown(void) {
+    delete rig;
+}
+
+// Tag i has the 4-byte UID 2i + 2; odd UIDs are never in the table
+static TagCacheEntry tagEntry(uint32_t i) {
+    TagCacheEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    uint32_t id = 2 * i + 2;
+    entry.uid[0] = id >> 24;
+    entry.uid[1] = id >> 16;
+    entry.uid[2] = id >> 8;
+    entry.uid[3] = id;
+    entry.uidLength = 4;
+    entry.assignmentId = i % 5 == 0 ? 0 : 1000 + i;  // Every fifth tag is listed without a project
+    return entry;
+}
+
+// The table a full sync would have written: header, then the entries sorted by UID
+static void writeTable(uint32_t count) {
+    File file = SPIFFS.open("/tags.bin", FILE_WRITE);
+    TagCacheHeader header = { TAG_CACHE_MAGIC, count, TABLE_VERSION };
+    file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+    for (uint32_t i = 0; i < count; i++) {
+        TagCacheEntry entry = tagEntry(i);
+        file.write(reinterpret_cast<const uint8_t*>(&entry), sizeof(entry));
+    }
+    file.close();
+}
+
+static uint32_t binarySearchSteps(uint32_t count) {
+    uint32_t steps = 0;
+    while (count > 0) {
+        count /= 2;
+        steps++;
+    }
+    return steps;
+}
+
+void test_10k_tag_lookups_stay_logarithmic(void) {
+    writeTable(TAG_COUNT);
+    TEST_ASSERT_TRUE(rig->tagCache.begin());
+    TEST_ASSERT_TRUE(rig->tagCache.isLoaded());
+    TEST_ASSERT_EQUAL_UINT32(TAG_COUNT, rig->tagCache.getCount());
+
+    uint32_t maxReads = 0;
+    uint32_t totalReads = 0;
+    uint32_t assigned = 0;
+    uint32_t opens = SPIFFS.getOpens();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < TAG_COUNT; i++) {
+        TagCacheEntry expected = tagEntry(i);
+        uint32_t reads = SPIFFS.getReads();
+        uint32_t assignmentId = 0xFFFFFFFF;
+        TagAssignment result = rig->tagCache.lookup(expected.uid, expected.uidLength, assignmentId);
+        reads = SPIFFS.getReads() - reads;
+
+        TEST_ASSERT_EQUAL(expected.assignmentId != 0 ? ASSIGNMENT_ASSIGNED : ASSIGNMENT_UNASSIGNED, result);
+        TEST_ASSERT_EQUAL_UINT32(expected.assignmentId, assignmentId);
+        assigned += result == ASSIGNMENT_ASSIGNED;
+        maxReads = max(maxReads, reads);
+        totalReads += reads;
+    }
+    double hostNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_EQUAL_UINT32(TAG_COUNT - TAG_COUNT / 5, assigned);
+    TEST_ASSERT_EQUAL_UINT32(0, SPIFFS.getOpens() - opens);  // The table stays open between syncs, no entry in RAM
+
+    // Tags the table does not know cost the full search, never more
+    uint32_t unknownMaxReads = 0;
+    for (uint32_t i = 0; i < 1000; i++) {
+        uint8_t uid[4] = { 0, 0, (uint8_t)((2 * i * 7 + 1) >> 8), (uint8_t)(2 * i * 7 + 1) };
+        uint32_t reads = SPIFFS.getReads();
+        uint32_t assignmentId = 0xFFFFFFFF;
+        TEST_ASSERT_EQUAL(ASSIGNMENT_UNKNOWN, rig->tagCache.lookup(uid, sizeof(uid), assignmentId));
+        TEST_ASSERT_EQUAL_UINT32(0, assignmentId);
+        unknownMaxReads = max(unknownMaxReads, SPIFFS.getReads() - reads);
+    }
+
+    char report[160];
+    snprintf(report, sizeof(report),
+             "%u tags: %u.%02u reads per hit, up to %u (miss %u), no opens; %u ns per lookup on the host",
+             TAG_COUNT, totalReads / TAG_COUNT, (totalReads % TAG_COUNT) * 100 / TAG_COUNT, maxReads,
+             unknownMaxReads, (unsigned)(hostNs / TAG_COUNT));
+    TEST_MESSAGE(report);
+
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(binarySearchSteps(TAG_COUNT), maxReads);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(binarySearchSteps(TAG_COUNT), unknownMaxReads);
+}
+
+void test_lookup_without_a_table_is_not_checked(void) {
+    TEST_ASSERT_TRUE(rig->tagCache.begin());
+    TagCacheEntry entry = tagEntry(1);
+    uint32_t assignmentId = 0xFFFFFFFF;
+    uint32_t opens = SPIFFS.getOpens();
+    TEST_ASSERT_EQUAL(ASSIGNMENT_NOT_CHECKED, rig->tagCache.lookup(entry.uid, entry.uidLength, assignmentId));
+    TEST_ASSERT_EQUAL_UINT32(0, assignmentId);
+    TEST_ASSERT_EQUAL_UINT32(opens, SPIFFS.getOpens());  // Not even an open before the first sync
+}
+
+void test_delta_sync_merges_into_the_10k_table(void) {
+    writeTable(TAG_COUNT);
+    TEST_ASSERT_TRUE(rig->tagCache.begin());
+    TEST_ASSERT_TRUE(rig->connect());
+
+    // One page: a tag gets a project, one is deleted, one is new
+    TagCacheEntry moved = tagEntry(5000);
+    TagCacheEntry deleted = tagEntry(7);
+    uint8_t added[4] = { 0, 0, 0, 3 };
+    char movedId[TAG_ID_TEXT_SIZE];
+    char deletedId[TAG_ID_TEXT_SIZE];
+    char addedId[TAG_ID_TEXT_SIZE];
+    formatTagId(moved.uid, moved.uidLength, movedId, sizeof(movedId));
+    formatTagId(deleted.uid, deleted.uidLength, deletedId, sizeof(deletedId));
+    formatTagId(added, sizeof(added), addedId, sizeof(addedId));
+    char page[512];
+    snprintf(page, sizeof(page),
+             "{\"version\":43,\"more\":false,\"assignments\":["
+             "{\"id\":77,\"tag_id\":\"%s\",\"assigned\":true},"
+             "{\"id\":8,\"tag_id\":\"%s\",\"assigned\":true,\"removed\":true},"
+             "{\"id\":99,\"tag_id\":\"%s\",\"assigned\":true}]}",
+             movedId, deletedId, addedId);
+    rig->primary.responseBody = page;
+
+    TEST_ASSERT_TRUE(rig->tagCache.syncIfDue(rig->webhook, "test-device"));
+    TEST_ASSERT_EQUAL_UINT32(TAG_COUNT, rig->tagCache.getCount());
+    TEST_ASSERT_TRUE(rig->tagCache.getVersion() == 43);
+
+    uint32_t assignmentId = 0;
+    TEST_ASSERT_EQUAL(ASSIGNMENT_ASSIGNED, rig->tagCache.lookup(moved.uid, moved.uidLength, assignmentId));
+    TEST_ASSERT_EQUAL_UINT32(77, assignmentId);
+    TEST_ASSERT_EQUAL(ASSIGNMENT_UNKNOWN, rig->tagCache.lookup(deleted.uid, deleted.uidLength, assignmentId));
+    TEST_ASSERT_EQUAL(ASSIGNMENT_ASSIGNED, rig->tagCache.lookup(added, sizeof(added), assignmentId));
+    TEST_ASSERT_EQUAL_UINT32(99, assignmentId);
+
+    // Every other tag came through the merge untouched
+    for (uint32_t i = 0; i < TAG_COUNT; i += 37) {
+        TagCacheEntry expected = tagEntry(i);
+        if (i == 5000 || i == 7) {
+            continue;
+        }
+        rig->tagCache.lookup(expected.uid, expected.uidLength, assignmentId);
+        TEST_ASSERT_EQUAL_UINT32(expected.assignmentId, assignmentId);
+    }
+}
+
+// Server side of the assignment sync: rows ordered by version, answered a page at a time
+struct AssignmentServer {
+    struct Row {
+        uint64_t version;
+        TagCacheEntry entry;
+        bool removed;
+    };
+    std::vector<Row> rows;
+
+    void change(const TagCacheEntry& entry, bool removed) {
+        rows.push_back({ rows.size() + 1, entry, removed });
+    }
+
+    std::string page(const std::string& request) {
+        StaticJsonDocument<256> query;
+        if (deserializeJson(query, request)) {
+            return "";
+        }
+        uint64_t since = query["assignments_since"].as<uint64_t>();
+        size_t limit = query["limit"].as<size_t>();
+
+        std::string body;
+        uint64_t pageVersion = since;
+        size_t listed = 0;
+        size_t i = since;  // Row n has version n + 1
+        for (; i < rows.size() && listed < limit; i++, listed++) {
+            const Row& row = rows[i];
+            char tagId[TAG_ID_TEXT_SIZE];
+            formatTagId(row.entry.uid, row.entry.uidLength, tagId, sizeof(tagId));
+            char item[128];
+            snprintf(item, sizeof(item), "%s{\"id\":%u,\"tag_id\":\"%s\",\"assigned\":%s%s}",
+                     listed > 0 ? "," : "", (unsigned)row.entry.assignmentId,
+                     tagId, row.entry.assignmentId != 0 ? "true" : "false", row.removed ? ",\"removed\":true" : "");
+            body += item;
+            pageVersion = row.version;
+        }
+        char head[64];
+        snprintf(head, sizeof(head), "{\"version\":%llu,\"more\":%s,\"assignments\":[",
+                 (unsigned long long)pageVersion, i < rows.size() ? "true" : "false");
+        return head + body + "]}";
+    }
+};
+
+struct SyncTraffic {
+    uint32_t requests;
+    size_t bytes;       // Request and response payloads
+};
+
+// Syncs until the cache holds every version the server has
+static SyncTraffic syncAll(AssignmentServer& server) {
+    FakeSink& sink = rig->primary;
+    uint32_t requests = sink.received;
+    size_t bytes = sink.bytesReceived + sink.bytesSent;
+    for (int i = 0; i < 1000 && rig->tagCache.getVersion() < server.rows.size(); i++) {
+        TEST_ASSERT_TRUE(rig->tagCache.syncIfDue(rig->webhook, "test-device"));
+    }
+    TEST_ASSERT_TRUE(rig->tagCache.getVersion() == server.rows.size());
+    return { sink.received - requests, sink.bytesReceived + sink.bytesSent - bytes };
+}
+
+void test_full_sync_against_delta_sync_bytes(void) {
+    TEST_ASSERT_TRUE(rig->tagCache.begin());
+    TEST_ASSERT_TRUE(rig->connect());
+    AssignmentServer server;
+    rig->primary.respond = [&server](const std::string& request) { return server.page(request); };
+
+    // First boot: every tag comes down, TAG_CACHE_SYNC_PAGE per request
+    for (uint32_t i = 0; i < TAG_COUNT; i++) {
+        server.change(tagEntry(i), false);
+    }
+    SyncTraffic full = syncAll(server);
+    TEST_ASSERT_EQUAL_UINT32(TAG_COUNT, rig->tagCache.getCount());
+
+    // Ten minutes later 40 tags changed project and 10 were deleted
+    const uint32_t moved = 40;
+    const uint32_t deleted = 10;
+    for (uint32_t i = 0; i < moved + deleted; i++) {
+        TagCacheEntry entry = tagEntry(i * 197);
+        entry.assignmentId = 90000 + i;
+        server.change(entry, i >= moved);
+    }
+    host::advance(TAG_CACHE_SYNC_INTERVAL);
+    SyncTraffic delta = syncAll(server);
+    TEST_ASSERT_EQUAL_UINT32(TAG_COUNT - deleted, rig->tagCache.getCount());
+
+    uint32_t assignmentId = 0;
+    TagCacheEntry movedTag = tagEntry(197);
+    TagCacheEntry deletedTag = tagEntry(moved * 197);
+    TEST_ASSERT_EQUAL(ASSIGNMENT_ASSIGNED, rig->tagCache.lookup(movedTag.uid, movedTag.uidLength, assignmentId));
+    TEST_ASSERT_EQUAL_UINT32(90001, assignmentId);
+    TEST_ASSERT_EQUAL(ASSIGNMENT_UNKNOWN, rig->tagCache.lookup(deletedTag.uid, deletedTag.uidLength, assignmentId));
+
+    char report[160];
+    snprintf(report, sizeof(report), "%u tags: full sync %u requests, %u bytes; delta of %u changes %u requests, %u bytes",
+             TAG_COUNT, full.requests, (unsigned)full.bytes, moved + deleted, delta.requests, (unsigned)delta.bytes);
+    TEST_MESSAGE(report);
+
+    TEST_ASSERT_EQUAL_UINT32((TAG_COUNT + TAG_CACHE_SYNC_PAGE - 1) / TAG_CACHE_SYNC_PAGE, full.requests);
+    TEST_ASSERT_EQUAL_UINT32((moved + deleted + TAG_CACHE_SYNC_PAGE - 1) / TAG_CACHE_SYNC_PAGE, delta.requests);
+    TEST_ASSERT_LESS_THAN_UINT32(full.bytes / 100, delta.bytes);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_10k_tag_lookups_stay_logarithmic);
+    RUN_TEST(test_lookup_without_a_table_is_not_checked);
+    RUN_TEST(test_delta_sync_merges_into_the_10k_table);
+    RUN_TEST(test_full_sync_against_delta_sync_bytes);
+    return UNITY_END();
+}
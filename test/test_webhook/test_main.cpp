@@ -0,0 +1,145 @@
+#include <unity.h>
+#include "test_support.h"
+
+// WebhookManager against two simulated receivers (see test/host/credentials.h)
+
+static FakeClock* fakeClock;
+static FakeHttpTransport* transport;
+static WebhookManager* webhook;
+
+void setUp(void) {
+    resetHost();
+    fakeClock = new FakeClock();
+    transport = new FakeHttpTransport();
+    transport->sink("primary.test");
+    transport->sink("backup.test");
+    webhook = new WebhookManager(*transport, *fakeClock);
+}
+
+void tearDown(void) {
+    delete webhook;
+    delete transport;
+    delete fakeClock;
+}
+
+void test_endpoints_are_parsed_from_the_urls(void) {
+    TEST_ASSERT_EQUAL(2, webhook->getEndpointCount());
+    const WebhookEndpoint& primary = webhook->getEndpoint(0);
+    TEST_ASSERT_EQUAL_STRING("primary.test", primary.host.c_str());
+    TEST_ASSERT_EQUAL(5678, primary.port);
+    TEST_ASSERT_EQUAL_STRING("/webhook/tags", primary.path.c_str());
+    TEST_ASSERT_FALSE(primary.hostIsIP);
+}
+
+void test_event_is_posted_as_json(void) {
+    TEST_ASSERT_TRUE(webhook->sendPollResult(makeEvent(42), "test-device"));
+
+    FakeSink& primary = transport->sink("primary.test");
+    TEST_ASSERT_EQUAL(1, primary.bodies.size());
+    TEST_ASSERT_EQUAL_STRING(WEBHOOK_CONTENT_TYPE, transport->lastContentType.c_str());
+
+    DynamicJsonDocument doc(1024);
+    TEST_ASSERT_TRUE(deserializeJson(doc, primary.bodies[0].c_str()) == DeserializationError::Ok);
+    TEST_ASSERT_EQUAL_STRING("test-device", doc["rfid_poll_result"]["device_id"].as<const char*>());
+    TEST_ASSERT_EQUAL_UINT32(42, eventId(doc["rfid_poll_result"]["tag_id"].as<const char*>()));
+    TEST_ASSERT_TRUE(doc["rfid_poll_result"]["tag_present"].as<bool>());
+    TEST_ASSERT_TRUE(transport->sink("backup.test").bodies.empty());
+}
+
+void test_keep_alive_connection_and_dns_are_reused(void) {
+    for (uint32_t id = 1; id <= 5; id++) {
+        TEST_ASSERT_TRUE(webhook->sendPollResult(makeEvent(id), "test-device"));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, transport->connects);
+    TEST_ASSERT_EQUAL_UINT32(1, transport->resolves);
+    TEST_ASSERT_TRUE(webhook->getLastTiming().connectionReused);
+    TEST_ASSERT_TRUE(deliveredIds(transport->sink("primary.test")) == idRange(1, 5));
+}
+
+void test_closed_connection_is_reopened(void) {
+    transport->sink("primary.test").keepAlive = false;
+    for (uint32_t id = 1; id <= 3; id++) {
+        TEST_ASSERT_TRUE(webhook->sendPollResult(makeEvent(id), "test-device"));
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, transport->connects);
+    TEST_ASSERT_EQUAL_UINT32(1, transport->resolves);  // DNS stays cached for DNS_CACHE_TTL
+    TEST_ASSERT_FALSE(webhook->getLastTiming().connectionReused);
+}
+
+void test_server_errors_fail_the_send(void) {
+    transport->sink("primary.test").status = 500;
+    transport->sink("backup.test").status = 503;
+
+    TEST_ASSERT_FALSE(webhook->sendPollResult(makeEvent(1), "test-device"));
+    TEST_ASSERT_EQUAL_UINT32(1, webhook->getEndpoint(0).failureCount);
+    TEST_ASSERT_EQUAL_UINT32(1, webhook->getEndpoint(1).failureCount);
+}
+
+void test_unreachable_primary_fails_over_to_backup(void) {
+    transport->sink("primary.test").down = true;
+
+    TEST_ASSERT_TRUE(webhook->sendPollResult(makeEvent(7), "test-device"));
+    TEST_ASSERT_EQUAL_UINT32(1, webhook->getFailoverCount());
+    TEST_ASSERT_TRUE(deliveredIds(transport->sink("backup.test")) == idRange(7, 1));
+    TEST_ASSERT_TRUE(transport->sink("primary.test").bodies.empty());
+}
+
+struct SendStats {
+    uint32_t posts;
+    size_t bytes;           // Request payloads
+    unsigned long time;     // ms, connection and POST round trips
+};
+
+static SendStats sendAll(uint32_t events, size_t batchSize) {
+    FakeSink& primary = transport->sink("primary.test");
+    uint32_t posts = primary.received;
+    size_t bytes = primary.bytesReceived;
+    unsigned long start = millis();
+
+    std::vector<PollEvent> pending;
+    for (uint32_t id = 1; id <= events; id++) {
+        pending.push_back(makeEvent(id));
+    }
+    size_t sent = 0;
+    while (sent < pending.size()) {
+        size_t count = min(batchSize, pending.size() - sent);
+        size_t delivered = batchSize == 1 ? (webhook->sendPollResult(pending[sent], "test-device") ? 1 : 0)
+                                          : webhook->sendPollResults(&pending[sent], count, "test-device");
+        TEST_ASSERT_GREATER_THAN_UINT32(0, delivered);
+        sent += delivered;
+    }
+    return { primary.received - posts, primary.bytesReceived - bytes, millis() - start };
+}
+
+void test_batched_posts_against_single_posts(void) {
+    const uint32_t events = 256;
+    const size_t batchSize = 16;
+    SendStats single = sendAll(events, 1);
+    SendStats batched = sendAll(events, batchSize);
+
+    char report[220];
+    snprintf(report, sizeof(report),
+             "%u events: single %u POSTs, %u bytes/event, %lu events/s; "
+             "batches of %u: %u POSTs, %u bytes/event, %lu events/s (+ up to %d ms batch window)",
+             events, single.posts, (unsigned)(single.bytes / events), events * 1000UL / single.time,
+             (unsigned)batchSize, batched.posts, (unsigned)(batched.bytes / events), events * 1000UL / batched.time,
+             WEBHOOK_BATCH_WINDOW);
+    TEST_MESSAGE(report);
+
+    TEST_ASSERT_EQUAL_UINT32(events, single.posts);
+    TEST_ASSERT_EQUAL_UINT32(events / batchSize, batched.posts);
+    TEST_ASSERT_LESS_THAN_UINT32(single.time / 5, batched.time);
+    TEST_ASSERT_LESS_THAN_UINT32(single.bytes, batched.bytes);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_endpoints_are_parsed_from_the_urls);
+    RUN_TEST(test_event_is_posted_as_json);
+    RUN_TEST(test_keep_alive_connection_and_dns_are_reused);
+    RUN_TEST(test_closed_connection_is_reopened);
+    RUN_TEST(test_server_errors_fail_the_send);
+    RUN_TEST(test_unreachable_primary_fails_over_to_backup);
+    RUN_TEST(test_batched_posts_against_single_posts);
+    return UNITY_END();
+}
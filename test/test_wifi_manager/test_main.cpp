@@ -0,0 +1,159 @@
+#include <unity.h>
+#include "test_support.h"
+#include <esp_sntp.h>
+
+// WiFiManager on the simulated station, with SNTP syncs fired by the test
+
+static FakeClock* fakeClock;
+static FakeNetwork* network;
+static WiFiManager* wifi;
+
+void setUp(void) {
+    resetHost();
+    fakeClock = new FakeClock();
+    network = new FakeNetwork();
+    network->inRange.push_back(WIFI_NETWORKS[0].ssid);
+    wifi = new WiFiManager(*network, *fakeClock);
+}
+
+void tearDown(void) {
+    delete wifi;
+    delete network;
+    delete fakeClock;
+}
+
+static bool connect() {
+    if (wifi->getState() == WIFI_STATE_IDLE) {
+        wifi->begin();
+    }
+    for (int i = 0; i < 10 && !wifi->isConnected(); i++) {
+        wifi->update();
+    }
+    return wifi->isConnected();
+}
+
+static const uint64_t EPOCH_MS = 1767225600000ULL;  // 2026-01-01
+
+// Software reset: NVS and the system clock survive. A power cycle also resets the clock
+static void reboot(bool powerCycle) {
+    delete wifi;
+    delete network;
+    if (powerCycle) {
+        host::setWallClock(0);
+    }
+    network = new FakeNetwork();
+    network->inRange.push_back(WIFI_NETWORKS[0].ssid);
+    wifi = new WiFiManager(*network, *fakeClock);
+}
+
+// First boot: scan and DHCP, then NTP dates the lease
+static void firstBootWithLease() {
+    TEST_ASSERT_TRUE(connect());
+    TEST_ASSERT_EQUAL_UINT32(1, network->scans);
+    TEST_ASSERT_FALSE(network->staticIp);
+    host::sntpSync(EPOCH_MS);
+    wifi->update();
+    TEST_ASSERT_TRUE(wifi->isTimeSynced());
+}
+
+void test_fresh_cached_lease_skips_scan_and_dhcp(void) {
+    firstBootWithLease();
+    host::advance(60000);
+    reboot(false);
+
+    TEST_ASSERT_TRUE(connect());
+    TEST_ASSERT_EQUAL_UINT32(0, network->scans);
+    TEST_ASSERT_EQUAL_UINT32(1, network->directJoins);
+    TEST_ASSERT_TRUE(network->staticIp);
+    TEST_ASSERT_EQUAL_UINT32(network->ip, network->staticLease.ip);
+}
+
+void test_expired_lease_falls_back_to_dhcp(void) {
+    firstBootWithLease();
+    host::advance(WIFI_STATIC_IP_MAX_AGE);
+    reboot(false);
+
+    TEST_ASSERT_TRUE(connect());
+    TEST_ASSERT_EQUAL_UINT32(1, network->directJoins);  // Still no scan
+    TEST_ASSERT_FALSE(network->staticIp);
+
+    // The new lease is stamped at once, the clock is valid
+    host::advance(60000);
+    reboot(false);
+    TEST_ASSERT_TRUE(connect());
+    TEST_ASSERT_TRUE(network->staticIp);
+}
+
+void test_lease_age_unknown_after_power_cycle(void) {
+    firstBootWithLease();
+    reboot(true);
+
+    TEST_ASSERT_TRUE(connect());
+    TEST_ASSERT_EQUAL_UINT32(1, network->directJoins);
+    TEST_ASSERT_FALSE(network->staticIp);
+}
+
+void test_lease_obtained_before_time_sync_is_not_reused(void) {
+    TEST_ASSERT_TRUE(connect());
+    reboot(false);
+    TEST_ASSERT_TRUE(connect());
+    TEST_ASSERT_FALSE(network->staticIp);
+}
+
+void test_moved_access_point_falls_back_to_scan(void) {
+    firstBootWithLease();
+    reboot(false);
+    network->channel = 11;
+
+    wifi->begin();
+    for (int i = 0; i < 10 && !wifi->isConnected(); i++) {
+        host::advance(WIFI_FAST_CONNECT_TIMEOUT);
+        wifi->update();
+    }
+    TEST_ASSERT_TRUE(wifi->isConnected());
+    TEST_ASSERT_EQUAL_UINT32(1, network->scans);
+    TEST_ASSERT_FALSE(network->staticIp);
+}
+
+void test_sntp_resync_measures_clock_drift(void) {
+    const uint64_t epochMs = EPOCH_MS;
+    TEST_ASSERT_TRUE(connect());
+    wifi->syncTime();
+    TEST_ASSERT_FALSE(wifi->isTimeSynced());
+
+    host::sntpSync(epochMs + millis());
+    wifi->update();
+    TEST_ASSERT_TRUE(wifi->isTimeSynced());
+    TEST_ASSERT_EQUAL_INT32(0, wifi->getDriftPpm());
+
+    // One hour later NTP is 36 ms ahead of the local clock: 10 ppm slow
+    host::advance(3600000);
+    host::sntpSync(epochMs + millis() + 36);
+    wifi->update();
+    TEST_ASSERT_EQUAL_INT32(36, wifi->getLastClockError());
+    TEST_ASSERT_EQUAL_INT32(10, wifi->getDriftPpm());
+}
+
+void test_sync_reported_between_updates_is_consumed_once(void) {
+    TEST_ASSERT_TRUE(connect());
+    wifi->syncTime();
+    host::sntpSync(1767225600000ULL);
+    host::sntpSync(1767225600000ULL + 5);  // Only the newest one is evaluated
+    wifi->update();
+    wifi->update();
+    TEST_ASSERT_TRUE(wifi->isTimeSynced());
+    TEST_ASSERT_EQUAL_UINT32(1767225600, (uint32_t)wifi->getLastSyncTime());
+    TEST_ASSERT_EQUAL_INT32(0, wifi->getLastClockError());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fresh_cached_lease_skips_scan_and_dhcp);
+    RUN_TEST(test_expired_lease_falls_back_to_dhcp);
+    RUN_TEST(test_lease_age_unknown_after_power_cycle);
+    RUN_TEST(test_lease_obtained_before_time_sync_is_not_reused);
+    RUN_TEST(test_moved_access_point_falls_back_to_scan);
+    RUN_TEST(test_sntp_resync_measures_clock_drift);
+    RUN_TEST(test_sync_reported_between_updates_is_consumed_once);
+    return UNITY_END();
+}
@@ -0,0 +1,20 @@
+#ifndef CREDENTIALS_H
+#define CREDENTIALS_H
+
+// Stand-in for src/credentials.h when building the load generator on the host:
+// virtual devices report network 0, the target comes from --url
+
+struct WiFiNetwork {
+    const char* ssid;
+    const char* password;
+};
+
+const WiFiNetwork WIFI_NETWORKS[] = {
+    {"loadgen", ""}
+};
+
+const int WIFI_NETWORKS_COUNT = sizeof(WIFI_NETWORKS) / sizeof(WiFiNetwork);
+
+#define WEBHOOK_URL "http://127.0.0.1:18080/webhook/loadgen"
+
+#endif // CREDENTIALS_H
@@ -0,0 +1,820 @@
+/**
+ * Fleet load generator and ingest sink for the webhook pipeline (host tool).
+ *
+ * Simulates many readers posting the same payloads as the firmware: events are
+ * PollEvent records encoded by the firmware's own code (event_json.cpp,
+ * msgpack_encoder.cpp). Each virtual device has its own device ID and tags, and
+ * alternates insert/removal with exponentially distributed dwell times.
+ *
+ *   loadgen --devices 300 --duration 60 --mode batch
+ *       Benchmarks against a built-in sink that appends every body to loadgen_sink.log
+ *   loadgen --url http://n8n:5678/webhook/x --devices 100 --mode retry
+ *       Drives a real pipeline
+ *   loadgen --sink 8080 --out bodies.log --fail-rate 0.05
+ *       Runs only the sink, e.g. on another machine
+ *
+ * Delivery modes:
+ *   single  one rfid_poll_result per request, failed events are dropped
+ *   batch   rfid_poll_results arrays (--batch events or --window ms), failed batches are dropped
+ *   retry   single, but failed events stay queued and are retried with the firmware's
+ *           backoff schedule (WEBHOOK_RETRY_BASE_DELAY..WEBHOOK_RETRY_MAX_DELAY, equal jitter)
+ *
+ * Build: pio run -e loadgen (see platformio.ini), then run .pio/build/loadgen/program
+ */
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ArduinoJson.h>
+#include "config.h"
+#include "event_json.h"
+#include "msgpack_encoder.h"
+#include "poll_event.h"
+
+using Clock = std::chrono::steady_clock;
+
+enum DeliveryMode { MODE_SINGLE, MODE_BATCH, MODE_RETRY };
+
+struct Options {
+    std::string url;                // Empty: start the built-in sink and target it
+    int devices = 100;
+    int threads = 8;                // Each worker owns devices/threads devices and one keep-alive connection
+    double duration = 30;           // s
+    DeliveryMode mode = MODE_SINGLE;
+    bool msgpack = false;
+    bool sessions = false;          // SESSION_MODE payloads instead of insert/removal pairs
+    int batch = 20;                 // Max events per batch request
+    int window = WEBHOOK_BATCH_WINDOW;  // ms to wait for a batch to fill
+    double speedup = 60;            // Simulated seconds per real second
+    double presentMean = 25 * 60;   // s, simulated time a tag stays on the reader
+    double absentMean = 10 * 60;    // s, simulated time between tags
+    int timeout = HTTP_TIMEOUT;     // ms
+    unsigned seed = 1;
+
+    // Sink
+    bool sinkOnly = false;
+    int sinkPort = 0;
+    std::string sinkOut = "loadgen_sink.log";
+    double failRate = 0;            // Share of requests the sink answers with 503
+    int sinkDelay = 0;              // ms added to every sink response
+};
+
+// ---------------------------------------------------------------------------
+// Statistics
+
+struct Stats {
+    std::mutex lock;
+    std::vector<double> latencies;  // ms, successful requests
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> ok{0};
+    std::atomic<uint64_t> connectErrors{0};
+    std::atomic<uint64_t> http4xx{0};
+    std::atomic<uint64_t> http5xx{0};
+    std::atomic<uint64_t> eventsGenerated{0};
+    std::atomic<uint64_t> eventsDelivered{0};
+    std::atomic<uint64_t> eventsDropped{0};
+    std::atomic<uint64_t> eventsQueued{0};  // Not yet sent when the run ended
+    std::atomic<uint64_t> retries{0};
+    std::atomic<uint64_t> bytesSent{0};
+
+    void addLatency(double ms) {
+        std::lock_guard<std::mutex> guard(lock);
+        latencies.push_back(ms);
+    }
+};
+
+static double percentile(std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = (size_t)std::ceil(p / 100.0 * sorted.size());
+    return sorted[std::min(sorted.size() - 1, index > 0 ? index - 1 : 0)];
+}
+
+// ---------------------------------------------------------------------------
+// Minimal HTTP/1.1 over one keep-alive connection, like the firmware's transport
+
+struct Url {
+    std::string host;
+    int port = 80;
+    std::string path = "/";
+};
+
+static bool parseUrl(const std::string& text, Url& url) {
+    const std::string scheme = "http://";
+    if (text.compare(0, scheme.size(), scheme) != 0) {
+        return false;
+    }
+    std::string rest = text.substr(scheme.size());
+    size_t slash = rest.find('/');
+    std::string hostPort = rest.substr(0, slash);
+    url.path = slash == std::string::npos ? "/" : rest.substr(slash);
+    size_t colon = hostPort.find(':');
+    url.host = hostPort.substr(0, colon);
+    url.port = colon == std::string::npos ? 80 : atoi(hostPort.c_str() + colon + 1);
+    return !url.host.empty() && url.port > 0;
+}
+
+static void setTimeout(int fd, int timeoutMs) {
+    timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static bool sendAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+// Reads one HTTP message (headers and Content-Length or chunked body) from buffered socket data
+class HttpReader {
+    private:
+        int fd;
+        std::string buffer;
+
+        bool fill() {
+            char chunk[4096];
+            ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                return false;
+            }
+            buffer.append(chunk, received);
+            return true;
+        }
+
+        bool readLine(std::string& line) {
+            size_t end;
+            while ((end = buffer.find("\r\n")) == std::string::npos) {
+                if (!fill()) {
+                    return false;
+                }
+            }
+            line = buffer.substr(0, end);
+            buffer.erase(0, end + 2);
+            return true;
+        }
+
+        bool readBytes(size_t length, std::string& out) {
+            while (buffer.size() < length) {
+                if (!fill()) {
+                    return false;
+                }
+            }
+            out.append(buffer, 0, length);
+            buffer.erase(0, length);
+            return true;
+        }
+
+    public:
+        explicit HttpReader(int fd) : fd(fd) {}
+
+        // startLine is the status or request line; headers are lowercased for lookup
+        bool read(std::string& startLine, std::string& headers, std::string& body) {
+            headers.clear();
+            body.clear();
+            if (!readLine(startLine)) {
+                return false;
+            }
+            std::string line;
+            long contentLength = 0;
+            bool chunked = false;
+            while (readLine(line) && !line.empty()) {
+                std::transform(line.begin(), line.end(), line.begin(), ::tolower);
+                if (line.compare(0, 15, "content-length:") == 0) {
+                    contentLength = atol(line.c_str() + 15);
+                } else if (line.compare(0, 18, "transfer-encoding:") == 0 && line.find("chunked") != std::string::npos) {
+                    chunked = true;
+                }
+                headers += line + "\n";
+            }
+            if (!chunked) {
+                return readBytes(contentLength, body);
+            }
+            for (;;) {
+                if (!readLine(line)) {
+                    return false;
+                }
+                size_t size = strtoul(line.c_str(), nullptr, 16);
+                if (size == 0) {
+                    return readLine(line);  // Trailing CRLF
+                }
+                std::string crlf;
+                if (!readBytes(size, body) || !readBytes(2, crlf)) {
+                    return false;
+                }
+            }
+        }
+};
+
+class HttpConnection {
+    private:
+        Url url;
+        int timeoutMs;
+        int fd = -1;
+        HttpReader* reader = nullptr;
+
+        bool connectSocket() {
+            addrinfo hints;
+            memset(&hints, 0, sizeof(hints));
+            hints.ai_family = AF_INET;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* result = nullptr;
+            if (getaddrinfo(url.host.c_str(), std::to_string(url.port).c_str(), &hints, &result) != 0) {
+                return false;
+            }
+            fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+            bool connected = fd >= 0 && ::connect(fd, result->ai_addr, result->ai_addrlen) == 0;
+            freeaddrinfo(result);
+            if (!connected) {
+                close();
+                return false;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            setTimeout(fd, timeoutMs);
+            reader = new HttpReader(fd);
+            return true;
+        }
+
+    public:
+        HttpConnection(const Url& url, int timeoutMs) : url(url), timeoutMs(timeoutMs) {}
+        ~HttpConnection() { close(); }
+
+        void close() {
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+            delete reader;
+            reader = nullptr;
+        }
+
+        // Returns the HTTP status, or -1 if no response arrived
+        int post(const char* contentType, const char* body, size_t length) {
+            std::string request = "POST " + url.path + " HTTP/1.1\r\nHost: " + url.host +
+                                  "\r\nContent-Type: " + contentType +
+                                  "\r\nContent-Length: " + std::to_string(length) +
+                                  "\r\nConnection: keep-alive\r\n\r\n";
+
+            // A kept-alive connection may have been closed by the server; retry once on a fresh one
+            for (int attempt = 0; attempt < 2; attempt++) {
+                bool reused = fd >= 0;
+                if (!reused && !connectSocket()) {
+                    return -1;
+                }
+                std::string status;
+                std::string headers;
+                std::string response;
+                if (sendAll(fd, request.data(), request.size()) && sendAll(fd, body, length) &&
+                    reader->read(status, headers, response)) {
+                    if (headers.find("connection: close") != std::string::npos) {
+                        close();
+                    }
+                    size_t space = status.find(' ');
+                    return space == std::string::npos ? -1 : atoi(status.c_str() + space + 1);
+                }
+                close();
+                if (!reused) {
+                    break;
+                }
+            }
+            return -1;
+        }
+};
+
+// ---------------------------------------------------------------------------
+// Ingest sink: answers every POST and appends its body to a file
+
+struct Sink {
+    const Options& options;
+    int listenFd = -1;
+    std::mutex fileLock;
+    FILE* out = nullptr;
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> bytes{0};
+
+    explicit Sink(const Options& options) : options(options) {}
+
+    bool start(int port) {
+        out = fopen(options.sinkOut.c_str(), "a");
+        if (out == nullptr) {
+            fprintf(stderr, "Cannot open %s\n", options.sinkOut.c_str());
+            return false;
+        }
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        if (bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, 1024) != 0) {
+            fprintf(stderr, "Cannot listen on port %d\n", port);
+            return false;
+        }
+        std::thread([this]() { acceptLoop(); }).detach();
+        return true;
+    }
+
+    void acceptLoop() {
+        for (;;) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                continue;
+            }
+            std::thread([this, fd]() { serve(fd); }).detach();
+        }
+    }
+
+    void store(const std::string& headers, const std::string& body) {
+        std::lock_guard<std::mutex> guard(fileLock);
+        if (headers.find("content-type: application/json") != std::string::npos) {
+            fwrite(body.data(), 1, body.size(), out);
+        } else {
+            // MessagePack: one hex line per body
+            for (unsigned char c : body) {
+                fprintf(out, "%02x", c);
+            }
+        }
+        fputc('\n', out);
+        fflush(out);
+    }
+
+    void serve(int fd) {
+        std::mt19937 random(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        std::uniform_real_distribution<double> uniform(0, 1);
+        HttpReader reader(fd);
+        std::string requestLine;
+        std::string headers;
+        std::string body;
+        while (reader.read(requestLine, headers, body)) {
+            requests++;
+            bytes += body.size();
+            if (options.sinkDelay > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.sinkDelay));
+            }
+            const char* response;
+            if (uniform(random) < options.failRate) {
+                failed++;
+                response = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+            } else {
+                store(headers, body);
+                response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 2\r\n\r\n{}";
+            }
+            if (!sendAll(fd, response, strlen(response))) {
+                break;
+            }
+        }
+        close(fd);
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Virtual devices
+
+struct VirtualDevice {
+    char id[16];                    // "NFC_%06X", like getDeviceId()
+    uint8_t tags[3][MAX_UID_LENGTH];
+    uint8_t tagLengths[3];
+    int currentTag = -1;            // -1 while no tag is present
+    Clock::time_point nextChange;
+    Clock::time_point presentSince;
+    uint64_t presentSinceEpochMs = 0;
+
+    std::deque<PollEvent> pending;  // Generated, not yet delivered
+    Clock::time_point batchStarted;
+    uint32_t retryAttempt = 0;
+    Clock::time_point nextRetry;
+};
+
+class Worker {
+    private:
+        const Options& options;
+        Stats& stats;
+        HttpConnection connection;
+        std::vector<VirtualDevice> devices;
+        std::mt19937_64 random;
+        StaticJsonDocument<2 * WEBHOOK_BATCH_MAX_BYTES> doc;
+        char payload[WEBHOOK_BATCH_MAX_BYTES + 1];
+
+        static uint64_t epochMs() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        Clock::duration dwell(double meanSeconds) {
+            std::exponential_distribution<double> exponential(1.0 / meanSeconds);
+            double realSeconds = exponential(random) / options.speedup;
+            return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(realSeconds));
+        }
+
+        // Same schedule as retryBackoffDelay(): exponential, capped, upper half randomized
+        Clock::duration backoff(uint32_t attempt) {
+            unsigned long delay = WEBHOOK_RETRY_BASE_DELAY;
+            while (attempt-- > 1 && delay < WEBHOOK_RETRY_MAX_DELAY) {
+                delay *= 2;
+            }
+            delay = std::min(delay, (unsigned long)WEBHOOK_RETRY_MAX_DELAY);
+            std::uniform_int_distribution<unsigned long> jitter(0, delay / 2);
+            return std::chrono::milliseconds(delay / 2 + jitter(random));
+        }
+
+        void changePresence(VirtualDevice& device, Clock::time_point now) {
+            PollEvent event;
+            memset(&event, 0, sizeof(event));
+            event.epochMs = epochMs();
+            event.timeSynced = true;
+            event.networkIndex = 0;
+            event.rssi = -40 - (int8_t)(random() % 40);
+
+            if (device.currentTag < 0) {
+                device.currentTag = random() % 3;
+                device.presentSince = now;
+                device.presentSinceEpochMs = event.epochMs;
+                device.nextChange = now + dwell(options.presentMean);
+                if (options.sessions) {
+                    return;  // Sessions are only sent when they end
+                }
+                event.tagPresent = true;
+            } else {
+                device.nextChange = now + dwell(options.absentMean);
+                if (options.sessions) {
+                    event.kind = EVENT_SESSION;
+                    event.epochMs = device.presentSinceEpochMs;
+                    event.durationMs = (uint32_t)(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                      now - device.presentSince).count() * options.speedup);
+                }
+            }
+            int tag = device.currentTag;
+            memcpy(event.uid, device.tags[tag], device.tagLengths[tag]);
+            event.uidLength = device.tagLengths[tag];
+            event.tagType = detectTagType(event.uidLength);
+            if (!event.tagPresent) {
+                device.currentTag = -1;
+            }
+
+            if (device.pending.empty()) {
+                device.batchStarted = now;
+            }
+            device.pending.push_back(event);
+            stats.eventsGenerated++;
+        }
+
+        bool readyToSend(const VirtualDevice& device, Clock::time_point now) const {
+            if (device.pending.empty()) {
+                return false;
+            }
+            switch (options.mode) {
+                case MODE_BATCH:
+                    return (int)device.pending.size() >= options.batch ||
+                           now - device.batchStarted >= std::chrono::milliseconds(options.window);
+                case MODE_RETRY:
+                    return device.retryAttempt == 0 || now >= device.nextRetry;
+                default:
+                    return true;
+            }
+        }
+
+        void send(VirtualDevice& device, Clock::time_point now) {
+            std::vector<PollEvent> events(device.pending.begin(), device.pending.end());
+            size_t count = options.mode == MODE_BATCH ? std::min(events.size(), (size_t)options.batch) : 1;
+            size_t packed = 0;
+            size_t length;
+            if (options.msgpack) {
+                length = encodeEventsMsgPack(events.data(), count, device.id,
+                                             reinterpret_cast<uint8_t*>(payload), WEBHOOK_BATCH_MAX_BYTES, packed);
+            } else {
+                length = encodeEventsJson(doc, events.data(), count, device.id, options.mode == MODE_BATCH,
+                                          WEBHOOK_BATCH_MAX_BYTES, payload, sizeof(payload), packed);
+            }
+            if (length == 0 || packed == 0) {
+                fprintf(stderr, "Encoding failed for %s\n", device.id);
+                device.pending.clear();
+                return;
+            }
+
+            Clock::time_point start = Clock::now();
+            int status = connection.post(options.msgpack ? "application/msgpack" : "application/json",
+                                         payload, length);
+            double latency = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            stats.requests++;
+            stats.bytesSent += length;
+            bool success = status >= 200 && status < 300;
+            if (success) {
+                stats.ok++;
+                stats.addLatency(latency);
+                stats.eventsDelivered += packed;
+            } else if (status < 0) {
+                stats.connectErrors++;
+            } else if (status < 500) {
+                stats.http4xx++;
+            } else {
+                stats.http5xx++;
+            }
+
+            if (success || options.mode != MODE_RETRY) {
+                if (!success) {
+                    stats.eventsDropped += packed;
+                }
+                device.pending.erase(device.pending.begin(), device.pending.begin() + packed);
+                device.retryAttempt = 0;
+                device.batchStarted = now;
+                return;
+            }
+
+            // Keep the events, like the journal does, and back off
+            device.retryAttempt++;
+            device.nextRetry = Clock::now() + backoff(device.retryAttempt);
+            stats.retries++;
+        }
+
+    public:
+        Worker(const Options& options, Stats& stats, const Url& url, int firstDevice, int deviceCount, unsigned seed)
+            : options(options), stats(stats), connection(url, options.timeout), random(seed) {
+            Clock::time_point now = Clock::now();
+            for (int i = 0; i < deviceCount; i++) {
+                VirtualDevice device;
+                snprintf(device.id, sizeof(device.id), "NFC_%06X", (unsigned)(0x100000 + firstDevice + i));
+                for (int tag = 0; tag < 3; tag++) {
+                    device.tagLengths[tag] = random() % 2 ? 4 : 7;
+                    for (int b = 0; b < MAX_UID_LENGTH; b++) {
+                        device.tags[tag][b] = (uint8_t)random();
+                    }
+                }
+                // Spread the first taps so devices do not start in lockstep
+                device.nextChange = now + dwell(options.absentMean);
+                devices.push_back(device);
+            }
+        }
+
+        void run(Clock::time_point end) {
+            while (Clock::now() < end) {
+                Clock::time_point now = Clock::now();
+                Clock::time_point wake = end;
+                for (VirtualDevice& device : devices) {
+                    if (now >= device.nextChange) {
+                        changePresence(device, now);
+                    }
+                    if (readyToSend(device, now)) {
+                        send(device, now);
+                        now = Clock::now();
+                    }
+                    wake = std::min(wake, device.nextChange);
+                    if (!device.pending.empty()) {
+                        if (options.mode == MODE_BATCH) {
+                            wake = std::min(wake, device.batchStarted + std::chrono::milliseconds(options.window));
+                        } else if (options.mode == MODE_RETRY && device.retryAttempt > 0) {
+                            wake = std::min(wake, device.nextRetry);
+                        } else {
+                            wake = now;
+                        }
+                    }
+                }
+                if (wake > now) {
+                    std::this_thread::sleep_until(wake);
+                }
+            }
+            for (const VirtualDevice& device : devices) {
+                stats.eventsQueued += device.pending.size();
+            }
+        }
+};
+
+// ---------------------------------------------------------------------------
+
+static void usage() {
+    printf("Usage: loadgen [options]\n"
+           "  --url URL          webhook to load (default: built-in sink on --sink-port or 18080)\n"
+           "  --devices N        virtual devices (default 100)\n"
+           "  --threads N        worker threads, one connection each (default 8)\n"
+           "  --duration S       run time in seconds (default 30)\n"
+           "  --mode M           single | batch | retry (default single)\n"
+           "  --batch N          max events per batch request (default 20)\n"
+           "  --window MS        batch fill window (default WEBHOOK_BATCH_WINDOW)\n"
+           "  --msgpack          MessagePack payloads instead of JSON\n"
+           "  --sessions         session payloads (SESSION_MODE) instead of insert/removal\n"
+           "  --speedup X        simulated seconds per real second (default 60)\n"
+           "  --present-mean S   mean simulated time a tag stays (default 1500)\n"
+           "  --absent-mean S    mean simulated time between tags (default 600)\n"
+           "  --timeout MS       request timeout (default HTTP_TIMEOUT)\n"
+           "  --seed N           random seed (default 1)\n"
+           "Sink:\n"
+           "  --sink PORT        only run the sink on PORT\n"
+           "  --sink-port PORT   port of the built-in sink (default 18080)\n"
+           "  --out FILE         file the sink appends bodies to (default loadgen_sink.log)\n"
+           "  --fail-rate P      share of requests answered with 503 (default 0)\n"
+           "  --sink-delay MS    delay before every sink response (default 0)\n");
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool takesValue = true;
+        if (arg == "--msgpack") {
+            options.msgpack = true;
+            takesValue = false;
+        } else if (arg == "--sessions") {
+            options.sessions = true;
+            takesValue = false;
+        } else if (arg == "--help") {
+            return false;
+        } else if (value == nullptr) {
+            fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        } else if (arg == "--url") {
+            options.url = value;
+        } else if (arg == "--devices") {
+            options.devices = atoi(value);
+        } else if (arg == "--threads") {
+            options.threads = atoi(value);
+        } else if (arg == "--duration") {
+            options.duration = atof(value);
+        } else if (arg == "--mode") {
+            std::string mode = value;
+            if (mode == "single") {
+                options.mode = MODE_SINGLE;
+            } else if (mode == "batch") {
+                options.mode = MODE_BATCH;
+            } else if (mode == "retry") {
+                options.mode = MODE_RETRY;
+            } else {
+                fprintf(stderr, "Unknown mode %s\n", value);
+                return false;
+            }
+        } else if (arg == "--batch") {
+            options.batch = atoi(value);
+        } else if (arg == "--window") {
+            options.window = atoi(value);
+        } else if (arg == "--speedup") {
+            options.speedup = atof(value);
+        } else if (arg == "--present-mean") {
+            options.presentMean = atof(value);
+        } else if (arg == "--absent-mean") {
+            options.absentMean = atof(value);
+        } else if (arg == "--timeout") {
+            options.timeout = atoi(value);
+        } else if (arg == "--seed") {
+            options.seed = (unsigned)atoi(value);
+        } else if (arg == "--sink") {
+            options.sinkOnly = true;
+            options.sinkPort = atoi(value);
+        } else if (arg == "--sink-port") {
+            options.sinkPort = atoi(value);
+        } else if (arg == "--out") {
+            options.sinkOut = value;
+        } else if (arg == "--fail-rate") {
+            options.failRate = atof(value);
+        } else if (arg == "--sink-delay") {
+            options.sinkDelay = atoi(value);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+        if (takesValue) {
+            i++;
+        }
+    }
+    return options.devices > 0 && options.threads > 0 && options.duration > 0 && options.batch > 0 &&
+           options.speedup > 0 && options.presentMean > 0 && options.absentMean > 0;
+}
+
+static const char* modeName(DeliveryMode mode) {
+    static const char* names[] = { "single", "batch", "retry" };
+    return names[mode];
+}
+
+static void report(const Options& options, Stats& stats, double elapsed, const Sink* sink) {
+    std::vector<double> latencies;
+    {
+        std::lock_guard<std::mutex> guard(stats.lock);
+        latencies = stats.latencies;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    uint64_t requests = stats.requests;
+    uint64_t errors = stats.connectErrors + stats.http4xx + stats.http5xx;
+
+    printf("\n--- Load Test Report ---\n");
+    printf("Mode: %s, %s%s, %d devices, %.0f s, speedup %.0fx\n", modeName(options.mode),
+           options.msgpack ? "MessagePack" : "JSON", options.sessions ? " sessions" : "",
+           options.devices, elapsed, options.speedup);
+    printf("Events: %llu generated, %llu delivered, %llu dropped, %llu still queued\n",
+           (unsigned long long)stats.eventsGenerated.load(), (unsigned long long)stats.eventsDelivered.load(),
+           (unsigned long long)stats.eventsDropped.load(), (unsigned long long)stats.eventsQueued.load());
+    printf("Requests: %llu, OK: %llu, Errors: %llu (%.2f%%: connect %llu, 4xx %llu, 5xx %llu), Retries: %llu\n",
+           (unsigned long long)requests, (unsigned long long)stats.ok.load(), (unsigned long long)errors,
+           requests > 0 ? 100.0 * errors / requests : 0.0, (unsigned long long)stats.connectErrors.load(),
+           (unsigned long long)stats.http4xx.load(), (unsigned long long)stats.http5xx.load(),
+           (unsigned long long)stats.retries.load());
+    printf("Throughput: %.1f requests/s, %.1f events/s, %.1f KB/s (%.0f bytes/request)\n",
+           requests / elapsed, stats.eventsDelivered / elapsed, stats.bytesSent / elapsed / 1024,
+           requests > 0 ? (double)stats.bytesSent / requests : 0.0);
+    printf("Latency (ms): p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n",
+           percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99),
+           latencies.empty() ? 0.0 : latencies.back());
+    if (sink != nullptr) {
+        printf("Sink: %llu requests, %llu answered 503, %llu bytes stored in %s\n",
+               (unsigned long long)sink->requests.load(), (unsigned long long)sink->failed.load(),
+               (unsigned long long)sink->bytes.load(), options.sinkOut.c_str());
+    }
+    printf("--- End Load Test Report ---\n");
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    // Sink only
+    if (options.sinkOnly) {
+        Sink sink(options);
+        if (!sink.start(options.sinkPort)) {
+            return 1;
+        }
+        printf("Sink listening on port %d, appending to %s\n", options.sinkPort, options.sinkOut.c_str());
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::seconds(10));
+            printf("Sink: %llu requests, %llu answered 503\n", (unsigned long long)sink.requests.load(),
+                   (unsigned long long)sink.failed.load());
+        }
+    }
+
+    // Built-in sink unless a URL was given
+    Sink* sink = nullptr;
+    if (options.url.empty()) {
+        int port = options.sinkPort != 0 ? options.sinkPort : 18080;
+        sink = new Sink(options);
+        if (!sink->start(port)) {
+            return 1;
+        }
+        options.url = "http://127.0.0.1:" + std::to_string(port) + "/webhook/loadgen";
+    }
+    Url url;
+    if (!parseUrl(options.url, url)) {
+        fprintf(stderr, "Only http://host[:port]/path URLs are supported\n");
+        return 1;
+    }
+
+    printf("Loading %s with %d devices on %d threads for %.0f s...\n", options.url.c_str(), options.devices,
+           options.threads, options.duration);
+    Stats stats;
+    std::vector<std::thread> threads;
+    std::vector<Worker*> workers;
+    int threadCount = std::min(options.threads, options.devices);
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(
+                                        std::chrono::duration<double>(options.duration));
+    int firstDevice = 0;
+    for (int i = 0; i < threadCount; i++) {
+        int deviceCount = options.devices / threadCount + (i < options.devices % threadCount ? 1 : 0);
+        workers.push_back(new Worker(options, stats, url, firstDevice, deviceCount, options.seed * 7919 + i));
+        firstDevice += deviceCount;
+    }
+    for (Worker* worker : workers) {
+        threads.emplace_back([worker, end]() { worker->run(end); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    report(options, stats, elapsed, sink);
+    for (Worker* worker : workers) {
+        delete worker;
+    }
+    return stats.ok > 0 ? 0 : 2;
+}